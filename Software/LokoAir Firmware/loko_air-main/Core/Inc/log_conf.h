@@ -24,9 +24,25 @@
     Use queue in interrupts, message will printed during with
     next log or by calling log_flush_isr_queue()
 */
-#define LOG_ISR_QUEUE (0U)
+#define LOG_ISR_QUEUE (1U)
+
+/*
+    Records in the interrupt queue, power of two. Each one keeps up to LOG_ISR_ARGS_SIZE bytes of arguments
+*/
+#define LOG_ISR_QUEUE_SIZE (8U)
 
 /*
    Internal buffer size
 */
-#define LOG_MAX_MESSAGE_LENGTH (128U)
\ No newline at end of file
+#define LOG_MAX_MESSAGE_LENGTH (128U)
+
+/*
+    Binary mode: message id, timestamp and raw arguments go to a RAM ring, log_process() writes them out.
+    No formatting on the target, tools/log-decoder.py prints the text. 0 - text mode
+*/
+#define LOG_BINARY_ENABLED (0U)
+
+/*
+    Binary ring size, power of two
+*/
+#define LOG_BINARY_RING_SIZE (1024U)
\ No newline at end of file
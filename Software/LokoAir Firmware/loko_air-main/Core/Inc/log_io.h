@@ -45,8 +45,7 @@ static inline log_timestamp_t _get_ts(void) {
 #    if LOG_ISR_QUEUE == 1U
 
 static bool _is_isr(void) {
-    // There is template, just add your implementation
-    return false;
+    return bsp_is_isr();
 }
 
 #    endif  // LOG_ISR_QUEUE == 1U
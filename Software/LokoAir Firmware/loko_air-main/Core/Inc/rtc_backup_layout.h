@@ -0,0 +1,38 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* RTC backup registers survive shutdown, but they are cleared on power loss or backup domain reset */
+
+/* DR0..DR2 belong to timer_if.c, SysTime keeps the seconds, the subseconds and the MSB of the RTC ticks there. The
+ * LoRaWAN stack rewrites them on every start and on the ClockSync corrections, so the application ones go above */
+#define RTC_BACKUP_REG_SYSTIME_COUNT (3U)
+
+/* Bootloaders released before the split read the mailbox from DR0, the application mirrors its request there */
+#define RTC_BACKUP_REG_MAILBOX_LEGACY (0U)
+
+#define RTC_BACKUP_REG_MAILBOX                 (3U)  /*<! Inter target mailbox */
+#define RTC_BACKUP_REG_GNSS_TRACE_WAKEUPS      (4U)  /*<! Wakeups since the fix was written to the GNSS trace */
+#define RTC_BACKUP_REG_AIRTIME_SIGNATURE       (5U)  /*<! Airtime ledger signature and band index */
+#define RTC_BACKUP_REG_AIRTIME_BUCKET_MS       (6U)  /*<! Airtime charged in the duty cycle bucket */
+#define RTC_BACKUP_REG_AIRTIME_SLEEP_S         (7U)  /*<! Shutdown duration programmed before the last shutdown */
+#define RTC_BACKUP_REG_AIRTIME_TOTAL_MS        (8U)  /*<! Total airtime since the ledger reset */
+#define RTC_BACKUP_REG_AIRTIME_TX_COUNT        (9U)  /*<! Transmission counter since the ledger reset */
+#define RTC_BACKUP_REG_AIRTIME_DEFERRED_COUNT  (10U) /*<! Deferred transmission counter since the ledger reset */
+#define RTC_BACKUP_REG_P2P_COUNTER_SIGNATURE   (11U) /*<! Encrypted P2P packet counter signature */
+#define RTC_BACKUP_REG_P2P_COUNTER             (12U) /*<! Last encrypted P2P packet counter (CTR nonce) */
+#define RTC_BACKUP_REG_BLDR_APP_SEAL           (13U) /*<! Bootloader seal of the verified application image */
+#define RTC_BACKUP_REG_LORAWAN_LINK_FAILS      (14U) /*<! Consecutive failed LoRaWAN link checks */
+#define RTC_BACKUP_REG_LORAWAN_SENT_FIX_S      (15U) /*<! Time of the newest fix sent by LoRaWAN, seconds since 2000 */
+#define RTC_BACKUP_REG_LORAWAN_BACKOFF         (16U) /*<! LoRaWAN backoff signature and failed attempt count */
+#define RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S  (17U) /*<! Time left until the next LoRaWAN attempt */
+#define RTC_BACKUP_REG_LORAWAN_BACKOFF_SLEEP_S (18U) /*<! Shutdown duration programmed before the last shutdown */
+
+#define RTC_BACKUP_REG_APP_FIRST RTC_BACKUP_REG_MAILBOX
+#define RTC_BACKUP_REG_COUNT     (19U)
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -4,6 +4,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -25,9 +26,16 @@ typedef enum {
     SUBGHZ_APP_RESULT_ERROR,
 } app_lora_result_t;
 
+/* Called once per subghz_radio_send_async(), from radio IRQ (TxDone/TxTimeout) or from subghz_radio_process() */
+typedef void (*subghz_radio_tx_done_cb_t)(app_lora_result_t result);
+
 void subghz_radio_init(app_lora_params_t *params);
 void subghz_radio_deinit(void);
 app_lora_result_t subghz_radio_send_block(const uint8_t *data, size_t size);
+app_lora_result_t subghz_radio_send_async(const uint8_t *data, size_t size, subghz_radio_tx_done_cb_t cb);
+bool subghz_radio_is_busy(void);
+void subghz_radio_process(void);
+uint32_t subghz_radio_get_time_on_air_ms(size_t size);
 
 #ifdef __cplusplus
 }
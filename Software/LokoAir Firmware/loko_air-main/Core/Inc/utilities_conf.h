@@ -34,6 +34,9 @@ extern "C" {
     __disable_irq()
 #define UTILS_EXIT_CRITICAL_SECTION() __set_PRIMASK(primask_bit)
 
+/* LoRaWAN packages use the ST memory utility, it is not a part of the project */
+#define UTIL_MEM_set_8(dst, value, size) memset((dst), (value), (size))
+
 #ifdef __cplusplus
 }
 #endif
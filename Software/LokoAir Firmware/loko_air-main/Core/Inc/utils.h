@@ -5,6 +5,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 /* Includes ------------------------------------------------------------------*/
+#include <rtc_backup_layout.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -58,12 +59,20 @@ extern "C" {
 #endif  // IS_ODD
 
 #define INTER_TARGET_MAILBOX_CMD_STAY_IN_BOOTLOADER 0x01020304UL
-#define INTER_TARGET_MAILBOX_SEND(message)   \
-    do {                                     \
-        bsp_rtc_store_write_reg(0, message); \
+#define INTER_TARGET_MAILBOX_SEND(message)                        \
+    do {                                                          \
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_MAILBOX, message); \
     } while (0)
 
-#define INTER_TARGET_MAILBOX_GET() bsp_rtc_store_read_reg(0)
+#define INTER_TARGET_MAILBOX_GET() bsp_rtc_store_read_reg(RTC_BACKUP_REG_MAILBOX)
+
+/* DR0 belongs to SysTime, it is written right before the reset only and the bootloader clears it */
+#define INTER_TARGET_MAILBOX_SEND_LEGACY(message)                        \
+    do {                                                                 \
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_MAILBOX_LEGACY, message); \
+    } while (0)
+
+#define INTER_TARGET_MAILBOX_GET_LEGACY() bsp_rtc_store_read_reg(RTC_BACKUP_REG_MAILBOX_LEGACY)
 
 #ifdef __cplusplus
 }
@@ -3,19 +3,29 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "Crypto/lorawan_aes.h"
 #include "subghz_phy_app.h"
+#include <airtime/airtime.h>
+#include <blackbox/blackbox.h>
 #include <bsp.h>
 #include <cayenne_lpp_c.h>
 #include <cmd_line/cmd_line.h>
+#include <crc16.h>
 #include <encrypt_p2p_payload/encrypt_p2p_payload.h>
+#include <event/event.h>
 #include <gnss_trace/gnss_trace.h>
 #include <log_io.h>
 #include <lorawan_app/lora_app.h>
+#include <lorawan_backoff/lorawan_backoff.h>
 #include <lwgps.h>
 #include <math.h>
+#include <profile/profile.h>
 #include <queue/queue.h>
+#include <rtc_backup_layout.h>
 #include <settings/settings.h>
 #include <settings_io.h>
+#include <stats/stats.h>
+#include <track_codec/track_codec.h>
 #include <utils.h>
 #include <version.h>
 
@@ -27,6 +37,8 @@ typedef struct send_gnss_data_s {
     double lon;
     uint16_t alt;
     uint16_t speed_mps;
+    uint32_t time_s; /*<! Seconds since 2000-01-01, 0 when unknown */
+    uint8_t quality; /*<! TRACK_CODEC_QUALITY_* bits, 0 for a fix restored from the GNSS trace */
 } send_gnss_data_t;
 
 typedef enum {
@@ -34,10 +46,31 @@ typedef enum {
     SYSTEM_STATE_TICKLE_CHARGE_MODE,
     SYSTEM_STATE_WAIT_FOR_GPS_FIX,
     SYSTEM_STATE_SEND_DATA,
+    SYSTEM_STATE_WAIT_FOR_TX_DONE,
     SYSTEM_STATE_SHUTDOWN,
     SYSTEM_STATE_SHUTDOWN_CHARGING,
 } system_state_t;
 
+STATIC_ASSERT((SYSTEM_STATE_SHUTDOWN_CHARGING + 1) == BLACKBOX_STATE_COUNT);
+STATIC_ASSERT((STATS_COUNTER_STATE_INIT_MS + SYSTEM_STATE_SHUTDOWN_CHARGING) == STATS_COUNTER_STATE_CHARGING_MS);
+
+typedef enum {
+    APP_TIMER_STATE,     /*<! Timeout or poll period of the current state */
+    APP_TIMER_GNSS_MODE, /*<! Acknowledge of the GNSS mode command */
+    APP_TIMER_BUTTON,    /*<! Button hold indication */
+    APP_TIMER_COUNT,
+} app_timer_t;
+
+STATIC_ASSERT(APP_TIMER_COUNT <= EVENT_TIMER_COUNT);
+
+/* LoRaWAN steps of SYSTEM_STATE_WAIT_FOR_TX_DONE */
+typedef enum {
+    LORAWAN_PHASE_JOIN,   /*<! Waiting for the join or the link check of the restored session */
+    LORAWAN_PHASE_UPLINK, /*<! Waiting for the uplink confirm */
+    LORAWAN_PHASE_LINGER, /*<! Stack is kept running after the uplink, for the FUOTA session too */
+    LORAWAN_PHASE_DEINIT, /*<! Waiting for the stack to stop */
+} lorawan_phase_t;
+
 typedef struct PACKED {
     uint32_t id1;
     uint32_t id2;
@@ -66,9 +99,20 @@ typedef struct PACKED {
     enc_p2p_payload_t payload;
 } __packed packet_data_encrypted_t;
 
-#define PACKET_DATA_VERSION_SHORT     (3) /* Step is 3*/
-#define PACKET_DATA_VERSION_EXTENDED  (PACKET_DATA_VERSION_SHORT + 1)
-#define PACKET_DATA_VERSION_ENCRYPTED (PACKET_DATA_VERSION_SHORT + 2)
+typedef struct PACKED {
+    uint32_t id1;
+    uint32_t id2;
+    uint8_t reserved : 4;
+    uint8_t version  : 4;
+    uint32_t counter; /* CTR nonce */
+    enc_p2p_record_t record;
+    uint8_t mac[ENC_P2P_MAC_SIZE]; /* Over all previous bytes */
+} __packed packet_data_authenticated_t;
+
+#define PACKET_DATA_VERSION_SHORT         (3) /* Step is 3*/
+#define PACKET_DATA_VERSION_EXTENDED      (PACKET_DATA_VERSION_SHORT + 1)
+#define PACKET_DATA_VERSION_ENCRYPTED     (PACKET_DATA_VERSION_SHORT + 2)
+#define PACKET_DATA_VERSION_AUTHENTICATED (PACKET_DATA_VERSION_SHORT + 3)
 
 /* -------------------------------------------------------------------------- */
 
@@ -77,9 +121,16 @@ typedef struct PACKED {
 #define BATTERY_CHECK_PERIOD_MS       (10 * 1000UL) /*<! Battery voltage checking period */
 #define BATTERY_MIN_LEVEL_FOR_GNSS_MV (3400)        /*<! GNSS Enable battery level */
 #define BATTERY_MIN_LEVEL_POWER_ON_MV (3100)        /*<! Minimal power on battery level */
-#define BSP_RTC_STORE_REG_WAKEUP      (0)           /*<! */
 #define DEBUG_PRINT_NMEA_DATA         (0)           /*<! Set 1 to see data from GNSS module */
 #define BUTTON_HOLD_TIMEOUT_MS        (3000UL)      /*<! Button hold timeout, milliseconds*/
+#define BUTTON_HOLD_POLL_MS           (50UL)        /*<! Button hold indication period */
+#define FUOTA_AWAKE_MAX_MS            (3600000UL)   /*<! Longest FUOTA session kept awake, milliseconds */
+#define GNSS_MODE_ACK_TIMEOUT_MS      (100UL)       /*<! GNSS mode command is sent again without the acknowledge */
+#define GNSS_MODE_SEND_ATTEMPTS       (3U)          /*<! GNSS mode command attempts */
+#define IDLE_POLL_MS                  (50UL)        /*<! Longest idle, the button and the charger are polled */
+#define JOIN_TIMEOUT_MS               (30000UL)     /*<! Join retries before the fix is left to the trace */
+#define JOIN_PROBE_TIMEOUT_MS         (10000UL)     /*<! Single join attempt when the backoff has expired */
+#define LORAWAN_POLL_MS               (1000UL)      /*<! FUOTA session activity check period */
 #define NO_FIX_TIMEOUT_MS                                                                                           \
     (5 * 60 * 1000UL) /*<! When GPS can't catch satellites during NO_FIX_TIMEOUT_MS time(milliseconds), go to sleep \
                          for SLEEP_NO_FIX_PERIOD_S */
@@ -88,6 +139,12 @@ typedef struct PACKED {
 #define SHUTDOWN_NO_AUTO_WAKEUP (0)    /*<! */
 #define SHUTDOWN_KEEP_WAKEUP    (-1U)  /*<! */
 
+#if DELAY_AFTER_SEND == 1
+#    define AFTER_SEND_DELAY_MS (10000UL) /*<! LoRaWAN stack keeps running after the uplink, for debugging */
+#else
+#    define AFTER_SEND_DELAY_MS (0UL)
+#endif  // DELAY_AFTER_SEND == 1
+
 /* Private macro -------------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
@@ -100,6 +157,30 @@ static QUEUE(_debug_rx_queue, QUEUE_DEBUG_RX_SIZE, uint8_t);
 static system_state_t _system_state = SYSTEM_STATE_INIT;
 static bool _is_enable_by_button = false;
 static bool _is_power_off_request = false;
+static bool _is_gnss_powered = false;
+static bool _is_gtrace_record_pending = false;
+static gtrace_record_t _gtrace_pending_record; /* Fix captured in WAIT_FOR_GPS_FIX, written while radio is busy */
+static volatile app_lora_result_t _p2p_tx_result = SUBGHZ_APP_RESULT_ERROR;
+static uint32_t _airtime_wait_s = 0; /* Time until the deferred P2P packet fits the duty cycle */
+static lorawan_backoff_action_t _lorawan_action = LORAWAN_BACKOFF_ACTION_SEND;
+static lorawan_phase_t _lorawan_phase = LORAWAN_PHASE_JOIN;
+static uint32_t _lorawan_linger_ts = 0;
+static uint32_t _lorawan_sent_fix_time_s = 0; /* Newest fix of the uplink in progress, 0 without the track */
+static send_gnss_data_t _gnss_data;           /* Fix of this wakeup or the latest one of the GNSS trace */
+static uint32_t _no_fix_ts = 0;
+
+static struct {
+    char const *command; /*<! Mode command sent until acknowledged, NULL when done */
+    size_t attempts;     /*<! Mode commands sent */
+    size_t ack_index;    /*<! Bytes of the acknowledge matched */
+} _gnss_mode;
+
+static struct {
+    bool is_button_pressed;    /*<! Last polled button level */
+    bool is_charger_connected; /*<! Last polled USB power level */
+    bool is_hold;              /*<! Button hold is being indicated */
+    uint32_t hold_ts;          /*<! Start of the button hold */
+} _inputs;
 
 #if LOG_ENABLED == 1U
 static const char *const DEBUG_START_INFO_STR[BSP_START_REASON_COUNT] = {
@@ -118,7 +199,13 @@ static bool _is_battery_voltage_critical_low(void);
 static bool _is_battery_voltage_low(void);
 static void _background_loop(void);
 static void _detect_wakeup_reason(void);
-static void _gnss_trace_save(lwgps_t const *gnss);
+static void _dispatch(event_t const *event);
+static void _gnss_trace_record_capture(lwgps_t const *gnss);
+static void _gnss_trace_save(void);
+static void _gnss_sleep(void);
+static void _gnss_mode_ack_match(uint8_t byte);
+static void _send_housekeeping(send_gnss_data_t const *gnss_data);
+static void _on_p2p_tx_done(app_lora_result_t result);
 static void _gnss_trace_wakeup_counter_inc(void);
 static void _gnss_trace_wakeup_counter_reset(void);
 static void _gtrace_init(void);
@@ -126,15 +213,15 @@ static void _gtrace_load(send_gnss_data_t *data);
 static void _led_blink_1x(void);
 static void _led_blink_3x(void);
 static void _lora_init(void);
+static void _lorawan_start(void);
 static void _prepare_to_sleep(void);
-static void _send_gnss_data(send_gnss_data_t const *gnss_data);
 static void _shutdown_button_holding_indication(void);
 static void _power_on_button_holding_indication(void);
 static void _shutdown(uint32_t auto_wakeup_timeout_s);
 static void _status_print(bool is_blink_enable);
 static void _switch_mode(system_state_t mode);
 static void _uart_data_proccess(void);
-static void _send_gnss_data_by_p2p_non_text_data(send_gnss_data_t const *gnss_data);
+static bool _send_gnss_data_by_p2p_non_text_data(send_gnss_data_t const *gnss_data);
 
 /* Private user code ---------------------------------------------------------*/
 
@@ -148,8 +235,10 @@ void bsp_uart_gnss_byte_received(uint8_t byte) {
         }
 
         _is_queue_full_dbg_display = true;
+        stats_inc(STATS_COUNTER_GNSS_RX_OVERFLOW);
     } else {
         _is_queue_full_dbg_display = false;
+        stats_max(STATS_COUNTER_GNSS_RX_PEAK, (uint32_t)queue_num_of(QHEAD(_gnss_rx_queue)));
     }
 }
 
@@ -165,8 +254,10 @@ void bsp_uart_debug_byte_received(uint8_t byte) {
         }
 
         _is_queue_full_dbg_display = true;
+        stats_inc(STATS_COUNTER_DEBUG_RX_OVERFLOW);
     } else {
         _is_queue_full_dbg_display = false;
+        stats_max(STATS_COUNTER_DEBUG_RX_PEAK, (uint32_t)queue_num_of(QHEAD(_debug_rx_queue)));
     }
 }
 
@@ -174,6 +265,7 @@ void bsp_uart_debug_byte_received(uint8_t byte) {
 
 static void _uart_data_proccess(void) {
     uint8_t queue_item = 0;
+    bool is_sentence_end = false;
 
     /* Parse debug stream */
     while (queue_dequeue(QHEAD(_debug_rx_queue), &queue_item, dequeue8)) {
@@ -185,40 +277,58 @@ static void _uart_data_proccess(void) {
 #if (DEBUG_PRINT_NMEA_DATA == 1U)
         bsp_uart_debug_write(&queue_item, sizeof(queue_item));
 #endif
+        _gnss_mode_ack_match(queue_item);
+        PROFILE_BEGIN(PROFILE_SCOPE_LWGPS_PROCESS);
         lwgps_process(&_gnss, &queue_item, sizeof(queue_item));
+        PROFILE_END(PROFILE_SCOPE_LWGPS_PROCESS);
+
+        if (queue_item == '\n') {
+            is_sentence_end = true;
+        }
+    }
+
+    /* Single event for the whole burst of sentences */
+    if (is_sentence_end == true) {
+        event_post(EVENT_TYPE_GNSS_EPOCH);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The button and the charger have no interrupts, their levels are polled on every wakeup */
+static void _poll_inputs(void) {
+    if (bsp_gpio_is_button_pressed() != _inputs.is_button_pressed) {
+        _inputs.is_button_pressed = !_inputs.is_button_pressed;
+        LOG_INFO("Button state changed - %d", _inputs.is_button_pressed);
+        event_post(EVENT_TYPE_BUTTON_EDGE);
+    }
+
+    if (bsp_gpio_is_usb_charger_connect() != _inputs.is_charger_connected) {
+        _inputs.is_charger_connected = !_inputs.is_charger_connected;
+        LOG_INFO("Charger state changed - %d", _inputs.is_charger_connected);
+        event_post(EVENT_TYPE_CHARGER_EDGE);
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
+/* Work of every wakeup, the events found here are handled right after it */
 static void _background_loop(void) {
 
-    _status_print(_is_enable_by_button ? true : bsp_gpio_is_usb_charger_connect());
+    LOG_PROCESS();
+    /* The LED belongs to the button hold indication */
+    if (_inputs.is_hold == false) {
+        _status_print(_is_enable_by_button ? true : bsp_gpio_is_usb_charger_connect());
+    }
     _uart_data_proccess();
 
     if (settings_get_is_lorawan_mode()) {
         lorawan_process();
     }
 
-    /* Button handling */
-    static bool _is_button_pressed_last_state = false;
-    if (bsp_gpio_is_button_pressed() != _is_button_pressed_last_state) {
-        _is_button_pressed_last_state = bsp_gpio_is_button_pressed();
-        LOG_INFO("Button state changed - %d", _is_button_pressed_last_state);
-
-        if (_is_button_pressed_last_state) {
-            if (_is_power_off_request == true) {
-                _power_on_button_holding_indication();
-            } else {
-                _shutdown_button_holding_indication();
-            }
-
-            if (bsp_gpio_is_button_pressed() == true) {
-                _is_power_off_request = !_is_power_off_request;
-                _switch_mode(_is_power_off_request == true ? SYSTEM_STATE_SHUTDOWN : SYSTEM_STATE_INIT);
-            }
-        }
-    }
+    /* Guard timeout of the P2P transmission */
+    subghz_radio_process();
+    _poll_inputs();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -230,42 +340,69 @@ static void _switch_mode(system_state_t mode) {
         [SYSTEM_STATE_TICKLE_CHARGE_MODE] = "SYSTEM_STATE_TICKLE_CHARGE_MODE",
         [SYSTEM_STATE_WAIT_FOR_GPS_FIX] = "SYSTEM_STATE_WAIT_FOR_GPS_FIX",
         [SYSTEM_STATE_SEND_DATA] = "SYSTEM_STATE_SEND_DATA",
+        [SYSTEM_STATE_WAIT_FOR_TX_DONE] = "SYSTEM_STATE_WAIT_FOR_TX_DONE",
         [SYSTEM_STATE_SHUTDOWN] = "SYSTEM_STATE_SHUTDOWN",
         [SYSTEM_STATE_SHUTDOWN_CHARGING] = "SYSTEM_STATE_SHUTDOWN_CHARGING",
     };
     LOG_DEBUG(LOG_COLOR(LOG_COLOR_CYAN) "Mode [%s] >>> [%s]", MODE_LIST[_system_state], MODE_LIST[mode]);
 #endif
+    static uint32_t _state_ts = 0;
+    stats_add((stats_counter_t)(STATS_COUNTER_STATE_INIT_MS + _system_state), bsp_get_ticks() - _state_ts);
+    _state_ts = bsp_get_ticks();
+
     _system_state = mode;
+    blackbox_set_state((uint8_t)mode);
+
+    /* Timeout of the former state is dropped, the new one starts its own on the entry */
+    event_timer_stop(APP_TIMER_STATE);
+    event_post(EVENT_TYPE_ENTRY);
 }
 
 /* -------------------------------------------------------------------------- */
 
-static bool _wait_for_gnss_response(char const *str, uint32_t timeout_ms) {
-    uint32_t start_ts = bsp_get_ticks();
-    size_t str_len = strlen(str);
-    uint8_t queue_item = 0;
-    size_t str_idx = 0;
+/* The mode command is sent again until PMTK001 acknowledges it, the fix is awaited meanwhile */
+static void _gnss_mode_send(void) {
+    _gnss_mode.attempts++;
+    _gnss_mode.ack_index = 0;
+    bsp_uart_gnss_write((const uint8_t *)_gnss_mode.command, strlen(_gnss_mode.command));
+    event_timer_start(APP_TIMER_GNSS_MODE, GNSS_MODE_ACK_TIMEOUT_MS);
+}
 
-    while ((bsp_get_ticks() - start_ts) < timeout_ms) {
-        if (queue_dequeue(QHEAD(_gnss_rx_queue), &queue_item, dequeue8) == false) {
-            bsp_lp_sleep();
-            continue;
-        }
-#if (DEBUG_PRINT_NMEA_DATA == 1U)
-        bsp_uart_debug_write(&queue_item, sizeof(queue_item));
-#endif
-        lwgps_process(&_gnss, &queue_item, sizeof(queue_item));
-        if (queue_item == str[str_idx]) {
-            str_idx++;
-            if (str_idx == str_len) {
-                return true;
-            }
-        } else {
-            str_idx = 0;
-        }
+/* -------------------------------------------------------------------------- */
+
+static void _gnss_mode_ack_match(uint8_t byte) {
+    static char const ACK[] = "PMTK001,886,";
+
+    if (_gnss_mode.command == NULL) {
+        return;
+    }
+
+    if (byte != (uint8_t)ACK[_gnss_mode.ack_index]) {
+        _gnss_mode.ack_index = 0;
+        return;
+    }
+
+    _gnss_mode.ack_index++;
+    if (_gnss_mode.ack_index == (sizeof(ACK) - 1U)) {
+        _gnss_mode.command = NULL;
+        event_timer_stop(APP_TIMER_GNSS_MODE);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _gnss_mode_on_timeout(void) {
+    if (_gnss_mode.command == NULL) {
+        return;
+    }
+
+    if (_gnss_mode.attempts < GNSS_MODE_SEND_ATTEMPTS) {
+        _gnss_mode_send();
+        return;
     }
 
-    return false;
+    LOG_ERROR("GNSS mode set timeout");
+    _gnss_mode.command = NULL;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -276,12 +413,13 @@ static void _gnss_init(void) {
 
     /* Reduce MCU clock to avoid deep power drop */
     bsp_clock_switch(BSP_CLOCK_CORE_100_KHZ);
-    bsp_delay_ms(GNSS_POWER_ON_DELAY_MS);
+    bsp_lp_delay_ms(GNSS_POWER_ON_DELAY_MS);
     bsp_gpio_gnss_on();
-    bsp_delay_ms(GNSS_POWER_ON_DELAY_MS);
+    bsp_lp_delay_ms(GNSS_POWER_ON_DELAY_MS);
     bsp_gpio_gnss_wakeup_leave();
-    bsp_delay_ms(GNSS_POWER_ON_DELAY_MS);
+    bsp_lp_delay_ms(GNSS_POWER_ON_DELAY_MS);
     bsp_clock_switch(DEFAULT_FREQ);
+    _is_gnss_powered = true;
 
     bsp_uart_gnss_init();
 
@@ -298,23 +436,15 @@ static void _gnss_init(void) {
         [SETTINGS_GNSS_MODE_STATIONARY] = "$PMTK886,4*2C\r\n",
     };
 
-    static const size_t BLIND_SEND_ATTEMPT = 3;
     settings_gnss_mode_t mode = settings_get_gnss_mode();
     if (mode >= SETTINGS_GNSS_MODE_COUNT) {
         return;
     }
 
     LOG_INFO("GNSS mode set to %d", mode);
-    char const *const MODE = MODES[mode];
-    size_t str_len = strlen(MODE);
-    const uint32_t SEND_TIMEOUT_MS = 100;
-    for (size_t i = 0; i < BLIND_SEND_ATTEMPT; ++i) {
-        bsp_uart_gnss_write((const uint8_t *)MODE, str_len);
-        if (_wait_for_gnss_response("PMTK001,886,", SEND_TIMEOUT_MS) == true) {
-            return;
-        }
-    }
-    LOG_ERROR("GNSS mode set timeout");
+    _gnss_mode.command = MODES[mode];
+    _gnss_mode.attempts = 0;
+    _gnss_mode_send();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -326,11 +456,17 @@ gtrace_t *app_get_gtrace_context(void) {
 /* -------------------------------------------------------------------------- */
 
 static void _led_blink_3x(void) {
+    static const uint32_t BLINK_HALF_PERIOD_MS = 300;
+
+    /* Deadlines keep the blink period, whatever the battery measurement takes */
+    uint32_t ts = bsp_get_ticks();
     for (size_t i = 0; i < 3; i++) {
-        bsp_delay_ms(300);
+        ts += BLINK_HALF_PERIOD_MS;
+        bsp_lp_sleep_until(ts);
         bsp_battery_measure();
         bsp_gpio_led_on();
-        bsp_delay_ms(300);
+        ts += BLINK_HALF_PERIOD_MS;
+        bsp_lp_sleep_until(ts);
         bsp_gpio_led_off();
     }
 }
@@ -339,13 +475,15 @@ static void _led_blink_3x(void) {
 
 static void _led_blink_1x(void) {
     bsp_gpio_led_on();
-    bsp_delay_ms(100);
+    bsp_lp_delay_ms(100);
     bsp_gpio_led_off();
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _prepare_to_sleep(void) {
+    LOG_PROCESS();
+    bsp_uart_debug_flush();
     bsp_gpio_led_off();
     if (settings_is_debug_output() == false) {
         bsp_gpio_gnss_wakeup_enter();
@@ -369,6 +507,17 @@ static void _shutdown(uint32_t auto_wakeup_timeout_s) {
         source |= WAKEUP_SOURCE_TIMER_MASK;
     }
 
+    if (SHUTDOWN_NO_AUTO_WAKEUP == auto_wakeup_timeout_s) {
+        blackbox_set_flags(BLACKBOX_FLAG_POWER_OFF);
+    }
+    if (bsp_gpio_is_usb_charger_connect() == true) {
+        blackbox_set_flags(BLACKBOX_FLAG_CHARGER);
+    }
+
+    airtime_prepare_to_shutdown((source & WAKEUP_SOURCE_TIMER_MASK) ? auto_wakeup_timeout_s : 0);
+    lorawan_backoff_prepare_to_shutdown((source & WAKEUP_SOURCE_TIMER_MASK) ? auto_wakeup_timeout_s : 0);
+    blackbox_commit((uint16_t)bsp_battery_get_voltage(),
+                    (source & WAKEUP_SOURCE_TIMER_MASK) ? auto_wakeup_timeout_s : 0);
     _prepare_to_sleep();
 
     while (bsp_gpio_is_button_pressed()) {
@@ -393,7 +542,7 @@ static void _power_on_button_holding_indication(void) {
             break;
         }
 
-        bsp_delay_ms(DEBOUNCE_DELAY_MS);
+        bsp_lp_delay_ms(DEBOUNCE_DELAY_MS);
     }
 
     bsp_gpio_led_off();
@@ -411,7 +560,7 @@ static void _shutdown_button_holding_indication(void) {
             break;
         }
 
-        bsp_delay_ms(50);
+        bsp_lp_delay_ms(50);
         bsp_gpio_led_toggle();
     }
 
@@ -425,7 +574,7 @@ static void _detect_wakeup_reason(void) {
 
     bool is_shutdown = false;
     /* Wait a bit to smooth noise on button or charger */
-    bsp_delay_ms(100);
+    bsp_lp_delay_ms(100);
 
     switch (reason) {
         case BSP_START_REASON_RESET:
@@ -490,7 +639,7 @@ static void _gtrace_init(void) {
 
 /* -------------------------------------------------------------------------- */
 
-static void _gnss_trace_save(lwgps_t const *gnss) {
+static void _gnss_trace_record_capture(lwgps_t const *gnss) {
     uint32_t speed_mps = (uint8_t)lwgps_to_speed(gnss->speed, lwgps_speed_mps);
     if (speed_mps > UINT8_MAX) {
         speed_mps = UINT8_MAX;
@@ -509,6 +658,20 @@ static void _gnss_trace_save(lwgps_t const *gnss) {
         .checksum = 0,  // Filled inside gtrace_add
     };
 
+    _gtrace_pending_record = record;
+    _is_gtrace_record_pending = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _gnss_trace_save(void) {
+    if (_is_gtrace_record_pending == false) {
+        return;
+    }
+
+    gtrace_record_t record = _gtrace_pending_record;
+    _is_gtrace_record_pending = false;
+
     LOG_DEBUG("Save GNSS Trace: %" PRIu32 "/%" PRIu32 "/%" PRIu32 " %" PRIu32 ":%" PRIu32 ":%" PRIu32 " %f, %f",
               (uint32_t)record.year,
               (uint32_t)record.month,
@@ -519,25 +682,36 @@ static void _gnss_trace_save(lwgps_t const *gnss) {
               record.latitude,
               record.longitude);
     gtrace_add(&_gtrace, &record);
+    _gnss_trace_wakeup_counter_reset();
+    blackbox_set_flags(BLACKBOX_FLAG_GTRACE_SAVE);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _gnss_sleep(void) {
+    if ((_is_gnss_powered == true) && (settings_is_debug_output() == false)) {
+        LOG_INFO("GNSS goes to sleep mode");
+        bsp_gpio_gnss_wakeup_enter();
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 
 static bool _gnss_trace_wakeup_counter_is_need_save(void) {
-    return (bsp_rtc_store_read_reg(BSP_RTC_STORE_REG_WAKEUP) >= settings_get_gnss_trace_save_mult());
+    return (bsp_rtc_store_read_reg(RTC_BACKUP_REG_GNSS_TRACE_WAKEUPS) >= settings_get_gnss_trace_save_mult());
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _gnss_trace_wakeup_counter_reset(void) {
-    bsp_rtc_store_write_reg(BSP_RTC_STORE_REG_WAKEUP, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_GNSS_TRACE_WAKEUPS, 0);
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _gnss_trace_wakeup_counter_inc(void) {
-    uint32_t wake_up_counter = bsp_rtc_store_read_reg(BSP_RTC_STORE_REG_WAKEUP) + 1U;
-    bsp_rtc_store_write_reg(BSP_RTC_STORE_REG_WAKEUP, wake_up_counter);
+    uint32_t wake_up_counter = bsp_rtc_store_read_reg(RTC_BACKUP_REG_GNSS_TRACE_WAKEUPS) + 1U;
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_GNSS_TRACE_WAKEUPS, wake_up_counter);
     LOG_DEBUG("GTrace Wake-up counter %" PRIu32 ", Threshold %" PRIu32,
               wake_up_counter,
               settings_get_gnss_trace_save_mult());
@@ -564,13 +738,25 @@ static bool _is_battery_voltage_critical_low(void) {
 static uint8_t _pack_vbat(uint32_t vbat_mv) {
     static const uint32_t VBAT_OFFSET = 2700;
     static const uint32_t VBAT_MAX = 4200;
-    uint32_t vbat = MIN(vbat_mv, VBAT_OFFSET);
-    vbat = MAX(vbat, VBAT_MAX);
+    uint32_t vbat = MAX(vbat_mv, VBAT_OFFSET);
+    vbat = MIN(vbat, VBAT_MAX);
     return (uint8_t)((vbat / 100) - (VBAT_OFFSET / 100));
 }
 
 /* -------------------------------------------------------------------------- */
 
+/* Seconds since 2000-01-01 of the last GNSS fix, 0 when the date is unknown */
+static uint32_t _gnss_get_time_s(void) {
+    return track_codec_get_time_s(_gnss.year, _gnss.month, _gnss.date, _gnss.hours, _gnss.minutes, _gnss.seconds);
+}
+
+static uint32_t _gtrace_get_time_s(gtrace_record_t const *record) {
+    return track_codec_get_time_s(record->year, record->month, record->date, record->hours, record->minutes,
+                                  record->seconds);
+}
+
+/* -------------------------------------------------------------------------- */
+
 static void _pack_lat_lon_32(double lat_lon, uint8_t packed_data[4]) {
     double scale = 1000000.0;
     int32_t lat_lon_scaled = (int32_t)round(lat_lon * scale);
@@ -583,58 +769,250 @@ static void _pack_lat_lon_32(double lat_lon, uint8_t packed_data[4]) {
 
 /* -------------------------------------------------------------------------- */
 
-static void _send_gnss_data_by_lorawan(send_gnss_data_t const *gnss_data) {
-    LOG_DEBUG("Ready to send, wait for join complete...");
+#if defined(CONFIG_LORAWAN_PAYLOAD_TRACK_CODEC)
+/* The fix of this wakeup and the stored fixes not sent yet, as many as the datarate allows. Uplinks missed by a join
+ * timeout or a power save wakeup are caught up this way */
+static size_t _pack_lorawan_track(uint8_t *payload, size_t max_size, send_gnss_data_t const *gnss_data) {
+    const uint32_t SENT_FIX_TIME_S = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_SENT_FIX_S);
+    const track_status_t STATUS = {
+        .vbat = _pack_vbat(bsp_battery_get_voltage()),
+        .quality = gnss_data->quality,
+    };
+
+    track_fix_t fixes[TRACK_CODEC_MAX_FIXES] = {
+        {
+            .lat = gnss_data->lat,
+            .lon = gnss_data->lon,
+            .time_s = gnss_data->time_s,
+            .alt = gnss_data->alt,
+            .speed_mps = (uint8_t)MIN(gnss_data->speed_mps, UINT8_MAX),
+        },
+    };
+    size_t fix_count = 1;
+
+    /* The trace is in the time order, the fix of this wakeup may be its last record already */
+    for (size_t i = gtrace_get_record_count(&_gtrace); (i > 0) && (fix_count < TRACK_CODEC_MAX_FIXES); i--) {
+        gtrace_record_t record;
+
+        if (gtrace_get_record(&_gtrace, i - 1U, &record) != GTRACE_RESULT_OK) {
+            continue;
+        }
+
+        const uint32_t TIME_S = _gtrace_get_time_s(&record);
 
-    uint32_t join_timeout_ts = bsp_get_ticks();
-    while (lorawan_is_joined() == false) {
-        if ((bsp_get_ticks() - join_timeout_ts) > 30000) {
-            LOG_ERROR("Join timeout");
+        if ((TIME_S <= SENT_FIX_TIME_S) || (TIME_S == 0)) {
             break;
         }
-        _background_loop();
-        bsp_lp_sleep();
+
+        if (TIME_S >= gnss_data->time_s) {
+            continue;
+        }
+
+        fixes[fix_count++] = (track_fix_t){
+            .lat = record.latitude,
+            .lon = record.longitude,
+            .time_s = TIME_S,
+            .alt = record.alt,
+            .speed_mps = record.speed_mps,
+        };
+    }
+
+    size_t encoded_fix_count = 0;
+    size_t size = track_codec_encode(payload, max_size, &STATUS, fixes, fix_count, &encoded_fix_count);
+
+    LOG_DEBUG("Track of %u from %u fixes, %u of %u bytes", encoded_fix_count, fix_count, size, max_size);
+
+    return size;
+}
+#endif /* CONFIG_LORAWAN_PAYLOAD_TRACK_CODEC */
+
+/* -------------------------------------------------------------------------- */
+
+/* Out of coverage the join is not even started until the backoff expires */
+static void _lorawan_start(void) {
+    _lorawan_action = lorawan_backoff_get_action();
+
+    if (_lorawan_action == LORAWAN_BACKOFF_ACTION_SKIP) {
+        return;
+    }
+
+    lorawan_init();
+
+    /* Restored session is not joined again, the link check tells whether the coverage is back */
+    if (_lorawan_action == LORAWAN_BACKOFF_ACTION_PROBE) {
+        lorawan_request_link_check();
     }
+}
+
+/* -------------------------------------------------------------------------- */
 
-    if (lorawan_is_joined() == true) {
-        LOG_DEBUG("Send LoRaWAN data...");
+/* The fix of this wakeup once joined, the track codec payload carries the stored fixes too */
+static void _lorawan_send_uplink(send_gnss_data_t const *gnss_data) {
+    LOG_DEBUG("Send LoRaWAN data...");
+    _lorawan_sent_fix_time_s = 0;
+
+#if defined(CONFIG_LORAWAN_PAYLOAD_TRACK_CODEC)
+    uint8_t payload[LORAWAN_APP_DATA_BUFFER_MAX_SIZE];
+    size_t size = _pack_lorawan_track(payload, lorawan_get_max_payload_size(), gnss_data);
+
+    if (size > 0) {
+        lorawan_send_on_port(LORAWAN_TRACK_APP_PORT, payload, (uint8_t)size);
+        _lorawan_sent_fix_time_s = gnss_data->time_s;
+    } else
+#endif /* CONFIG_LORAWAN_PAYLOAD_TRACK_CODEC */
+    {
         cayenne_lpp_reset(&_cayenne_lpp);
         cayenne_lpp_add_gps(&_cayenne_lpp, 1, (float)gnss_data->lat, (float)gnss_data->lon, (float)gnss_data->alt);
-
         lorawan_send(_cayenne_lpp.buffer, _cayenne_lpp.cursor);
+    }
+}
 
-        while (lorawan_is_tx_complete() == false) {
-            _background_loop();
-            bsp_lp_sleep();
-        }
-        LOG_DEBUG("Send done");
+/* -------------------------------------------------------------------------- */
+
+/* Join or uplink is over, either way the stack keeps running for a while */
+static void _lorawan_on_link_done(void) {
+    if ((lorawan_is_joined() == false) || (lorawan_get_link_result() == LORAWAN_LINK_LOST)) {
+        lorawan_backoff_on_failure(lorawan_get_random());
+        blackbox_set_tx_result(BLACKBOX_TX_FAILED);
+    } else {
+        lorawan_backoff_on_success();
+        blackbox_set_tx_result(BLACKBOX_TX_OK);
     }
 
-#if DELAY_AFTER_SEND == 1
-    uint32_t wait_ts = bsp_get_ticks();
-    while ((bsp_get_ticks() - wait_ts) < 10000) {
-        _background_loop();
-        bsp_lp_sleep();
+    _lorawan_phase = LORAWAN_PHASE_LINGER;
+    _lorawan_linger_ts = bsp_get_ticks();
+    event_timer_start(APP_TIMER_STATE, AFTER_SEND_DELAY_MS);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _lorawan_deinit(void) {
+    if (lorawan_deinit() == false) {
+        event_timer_start(APP_TIMER_STATE, IDLE_POLL_MS);
+        return;
+    }
+
+    if (lorawan_is_update_ready()) {
+        LOG_INFO("Firmware patch received, restart to apply");
+        LOG_PROCESS();
+        bsp_lp_delay_ms(100);
+        bsp_system_reset();
+    }
+
+    _switch_mode(SYSTEM_STATE_SHUTDOWN);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* FUOTA session is set up by the downlinks of the uplink, the fragments come by multicast later */
+static void _lorawan_linger(void) {
+    if (lorawan_is_fuota_active() && (_is_power_off_request == false) &&
+        ((bsp_get_ticks() - _lorawan_linger_ts) < (AFTER_SEND_DELAY_MS + FUOTA_AWAKE_MAX_MS))) {
+        event_timer_start(APP_TIMER_STATE, LORAWAN_POLL_MS);
+        return;
     }
-#endif  // DELAY_AFTER_SEND == 1
 
     LOG_DEBUG("LoraWan deinit");
-    while (lorawan_deinit() == false) {
-        _background_loop();
-        bsp_lp_sleep();
+    _lorawan_phase = LORAWAN_PHASE_DEINIT;
+    _lorawan_deinit();
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_wait_for_lorawan(event_t const *event) {
+    const bool IS_TIMEOUT = (event->type == EVENT_TYPE_TIMER) && (event->timer == APP_TIMER_STATE);
+
+    switch (_lorawan_phase) {
+        case LORAWAN_PHASE_JOIN:
+            if (event->type == EVENT_TYPE_ENTRY) {
+                LOG_DEBUG("Ready to send, wait for join complete...");
+                event_timer_start(APP_TIMER_STATE,
+                                  (_lorawan_action == LORAWAN_BACKOFF_ACTION_PROBE) ? JOIN_PROBE_TIMEOUT_MS
+                                                                                    : JOIN_TIMEOUT_MS);
+            }
+
+            if (lorawan_is_joined() == true) {
+                event_timer_stop(APP_TIMER_STATE);
+                _lorawan_send_uplink(&_gnss_data);
+                _lorawan_phase = LORAWAN_PHASE_UPLINK;
+            } else if (IS_TIMEOUT) {
+                LOG_ERROR("Join timeout");
+                _lorawan_on_link_done();
+            }
+            break;
+        case LORAWAN_PHASE_UPLINK:
+            if (lorawan_is_tx_complete() == true) {
+                /* The stored fixes up to this one are not repeated in the next uplinks */
+                if (_lorawan_sent_fix_time_s != 0) {
+                    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_SENT_FIX_S, _lorawan_sent_fix_time_s);
+                }
+                LOG_DEBUG("Send done");
+                _lorawan_on_link_done();
+            }
+            break;
+        case LORAWAN_PHASE_LINGER:
+            if (IS_TIMEOUT) {
+                _lorawan_linger();
+            }
+            break;
+        case LORAWAN_PHASE_DEINIT:
+            if (IS_TIMEOUT) {
+                _lorawan_deinit();
+            }
+            break;
+        default:
+            break;
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void _send_gnss_data_by_p2p_non_text_data(send_gnss_data_t const *gnss_data) {
+static void _on_p2p_tx_done(app_lora_result_t result) {
+    /* Radio IRQ context */
+    _p2p_tx_result = result;
+    event_post(EVENT_TYPE_TX_DONE);
+}
 
-    uint8_t tx_payload[MAX(sizeof(packet_data_encrypted_t), sizeof(packet_data_extended_t))] = { 0 };
-    size_t tx_size = 0;
+/* -------------------------------------------------------------------------- */
 
-    _lora_init();
+/* Returns true when the transmission has been started, completion is reported via _on_p2p_tx_done */
+static bool _send_gnss_data_by_p2p_non_text_data(send_gnss_data_t const *gnss_data) {
+
+    uint8_t tx_payload[MAX(sizeof(packet_data_authenticated_t),
+                           MAX(sizeof(packet_data_encrypted_t), sizeof(packet_data_extended_t)))] = { 0 };
+    size_t tx_size = 0;
 
-    if (settings_get_is_p2p_encrypted() == true) {
+    if (settings_get_p2p_encryption() == SETTINGS_P2P_ENCRYPTION_CTR_MAC) {
+        packet_data_authenticated_t packet_data_authenticated = {
+            .id1 = settings_get_id_1(),
+            .id2 = settings_get_id_2(),
+            .version = PACKET_DATA_VERSION_AUTHENTICATED,
+            .reserved = 0,
+            .counter = enc_p2p_get_next_counter(_gnss_get_time_s()),
+            .record = {
+                .vbat = _pack_vbat(bsp_battery_get_voltage()),
+                .reserved = 0,
+                .lat_32bit = {0},
+                .lon_32bit = {0},
+                .speed_mps = (uint8_t)gnss_data->speed_mps,
+                .alt_meters = gnss_data->alt,
+            },
+            .mac = {0},
+        };
+        _pack_lat_lon_32(gnss_data->lat, packet_data_authenticated.record.lat_32bit);
+        _pack_lat_lon_32(gnss_data->lon, packet_data_authenticated.record.lon_32bit);
+        enc_p2p_ctr_crypt((uint8_t *)&packet_data_authenticated.record,
+                          sizeof(packet_data_authenticated.record),
+                          packet_data_authenticated.id1,
+                          packet_data_authenticated.id2,
+                          packet_data_authenticated.counter);
+        enc_p2p_get_mac(packet_data_authenticated.mac,
+                        (uint8_t const *)&packet_data_authenticated,
+                        offsetof(packet_data_authenticated_t, mac));
+
+        tx_size = sizeof(packet_data_authenticated);
+        memcpy(tx_payload, &packet_data_authenticated, tx_size);
+    } else if (settings_get_is_p2p_encrypted() == true) {
         packet_data_encrypted_t packet_data_encrypted = {
             .id1 = settings_get_id_1(),
             .id2 = settings_get_id_2(),
@@ -690,15 +1068,36 @@ static void _send_gnss_data_by_p2p_non_text_data(send_gnss_data_t const *gnss_da
         memcpy(tx_payload, &packet_data_short, tx_size);
     }
 
-    LOG_DEBUG_ARRAY_BLUE("Send data", tx_payload, tx_size);
-    if (subghz_radio_send_block(tx_payload, tx_size) == SUBGHZ_APP_RESULT_ERROR) {
+    /* Deferred packet is not queued, the next allowed transmission carries the latest fix */
+    uint32_t time_on_air_ms = subghz_radio_get_time_on_air_ms(tx_size);
+    if (airtime_consume(time_on_air_ms) == AIRTIME_RESULT_DEFERRED) {
+        _airtime_wait_s = airtime_get_wait_s(time_on_air_ms);
+        LOG_WARNING("P2P TX deferred by duty cycle, time on air %lu ms, next slot in %lu s",
+                    time_on_air_ms,
+                    _airtime_wait_s);
+        blackbox_set_tx_result(BLACKBOX_TX_DEFERRED);
+        return false;
+    }
+
+    _lora_init();
+
+    _p2p_tx_result = SUBGHZ_APP_RESULT_ERROR;
+    if (subghz_radio_send_async(tx_payload, tx_size, _on_p2p_tx_done) == SUBGHZ_APP_RESULT_ERROR) {
         LOG_ERROR("Failed to send LoRa message");
+        blackbox_set_tx_result(BLACKBOX_TX_FAILED);
+        return false;
     }
+    LOG_DEBUG_ARRAY_BLUE("Send data", tx_payload, tx_size);
+
+    return true;
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void _send_gnss_data(send_gnss_data_t const *gnss_data) {
+/* Work which doesn't depend on the radio, done while the P2P packet is on air */
+static void _send_housekeeping(send_gnss_data_t const *gnss_data) {
+    _gnss_sleep();
+    _gnss_trace_save();
 
     LOG_DEBUG(LOG_COLOR(LOG_COLOR_BLUE) "Data to send: %02lu,%03lu,%lf,%lf,%lu,%lu,%lu",
               settings_get_id_1(),
@@ -708,12 +1107,30 @@ static void _send_gnss_data(send_gnss_data_t const *gnss_data) {
               (uint32_t)gnss_data->alt,
               (uint32_t)gnss_data->speed_mps,
               bsp_battery_get_voltage());
+}
 
+/* -------------------------------------------------------------------------- */
+
+static void _on_send_data(void) {
     if (settings_get_is_lorawan_mode()) {
-        _send_gnss_data_by_lorawan(gnss_data);
-    } else {
-        _send_gnss_data_by_p2p_non_text_data(gnss_data);
+        _send_housekeeping(&_gnss_data);
+
+        if (_lorawan_action == LORAWAN_BACKOFF_ACTION_SKIP) {
+            LOG_INFO("LoRaWAN backoff, the fix is kept in the trace");
+            blackbox_set_tx_result(BLACKBOX_TX_SKIPPED);
+            _switch_mode(SYSTEM_STATE_SHUTDOWN);
+            return;
+        }
+
+        _lorawan_phase = LORAWAN_PHASE_JOIN;
+        _switch_mode(SYSTEM_STATE_WAIT_FOR_TX_DONE);
+        return;
     }
+
+    bool is_tx_started = _send_gnss_data_by_p2p_non_text_data(&_gnss_data);
+    _send_housekeeping(&_gnss_data);
+
+    _switch_mode(is_tx_started ? SYSTEM_STATE_WAIT_FOR_TX_DONE : SYSTEM_STATE_SHUTDOWN);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -788,6 +1205,261 @@ static void _gtrace_load(send_gnss_data_t *data) {
         data->lon = record.longitude;
         data->alt = record.alt;
         data->speed_mps = record.speed_mps;
+        data->time_s = _gtrace_get_time_s(&record);
+        data->quality = 0;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Hold for BUTTON_HOLD_TIMEOUT_MS toggles the power off request. The LED is on while the power on is held and blinks
+ * while the power off is held, the state machine goes on meanwhile */
+static void _on_button_edge(void) {
+    if (_inputs.is_button_pressed == false) {
+        if (_inputs.is_hold == true) {
+            _inputs.is_hold = false;
+            event_timer_stop(APP_TIMER_BUTTON);
+            bsp_gpio_led_off();
+        }
+        return;
+    }
+
+    _inputs.is_hold = true;
+    _inputs.hold_ts = bsp_get_ticks();
+    bsp_gpio_led_on();
+    event_timer_start(APP_TIMER_BUTTON, BUTTON_HOLD_POLL_MS);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_button_hold_timer(void) {
+    if (_inputs.is_hold == false) {
+        return;
+    }
+
+    if ((bsp_get_ticks() - _inputs.hold_ts) < BUTTON_HOLD_TIMEOUT_MS) {
+        if (_is_power_off_request == true) {
+            bsp_battery_measure();
+        } else {
+            bsp_gpio_led_toggle();
+        }
+        event_timer_start(APP_TIMER_BUTTON, BUTTON_HOLD_POLL_MS);
+        return;
+    }
+
+    _inputs.is_hold = false;
+    bsp_gpio_led_off();
+    _is_power_off_request = !_is_power_off_request;
+
+    /* The transmission is completed and the LoRaWAN context stored first, the shutdown honours the request then */
+    if (_system_state == SYSTEM_STATE_WAIT_FOR_TX_DONE) {
+        LOG_DEBUG("Power %s after the transmission", (_is_power_off_request == true) ? "off" : "on");
+        return;
+    }
+
+    _switch_mode(_is_power_off_request == true ? SYSTEM_STATE_SHUTDOWN : SYSTEM_STATE_INIT);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_init(void) {
+    LOG_DEBUG("System init, VBAT %d", bsp_battery_get_voltage());
+    /* Do not enable GNSS module when battery low, just send latest coordinates */
+    /* First battery measurement occur when button pressed */
+    if (_is_battery_voltage_critical_low() == true) {
+        LOG_DEBUG("Battery voltage %" PRIu32, bsp_battery_get_voltage());
+        if (bsp_gpio_is_usb_charger_connect() == true) {
+            LOG_DEBUG("Battery critical low, switch to tickle charge mode");
+            _switch_mode(SYSTEM_STATE_TICKLE_CHARGE_MODE);
+        } else {
+            LOG_DEBUG("Battery critical low, shutdown");
+            blackbox_set_flags(BLACKBOX_FLAG_BATTERY_LOW);
+            _switch_mode(SYSTEM_STATE_SHUTDOWN);
+        }
+    } else if ((_is_battery_voltage_low() == true) && (bsp_gpio_is_usb_charger_connect() == false)) {
+        LOG_INFO("Battery low, do not enable GNSS module, just send lates data");
+        blackbox_set_flags(BLACKBOX_FLAG_BATTERY_LOW);
+
+        if (settings_get_is_lorawan_mode()) {
+            _lorawan_start();
+        }
+        _gtrace_load(&_gnss_data);
+        _switch_mode(SYSTEM_STATE_SEND_DATA);
+    } else {
+        _gnss_init();
+
+        if (settings_get_is_lorawan_mode()) {
+            _lorawan_start();
+        }
+        _gtrace_load(&_gnss_data);
+        _switch_mode(SYSTEM_STATE_WAIT_FOR_GPS_FIX);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Stays here while the battery is critically low and the USB connected */
+static void _on_tickle_charge(void) {
+    if ((_is_battery_voltage_critical_low() == false) || (bsp_gpio_is_usb_charger_connect() == false)) {
+        _switch_mode(SYSTEM_STATE_INIT);
+        return;
+    }
+
+    /* The battery voltage is measured by _status_print() */
+    if (event_timer_is_running(APP_TIMER_STATE) == false) {
+        event_timer_start(APP_TIMER_STATE, BATTERY_CHECK_PERIOD_MS);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_wait_for_gps_fix(event_t const *event) {
+    if (event->type == EVENT_TYPE_ENTRY) {
+        const uint32_t ELAPSED_MS = bsp_get_ticks() - _no_fix_ts;
+        event_timer_start(APP_TIMER_STATE, (ELAPSED_MS < NO_FIX_TIMEOUT_MS) ? (NO_FIX_TIMEOUT_MS - ELAPSED_MS) : 0);
+    }
+
+    bool is_switch_next_state = false;
+    if ((_gnss.fix_mode >= 3) && (_gnss.is_valid == 1)) {
+
+        LOG_INFO("GNSS data captured!!!");
+        /* Copy normal gnss coords */
+        _gnss_data.lat = _gnss.latitude;
+        _gnss_data.lon = _gnss.longitude;
+        _gnss_data.alt = (uint16_t)_gnss.altitude;
+        _gnss_data.speed_mps = (uint16_t)lwgps_to_speed(_gnss.speed, lwgps_speed_mps);
+        _gnss_data.time_s = _gnss_get_time_s();
+        _gnss_data.quality = track_codec_get_quality(_gnss.fix_mode, (float)_gnss.dop_h);
+        blackbox_set_fix(_gnss_data.time_s);
+
+        /* Fix which is not likely to be sent is stored, the next uplink catches it up */
+        if (_gnss_trace_wakeup_counter_is_need_save() || (gtrace_get_record_count(&_gtrace) == 0) ||
+            (_lorawan_action != LORAWAN_BACKOFF_ACTION_SEND)) {
+            /* Written in SYSTEM_STATE_SEND_DATA while the radio is busy */
+            _gnss_trace_record_capture(&_gnss);
+        }
+
+        is_switch_next_state = true;
+    } else if ((bsp_gpio_is_usb_charger_connect() == false) && ((bsp_get_ticks() - _no_fix_ts) >= NO_FIX_TIMEOUT_MS)) {
+        /* With the USB power the timeout is checked again on the charger disconnect */
+        is_switch_next_state = true;
+    }
+
+    /*Disable GNSS module when battery low, just send latest coordinates */
+    if (_is_battery_voltage_low()) {
+        LOG_INFO("Battery low, disable GNSS module, just send lates data");
+        blackbox_set_flags(BLACKBOX_FLAG_BATTERY_LOW);
+        is_switch_next_state = true;
+    }
+
+    if (is_switch_next_state == true) {
+        _switch_mode(SYSTEM_STATE_SEND_DATA);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_wait_for_p2p_tx_done(void) {
+    if (subghz_radio_is_busy() == true) {
+        return;
+    }
+
+    if (_p2p_tx_result == SUBGHZ_APP_RESULT_ERROR) {
+        LOG_ERROR("Failed to send LoRa message");
+        blackbox_set_tx_result(BLACKBOX_TX_FAILED);
+    } else {
+        blackbox_set_tx_result(BLACKBOX_TX_OK);
+    }
+    /* The entry of the shutdown is handled before the core sleeps again */
+    _switch_mode(SYSTEM_STATE_SHUTDOWN);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_shutdown(void) {
+    if (bsp_gpio_is_usb_charger_connect() == true) {
+        LOG_INFO("Switch to Charging mode");
+        _prepare_to_sleep();
+        _switch_mode(SYSTEM_STATE_SHUTDOWN_CHARGING);
+        return;
+    }
+
+    uint32_t time_off = (_is_power_off_request == true) ? SHUTDOWN_NO_AUTO_WAKEUP : settings_get_auto_wakeup_period_s();
+    if (bsp_get_start_reason() == BSP_START_REASON_CHARGER) {
+        time_off = SHUTDOWN_KEEP_WAKEUP;
+    } else if (time_off != SHUTDOWN_NO_AUTO_WAKEUP) {
+        /* Don't wake up for a fix which can't be sent anyway */
+        time_off = MAX(time_off, _airtime_wait_s);
+    }
+    _shutdown(time_off);
+    LOG_ERROR("If you see it, shutdown is broken");
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_shutdown_charging(void) {
+    if (bsp_gpio_is_usb_charger_connect() == false) {
+        _switch_mode(SYSTEM_STATE_SHUTDOWN);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Run to completion, the handler of the current state gets the events the common handlers leave */
+static void _dispatch(event_t const *event) {
+    if (event->type == EVENT_TYPE_BUTTON_EDGE) {
+        _on_button_edge();
+        return;
+    }
+
+    if ((event->type == EVENT_TYPE_TIMER) && (event->timer == APP_TIMER_BUTTON)) {
+        _on_button_hold_timer();
+        return;
+    }
+
+    if ((event->type == EVENT_TYPE_TIMER) && (event->timer == APP_TIMER_GNSS_MODE)) {
+        _gnss_mode_on_timeout();
+        return;
+    }
+
+    const bool IS_ENTRY = (event->type == EVENT_TYPE_ENTRY);
+
+    switch (_system_state) {
+        case SYSTEM_STATE_INIT:
+            if (IS_ENTRY) {
+                _on_init();
+            }
+            break;
+        case SYSTEM_STATE_TICKLE_CHARGE_MODE:
+            _on_tickle_charge();
+            break;
+        case SYSTEM_STATE_WAIT_FOR_GPS_FIX:
+            _on_wait_for_gps_fix(event);
+            break;
+        case SYSTEM_STATE_SEND_DATA:
+            if (IS_ENTRY) {
+                _on_send_data();
+            }
+            break;
+        case SYSTEM_STATE_WAIT_FOR_TX_DONE:
+            if (settings_get_is_lorawan_mode()) {
+                _on_wait_for_lorawan(event);
+            } else {
+                _on_wait_for_p2p_tx_done();
+            }
+            break;
+        case SYSTEM_STATE_SHUTDOWN:
+            if (IS_ENTRY) {
+                _on_shutdown();
+            }
+            break;
+        case SYSTEM_STATE_SHUTDOWN_CHARGING:
+            _on_shutdown_charging();
+            break;
+        default:
+            LOG_ERROR("Unknown system state");
+            _switch_mode(SYSTEM_STATE_SHUTDOWN);
+            break;
     }
 }
 
@@ -796,11 +1468,16 @@ static void _gtrace_load(send_gnss_data_t *data) {
 int main(void) {
 
     bsp_init();
+    PROFILE_INIT();
     bsp_clock_init();
     bsp_gpio_init();
     bsp_uart_debug_init();
     bsp_rtc_init();
 
+#if CRC16_IS_RAM_TABLE_MODE
+    crc16_generate_table();
+#endif /* CRC16_MODE */
+
 #if LOG_ENABLED == 1U
     const log_mask_t LOG_MASK = DEBUG_BUILD == 1 ? LOG_MASK_ALL : LOG_MASK_OFF;
     log_init(LOG_MASK, &LOG_IO_INTERFACE);
@@ -820,10 +1497,17 @@ int main(void) {
     mcu_flash_print_info();
 
     settings_init(&SETTINGS_IO);
+    airtime_init(settings_get_lora_frequency_hz(), bsp_get_start_reason() == BSP_START_REASON_TIMER_ALARM);
+    lorawan_backoff_init(bsp_get_start_reason() == BSP_START_REASON_TIMER_ALARM);
+    blackbox_init();
+    blackbox_begin((uint8_t)bsp_get_start_reason());
+    lorawan_aes_set_backend(bsp_aes_encrypt_block);
+    enc_p2p_init();
 
     queue_init(QHEAD(_debug_rx_queue), QUEUE_DEBUG_RX_SIZE);
     queue_init(QHEAD(_gnss_rx_queue), QUEUE_RX_GNSS_SIZE);
     lwgps_init(&_gnss);
+    event_init();
 
     UTIL_TIMER_Init();
 
@@ -839,143 +1523,32 @@ int main(void) {
     }
 #endif  // LOG_ENABLED == 1U
 
-    uint32_t no_fix_ts = bsp_get_ticks();
-
-    send_gnss_data_t gnss_data = {
-        .lat = 0.f,
-        .lon = 0.f,
-        .alt = 0.f,
-        .speed_mps = 0,
-    };
+    _no_fix_ts = bsp_get_ticks();
+    _inputs.is_charger_connected = bsp_gpio_is_usb_charger_connect();
 
     LOG_DEBUG("Application started...");
-    for (;;) {
+    /* Entry of SYSTEM_STATE_INIT */
+    event_post(EVENT_TYPE_ENTRY);
 
-        switch (_system_state) {
-            case SYSTEM_STATE_INIT: {
-                LOG_DEBUG("System init, VBAT %d", bsp_battery_get_voltage());
-                /* Do not enable GNSS module when battery low, just send latest coordinates */
-                /* First battery measurement occur when button pressed */
-                if (_is_battery_voltage_critical_low() == true) {
-                    LOG_DEBUG("Battery voltage %" PRIu32, bsp_battery_get_voltage());
-                    if (bsp_gpio_is_usb_charger_connect() == true) {
-                        LOG_DEBUG("Battery critical low, switch to tickle charge mode");
-                        _switch_mode(SYSTEM_STATE_TICKLE_CHARGE_MODE);
-                    } else {
-                        LOG_DEBUG("Battery critical low, shutdown");
-                        _switch_mode(SYSTEM_STATE_SHUTDOWN);
-                    }
-                } else if ((_is_battery_voltage_low() == true) && (bsp_gpio_is_usb_charger_connect() == false)) {
-                    LOG_INFO("Battery low, do not enable GNSS module, just send lates data");
-
-                    if (settings_get_is_lorawan_mode()) {
-                        lorawan_init();
-                    }
-                    _gtrace_load(&gnss_data);
-                    _switch_mode(SYSTEM_STATE_SEND_DATA);
-                } else {
-                    _gnss_init();
-
-                    if (settings_get_is_lorawan_mode()) {
-                        lorawan_init();
-                    }
-                    _gtrace_load(&gnss_data);
-                    _switch_mode(SYSTEM_STATE_WAIT_FOR_GPS_FIX);
-                }
-            } break;
-            case SYSTEM_STATE_WAIT_FOR_GPS_FIX: {
-                bool is_switch_next_state = false;
-                if ((_gnss.fix_mode >= 3) && (_gnss.is_valid == 1)) {
-
-                    LOG_INFO("GNSS data captured!!!");
-                    /* Copy normal gnss coords */
-                    gnss_data.lat = _gnss.latitude;
-                    gnss_data.lon = _gnss.longitude;
-                    gnss_data.alt = (uint16_t)_gnss.altitude;
-                    gnss_data.speed_mps = (uint16_t)lwgps_to_speed(_gnss.speed, lwgps_speed_mps);
-
-                    if (_gnss_trace_wakeup_counter_is_need_save() || (gtrace_get_record_count(&_gtrace) == 0)) {
-                        _gnss_trace_save(&_gnss);
-                        _gnss_trace_wakeup_counter_reset();
-                    }
-
-                    is_switch_next_state = true;
-                } else if ((bsp_gpio_is_usb_charger_connect() == false) &&
-                           ((bsp_get_ticks() - no_fix_ts) >= NO_FIX_TIMEOUT_MS)) {
-                    is_switch_next_state = true;
-                }
-
-                /*Disable GNSS module when battery low, just send latest coordinates */
-                if (_is_battery_voltage_low()) {
-                    LOG_INFO("Battery low, disable GNSS module, just send lates data");
-                    is_switch_next_state = true;
-                }
+    for (;;) {
+        _background_loop();
 
-                if (is_switch_next_state == true) {
-                    if (settings_is_debug_output() == false) {
-                        LOG_INFO("GNSS goes to sleep mode");
-                        bsp_gpio_gnss_wakeup_enter();
-                    }
-                    _switch_mode(SYSTEM_STATE_SEND_DATA);
-                }
-            } break;
-            case SYSTEM_STATE_SEND_DATA: {
-                _send_gnss_data(&gnss_data);
-                _switch_mode(SYSTEM_STATE_SHUTDOWN);
-            } break;
-            case SYSTEM_STATE_SHUTDOWN: {
-                if (bsp_gpio_is_usb_charger_connect() == true) {
-                    LOG_INFO("Switch to Charging mode");
-                    _prepare_to_sleep();
-                    _switch_mode(SYSTEM_STATE_SHUTDOWN_CHARGING);
-                } else {
-                    uint32_t time_off =
-                        (_is_power_off_request == true) ? SHUTDOWN_NO_AUTO_WAKEUP : settings_get_auto_wakeup_period_s();
-                    if (bsp_get_start_reason() == BSP_START_REASON_CHARGER) {
-                        time_off = SHUTDOWN_KEEP_WAKEUP;
-                    }
-                    _shutdown(time_off);
-                    LOG_ERROR("If you see it, shutdown is broken");
-                }
-            } break;
-            case SYSTEM_STATE_SHUTDOWN_CHARGING: {
-                if (bsp_gpio_is_usb_charger_connect() == false) {
-                    _switch_mode(SYSTEM_STATE_SHUTDOWN);
-                }
-                /* Allow uart receive some data, anyway we will sleep all time */
-                bsp_delay_ms(100);
-
-            } break;
-            case SYSTEM_STATE_TICKLE_CHARGE_MODE: {
-                while (_is_battery_voltage_critical_low() == true) {
-                    /* Hangs here until the battery level is critically low and the USB connected */
-                    if (bsp_gpio_is_usb_charger_connect() == false) {
-                        break;
-                    }
-
-                    bsp_clock_switch(BSP_CLOCK_CORE_100_KHZ);
-                    bsp_lp_sleep();
-                    bsp_clock_switch(DEFAULT_FREQ);
-                }
-                _switch_mode(SYSTEM_STATE_INIT);
-            } break;
-            default:
-                LOG_ERROR("Unknown system state");
-                _switch_mode(SYSTEM_STATE_SHUTDOWN);
-                break;
+        event_t event;
+        while (event_get(&event)) {
+            _dispatch(&event);
         }
 
-        _background_loop();
-
-        /* Reduce consumption in SYSTEM_STATE_SHUTDOWN_CHARGING */
-        if (_system_state == SYSTEM_STATE_SHUTDOWN_CHARGING) {
+        /* Reduce consumption while charging */
+        const bool IS_SLOW_CLOCK = (_system_state == SYSTEM_STATE_SHUTDOWN_CHARGING) ||
+                                   (_system_state == SYSTEM_STATE_TICKLE_CHARGE_MODE);
+        if (IS_SLOW_CLOCK) {
             bsp_clock_switch(BSP_CLOCK_CORE_100_KHZ);
         }
 
-        //"Wait for interrupt" enter MCU core to sleep mode until any interrupt occur
-        bsp_lp_sleep();
+        /* Sleep or Stop2 until an interrupt, the nearest timer or the poll of the button and the charger */
+        event_wait(IDLE_POLL_MS);
 
-        if (_system_state == SYSTEM_STATE_SHUTDOWN_CHARGING) {
+        if (IS_SLOW_CLOCK) {
             bsp_clock_switch(DEFAULT_FREQ);
         }
     }
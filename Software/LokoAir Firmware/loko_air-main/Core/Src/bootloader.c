@@ -5,7 +5,10 @@
 
 #include <bsp.h>
 #include <crc16.h>
+#include <delta_patch.h>
+#include <lz_image.h>
 #include <queue/queue.h>
+#include <rtc_backup_layout.h>
 #include <stm32_bootloader_host_protocol.h>
 #include <utils.h>
 #include <version.h>
@@ -13,13 +16,22 @@
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private define ------------------------------------------------------------*/
-#define QUEUE_DEBUG_RX_SIZE (256 * 2) /*<! */
+#define QUEUE_DEBUG_RX_SIZE (STM32_BOOTLOADER_EXT_WINDOW * STM32_BOOTLOADER_EXT_FRAME_SIZE_MAX) /*<! */
+#define APP_SEAL_SIGNATURE  (0x5EA10000UL) /*<! Verified image seal, the low half word is the image CRC */
+#define APP_SEAL_MASK       (0xFFFF0000UL) /*<! */
+#define LZ_IMAGE_LOAD_ADDR  (0x90000000UL) /*<! Writes of a compressed container go here, unpacked into the app */
+#define UPDATE_SCRATCH_PAGE (bsp_flash_get_update_page_count() - 2U) /*<! After the staged patch */
+#define UPDATE_JOURNAL_PAGE (bsp_flash_get_update_page_count() - 1U) /*<! */
 /* Private macro -------------------------------------------------------------*/
 
 /* Private variables ---------------------------------------------------------*/
 
 static QUEUE(_debug_rx_queue, QUEUE_DEBUG_RX_SIZE, uint8_t);
 static stm32_bootloader_context_t _context;
+static lz_image_t _lz_image;
+static size_t _lz_image_next_offset;
+static bool _is_lz_image_written;
+static uint8_t _delta_patch_page_buffer[BSP_FLASH_SETTINGS_PAGE_SIZE];
 
 /* -------------------------------------------------------------------------- */
 
@@ -73,6 +85,121 @@ static bool _is_current_app_crc_corrupted(void) {
     return true;
 }
 
+/* -------------------------------------------------------------------------- */
+
+static bool _get_app_seal(uint32_t *seal) {
+    version_info_block_t const *const app_on_flash_info = _get_app_info();
+
+    if (app_on_flash_info->signature != FIRMWARE_APP_SIGNATURE) {
+        return false;
+    }
+
+    if (app_on_flash_info->crc_data_len >= mcu_flash_get_app_size()) {
+        return false;
+    }
+
+    const uint32_t CURRENT_CRC = *(uint32_t const *)(mcu_flash_get_app_addr() + app_on_flash_info->crc_data_len);
+    *seal = APP_SEAL_SIGNATURE | (CURRENT_CRC & ~APP_SEAL_MASK);
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The seal lives in the RTC backup domain: a power-on reset drops it and every app flash write or erase clears it, so
+ * the full CRC runs once after those, timer and button wakeups launch the sealed image right away */
+static bool _is_current_app_verified(void) {
+    uint32_t seal = 0;
+
+    if (_get_app_seal(&seal) && (bsp_rtc_store_read_reg(RTC_BACKUP_REG_BLDR_APP_SEAL) == seal)) {
+        return true;
+    }
+
+    if (_is_current_app_crc_corrupted()) {
+        return false;
+    }
+
+    if (_get_app_seal(&seal)) {
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_BLDR_APP_SEAL, seal);
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _app_seal_clear(void) {
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_BLDR_APP_SEAL, 0);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_erase_app_page(size_t page) {
+    mcu_flash_erase_app_page(page * BSP_FLASH_SETTINGS_PAGE_SIZE);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_erase_patch(void) {
+    bsp_flash_update_erase(0);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_erase_scratch(void) {
+    bsp_flash_update_erase(UPDATE_SCRATCH_PAGE);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_write_scratch(void const *data, size_t size) {
+    bsp_flash_update_write(UPDATE_SCRATCH_PAGE * BSP_FLASH_SETTINGS_PAGE_SIZE, data, size);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_erase_journal(void) {
+    bsp_flash_update_erase(UPDATE_JOURNAL_PAGE);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _delta_patch_write_journal(size_t offset, void const *data, size_t size) {
+    bsp_flash_update_write(UPDATE_JOURNAL_PAGE * BSP_FLASH_SETTINGS_PAGE_SIZE + offset, data, size);
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The staged patch is applied before the image check, the image CRC verifies the result. The patch is dropped when
+ * done or rejected, a power loss resumes it on the next boot */
+static void _apply_delta_patch(void) {
+    uint8_t const *update = bsp_flash_update_get_addr();
+
+    const delta_patch_io_t DELTA_PATCH_IO = {
+        .app = mcu_flash_get_app_addr(),
+        .app_size = mcu_flash_get_app_size(),
+        .patch = update,
+        .patch_size = UPDATE_SCRATCH_PAGE * BSP_FLASH_SETTINGS_PAGE_SIZE,
+        .scratch = &update[UPDATE_SCRATCH_PAGE * BSP_FLASH_SETTINGS_PAGE_SIZE],
+        .journal = &update[UPDATE_JOURNAL_PAGE * BSP_FLASH_SETTINGS_PAGE_SIZE],
+        .page_size = BSP_FLASH_SETTINGS_PAGE_SIZE,
+        .erase_app_page = _delta_patch_erase_app_page,
+        .write_app = mcu_flash_write_app,
+        .erase_patch = _delta_patch_erase_patch,
+        .erase_scratch = _delta_patch_erase_scratch,
+        .write_scratch = _delta_patch_write_scratch,
+        .erase_journal = _delta_patch_erase_journal,
+        .write_journal = _delta_patch_write_journal,
+    };
+
+    if (delta_patch_is_present(&DELTA_PATCH_IO) == false) {
+        return;
+    }
+
+    _app_seal_clear();
+    delta_patch_apply(&DELTA_PATCH_IO, _delta_patch_page_buffer);
+}
+
 /* --------------------------------------------------------------------------- */
 
 static void _read_mem(size_t addr, uint8_t *byte, size_t size) {
@@ -107,7 +234,66 @@ static void _read_mem(size_t addr, uint8_t *byte, size_t size) {
 
 /* --------------------------------------------------------------------------- */
 
+/* Unpacked chunks are window sized, so every chunk starts a new page */
+static void _lz_image_output(void *user, size_t offset, uint8_t const *data, size_t size) {
+    (void)user;
+
+    if ((offset + size) > mcu_flash_get_app_size()) {
+        return;
+    }
+
+    _is_lz_image_written = true;
+
+    for (size_t page_offset = offset; page_offset < (offset + size); page_offset += BSP_FLASH_SETTINGS_PAGE_SIZE) {
+        mcu_flash_erase_app_page(page_offset);
+    }
+
+    mcu_flash_write_app(offset, data, size);
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The container is expected in order, a write to its start restarts unpacking */
+static void _lz_image_write(size_t offset, uint8_t const *byte, size_t size) {
+    if (offset == 0) {
+        _app_seal_clear();
+        lz_image_init(&_lz_image, _lz_image_output, NULL);
+        _lz_image_next_offset = 0;
+        _is_lz_image_written = false;
+    }
+
+    if ((offset != _lz_image_next_offset) || (_lz_image.result != LZ_IMAGE_RESULT_IN_PROGRESS)) {
+        return;
+    }
+
+    _lz_image_next_offset += size;
+
+    if ((lz_image_feed(&_lz_image, byte, size) == LZ_IMAGE_RESULT_ERROR) ||
+        (lz_image_get_size(&_lz_image) > mcu_flash_get_app_size())) {
+        _lz_image.result = LZ_IMAGE_RESULT_ERROR;
+
+        /* A partly unpacked image must not start */
+        if (_is_lz_image_written) {
+            mcu_flash_erase_app_page(0);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
 static void _write_mem(size_t addr, uint8_t const *byte, size_t size) {
+    if ((addr >= LZ_IMAGE_LOAD_ADDR) && (addr < (LZ_IMAGE_LOAD_ADDR + mcu_flash_get_app_size()))) {
+        _lz_image_write(addr - LZ_IMAGE_LOAD_ADDR, byte, size);
+        return;
+    }
+
+    const size_t UPDATE_ADDR = (size_t)bsp_flash_update_get_addr();
+    const size_t UPDATE_SIZE = bsp_flash_get_update_page_count() * BSP_FLASH_SETTINGS_PAGE_SIZE;
+    if ((addr >= UPDATE_ADDR) && ((addr + size) <= (UPDATE_ADDR + UPDATE_SIZE))) {
+        bsp_flash_update_write(addr - UPDATE_ADDR, byte, size);
+        return;
+    }
+
     const size_t APP_ADDR = (size_t)mcu_flash_get_app_addr();
     if (addr < APP_ADDR) {
         return;
@@ -116,15 +302,57 @@ static void _write_mem(size_t addr, uint8_t const *byte, size_t size) {
         return;
     }
 
+    _app_seal_clear();
     mcu_flash_write_app(addr - APP_ADDR, byte, size);
 }
 
 /* --------------------------------------------------------------------------- */
 
+static bool _erase_update_page_at(size_t addr) {
+    const size_t UPDATE_ADDR = (size_t)bsp_flash_update_get_addr();
+    const size_t UPDATE_PAGE = (addr - UPDATE_ADDR) / BSP_FLASH_SETTINGS_PAGE_SIZE;
+    if ((addr < UPDATE_ADDR) || (UPDATE_PAGE >= bsp_flash_get_update_page_count())) {
+        return false;
+    }
+
+    bsp_flash_update_erase(UPDATE_PAGE);
+
+    /* A new patch, the progress of a previous one must not apply to it */
+    if (UPDATE_PAGE == 0) {
+        _delta_patch_erase_journal();
+    }
+
+    return true;
+}
+
+/* --------------------------------------------------------------------------- */
+
 static void _erase_page(size_t page_number) {
+    const size_t FLASH_ADDR = 0x08000000;
+
     if ((page_number == (0x8000 / BSP_FLASH_SETTINGS_PAGE_SIZE)) || (page_number == 0xFF)) {
+        _app_seal_clear();
         mcu_flash_erase_app();
+        return;
     }
+
+    _erase_update_page_at(FLASH_ADDR + page_number * BSP_FLASH_SETTINGS_PAGE_SIZE);
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void _erase_page_at(size_t addr) {
+    if (_erase_update_page_at(addr)) {
+        return;
+    }
+
+    const size_t APP_ADDR = (size_t)mcu_flash_get_app_addr();
+    if ((addr < APP_ADDR) || (addr >= (APP_ADDR + mcu_flash_get_app_size()))) {
+        return;
+    }
+
+    _app_seal_clear();
+    mcu_flash_erase_app_page(addr - APP_ADDR);
 }
 
 /* --------------------------------------------------------------------------- */
@@ -143,6 +371,11 @@ static stm32_bootloader_io_t const BLDR_PROTOCOL_IO = {
     .write_mem = _write_mem,
     .erase_page = _erase_page,
     .goto_addr = _goto_addr,
+    .is_baud_valid = bsp_uart_debug_is_baudrate_valid,
+    .set_baud = bsp_uart_debug_set_baudrate,
+    .erase_page_at = _erase_page_at,
+    .page_size = BSP_FLASH_SETTINGS_PAGE_SIZE,
+    .get_ticks = bsp_get_ticks,
 };
 
 /* --------------------------------------------------------------------------- */
@@ -154,15 +387,24 @@ int main(void) {
     bsp_gpio_init();
     bsp_rtc_init();
 
-#if (CRC16_MODE == CRC_RAM_TABLE)
+#if CRC16_IS_RAM_TABLE_MODE
     crc16_generate_table();
 #endif /* CRC16_MODE */
 
     bool is_bootloader_requested = (INTER_TARGET_MAILBOX_GET() == INTER_TARGET_MAILBOX_CMD_STAY_IN_BOOTLOADER);
-    bsp_rtc_store_write_reg(0, 0);
+    INTER_TARGET_MAILBOX_SEND(0);
 
-    if ((is_bootloader_requested == false) && (_is_current_app_crc_corrupted() == false)) {
-        bsp_launch_app();
+    /* Mirrored request of the application for the former bootloaders, SysTime must not start from it */
+    if (INTER_TARGET_MAILBOX_GET_LEGACY() == INTER_TARGET_MAILBOX_CMD_STAY_IN_BOOTLOADER) {
+        INTER_TARGET_MAILBOX_SEND_LEGACY(0);
+    }
+
+    if (is_bootloader_requested == false) {
+        _apply_delta_patch();
+
+        if (_is_current_app_verified() == true) {
+            bsp_launch_app();
+        }
     }
 
     bsp_clock_switch(BSP_CLOCK_CORE_16_MHZ);
@@ -183,6 +425,7 @@ int main(void) {
         while (queue_dequeue(QHEAD(_debug_rx_queue), &queue_item, dequeue8) == true) {
             stm32_bootloader_host_protocol_byte_handle(&_context, queue_item);
         }
+        stm32_bootloader_host_protocol_poll(&_context);
 
         if (bsp_gpio_is_button_pressed() == false) {
             button_pressed_duration_ms = bsp_get_ticks();
@@ -0,0 +1,326 @@
+#include "frag_decoder_if.h"
+#include "FragDecoder.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <bsp.h>
+#include <delta_patch.h>
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define FLASH_WORD_SIZE    (8U)
+#define FLASH_WORD_FULL    (0xFFU)
+#define PATCH_PAGE_COUNT   (FRAG_DECODER_IF_REGION_SIZE / BSP_FLASH_SETTINGS_PAGE_SIZE)
+#define JOURNAL_PAGE       (bsp_flash_get_update_page_count() - 1U)
+#define PENDING_WORD_COUNT (2U * FRAG_MAX_REDUNDANCY + 2U)
+#define LOG_PREFIX         "FUOTA: "
+
+STATIC_ASSERT((FRAG_MAX_NB * FRAG_MAX_SIZE) <= FRAG_DECODER_IF_REGION_SIZE);
+
+/* -------------------------------------------------------------------------- */
+
+/* Flash word is programmed once. Fragments are not word aligned and lost ones are recovered out of order, so the
+ * partially received words wait in RAM. Every missing fragment leaves at most two of them */
+typedef struct {
+    uint32_t offset;
+    uint8_t data[FLASH_WORD_SIZE];
+    uint8_t mask; /*<! Received bytes */
+} pending_word_t;
+
+/* The decoder rewrites a lost fragment on every coded one until the file is complete, the final data is known only
+ * then. Up to FRAG_MAX_REDUNDANCY of them are lost, otherwise the session fails anyway */
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    uint8_t data[FRAG_MAX_SIZE];
+} recovered_row_t;
+
+static pending_word_t _pending[PENDING_WORD_COUNT];
+static size_t _pending_count;
+static recovered_row_t _recovered[FRAG_MAX_REDUNDANCY];
+static size_t _recovered_count;
+static uint32_t _received_end; /*<! End of the last received fragment, a repeated one is not programmed again */
+static bool _is_session_active;
+static bool _is_write_failed; /*<! The decoder ignores the write result, the session fails at the end */
+static bool _is_update_ready;
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _erase(void);
+static int32_t _write(uint32_t addr, uint8_t *data, uint32_t size);
+static int32_t _read(uint32_t addr, uint8_t *data, uint32_t size);
+static void _on_progress(uint16_t frag_counter, uint16_t frag_nb, uint8_t frag_size, uint16_t frag_nb_lost);
+static void _on_done(int32_t status, uint32_t size);
+
+const LmhpFragmentationParams_t FRAG_DECODER_IF_FragmentationParams = {
+    .DecoderCallbacks = {
+        .FragDecoderErase = _erase,
+        .FragDecoderWrite = _write,
+        .FragDecoderRead = _read,
+    },
+    .OnProgress = _on_progress,
+    .OnDone = _on_done,
+};
+
+/* -------------------------------------------------------------------------- */
+
+static pending_word_t *_find_pending(uint32_t offset) {
+    for (size_t i = 0; i < _pending_count; i++) {
+        if (_pending[i].offset == offset) {
+            return &_pending[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _program_pending(pending_word_t *word) {
+    bsp_flash_update_write(word->offset, word->data, FLASH_WORD_SIZE);
+    *word = _pending[--_pending_count];
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _write_partial_word(uint32_t addr, uint8_t const *data, uint32_t size) {
+    const uint32_t OFFSET = addr & ~(FLASH_WORD_SIZE - 1U);
+    pending_word_t *word = _find_pending(OFFSET);
+
+    if (word == NULL) {
+        if (_pending_count >= PENDING_WORD_COUNT) {
+            LOG_ERROR(LOG_PREFIX "No room for the partial word 0x%08" PRIX32, OFFSET);
+            return -1;
+        }
+
+        word = &_pending[_pending_count++];
+        word->offset = OFFSET;
+        word->mask = 0;
+        memset(word->data, 0xFF, sizeof(word->data));
+    }
+
+    for (uint32_t i = 0; i < size; i++) {
+        word->data[addr - OFFSET + i] = data[i];
+        word->mask |= (uint8_t)(1U << (addr - OFFSET + i));
+    }
+
+    if (word->mask == FLASH_WORD_FULL) {
+        _program_pending(word);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _flush_pending(void) {
+    while (_pending_count > 0) {
+        _program_pending(&_pending[0]);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _program(uint32_t addr, uint8_t const *data, uint32_t size) {
+    const uint32_t HEAD_SIZE = MIN((FLASH_WORD_SIZE - (addr % FLASH_WORD_SIZE)) % FLASH_WORD_SIZE, size);
+
+    if ((HEAD_SIZE > 0) && (_write_partial_word(addr, data, HEAD_SIZE) != 0)) {
+        return -1;
+    }
+
+    addr += HEAD_SIZE;
+    data += HEAD_SIZE;
+    size -= HEAD_SIZE;
+
+    const uint32_t BODY_SIZE = size - (size % FLASH_WORD_SIZE);
+
+    if (BODY_SIZE > 0) {
+        bsp_flash_update_write(addr, data, BODY_SIZE);
+    }
+
+    if ((size > BODY_SIZE) && (_write_partial_word(addr + BODY_SIZE, &data[BODY_SIZE], size - BODY_SIZE) != 0)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _store_recovered(uint32_t addr, uint8_t const *data, uint32_t size) {
+    recovered_row_t *row = NULL;
+
+    for (size_t i = 0; i < _recovered_count; i++) {
+        if (_recovered[i].offset == addr) {
+            row = &_recovered[i];
+            break;
+        }
+    }
+
+    if (row == NULL) {
+        if ((_recovered_count >= FRAG_MAX_REDUNDANCY) || (size > FRAG_MAX_SIZE)) {
+            LOG_ERROR(LOG_PREFIX "No room for the lost fragment 0x%08" PRIX32, addr);
+            return -1;
+        }
+
+        row = &_recovered[_recovered_count++];
+        row->offset = addr;
+        row->size = size;
+    }
+
+    memcpy(row->data, data, row->size);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _program_recovered(void) {
+    for (size_t i = 0; i < _recovered_count; i++) {
+        if (_program(_recovered[i].offset, _recovered[i].data, _recovered[i].size) != 0) {
+            _is_write_failed = true;
+        }
+    }
+
+    _recovered_count = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _erase(void) {
+    for (size_t page = 0; page < PATCH_PAGE_COUNT; page++) {
+        bsp_flash_update_erase(page);
+    }
+
+    /* A new patch, the progress of a previous one must not apply to it */
+    bsp_flash_update_erase(JOURNAL_PAGE);
+
+    _pending_count = 0;
+    _recovered_count = 0;
+    _received_end = 0;
+    _is_session_active = true;
+    _is_write_failed = false;
+    _is_update_ready = false;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _write(uint32_t addr, uint8_t *data, uint32_t size) {
+    if (((uint64_t)addr + size) > FRAG_DECODER_IF_REGION_SIZE) {
+        LOG_ERROR(LOG_PREFIX "Write of %" PRIu32 " bytes at 0x%08" PRIX32 " is out of the region", size, addr);
+        _is_write_failed = true;
+        return -1;
+    }
+
+    /* The received fragment is written to the row of its counter, the rows of the lost ones are rebuilt later */
+    const uint32_t RECEIVED_ADDR = (uint32_t)(FragDecoderGetStatus().FragNbRx - 1U) * size;
+    int32_t result = 0;
+
+    if (addr != RECEIVED_ADDR) {
+        result = _store_recovered(addr, data, size);
+    } else if ((addr + size) > _received_end) {
+        _received_end = addr + size;
+        result = _program(addr, data, size);
+    }
+
+    if (result != 0) {
+        _is_write_failed = true;
+    }
+
+    return result;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _read(uint32_t addr, uint8_t *data, uint32_t size) {
+    if (((uint64_t)addr + size) > FRAG_DECODER_IF_REGION_SIZE) {
+        return -1;
+    }
+
+    memcpy(data, (uint8_t const *)bsp_flash_update_get_addr() + addr, size);
+
+    for (size_t i = 0; i < _pending_count; i++) {
+        for (uint32_t byte = 0; byte < FLASH_WORD_SIZE; byte++) {
+            const uint32_t OFFSET = _pending[i].offset + byte;
+
+            if ((_pending[i].mask & (1U << byte)) && (OFFSET >= addr) && (OFFSET < (addr + size))) {
+                data[OFFSET - addr] = _pending[i].data[byte];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _recovered_count; i++) {
+        const uint32_t START = MAX(addr, _recovered[i].offset);
+        const uint32_t END = MIN(addr + size, _recovered[i].offset + _recovered[i].size);
+
+        if (START < END) {
+            memcpy(&data[START - addr], &_recovered[i].data[START - _recovered[i].offset], END - START);
+        }
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_progress(uint16_t frag_counter, uint16_t frag_nb, uint8_t frag_size, uint16_t frag_nb_lost) {
+    LOG_DEBUG(LOG_PREFIX "Fragment %u of %u, size %u, lost %u", frag_counter, frag_nb, frag_size, frag_nb_lost);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_done(int32_t status, uint32_t size) {
+    /* The file is complete, the lost fragments are final and fill the partial words of their neighbours */
+    _program_recovered();
+    _flush_pending();
+    _is_session_active = false;
+
+    if (FragDecoderGetStatus().MatrixError != 0) {
+        LOG_ERROR(LOG_PREFIX "Too many lost fragments, status %" PRId32, status);
+        return;
+    }
+
+    if (_is_write_failed) {
+        LOG_ERROR(LOG_PREFIX "Patch of %" PRIu32 " bytes is not stored", size);
+        bsp_flash_update_erase(0);
+        return;
+    }
+
+    /* The bootloader applies the patch only to the image it was made for */
+    const delta_patch_io_t IO = {
+        .app = mcu_flash_get_app_addr(),
+        .app_size = mcu_flash_get_app_size(),
+        .patch = bsp_flash_update_get_addr(),
+        .patch_size = FRAG_DECODER_IF_REGION_SIZE,
+        .page_size = BSP_FLASH_SETTINGS_PAGE_SIZE,
+    };
+
+    delta_patch_result_t result = delta_patch_verify(&IO);
+
+    if (result != DELTA_PATCH_RESULT_READY) {
+        LOG_ERROR(LOG_PREFIX "Patch of %" PRIu32 " bytes rejected, result %u", size, result);
+        bsp_flash_update_erase(0);
+        return;
+    }
+
+    LOG_INFO(LOG_PREFIX "Patch of %" PRIu32 " bytes is ready", size);
+    _is_update_ready = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool frag_decoder_if_is_session_active(void) {
+    return _is_session_active;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool frag_decoder_if_is_update_ready(void) {
+    return _is_update_ready;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "LmhpFragmentation.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* The fragmented file is a delta patch (Core/delta_patch), received into the patch staging area of the update flash
+ * area and applied by the bootloader after the restart */
+#define FRAG_DECODER_IF_REGION_SIZE (28U * 1024U) /*<! Update area without the scratch and journal pages */
+
+#define FRAG_MAX_SIZE       (240U)
+#define FRAG_MIN_SIZE       (40U)
+#define FRAG_MAX_NB         (FRAG_DECODER_IF_REGION_SIZE / FRAG_MAX_SIZE) /*<! Largest file fits the staging area */
+#define FRAG_MAX_REDUNDANCY (FRAG_MAX_NB / 10U) /*<! 10% of lost fragments */
+
+#define FRAG_DECODER_DWL_REGION_SIZE FRAG_DECODER_IF_REGION_SIZE
+
+/* -------------------------------------------------------------------------- */
+
+extern const LmhpFragmentationParams_t FRAG_DECODER_IF_FragmentationParams;
+
+/* -------------------------------------------------------------------------- */
+
+bool frag_decoder_if_is_session_active(void);
+bool frag_decoder_if_is_update_ready(void);
+
+#ifdef __cplusplus
+}
+#endif
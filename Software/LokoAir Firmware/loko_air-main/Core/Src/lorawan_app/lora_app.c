@@ -1,6 +1,8 @@
 #include "lora_app.h"
 #include "LmHandler.h"
+#include "LoRaMacCrypto.h"
 #include "Region.h"
+#include "frag_decoder_if.h"
 #include "lora_app_version.h"
 #include "lora_info.h"
 #include "lorawan_version.h"
@@ -11,6 +13,9 @@
 #include <inttypes.h>
 
 #include <bsp.h>
+#include <event/event.h>
+#include <lorawan_nvm.h>
+#include <rtc_backup_layout.h>
 #include <settings/settings.h>
 
 static void _on_join_request(LmHandlerJoinParams_t *join_params);
@@ -19,6 +24,8 @@ static void _on_rx_data(LmHandlerAppData_t *app_data, LmHandlerRxParams_t *param
 static void _on_mac_process_notify(void);
 static void _on_restore_context_request(void *nvm, uint32_t nvm_size);
 static void _on_store_context_request(void *nvm, uint32_t nvm_size);
+static void _on_class_change(DeviceClass_t device_class);
+static void _on_sys_time_update(void);
 /* -------------------------------------------------------------------------- */
 
 uint8_t calculate_lorawan_battery_level(uint16_t voltage_mv, uint16_t min_voltage_mv, uint16_t max_voltage_mv) {
@@ -75,6 +82,8 @@ static LmHandlerCallbacks_t _lm_handler_callbacks = {
     .OnRxData = _on_rx_data,
     .OnRestoreContextRequest = _on_restore_context_request,
     .OnStoreContextRequest = _on_store_context_request,
+    .OnClassChange = _on_class_change,
+    .OnSysTimeUpdate = _on_sys_time_update,
 };
 
 static LmHandlerParams_t _lm_handler_params = {
@@ -96,12 +105,45 @@ static LmHandlerAppData_t _app_data = {
 
 static volatile bool _is_tx_complete = false;
 static volatile bool _is_joined = false;
+static volatile DeviceClass_t _device_class = CLASS_A;
+static volatile bool _is_link_check_pending = false;
+static volatile bool _is_downlink_received = false;
+static bool _is_link_check_forced = false;
+
+static lorawan_nvm_t _nvm;
+STATIC_ASSERT(((sizeof(LoRaMacNvmData_t) + 7U) & ~7U) <= LORAWAN_NVM_CONTEXT_MAX_SIZE);
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_rejoin_required(void) {
+    uint32_t fcnt_up = 0;
+
+    if (LORAWAN_FORCE_REJOIN_AT_BOOT) {
+        return true;
+    }
+
+    if (bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS) >= LORAWAN_LINK_CHECK_FAIL_LIMIT) {
+        LOG_WARNING("Link lost, rejoin");
+        return true;
+    }
+
+    if ((LoRaMacCryptoGetFCntUp(&fcnt_up) == LORAMAC_CRYPTO_SUCCESS) && (fcnt_up >= LORAWAN_FCNT_UP_REJOIN_LIMIT)) {
+        LOG_WARNING("Uplink counter %" PRIu32 " runs out, rejoin", fcnt_up);
+        return true;
+    }
+
+    return false;
+}
 
 /* -------------------------------------------------------------------------- */
 
 void lorawan_init(void) {
 
     _is_joined = false;
+    _device_class = LORAWAN_DEFAULT_CLASS;
+    _is_link_check_pending = false;
+    _is_downlink_received = false;
+    _is_link_check_forced = false;
 
     _lm_handler_params.ActiveRegion = settings_get_lorawan_region_id();
 
@@ -109,12 +151,24 @@ void lorawan_init(void) {
     LmHandlerInit(&_lm_handler_callbacks, APP_VERSION);
     LmHandlerConfigure(&_lm_handler_params);
 
-    LmHandlerJoin(LORAWAN_DEFAULT_ACTIVATION_TYPE, LORAWAN_FORCE_REJOIN_AT_BOOT);
+    /* Session restored from the NVM keeps its keys, counters and datarate, no join request is sent for it */
+    bool is_rejoin = (LmHandlerJoinStatus() != LORAMAC_HANDLER_SET) || _is_rejoin_required();
+
+    LmHandlerJoin(LORAWAN_DEFAULT_ACTIVATION_TYPE, is_rejoin);
+
+    if (is_rejoin == false) {
+        LOG_INFO("LoRaWAN session restored");
+        _is_joined = true;
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _on_rx_data(LmHandlerAppData_t *app_data, LmHandlerRxParams_t *params) {
+    if ((params != NULL) && (params->Status == LORAMAC_EVENT_INFO_STATUS_OK)) {
+        _is_downlink_received = true;
+    }
+
     if ((app_data == NULL) || (params == NULL)) {
         return;
     }
@@ -166,9 +220,46 @@ static void _on_rx_data(LmHandlerAppData_t *app_data, LmHandlerRxParams_t *param
 
 /* -------------------------------------------------------------------------- */
 
+static bool _is_link_check_due(void) {
+    uint32_t fcnt_up = 0;
+
+    if (_is_link_check_forced) {
+        return true;
+    }
+
+    return (LoRaMacCryptoGetFCntUp(&fcnt_up) == LORAMAC_CRYPTO_SUCCESS) && ((fcnt_up % LORAWAN_LINK_CHECK_PERIOD) == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint8_t lorawan_get_max_payload_size(void) {
+    LoRaMacTxInfo_t tx_info;
+
+    if (LoRaMacQueryTxPossible(0, &tx_info) != LORAMAC_STATUS_OK) {
+        return 0;
+    }
+
+    uint8_t size = MIN(tx_info.MaxPossibleApplicationDataSize, LORAWAN_APP_DATA_BUFFER_MAX_SIZE);
+
+    /* LinkCheckReq is added to the FOpts of the uplink by lorawan_send_on_port() */
+    if (_is_link_check_due() && (size > 0)) {
+        size--;
+    }
+
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
 void lorawan_send(void const *data, uint8_t size) {
+    lorawan_send_on_port(LORAWAN_USER_APP_PORT, data, size);
+}
+
+/* -------------------------------------------------------------------------- */
 
-    _app_data.Port = LORAWAN_USER_APP_PORT;
+void lorawan_send_on_port(uint8_t port, void const *data, uint8_t size) {
+
+    _app_data.Port = port;
     _app_data.BufferSize = size;
     memcpy(_app_data.Buffer, data, size);
 
@@ -178,6 +269,12 @@ void lorawan_send(void const *data, uint8_t size) {
 
     LOG_DEBUG_ARRAY_BLUE("TX", _app_data.Buffer, _app_data.BufferSize);
 
+    /* The answer comes in the receive windows of this uplink */
+    if (_is_link_check_due()) {
+        _is_link_check_pending = (LmHandlerLinkCheckReq() == LORAMAC_HANDLER_SUCCESS);
+        _is_link_check_forced = false;
+    }
+
     LmHandlerErrorStatus_t status = LmHandlerSend(&_app_data, _lm_handler_params.IsTxConfirmed, false);
     if (LORAMAC_HANDLER_SUCCESS == status) {
         LOG_INFO("SEND REQUEST...");
@@ -214,6 +311,7 @@ static void _on_tx_data(LmHandlerTxParams_t *params) {
             LOG_DEBUG("UNCONFIRMED");
         }
         _is_tx_complete = true;
+        event_post(EVENT_TYPE_TX_DONE);
     }
 }
 
@@ -226,8 +324,10 @@ static void _on_join_request(LmHandlerJoinParams_t *join_params) {
 
     if (join_params->Status == LORAMAC_HANDLER_SUCCESS) {
         LOG_INFO("###### = JOINED = ");
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS, 0);
         LmHandlerNvmDataStore();
         _is_joined = true;
+        event_post(EVENT_TYPE_TX_DONE);
         if (join_params->Mode == ACTIVATION_TYPE_ABP) {
             LOG_DEBUG("ABP ======================");
         } else {
@@ -235,7 +335,7 @@ static void _on_join_request(LmHandlerJoinParams_t *join_params) {
         }
     } else {
         LOG_ERROR("###### = JOIN FAILED, restart join process =");
-        LmHandlerJoin(LORAWAN_DEFAULT_ACTIVATION_TYPE, LORAWAN_FORCE_REJOIN_AT_BOOT);
+        LmHandlerJoin(LORAWAN_DEFAULT_ACTIVATION_TYPE, true);
     }
 }
 
@@ -243,19 +343,22 @@ static void _on_join_request(LmHandlerJoinParams_t *join_params) {
 
 static void _on_restore_context_request(void *nvm, uint32_t nvm_size) {
     LOG_WARNING("Restore %" PRIu32, nvm_size);
-    bsp_flash_lorawan_nvm_read(0, nvm, nvm_size);
+
+    if (lorawan_nvm_load(&_nvm, nvm, nvm_size) != LORAWAN_NVM_RESULT_OK) {
+        /* Erased context fails the CRC check of the stack, the device joins */
+        memset(nvm, 0xFF, nvm_size);
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _on_store_context_request(void *nvm, uint32_t nvm_size) {
+    lorawan_nvm_result_t result = lorawan_nvm_store(&_nvm, nvm, nvm_size);
 
-    if (memcmp(bsp_flash_lorawan_nvm_get_addr(), nvm, nvm_size) == 0) {
+    if (result == LORAWAN_NVM_RESULT_UNCHANGED) {
         LOG_INFO("No need save lorawan nvm");
-    } else {
-        LOG_INFO("Store nvm");
-        bsp_flash_lorawan_nvm_erase();
-        bsp_flash_lorawan_nvm_write(0, nvm, nvm_size);
+    } else if (result != LORAWAN_NVM_RESULT_OK) {
+        LOG_ERROR("Store nvm of %" PRIu32 " bytes failed", nvm_size);
     }
 }
 
@@ -267,6 +370,22 @@ static void _on_mac_process_notify(void) {
 
 /* -------------------------------------------------------------------------- */
 
+/* Remote multicast setup switches to class C for the session and back to class A when it ends */
+static void _on_class_change(DeviceClass_t device_class) {
+    static const char *_class_strings[] = { "A", "B", "C" };
+
+    LOG_INFO("Switch to class %s done", _class_strings[device_class]);
+    _device_class = device_class;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _on_sys_time_update(void) {
+    LOG_INFO("System time synchronized");
+}
+
+/* -------------------------------------------------------------------------- */
+
 bool lorawan_is_joined(void) {
     return _is_joined;
 }
@@ -279,9 +398,67 @@ bool lorawan_is_tx_complete(void) {
 
 /* -------------------------------------------------------------------------- */
 
+bool lorawan_is_fuota_active(void) {
+    return (_device_class != CLASS_A) || frag_decoder_if_is_session_active();
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool lorawan_is_update_ready(void) {
+    return frag_decoder_if_is_update_ready();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_request_rejoin(void) {
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS, LORAWAN_LINK_CHECK_FAIL_LIMIT);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_request_link_check(void) {
+    _is_link_check_forced = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+lorawan_link_result_t lorawan_get_link_result(void) {
+    if (_is_downlink_received) {
+        return LORAWAN_LINK_OK;
+    }
+
+    return _is_link_check_pending ? LORAWAN_LINK_LOST : LORAWAN_LINK_UNKNOWN;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t lorawan_get_random(void) {
+    return (uint32_t)randr(0, INT32_MAX);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _update_link_check(void) {
+    if (_is_downlink_received) {
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS, 0);
+    } else if (_is_link_check_pending) {
+        uint32_t fails = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS) + 1U;
+
+        LOG_WARNING("Link check failed %" PRIu32 " time(s)", fails);
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_LINK_FAILS, fails);
+    }
+
+    _is_link_check_pending = false;
+    _is_downlink_received = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
 bool lorawan_deinit(void) {
 
     if (LmHandlerStop() == LORAMAC_HANDLER_SUCCESS) {
+        _update_link_check();
+        /* Frame counters, DevNonce and the ADR state of this wakeup are restored at the next one */
         LmHandlerNvmDataStore();
         return true;
     }
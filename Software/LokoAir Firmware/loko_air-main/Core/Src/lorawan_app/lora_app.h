@@ -19,6 +19,12 @@ extern "C" {
  */
 #define LORAWAN_SWITCH_CLASS_PORT 3
 
+/*!
+ * LoRaWAN compact track application port, see Core/track_codec
+ * @note do not use 224. It is reserved for certification
+ */
+#define LORAWAN_TRACK_APP_PORT 4
+
 /*!
  * LoRaWAN default class
  */
@@ -50,7 +56,23 @@ extern "C" {
  * LoRaWAN force rejoin even if the NVM context is restored
  * @note useful only when context management is enabled by CONTEXT_MANAGEMENT_ENABLED
  */
-#define LORAWAN_FORCE_REJOIN_AT_BOOT true
+#define LORAWAN_FORCE_REJOIN_AT_BOOT false
+
+/*!
+ * Uplinks with the frame counter multiple of the period request a link check
+ * @note an uplink without any downlink in its receive windows fails the check
+ */
+#define LORAWAN_LINK_CHECK_PERIOD 16
+
+/*!
+ * Consecutive failed link checks after which the restored session is dropped and the device joins again
+ */
+#define LORAWAN_LINK_CHECK_FAIL_LIMIT 3
+
+/*!
+ * Uplink frame counter after which the device joins again, before the counter wraps
+ */
+#define LORAWAN_FCNT_UP_REJOIN_LIMIT 0xFFFF0000UL
 
 /*!
  * User application data buffer size
@@ -74,6 +96,12 @@ extern "C" {
  */
 #define LORAWAN_DEFAULT_CLASS_B_C_RESP_TIMEOUT 8000
 
+typedef enum {
+    LORAWAN_LINK_UNKNOWN, /*<! No downlink, and no link check was requested */
+    LORAWAN_LINK_OK,      /*<! Downlink received in this wakeup */
+    LORAWAN_LINK_LOST,    /*<! Link check requested, no downlink */
+} lorawan_link_result_t;
+
 /**
  * @brief  Init Lora Application
  */
@@ -82,7 +110,16 @@ void lorawan_process(void);
 bool lorawan_deinit(void);
 bool lorawan_is_joined(void);
 bool lorawan_is_tx_complete(void);
+bool lorawan_is_fuota_active(void); /*<! Multicast or fragmentation session is running, keep the device awake */
+bool lorawan_is_update_ready(void); /*<! Verified patch is staged, the bootloader applies it after the restart */
+void lorawan_request_rejoin(void);  /*<! Drop the restored session at the next init and join again */
 void lorawan_send(void const *data, uint8_t size);
+void lorawan_send_on_port(uint8_t port, void const *data, uint8_t size);
+uint8_t lorawan_get_max_payload_size(void); /*<! Application payload of the next uplink at the current datarate */
+
+void lorawan_request_link_check(void);               /*<! Add LinkCheckReq to the next uplink out of the period */
+lorawan_link_result_t lorawan_get_link_result(void); /*<! Valid after the uplink is complete */
+uint32_t lorawan_get_random(void);                   /*<! Random value of the MAC generator, seeded by the radio */
 
 #ifdef __cplusplus
 }
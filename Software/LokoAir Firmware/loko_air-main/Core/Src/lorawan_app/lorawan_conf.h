@@ -62,6 +62,14 @@ extern "C" {
  */
 #define CONTEXT_MANAGEMENT_ENABLED 1
 
+/*!
+ * Enables/Disables the data distribution packages: clock sync, remote multicast setup, fragmentation and firmware
+ * management. The fragmented file is stored by frag_decoder_if.c
+ * \note Clock sync corrections go through SysTimeSet(), which rewrites the RTC backup registers of timer_if.c. The
+ *       application registers of rtc_backup_layout.h must stay above them, timer_if.c asserts that
+ */
+#define LORAWAN_DATA_DISTRIB_MGT 1
+
 /* Class B ------------------------------------*/
 #define LORAMAC_CLASSB_ENABLED 0
 
@@ -30,6 +30,9 @@
 #include "stm32wlxx_ll_rtc.h"
 
 #include "timer_if.h"
+#include <bsp.h>
+#include <rtc_backup_layout.h>
+#include <utils.h>
 
 /* External variables ---------------------------------------------------------*/
 /**
@@ -89,6 +92,13 @@ const UTIL_SYSTIM_Driver_s UTIL_SYSTIMDriver = {
  */
 #define RTC_BKP_MSBTICKS RTC_BKP_DR2
 
+/* The application backup registers are above the SysTime ones, see rtc_backup_layout.h */
+STATIC_ASSERT(RTC_BKP_SECONDS < RTC_BACKUP_REG_SYSTIME_COUNT);
+STATIC_ASSERT(RTC_BKP_SUBSECONDS < RTC_BACKUP_REG_SYSTIME_COUNT);
+STATIC_ASSERT(RTC_BKP_MSBTICKS < RTC_BACKUP_REG_SYSTIME_COUNT);
+STATIC_ASSERT(RTC_BACKUP_REG_APP_FIRST >= RTC_BACKUP_REG_SYSTIME_COUNT);
+STATIC_ASSERT(RTC_BACKUP_REG_COUNT <= RTC_BACKUP_NB);
+
 /* #define RTIF_DEBUG */
 
 /**
@@ -352,8 +362,9 @@ static uint32_t TIMER_IF_BkUp_Read_MSBticks(void) {
     return MSBticks;
 }
 
+/* Same counter as the firmware time base, see bsp_rtc_get_ms() */
 static inline uint32_t GetTimerTicks(void) {
-    return (UINT32_MAX - LL_RTC_TIME_GetSubSecond(RTC));
+    return bsp_rtc_get_counter();
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
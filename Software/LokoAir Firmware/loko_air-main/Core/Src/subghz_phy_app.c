@@ -2,22 +2,50 @@
 #include "bsp.h"
 #include "bsp_subghz.h"
 #include "radio.h"
+#include <stats/stats.h>
 #include <stdbool.h>
 
 /* -------------------------------------------------------------------------- */
 
 #define _ENTRY_TRACE(...) LOG_DEBUG(LOG_COLOR(LOG_COLOR_RED) "ENTERED TO SUBGHZ Event: %s", __FUNCTION__)
 
+#define TX_GUARD_TIMEOUT_MS (7000) /*<! Fallback if radio lost TxDone/TxTimeout event */
+
 /* -------------------------------------------------------------------------- */
 
-static volatile bool _is_sent = false;
-static volatile bool _is_timeout = false;
+static volatile bool _is_busy = false;
+static volatile app_lora_result_t _tx_result = SUBGHZ_APP_RESULT_ERROR;
+static subghz_radio_tx_done_cb_t _tx_done_cb = NULL;
+static uint32_t _tx_start_ts = 0;
+
+/* -------------------------------------------------------------------------- */
+
+static void _tx_complete(app_lora_result_t result) {
+    bsp_disable_irq();
+    bool is_busy = _is_busy;
+    subghz_radio_tx_done_cb_t cb = _tx_done_cb;
+    _tx_done_cb = NULL;
+    _tx_result = result;
+    _is_busy = false;
+    bsp_enable_irq();
+
+    if (is_busy == false) {
+        return;
+    }
+
+    stats_inc((result == SUBGHZ_APP_RESULT_OK) ? STATS_COUNTER_RADIO_TX : STATS_COUNTER_RADIO_TX_ERRORS);
+    stats_add(STATS_COUNTER_RADIO_TX_MS, bsp_get_ticks() - _tx_start_ts);
+
+    if (cb != NULL) {
+        cb(result);
+    }
+}
 
 /* -------------------------------------------------------------------------- */
 
 static void _on_tx_done(void) {
     //    _ENTRY_TRACE();
-    _is_sent = true;
+    _tx_complete(SUBGHZ_APP_RESULT_OK);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -30,7 +58,7 @@ static void _on_rx_done(uint8_t *payload, uint16_t size, int16_t rssi, int8_t lo
 
 static void _on_tx_timeout(void) {
     _ENTRY_TRACE();
-    _is_timeout = true;
+    _tx_complete(SUBGHZ_APP_RESULT_ERROR);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -47,6 +75,19 @@ static void _on_rx_error(void) {
 
 /* -------------------------------------------------------------------------- */
 
+uint32_t subghz_radio_get_time_on_air_ms(size_t size) {
+    return Radio.TimeOnAir(MODEM_LORA,
+                           LORA_BANDWIDTH,
+                           LORA_SPREADING_FACTOR,
+                           LORA_CODINGRATE,
+                           LORA_PREAMBLE_LENGTH,
+                           LORA_FIX_LENGTH_PAYLOAD_ON,
+                           (uint8_t)size,
+                           true);
+}
+
+/* -------------------------------------------------------------------------- */
+
 void subghz_radio_init(app_lora_params_t *params) {
     static RadioEvents_t _radio_events = {
         .TxDone = _on_tx_done,
@@ -94,22 +135,50 @@ void subghz_radio_deinit(void) {
 
 /* -------------------------------------------------------------------------- */
 
-app_lora_result_t subghz_radio_send_block(const uint8_t *data, size_t size) {
-    _is_sent = false;
-    _is_timeout = false;
-    Radio.Send((uint8_t *)data, size);
+app_lora_result_t subghz_radio_send_async(const uint8_t *data, size_t size, subghz_radio_tx_done_cb_t cb) {
+    if ((data == NULL) || (size == 0) || (size > UINT8_MAX) || (_is_busy == true)) {
+        return SUBGHZ_APP_RESULT_ERROR;
+    }
 
-    size_t ts = bsp_get_ticks();
+    _tx_done_cb = cb;
+    _tx_result = SUBGHZ_APP_RESULT_ERROR;
+    _tx_start_ts = bsp_get_ticks();
+    _is_busy = true;
+    Radio.Send((uint8_t *)data, (uint8_t)size);
 
-    while ((_is_sent == false) && (_is_timeout == false)) {
-        bsp_lp_sleep();
+    return SUBGHZ_APP_RESULT_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool subghz_radio_is_busy(void) {
+    return _is_busy;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void subghz_radio_process(void) {
+    if ((_is_busy == true) && ((bsp_get_ticks() - _tx_start_ts) > TX_GUARD_TIMEOUT_MS)) {
+        LOG_ERROR("Radio TX guard timeout");
+        _tx_complete(SUBGHZ_APP_RESULT_ERROR);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+app_lora_result_t subghz_radio_send_block(const uint8_t *data, size_t size) {
+    if (subghz_radio_send_async(data, size, NULL) != SUBGHZ_APP_RESULT_OK) {
+        return SUBGHZ_APP_RESULT_ERROR;
+    }
 
-        if ((bsp_get_ticks() - ts) > 7000) {
-            break;
-        }
+    while (_is_busy == true) {
+        /* Radio interrupt ends the idle, the guard timeout is the deadline */
+        const uint32_t ELAPSED = bsp_get_ticks() - _tx_start_ts;
+        bsp_lp_idle((ELAPSED < TX_GUARD_TIMEOUT_MS) ? (TX_GUARD_TIMEOUT_MS - ELAPSED) : 0);
+        subghz_radio_process();
     }
 
-    return _is_sent == false ? SUBGHZ_APP_RESULT_ERROR : SUBGHZ_APP_RESULT_OK;
+    return _tx_result;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -0,0 +1,200 @@
+#include "airtime.h"
+#include <bsp.h>
+#include <rtc_backup_layout.h>
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define AIRTIME_SIGNATURE      (0xA17E0000UL)
+#define AIRTIME_SIGNATURE_MASK (0xFFFF0000UL)
+#define LOG_PREFIX             "AIRTIME: "
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t min_hz;
+    uint32_t max_hz;
+    uint32_t duty_cycle_ppm;
+} airtime_band_t;
+
+/* ETSI EN 300 220 sub-bands, [min_hz, max_hz). Frequency out of the table is not restricted */
+static const airtime_band_t _bands[] = {
+    {.min_hz = 433050000, .max_hz = 434790000, .duty_cycle_ppm = 100000}, /* EU433, 10%  */
+    { .min_hz = 863000000, .max_hz = 865000000, .duty_cycle_ppm = 1000  }, /* 0.1%        */
+    { .min_hz = 865000000, .max_hz = 868000000, .duty_cycle_ppm = 10000 }, /* 1%          */
+    { .min_hz = 868000000, .max_hz = 868600000, .duty_cycle_ppm = 10000 }, /* g1, 1%      */
+    { .min_hz = 868700000, .max_hz = 869200000, .duty_cycle_ppm = 1000  }, /* g2, 0.1%    */
+    { .min_hz = 869400000, .max_hz = 869650000, .duty_cycle_ppm = 100000}, /* g3, 10%     */
+    { .min_hz = 869700000, .max_hz = 870000000, .duty_cycle_ppm = 10000 }, /* g4, 1%      */
+};
+
+#define BAND_INDEX_UNRESTRICTED (COUNT_OF(_bands))
+
+static struct {
+    uint32_t band_index;
+    uint32_t last_update_ts;
+    uint32_t leak_residual; /* Leaked airtime fraction, ms * ppm */
+} _ctx = {
+    .band_index = BAND_INDEX_UNRESTRICTED,
+    .last_update_ts = 0,
+    .leak_residual = 0,
+};
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _find_band(uint32_t freq_hz) {
+    for (size_t i = 0; i < COUNT_OF(_bands); i++) {
+        if ((freq_hz >= _bands[i].min_hz) && (freq_hz < _bands[i].max_hz)) {
+            return (uint32_t)i;
+        }
+    }
+
+    return BAND_INDEX_UNRESTRICTED;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _get_duty_cycle_ppm(void) {
+    if (_ctx.band_index < COUNT_OF(_bands)) {
+        return _bands[_ctx.band_index].duty_cycle_ppm;
+    }
+
+    return AIRTIME_DUTY_CYCLE_PPM_FULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _get_budget_ms(void) {
+    return (uint32_t)(((uint64_t)AIRTIME_WINDOW_S * _get_duty_cycle_ppm()) / 1000U);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _reg_inc(size_t reg, uint32_t value) {
+    bsp_rtc_store_write_reg(reg, bsp_rtc_store_read_reg(reg) + value);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Leaky bucket: the charged airtime drains with the band duty cycle rate */
+static void _leak(uint64_t elapsed_ms) {
+    uint64_t leak = elapsed_ms * _get_duty_cycle_ppm() + _ctx.leak_residual;
+    _ctx.leak_residual = (uint32_t)(leak % AIRTIME_DUTY_CYCLE_PPM_FULL);
+    leak /= AIRTIME_DUTY_CYCLE_PPM_FULL;
+
+    uint32_t bucket_ms = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS);
+    bucket_ms = (leak >= bucket_ms) ? 0 : bucket_ms - (uint32_t)leak;
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS, bucket_ms);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _update(void) {
+    uint32_t now = bsp_get_ticks();
+    _leak(now - _ctx.last_update_ts);
+    _ctx.last_update_ts = now;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void airtime_init(uint32_t freq_hz, bool is_sleep_time_valid) {
+    _ctx.band_index = _find_band(freq_hz);
+    _ctx.last_update_ts = bsp_get_ticks();
+    _ctx.leak_residual = 0;
+
+    uint32_t signature = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_SIGNATURE);
+
+    if ((signature & AIRTIME_SIGNATURE_MASK) != AIRTIME_SIGNATURE) {
+        LOG_INFO(LOG_PREFIX "Ledger not found, reset");
+        airtime_reset();
+        return;
+    }
+
+    if ((signature & ~AIRTIME_SIGNATURE_MASK) != _ctx.band_index) {
+        LOG_INFO(LOG_PREFIX "Band changed, bucket cleared");
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SIGNATURE, AIRTIME_SIGNATURE | _ctx.band_index);
+        bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS, 0);
+    } else if (is_sleep_time_valid == true) {
+        _leak((uint64_t)bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_SLEEP_S) * 1000U);
+    }
+
+    /* Unknown sleep time is not leaked, it keeps the ledger on the safe side */
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SLEEP_S, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+airtime_result_t airtime_consume(uint32_t time_on_air_ms) {
+    _update();
+
+    uint32_t bucket_ms = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS);
+
+    if (((uint64_t)bucket_ms + time_on_air_ms) > _get_budget_ms()) {
+        _reg_inc(RTC_BACKUP_REG_AIRTIME_DEFERRED_COUNT, 1);
+        LOG_WARNING(LOG_PREFIX "Duty cycle limit, used %lu of %lu ms, request %lu ms",
+                    bucket_ms,
+                    _get_budget_ms(),
+                    time_on_air_ms);
+        return AIRTIME_RESULT_DEFERRED;
+    }
+
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS, bucket_ms + time_on_air_ms);
+    _reg_inc(RTC_BACKUP_REG_AIRTIME_TOTAL_MS, time_on_air_ms);
+    _reg_inc(RTC_BACKUP_REG_AIRTIME_TX_COUNT, 1);
+
+    return AIRTIME_RESULT_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t airtime_get_wait_s(uint32_t time_on_air_ms) {
+    _update();
+
+    uint64_t required_ms = (uint64_t)bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS) + time_on_air_ms;
+    uint32_t budget_ms = _get_budget_ms();
+
+    if (required_ms <= budget_ms) {
+        return 0;
+    }
+
+    uint64_t wait_ms = ((required_ms - budget_ms) * AIRTIME_DUTY_CYCLE_PPM_FULL) / _get_duty_cycle_ppm();
+
+    return (uint32_t)((wait_ms + 999U) / 1000U);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void airtime_prepare_to_shutdown(uint32_t sleep_s) {
+    _update();
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SLEEP_S, sleep_s);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void airtime_get_ledger(airtime_ledger_t *ledger) {
+    _update();
+
+    ledger->band_index = _ctx.band_index;
+    ledger->duty_cycle_ppm = _get_duty_cycle_ppm();
+    ledger->budget_ms = _get_budget_ms();
+    ledger->bucket_ms = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS);
+    ledger->total_ms = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_TOTAL_MS);
+    ledger->tx_count = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_TX_COUNT);
+    ledger->deferred_count = bsp_rtc_store_read_reg(RTC_BACKUP_REG_AIRTIME_DEFERRED_COUNT);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void airtime_reset(void) {
+    _ctx.last_update_ts = bsp_get_ticks();
+    _ctx.leak_residual = 0;
+
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SIGNATURE, AIRTIME_SIGNATURE | _ctx.band_index);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_BUCKET_MS, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SLEEP_S, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_TOTAL_MS, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_TX_COUNT, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_DEFERRED_COUNT, 0);
+}
+
+/* -------------------------------------------------------------------------- */
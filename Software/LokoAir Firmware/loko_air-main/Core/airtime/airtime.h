@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define AIRTIME_WINDOW_S            (3600UL)    /*<! Duty cycle observation period */
+#define AIRTIME_DUTY_CYCLE_PPM_FULL (1000000UL) /*<! 100%, no restriction */
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    AIRTIME_RESULT_OK,
+    AIRTIME_RESULT_DEFERRED,
+} airtime_result_t;
+
+typedef struct {
+    uint32_t band_index;     /*<! Index in the band table */
+    uint32_t duty_cycle_ppm; /*<! Band duty cycle, parts per million */
+    uint32_t budget_ms;      /*<! Bucket capacity: AIRTIME_WINDOW_S * duty cycle */
+    uint32_t bucket_ms;      /*<! Airtime charged and not leaked yet */
+    uint32_t total_ms;       /*<! Total airtime since the ledger reset */
+    uint32_t tx_count;       /*<! Transmissions since the ledger reset */
+    uint32_t deferred_count; /*<! Deferred transmissions since the ledger reset */
+} airtime_ledger_t;
+
+/* -------------------------------------------------------------------------- */
+
+void airtime_init(uint32_t freq_hz, bool is_sleep_time_valid);
+airtime_result_t airtime_consume(uint32_t time_on_air_ms);
+uint32_t airtime_get_wait_s(uint32_t time_on_air_ms);
+void airtime_prepare_to_shutdown(uint32_t sleep_s);
+void airtime_get_ledger(airtime_ledger_t *ledger);
+void airtime_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
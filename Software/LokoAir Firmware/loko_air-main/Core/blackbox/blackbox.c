@@ -0,0 +1,319 @@
+#include "blackbox.h"
+#include <bsp.h>
+#include <string.h>
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define LOG_PREFIX      "BLACKBOX: "
+#define TTFF_UNIT_MS    (100U)
+#define U16_SATURATED   (0xFFFFU)
+#define MS_IN_SECOND    (1000U)
+#define FLASH_WORD_SIZE (8U)
+
+STATIC_ASSERT(sizeof(blackbox_record_t) == 32U);
+STATIC_ASSERT((sizeof(blackbox_record_t) % FLASH_WORD_SIZE) == 0);
+
+/* -------------------------------------------------------------------------- */
+
+static struct {
+    bool is_empty;                           /* No valid record in the ring */
+    size_t newest_slot;                      /* Slot of the newest record */
+    uint32_t newest_sequence;                /* Sequence of the newest record */
+    size_t count;                            /* Records from the oldest to the newest one */
+    bool is_active;                          /* Cycle is collected and not committed yet */
+    uint8_t state;                           /* Current application state */
+    uint32_t state_ts;                       /* Start of the current state accounting */
+    uint32_t begin_ts;                       /* Start of the cycle */
+    uint32_t state_ms[BLACKBOX_STATE_COUNT]; /* Time spent in each state */
+    blackbox_record_t record;                /* Cycle being collected */
+} _ctx = {
+    .is_empty = true,
+};
+
+/* -------------------------------------------------------------------------- */
+
+static uint8_t _checksum(uint8_t const *data, size_t size) {
+    uint8_t checksum = (uint8_t)size;
+
+    while (size-- != 0) {
+        checksum -= *data++;
+    }
+
+    return checksum;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint8_t _get_checksum(blackbox_record_t const *record) {
+    return _checksum((uint8_t const *)record, sizeof(blackbox_record_t) - 1 /* checksum */);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_records_per_page(void) {
+    return bsp_flash_get_blackbox_page_size() / sizeof(blackbox_record_t);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_slot_count(void) {
+    return _get_records_per_page() * bsp_flash_get_blackbox_page_count();
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_slot_offset(size_t slot) {
+    const size_t PER_PAGE = _get_records_per_page();
+    return (slot / PER_PAGE) * bsp_flash_get_blackbox_page_size() + (slot % PER_PAGE) * sizeof(blackbox_record_t);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _read_slot(size_t slot, blackbox_record_t *record) {
+    bsp_flash_blackbox_read(_get_slot_offset(slot), record, sizeof(blackbox_record_t));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_empty(blackbox_record_t const *record) {
+    uint8_t const *data = (uint8_t const *)record;
+
+    for (size_t i = 0; i < sizeof(blackbox_record_t); i++) {
+        if (data[i] != 0xFFU) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_valid(blackbox_record_t const *record) {
+    return (_is_empty(record) == false) && (record->checksum == _get_checksum(record));
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Page with a record which is neither empty nor valid, torn by a power loss or left by the former layout, is erased.
+ * Otherwise a random record could pass the 8-bit checksum and break the sequence */
+static void _check_page(size_t page) {
+    const size_t PER_PAGE = _get_records_per_page();
+    size_t invalid_records = 0;
+
+    for (size_t slot = page * PER_PAGE; slot < ((page + 1U) * PER_PAGE); slot++) {
+        blackbox_record_t record;
+        _read_slot(slot, &record);
+
+        if ((_is_empty(&record) == false) && (_is_valid(&record) == false)) {
+            invalid_records++;
+        }
+    }
+
+    if (invalid_records != 0) {
+        LOG_WARNING(LOG_PREFIX "Erase page %u, invalid records %u", page, invalid_records);
+        bsp_flash_blackbox_erase(page);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _scan(void) {
+    const size_t SLOT_COUNT = _get_slot_count();
+    uint32_t oldest_sequence = 0;
+
+    _ctx.is_empty = true;
+    _ctx.newest_slot = SLOT_COUNT - 1U;
+    _ctx.newest_sequence = 0;
+    _ctx.count = 0;
+
+    for (size_t slot = 0; slot < SLOT_COUNT; slot++) {
+        blackbox_record_t record;
+        _read_slot(slot, &record);
+
+        if (_is_valid(&record) == false) {
+            continue;
+        }
+
+        if (_ctx.is_empty || (record.sequence > _ctx.newest_sequence)) {
+            _ctx.newest_sequence = record.sequence;
+            _ctx.newest_slot = slot;
+        }
+
+        if (_ctx.is_empty || (record.sequence < oldest_sequence)) {
+            oldest_sequence = record.sequence;
+        }
+
+        _ctx.is_empty = false;
+    }
+
+    if (_ctx.is_empty == false) {
+        _ctx.count = MIN((size_t)(_ctx.newest_sequence - oldest_sequence) + 1U, SLOT_COUNT);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_page_empty(size_t page) {
+    const size_t PER_PAGE = _get_records_per_page();
+
+    for (size_t slot = page * PER_PAGE; slot < ((page + 1U) * PER_PAGE); slot++) {
+        blackbox_record_t record;
+        _read_slot(slot, &record);
+
+        if (_is_empty(&record) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _saturate_u16(uint32_t value) {
+    return (uint16_t)MIN(value, U16_SATURATED);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _account_state(void) {
+    const uint32_t NOW = bsp_get_ticks();
+
+    if (_ctx.state < BLACKBOX_STATE_COUNT) {
+        _ctx.state_ms[_ctx.state] += NOW - _ctx.state_ts;
+    }
+    _ctx.state_ts = NOW;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_init(void) {
+    for (size_t page = 0; page < bsp_flash_get_blackbox_page_count(); page++) {
+        _check_page(page);
+    }
+
+    _scan();
+    LOG_INFO(LOG_PREFIX "%u records, next cycle %lu", _ctx.count, _ctx.is_empty ? 0 : _ctx.newest_sequence + 1U);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_begin(uint8_t start_reason) {
+    memset(&_ctx.record, 0, sizeof(_ctx.record));
+    memset(_ctx.state_ms, 0, sizeof(_ctx.state_ms));
+
+    _ctx.record.start_reason = start_reason;
+    _ctx.record.ttff_100ms = BLACKBOX_NO_FIX;
+    _ctx.record.tx_result = BLACKBOX_TX_NONE;
+    _ctx.state = 0;
+    _ctx.begin_ts = bsp_get_ticks();
+    _ctx.state_ts = _ctx.begin_ts;
+    _ctx.is_active = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_set_state(uint8_t state) {
+    if (_ctx.is_active == false) {
+        return;
+    }
+
+    _account_state();
+    _ctx.state = state;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The first fix of the cycle gives TTFF, the later ones only update the time */
+void blackbox_set_fix(uint32_t fix_time_s) {
+    if (_ctx.is_active == false) {
+        return;
+    }
+
+    if (_ctx.record.ttff_100ms == BLACKBOX_NO_FIX) {
+        const uint32_t TTFF = (bsp_get_ticks() - _ctx.begin_ts) / TTFF_UNIT_MS;
+        _ctx.record.ttff_100ms = (uint16_t)MIN(TTFF, BLACKBOX_NO_FIX - 1U);
+    }
+    _ctx.record.fix_time_s = fix_time_s;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_set_tx_result(blackbox_tx_result_t result) {
+    _ctx.record.tx_result = (uint8_t)result;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_set_flags(uint8_t flags) {
+    _ctx.record.flags |= flags;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Single flash program per cycle, the repeated calls before the next blackbox_begin() are ignored */
+void blackbox_commit(uint16_t vbat_mv, uint32_t sleep_s) {
+    if (_ctx.is_active == false) {
+        return;
+    }
+    _ctx.is_active = false;
+    _account_state();
+
+    blackbox_record_t *record = &_ctx.record;
+    for (size_t i = 0; i < BLACKBOX_STATE_COUNT; i++) {
+        record->state_time_s[i] = _saturate_u16((_ctx.state_ms[i] + MS_IN_SECOND / 2U) / MS_IN_SECOND);
+    }
+    record->sequence = _ctx.is_empty ? 0 : _ctx.newest_sequence + 1U;
+    record->vbat_mv = vbat_mv;
+    record->sleep_s = _saturate_u16(sleep_s);
+    record->checksum = _get_checksum(record);
+
+    const size_t SLOT = _ctx.is_empty ? 0 : (_ctx.newest_slot + 1U) % _get_slot_count();
+    const size_t PER_PAGE = _get_records_per_page();
+    const size_t PAGE = SLOT / PER_PAGE;
+
+    /* The oldest page is reused when the ring is full */
+    if (((SLOT % PER_PAGE) == 0) && (_is_page_empty(PAGE) == false)) {
+        bsp_flash_blackbox_erase(PAGE);
+    }
+
+    bsp_flash_blackbox_write(_get_slot_offset(SLOT), record, sizeof(*record));
+    _scan();
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t blackbox_get_record_count(void) {
+    return _ctx.count;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Index 0 is the oldest record. The records are contiguous in the ring, so the slot follows from the sequence */
+blackbox_result_t blackbox_get_record(size_t index, blackbox_record_t *record) {
+    if (index >= _ctx.count) {
+        return BLACKBOX_RESULT_ERROR;
+    }
+
+    const size_t SLOT_COUNT = _get_slot_count();
+    const size_t BACK = _ctx.count - 1U - index;
+    const uint32_t SEQUENCE = _ctx.newest_sequence - (uint32_t)BACK;
+
+    _read_slot((_ctx.newest_slot + SLOT_COUNT - BACK) % SLOT_COUNT, record);
+
+    return (_is_valid(record) && (record->sequence == SEQUENCE)) ? BLACKBOX_RESULT_OK : BLACKBOX_RESULT_ERROR;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_erase(void) {
+    for (size_t page = 0; page < bsp_flash_get_blackbox_page_count(); page++) {
+        bsp_flash_blackbox_erase(page);
+    }
+
+    _scan();
+}
+
+/* -------------------------------------------------------------------------- */
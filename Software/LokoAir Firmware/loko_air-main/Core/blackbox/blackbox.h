@@ -0,0 +1,68 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Black box of the wakeup cycles for the post-mortem analysis. The cycle is collected in RAM and programmed to the
+ * flash ring as one record right before the shutdown, the oldest page is erased when the ring is full */
+
+#define BLACKBOX_STATE_COUNT (7U)      /*<! Application states with the time accounted */
+#define BLACKBOX_NO_FIX      (0xFFFFU) /*<! ttff_100ms of the cycle without a fix */
+
+#define BLACKBOX_FLAG_BATTERY_LOW (0x01U) /*<! GNSS was skipped or stopped by the low battery */
+#define BLACKBOX_FLAG_CHARGER     (0x02U) /*<! Charger was connected at the shutdown */
+#define BLACKBOX_FLAG_POWER_OFF   (0x04U) /*<! Switched off by the button, no timer wakeup */
+#define BLACKBOX_FLAG_GTRACE_SAVE (0x08U) /*<! Fix has been written to the GNSS trace */
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    BLACKBOX_TX_NONE,     /*<! Nothing has been sent in the cycle */
+    BLACKBOX_TX_OK,       /*<! Sent, the LoRaWAN link is fine */
+    BLACKBOX_TX_FAILED,   /*<! Radio error, the LoRaWAN join or the link check has failed */
+    BLACKBOX_TX_DEFERRED, /*<! P2P packet has not fitted the duty cycle */
+    BLACKBOX_TX_SKIPPED,  /*<! LoRaWAN attempt skipped by the backoff */
+} blackbox_tx_result_t;
+
+typedef enum {
+    BLACKBOX_RESULT_OK,
+    BLACKBOX_RESULT_ERROR,
+} blackbox_result_t;
+
+/* 32 bytes, four flash double words */
+typedef struct PACKED {
+    uint32_t sequence;                           /*<! Cycle number, continues over the whole ring */
+    uint32_t fix_time_s;                         /*<! Seconds since 2000-01-01 of the fix, 0 when unknown */
+    uint16_t state_time_s[BLACKBOX_STATE_COUNT]; /*<! Time spent in each state, saturated */
+    uint16_t ttff_100ms;                         /*<! Time to the first fix since the start of the cycle */
+    uint16_t vbat_mv;                            /*<! Battery voltage at the shutdown */
+    uint16_t sleep_s;                            /*<! Timer wakeup period, 0 without it, saturated */
+    uint8_t start_reason;                        /*<! bsp_start_reason_t of the wakeup */
+    uint8_t tx_result;                           /*<! blackbox_tx_result_t */
+    uint8_t flags;                               /*<! BLACKBOX_FLAG_* */
+    uint8_t checksum;                            /* for internal purposes */
+} __packed blackbox_record_t;
+
+/* -------------------------------------------------------------------------- */
+
+void blackbox_init(void);
+void blackbox_begin(uint8_t start_reason);
+void blackbox_set_state(uint8_t state);
+void blackbox_set_fix(uint32_t fix_time_s);
+void blackbox_set_tx_result(blackbox_tx_result_t result);
+void blackbox_set_flags(uint8_t flags);
+void blackbox_commit(uint16_t vbat_mv, uint32_t sleep_s);
+size_t blackbox_get_record_count(void);
+blackbox_result_t blackbox_get_record(size_t index, blackbox_record_t *record);
+void blackbox_erase(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -14,23 +14,77 @@ void bsp_flash_gnss_trace_erase(size_t page);
 size_t bsp_flash_get_gnss_trace_page_count(void);
 size_t bsp_flash_get_gnss_trace_page_size(void);
 
+void bsp_flash_blackbox_read(const size_t offset, void *data, const size_t size);
+void bsp_flash_blackbox_write(const size_t offset, const void *data, const size_t size);
+void bsp_flash_blackbox_erase(size_t page);
+size_t bsp_flash_get_blackbox_page_count(void);
+size_t bsp_flash_get_blackbox_page_size(void);
+
 void bsp_flash_lorawan_nvm_read(const size_t offset, void *data, const size_t size);
 void bsp_flash_lorawan_nvm_write(const size_t offset, const void *data, const size_t size);
 void bsp_flash_lorawan_nvm_erase(void);
+void bsp_flash_lorawan_nvm_erase_page(size_t page);
+size_t bsp_flash_get_lorawan_nvm_page_count(void);
+size_t bsp_flash_get_lorawan_nvm_page_size(void);
 void *bsp_flash_lorawan_nvm_get_addr(void);
+size_t bsp_fake_flash_lorawan_nvm_get_erase_count(size_t page);
+size_t bsp_fake_flash_lorawan_nvm_get_overwrite_count(void);
+void bsp_fake_flash_lorawan_nvm_reset(void);
+
+void bsp_flash_update_write(const size_t offset, const void *data, const size_t size);
+void bsp_flash_update_erase(size_t page);
+void const *bsp_flash_update_get_addr(void);
+size_t bsp_flash_get_update_page_count(void);
+size_t bsp_fake_flash_update_get_overwrite_count(void);
+void bsp_fake_flash_update_reset(void);
+
+void mcu_flash_erase_app(void);
+void mcu_flash_write_app(const size_t offset, const void *data, const size_t size);
+void const *mcu_flash_get_app_addr(void);
+size_t mcu_flash_get_app_size(void);
 
 void bsp_uart_debug_write(uint8_t const *data, size_t size);
+void bsp_uart_debug_flush(void);
 size_t bsp_uart_debug_get_buffer(char *out_data, size_t size);
 void bsp_uart_debug_drop_buffer(void);
 
+void bsp_rtc_store_write_reg(size_t reg, uint32_t value);
+uint32_t bsp_rtc_store_read_reg(size_t reg);
+uint32_t bsp_rtc_store_get_reg_count(void);
+void bsp_fake_rtc_store_clear(void);
+
+#define BSP_AES_BLOCK_SIZE (16U)
+
+bool bsp_aes_encrypt_block(const uint8_t *key,
+                           size_t key_size,
+                           const uint8_t in[BSP_AES_BLOCK_SIZE],
+                           uint8_t out[BSP_AES_BLOCK_SIZE]);
+size_t bsp_fake_aes_get_block_count(void);
+void bsp_fake_aes_set_fail(bool is_fail);
+void bsp_fake_aes_reset(void);
+
+uint16_t bsp_crc16_ccitt(const uint8_t *data, uint32_t size, uint16_t crc);
+size_t bsp_fake_crc_get_call_count(void);
+
 uint32_t bsp_get_ticks(void);
 void bsp_fake_forward_ticks_ms(uint32_t ms);
 
+void bsp_cycles_init(void);
+uint32_t bsp_cycles_get(void);
+void bsp_fake_forward_cycles(uint32_t cycles);
+
 void bsp_system_reset(void);
+bool bsp_is_isr(void);
+void bsp_disable_irq(void);
+void bsp_enable_irq(void);
+void bsp_fake_irq_schedule(uint32_t ts, void (*handler)(void));
 
 uint64_t bsp_get_uid64(void);
 
 void bsp_delay_ms(uint32_t ms);
+void bsp_lp_idle(uint32_t idle_ms);
+void bsp_lp_sleep_until(uint32_t ts);
+void bsp_lp_delay_ms(uint32_t ms);
 
 #define BSP_FLASH_SETTINGS_PAGE_SIZE (2048)
 
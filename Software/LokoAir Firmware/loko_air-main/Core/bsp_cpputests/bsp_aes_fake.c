@@ -0,0 +1,159 @@
+#include "bsp.h"
+#include <string.h>
+
+/* Reference FIPS-197 implementation in place of the AES peripheral, independent from the LoRaWAN software AES */
+
+#define AES_BLOCK_SIZE   (16U)
+#define AES_MAX_ROUNDS   (14U)
+#define AES_KEY_SIZE_128 (16U)
+#define AES_KEY_SIZE_256 (32U)
+
+static const uint8_t _sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static size_t _block_count = 0;
+static bool _is_fail = false;
+
+/*----------------------------------------------------------------------------*/
+
+static uint8_t _xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80U) ? 0x1BU : 0x00U));
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void _expand_key(const uint8_t *key, size_t key_size, uint8_t *schedule, size_t round_count) {
+    const size_t NK = key_size / 4;
+    uint8_t rcon = 1;
+
+    memcpy(schedule, key, key_size);
+
+    for (size_t i = NK; i < 4 * (round_count + 1); i++) {
+        uint8_t temp[4];
+        memcpy(temp, &schedule[(i - 1) * 4], sizeof(temp));
+
+        if ((i % NK) == 0) {
+            uint8_t first = temp[0];
+            temp[0] = (uint8_t)(_sbox[temp[1]] ^ rcon);
+            temp[1] = _sbox[temp[2]];
+            temp[2] = _sbox[temp[3]];
+            temp[3] = _sbox[first];
+            rcon = _xtime(rcon);
+        } else if ((NK > 6) && ((i % NK) == 4)) {
+            for (size_t j = 0; j < 4; j++) {
+                temp[j] = _sbox[temp[j]];
+            }
+        }
+
+        for (size_t j = 0; j < 4; j++) {
+            schedule[i * 4 + j] = (uint8_t)(schedule[(i - NK) * 4 + j] ^ temp[j]);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void _add_round_key(uint8_t state[AES_BLOCK_SIZE], const uint8_t *round_key) {
+    for (size_t i = 0; i < AES_BLOCK_SIZE; i++) {
+        state[i] ^= round_key[i];
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void _sub_shift_rows(uint8_t state[AES_BLOCK_SIZE]) {
+    uint8_t temp[AES_BLOCK_SIZE];
+
+    for (size_t col = 0; col < 4; col++) {
+        for (size_t row = 0; row < 4; row++) {
+            temp[col * 4 + row] = _sbox[state[((col + row) % 4) * 4 + row]];
+        }
+    }
+
+    memcpy(state, temp, AES_BLOCK_SIZE);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void _mix_columns(uint8_t state[AES_BLOCK_SIZE]) {
+    for (size_t col = 0; col < 4; col++) {
+        uint8_t *c = &state[col * 4];
+        uint8_t all = (uint8_t)(c[0] ^ c[1] ^ c[2] ^ c[3]);
+        uint8_t first = c[0];
+
+        c[0] ^= (uint8_t)(all ^ _xtime((uint8_t)(c[0] ^ c[1])));
+        c[1] ^= (uint8_t)(all ^ _xtime((uint8_t)(c[1] ^ c[2])));
+        c[2] ^= (uint8_t)(all ^ _xtime((uint8_t)(c[2] ^ c[3])));
+        c[3] ^= (uint8_t)(all ^ _xtime((uint8_t)(c[3] ^ first)));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool bsp_aes_encrypt_block(const uint8_t *key,
+                           size_t key_size,
+                           const uint8_t in[BSP_AES_BLOCK_SIZE],
+                           uint8_t out[BSP_AES_BLOCK_SIZE]) {
+
+    if (((key_size != AES_KEY_SIZE_128) && (key_size != AES_KEY_SIZE_256)) || _is_fail) {
+        return false;
+    }
+
+    const size_t ROUND_COUNT = key_size / 4 + 6;
+    uint8_t schedule[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE];
+    uint8_t state[AES_BLOCK_SIZE];
+
+    _expand_key(key, key_size, schedule, ROUND_COUNT);
+    memcpy(state, in, AES_BLOCK_SIZE);
+    _add_round_key(state, schedule);
+
+    for (size_t round = 1; round <= ROUND_COUNT; round++) {
+        _sub_shift_rows(state);
+
+        if (round != ROUND_COUNT) {
+            _mix_columns(state);
+        }
+
+        _add_round_key(state, &schedule[round * AES_BLOCK_SIZE]);
+    }
+
+    memcpy(out, state, AES_BLOCK_SIZE);
+    _block_count++;
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_fake_aes_get_block_count(void) {
+    return _block_count;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_fake_aes_set_fail(bool is_fail) {
+    _is_fail = is_fail;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_fake_aes_reset(void) {
+    _block_count = 0;
+    _is_fail = false;
+}
@@ -2,17 +2,67 @@
 
 uint32_t _fake_ticks_ms = 0;
 
+static bool _fake_is_irq_disabled = false;
+static uint32_t _fake_irq_ts = 0;
+static void (*_fake_irq_handler)(void) = NULL;
+
+/* The scheduled interrupt handler runs once it is due and the interrupts are enabled */
+static void _fake_irq_run(void) {
+    if ((_fake_irq_handler == NULL) || _fake_is_irq_disabled || ((int32_t)(_fake_irq_ts - _fake_ticks_ms) > 0)) {
+        return;
+    }
+
+    void (*handler)(void) = _fake_irq_handler;
+    _fake_irq_handler = NULL;
+    handler();
+}
+
 uint32_t bsp_get_ticks(void) {
     return _fake_ticks_ms;
 }
 
 void bsp_fake_forward_ticks_ms(uint32_t ms) {
     _fake_ticks_ms += ms;
+    _fake_irq_run();
+}
+
+uint32_t _fake_cycles = 0;
+
+void bsp_cycles_init(void) {
+    _fake_cycles = 0;
+}
+
+uint32_t bsp_cycles_get(void) {
+    return _fake_cycles;
+}
+
+void bsp_fake_forward_cycles(uint32_t cycles) {
+    _fake_cycles += cycles;
 }
 
 void bsp_system_reset(void) {
 }
 
+bool bsp_is_isr(void) {
+    return false;
+}
+
+void bsp_disable_irq(void) {
+    _fake_is_irq_disabled = true;
+}
+
+void bsp_enable_irq(void) {
+    _fake_is_irq_disabled = false;
+    _fake_irq_run();
+}
+
+/* Single interrupt at the ts tick, a NULL handler cancels it */
+void bsp_fake_irq_schedule(uint32_t ts, void (*handler)(void)) {
+    _fake_irq_ts = ts;
+    _fake_irq_handler = handler;
+    _fake_irq_run();
+}
+
 uint64_t bsp_get_uid64(void) {
     return 0x1234567890ABCDEFLL;
 }
@@ -20,4 +70,27 @@ uint64_t bsp_get_uid64(void) {
 void bsp_delay_ms(uint32_t ms) {
     (void)ms;
     return;
-}
\ No newline at end of file
+}
+
+/* The scheduled interrupt ends the idle, a masked one too as it stays pending */
+void bsp_lp_idle(uint32_t idle_ms) {
+    uint32_t wakeup_ts = _fake_ticks_ms + idle_ms;
+
+    if ((_fake_irq_handler != NULL) && ((int32_t)(_fake_irq_ts - wakeup_ts) < 0)) {
+        wakeup_ts = ((int32_t)(_fake_irq_ts - _fake_ticks_ms) > 0) ? _fake_irq_ts : _fake_ticks_ms;
+    }
+
+    _fake_ticks_ms = wakeup_ts;
+    _fake_irq_run();
+}
+
+/* Virtual time, the sleep returns at once with the ticks moved to the deadline */
+void bsp_lp_sleep_until(uint32_t ts) {
+    if ((int32_t)(ts - _fake_ticks_ms) > 0) {
+        _fake_ticks_ms = ts;
+    }
+}
+
+void bsp_lp_delay_ms(uint32_t ms) {
+    _fake_ticks_ms += ms;
+}
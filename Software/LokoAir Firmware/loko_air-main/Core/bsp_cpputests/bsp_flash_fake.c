@@ -11,7 +11,13 @@
 // #define FLASH_GNSS_TRACE_PAGE_ADDR  (FLASH_GNSS_TRACE_PAGE_INDEX * FLASH_PAGE_SIZE + FLASH_BASE)
 #define FLASH_GNSS_TRACE_PAGE_COUNT (2U)
 
-#define FLASH_LORAWAN_NVM_PAGE_COUNT (1U)
+#define FLASH_BLACKBOX_PAGE_COUNT (2U)
+
+#define FLASH_LORAWAN_NVM_PAGE_COUNT (4U)
+#define FLASH_WORD_SIZE              (8U)
+
+#define FLASH_UPDATE_PAGE_COUNT (16U)
+#define FLASH_APP_PAGE_COUNT    (32U)
 
 /*----------------------------------------------------------------------------*/
 static uint8_t _settings_fake_region[FLASH_PAGE_SIZE];
@@ -71,7 +77,47 @@ size_t bsp_flash_get_gnss_trace_page_size(void) {
 
 /*----------------------------------------------------------------------------*/
 
+static uint8_t _blackbox_fake_region[FLASH_PAGE_SIZE * FLASH_BLACKBOX_PAGE_COUNT];
+
+void bsp_flash_blackbox_read(const size_t offset, void *data, const size_t size) {
+    memcpy(data, &_blackbox_fake_region[offset], size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_blackbox_write(const size_t offset, const void *data, const size_t size) {
+    memcpy(&_blackbox_fake_region[offset], data, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_blackbox_erase(size_t page) {
+    if (page >= FLASH_BLACKBOX_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    memset(&_blackbox_fake_region[page * FLASH_PAGE_SIZE], 0xFF, FLASH_PAGE_SIZE);
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_blackbox_page_count(void) {
+    return FLASH_BLACKBOX_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_blackbox_page_size(void) {
+    return FLASH_PAGE_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+
 static uint8_t _lorawan_fake_region[FLASH_PAGE_SIZE * FLASH_LORAWAN_NVM_PAGE_COUNT];
+static size_t _lorawan_erase_counts[FLASH_LORAWAN_NVM_PAGE_COUNT];
+static size_t _lorawan_overwrite_count;
+
 void bsp_flash_lorawan_nvm_read(const size_t offset, void *data, const size_t size) {
 
     memcpy(data, &_lorawan_fake_region[offset], size);
@@ -80,6 +126,15 @@ void bsp_flash_lorawan_nvm_read(const size_t offset, void *data, const size_t si
 /*----------------------------------------------------------------------------*/
 
 void bsp_flash_lorawan_nvm_write(const size_t offset, const void *data, const size_t size) {
+    /* Flash double word is programmed once after the erase */
+    for (size_t i = offset - (offset % FLASH_WORD_SIZE); i < (offset + size); i += FLASH_WORD_SIZE) {
+        for (size_t byte = 0; byte < FLASH_WORD_SIZE; byte++) {
+            if (_lorawan_fake_region[i + byte] != 0xFF) {
+                _lorawan_overwrite_count++;
+                break;
+            }
+        }
+    }
 
     memcpy(&_lorawan_fake_region[offset], data, size);
 }
@@ -88,7 +143,53 @@ void bsp_flash_lorawan_nvm_write(const size_t offset, const void *data, const si
 
 void bsp_flash_lorawan_nvm_erase(void) {
 
-    memset(_lorawan_fake_region, 0, FLASH_LORAWAN_NVM_PAGE_COUNT);
+    for (size_t page = 0; page < FLASH_LORAWAN_NVM_PAGE_COUNT; page++) {
+        bsp_flash_lorawan_nvm_erase_page(page);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_lorawan_nvm_erase_page(size_t page) {
+    if (page >= FLASH_LORAWAN_NVM_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    memset(&_lorawan_fake_region[page * FLASH_PAGE_SIZE], 0xFF, FLASH_PAGE_SIZE);
+    _lorawan_erase_counts[page]++;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_lorawan_nvm_page_count(void) {
+    return FLASH_LORAWAN_NVM_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_lorawan_nvm_page_size(void) {
+    return FLASH_PAGE_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_fake_flash_lorawan_nvm_get_erase_count(size_t page) {
+    return _lorawan_erase_counts[page];
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_fake_flash_lorawan_nvm_get_overwrite_count(void) {
+    return _lorawan_overwrite_count;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_fake_flash_lorawan_nvm_reset(void) {
+    memset(_lorawan_fake_region, 0xFF, sizeof(_lorawan_fake_region));
+    memset(_lorawan_erase_counts, 0, sizeof(_lorawan_erase_counts));
+    _lorawan_overwrite_count = 0;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -99,3 +200,84 @@ void *bsp_flash_lorawan_nvm_get_addr(void) {
 }
 
 /*----------------------------------------------------------------------------*/
+
+static uint8_t _update_fake_region[FLASH_PAGE_SIZE * FLASH_UPDATE_PAGE_COUNT];
+static size_t _update_overwrite_count;
+
+void bsp_flash_update_write(const size_t offset, const void *data, const size_t size) {
+    /* Flash double word is programmed once after the erase */
+    for (size_t i = offset - (offset % FLASH_WORD_SIZE); i < (offset + size); i += FLASH_WORD_SIZE) {
+        for (size_t byte = 0; byte < FLASH_WORD_SIZE; byte++) {
+            if (_update_fake_region[i + byte] != 0xFF) {
+                _update_overwrite_count++;
+                break;
+            }
+        }
+    }
+
+    memcpy(&_update_fake_region[offset], data, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_update_erase(size_t page) {
+    if (page >= FLASH_UPDATE_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    memset(&_update_fake_region[page * FLASH_PAGE_SIZE], 0xFF, FLASH_PAGE_SIZE);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void const *bsp_flash_update_get_addr(void) {
+    return (void const *)_update_fake_region;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_update_page_count(void) {
+    return FLASH_UPDATE_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_fake_flash_update_get_overwrite_count(void) {
+    return _update_overwrite_count;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_fake_flash_update_reset(void) {
+    memset(_update_fake_region, 0xFF, sizeof(_update_fake_region));
+    _update_overwrite_count = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint8_t _app_fake_region[FLASH_PAGE_SIZE * FLASH_APP_PAGE_COUNT];
+
+void mcu_flash_erase_app(void) {
+    memset(_app_fake_region, 0xFF, sizeof(_app_fake_region));
+}
+
+/*----------------------------------------------------------------------------*/
+
+void mcu_flash_write_app(const size_t offset, const void *data, const size_t size) {
+    memcpy(&_app_fake_region[offset], data, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void const *mcu_flash_get_app_addr(void) {
+    return (void const *)_app_fake_region;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t mcu_flash_get_app_size(void) {
+    return sizeof(_app_fake_region);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+#include "bsp.h"
+#include <string.h>
+
+#define RTC_BACKUP_NB (20U)
+
+static uint32_t _backup_regs[RTC_BACKUP_NB] = { 0 };
+
+void bsp_rtc_store_write_reg(size_t reg, uint32_t value) {
+    if (reg >= RTC_BACKUP_NB) {
+        LOG_ERROR("Wrong backup register %u", reg);
+        return;
+    }
+
+    _backup_regs[reg] = value;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t bsp_rtc_store_read_reg(size_t reg) {
+    if (reg >= RTC_BACKUP_NB) {
+        LOG_ERROR("Wrong backup register %u", reg);
+        return 0;
+    }
+
+    return _backup_regs[reg];
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t bsp_rtc_store_get_reg_count(void) {
+    return RTC_BACKUP_NB;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_fake_rtc_store_clear(void) {
+    memset(_backup_regs, 0, sizeof(_backup_regs));
+}
@@ -17,6 +17,10 @@ void bsp_uart_debug_write(uint8_t const *data, size_t size) {
 #endif
 }
 
+void bsp_uart_debug_flush(void) {
+    // The fake output is written right away
+}
+
 size_t bsp_uart_debug_get_buffer(char *out_data, size_t size) {
     size_t copy_size = MIN(size, _out_buffer_index);
 
@@ -43,6 +43,8 @@ void bsp_launch_app(void) {
         return;
     }
 
+    bsp_uart_debug_flush();
+
     for (IRQn_Type irq = 0; irq <= DMAMUX1_OVR_IRQn; irq++) {
         NVIC_DisableIRQ(irq);
     }
@@ -76,6 +78,7 @@ void bsp_enable_irq(void) {
 
 /* -------------------------------------------------------------------------- */
 
+/* Milliseconds of the RTC time base with CONFIG_BSP_USE_RTC, see HAL_GetTick() in bsp_rtc.c, SysTick otherwise */
 uint32_t bsp_get_ticks(void) {
     return HAL_GetTick();
 }
@@ -102,7 +105,29 @@ bool bsp_is_debug_session(void) {
 
 /* -------------------------------------------------------------------------- */
 
+bool bsp_is_isr(void) {
+    return __get_IPSR() != 0U;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* DWT cycle counter runs with the core clock, it stops in the low power modes */
+void bsp_cycles_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t bsp_cycles_get(void) {
+    return DWT->CYCCNT;
+}
+
+/* -------------------------------------------------------------------------- */
+
 void bsp_system_reset(void) {
+    bsp_uart_debug_flush();
     NVIC_SystemReset();
 }
 
@@ -140,6 +165,7 @@ void bsp_fatal_error(size_t code, char *note, char *file, size_t line) {
     LOG_ERROR("\r\nFatal error! %s:%d - %d, %s", file, line, code, note == NULL ? "" : note);
     bsp_soft_breakpoint();
     LOG_ERROR("Reset system");
+    LOG_PROCESS();
     bsp_system_reset();
 }
 
@@ -8,7 +8,9 @@ extern "C" {
 #include <stdint.h>
 
 #include "bsp_adc.h"
+#include "bsp_aes.h"
 #include "bsp_clocks.h"
+#include "bsp_crc.h"
 #include "bsp_flash.h"
 #include "bsp_gpio.h"
 #include <bsp_battery.h>
@@ -40,6 +42,7 @@ bsp_start_reason_t bsp_get_start_reason(void);
 void bsp_init(void);
 void bsp_soft_breakpoint(void);
 bool bsp_is_debug_session(void);
+bool bsp_is_isr(void);
 void bsp_system_reset(void);
 void bsp_disable_irq(void);
 void bsp_enable_irq(void);
@@ -47,6 +50,9 @@ void bsp_enable_irq(void);
 uint32_t bsp_get_ticks(void);
 void bsp_delay_ms(uint32_t ms);
 
+void bsp_cycles_init(void);
+uint32_t bsp_cycles_get(void);
+
 uint64_t bsp_get_uid64(void);
 
 void bsp_fatal_error(size_t code, char *note, char *file, size_t line);
@@ -0,0 +1,93 @@
+#include "stm32wlxx_hal.h"
+#include "stm32wlxx_ll_bus.h"
+
+#include <bsp.h>
+#include <profile/profile.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------*/
+
+#define AES_KEY_SIZE_128      (16U)
+#define AES_KEY_SIZE_256      (32U)
+#define AES_BLOCK_WORD_COUNT  (BSP_AES_BLOCK_SIZE / sizeof(uint32_t))
+#define AES_CCF_TIMEOUT_TICKS (1000U)
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t _read_be32(const uint8_t *data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* KEYR0 holds the last key word, KEYR3/KEYR7 the first one */
+static void _load_key(const uint8_t *key, size_t key_size) {
+    const uint8_t *last = &key[key_size - sizeof(uint32_t)];
+
+    AES->KEYR0 = _read_be32(last);
+    AES->KEYR1 = _read_be32(last - 4);
+    AES->KEYR2 = _read_be32(last - 8);
+    AES->KEYR3 = _read_be32(last - 12);
+
+    if (key_size == AES_KEY_SIZE_256) {
+        AES->KEYR4 = _read_be32(last - 16);
+        AES->KEYR5 = _read_be32(last - 20);
+        AES->KEYR6 = _read_be32(last - 24);
+        AES->KEYR7 = _read_be32(last - 28);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* ECB encryption of a single block, the peripheral is clocked only for the block */
+bool bsp_aes_encrypt_block(const uint8_t *key,
+                           size_t key_size,
+                           const uint8_t in[BSP_AES_BLOCK_SIZE],
+                           uint8_t out[BSP_AES_BLOCK_SIZE]) {
+
+    if ((key_size != AES_KEY_SIZE_128) && (key_size != AES_KEY_SIZE_256)) {
+        return false;
+    }
+
+    PROFILE_BEGIN(PROFILE_SCOPE_AES_BLOCK);
+    LL_AHB3_GRP1_EnableClock(LL_AHB3_GRP1_PERIPH_AES);
+
+    /* Mode 1 (encryption), ECB, byte swapped data so blocks are written as they are in memory */
+    AES->CR = AES_CR_DATATYPE_1 | ((key_size == AES_KEY_SIZE_256) ? AES_CR_KEYSIZE : 0U);
+    _load_key(key, key_size);
+    AES->CR |= AES_CR_EN;
+
+    for (size_t i = 0; i < AES_BLOCK_WORD_COUNT; i++) {
+        uint32_t word;
+        memcpy(&word, &in[i * sizeof(uint32_t)], sizeof(word));
+        AES->DINR = word;
+    }
+
+    uint32_t timeout_ticks = AES_CCF_TIMEOUT_TICKS;
+
+    while ((AES->SR & AES_SR_CCF) == 0U) {
+        timeout_ticks--;
+
+        if (timeout_ticks == 0) {
+            break;
+        }
+    }
+
+    bool is_ok = (timeout_ticks != 0) && ((AES->SR & (AES_SR_RDERR | AES_SR_WRERR)) == 0U);
+
+    if (is_ok) {
+        for (size_t i = 0; i < AES_BLOCK_WORD_COUNT; i++) {
+            uint32_t word = AES->DOUTR;
+            memcpy(&out[i * sizeof(uint32_t)], &word, sizeof(word));
+        }
+    } else {
+        LOG_ERROR("AES block failed, SR 0x%08lX", AES->SR);
+    }
+
+    AES->CR = AES_CR_CCFC | AES_CR_ERRC;
+
+    LL_AHB3_GRP1_DisableClock(LL_AHB3_GRP1_PERIPH_AES);
+    PROFILE_END(PROFILE_SCOPE_AES_BLOCK);
+
+    return is_ok;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BSP_AES_BLOCK_SIZE (16U)
+
+bool bsp_aes_encrypt_block(const uint8_t *key,
+                           size_t key_size,
+                           const uint8_t in[BSP_AES_BLOCK_SIZE],
+                           uint8_t out[BSP_AES_BLOCK_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
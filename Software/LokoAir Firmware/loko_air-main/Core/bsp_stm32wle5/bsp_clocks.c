@@ -155,6 +155,11 @@ void bsp_clock_init(void) {
 /* -------------------------------------------------------------------------- */
 
 void bsp_clock_switch(bsp_clock_list_t freq) {
+    if (bsp_clock_cpu_core_freq_hz() != freq) {
+        /* The debug UART clock follows the core one */
+        bsp_uart_debug_flush();
+    }
+
     if (bsp_clock_cpu_core_freq_hz() > freq) {
         _clock_down_to_switch(freq);
     } else if (bsp_clock_cpu_core_freq_hz() < freq) {
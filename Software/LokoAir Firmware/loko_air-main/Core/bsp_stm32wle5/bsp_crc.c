@@ -0,0 +1,41 @@
+#include "stm32wlxx_hal.h"
+#include "stm32wlxx_ll_bus.h"
+
+#include <bsp.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------*/
+
+#define CRC16_CCITT_POLY (0x1021U)
+
+/*----------------------------------------------------------------------------*/
+
+/* CRC-16/CCITT on the CRC unit: 16 bit polynomial, no input/output reversal, the given crc is the init value */
+uint16_t bsp_crc16_ccitt(const uint8_t *data, uint32_t size, uint16_t crc) {
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+
+    CRC->POL = CRC16_CCITT_POLY;
+    CRC->INIT = crc;
+    CRC->CR = CRC_CR_POLYSIZE_0 | CRC_CR_RESET;
+
+    /* Word writes are processed MSB first, byte swap keeps the memory order of the stream */
+    while (size >= sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        CRC->DR = __REV(word);
+        data += sizeof(uint32_t);
+        size -= sizeof(uint32_t);
+    }
+
+    while (size > 0) {
+        *(__IO uint8_t *)&CRC->DR = *data;
+        data++;
+        size--;
+    }
+
+    crc = (uint16_t)CRC->DR;
+
+    LL_AHB1_GRP1_DisableClock(LL_AHB1_GRP1_PERIPH_CRC);
+
+    return crc;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+uint16_t bsp_crc16_ccitt(const uint8_t *data, uint32_t size, uint16_t crc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,8 @@
 #include "stm32wlxx_hal.h"
 #include <bsp.h>
 #include <bsp_flash_layout.h>
+#include <profile/profile.h>
+#include <stats/stats.h>
 #include <string.h>
 
 /*----------------------------------------------------------------------------*/
@@ -10,17 +12,19 @@ static void _flash_write(const size_t offset_in, const void *data, const size_t
     size_t left_size = size;
     size_t offset = offset_in;
 
-    HAL_FLASH_Unlock();
-
     if (offset % FLASH_WORD_SIZE) {
         LOG_ERROR("Error flash write: address not aligned to 8");
         return;
     }
 
+    PROFILE_BEGIN(PROFILE_SCOPE_FLASH_WRITE);
+    HAL_FLASH_Unlock();
+
     while (left_size >= FLASH_WORD_SIZE) {
         uint64_t aligned_double_word;
         memcpy(&aligned_double_word, data, FLASH_WORD_SIZE);
         HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, offset, aligned_double_word);
+        stats_inc(STATS_COUNTER_FLASH_PROGRAMS);
         left_size -= FLASH_WORD_SIZE;
         offset += FLASH_WORD_SIZE;
         data += FLASH_WORD_SIZE;
@@ -30,9 +34,11 @@ static void _flash_write(const size_t offset_in, const void *data, const size_t
         uint64_t read_mod_write_buff = *(uint64_t *)(offset);
         memcpy(&read_mod_write_buff, data, left_size);
         HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, offset, read_mod_write_buff);
+        stats_inc(STATS_COUNTER_FLASH_PROGRAMS);
     }
 
     HAL_FLASH_Lock();
+    PROFILE_END(PROFILE_SCOPE_FLASH_WRITE);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -51,6 +57,7 @@ static void _flash_erase(size_t page, size_t count) {
     if (HAL_FLASHEx_Erase(&erase_param, &page_error) != HAL_OK) {
         // TODO Print
     }
+    stats_add(STATS_COUNTER_FLASH_ERASES, (uint32_t)count);
 
     HAL_FLASH_Lock();
 }
@@ -110,6 +117,41 @@ size_t bsp_flash_get_gnss_trace_page_size(void) {
 
 /*----------------------------------------------------------------------------*/
 
+void bsp_flash_blackbox_read(const size_t offset, void *data, const size_t size) {
+    memcpy(data, (void *)(FLASH_BLACKBOX_PAGE_ADDR + offset), size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_blackbox_write(const size_t offset, const void *data, const size_t size) {
+    _flash_write(FLASH_BLACKBOX_PAGE_ADDR + offset, data, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_blackbox_erase(size_t page) {
+    if (page >= FLASH_BLACKBOX_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    _flash_erase(FLASH_BLACKBOX_PAGE_INDEX + page, 1);
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_blackbox_page_count(void) {
+    return FLASH_BLACKBOX_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_blackbox_page_size(void) {
+    return FLASH_PAGE_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+
 void bsp_flash_lorawan_nvm_read(const size_t offset, void *data, const size_t size) {
 
     memcpy(data, (void *)(FLASH_LORAWAN_NVM_PAGE_ADDR + offset), size);
@@ -130,6 +172,29 @@ void bsp_flash_lorawan_nvm_erase(void) {
 
 /*----------------------------------------------------------------------------*/
 
+void bsp_flash_lorawan_nvm_erase_page(size_t page) {
+    if (page >= FLASH_LORAWAN_NVM_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    _flash_erase(FLASH_LORAWAN_NVM_PAGE_INDEX + page, 1);
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_lorawan_nvm_page_count(void) {
+    return FLASH_LORAWAN_NVM_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_lorawan_nvm_page_size(void) {
+    return FLASH_PAGE_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+
 void *bsp_flash_lorawan_nvm_get_addr(void) {
 
     return (void *)FLASH_LORAWAN_NVM_PAGE_ADDR;
@@ -137,12 +202,51 @@ void *bsp_flash_lorawan_nvm_get_addr(void) {
 
 /*----------------------------------------------------------------------------*/
 
+void bsp_flash_update_write(const size_t offset, const void *data, const size_t size) {
+    _flash_write(FLASH_UPDATE_PAGE_ADDR + offset, data, size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void bsp_flash_update_erase(size_t page) {
+    if (page >= FLASH_UPDATE_PAGE_COUNT) {
+        LOG_ERROR("Wrong erase page %u", page);
+        return;
+    }
+
+    _flash_erase(FLASH_UPDATE_PAGE_INDEX + page, 1);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void const *bsp_flash_update_get_addr(void) {
+    return (const void *)FLASH_UPDATE_PAGE_ADDR;
+}
+
+/*----------------------------------------------------------------------------*/
+
+size_t bsp_flash_get_update_page_count(void) {
+    return FLASH_UPDATE_PAGE_COUNT;
+}
+
+/*----------------------------------------------------------------------------*/
+
 void mcu_flash_erase_app(void) {
     _flash_erase(FLASH_APP_PAGE_INDEX, FLASH_APP_PAGE_COUNT);
 }
 
 /*----------------------------------------------------------------------------*/
 
+void mcu_flash_erase_app_page(const size_t offset) {
+    if (offset >= (FLASH_APP_PAGE_COUNT * FLASH_PAGE_SIZE)) {
+        return;
+    }
+
+    _flash_erase(FLASH_APP_PAGE_INDEX + (offset / FLASH_PAGE_SIZE), 1);
+}
+
+/*----------------------------------------------------------------------------*/
+
 void mcu_flash_write_app(const size_t offset, const void *data, const size_t size) {
     _flash_write(FLASH_APP_PAGE_ADDR + offset, data, size);
 }
@@ -175,6 +279,14 @@ void mcu_flash_print_info(void) {
              (uint32_t)mcu_flash_get_app_addr(),
              (uint32_t)(mcu_flash_get_app_addr() + mcu_flash_get_app_size() - 1),
              (uint32_t)__BYTES_TO_KILOBYTES(mcu_flash_get_app_size()));
+    LOG_INFO("Blackbox      | 0x%08" PRIX32 " | 0x%08" PRIX32 " |  %08" PRIu32 " |",
+             (uint32_t)FLASH_BLACKBOX_PAGE_ADDR,
+             (uint32_t)(FLASH_BLACKBOX_PAGE_ADDR + FLASH_BLACKBOX_PAGE_SIZE - 1),
+             (uint32_t)__BYTES_TO_KILOBYTES(FLASH_BLACKBOX_PAGE_SIZE));
+    LOG_INFO("Update        | 0x%08" PRIX32 " | 0x%08" PRIX32 " |  %08" PRIu32 " |",
+             (uint32_t)FLASH_UPDATE_PAGE_ADDR,
+             (uint32_t)(FLASH_UPDATE_PAGE_ADDR + FLASH_UPDATE_PAGE_SIZE - 1),
+             (uint32_t)__BYTES_TO_KILOBYTES(FLASH_UPDATE_PAGE_SIZE));
     LOG_INFO("LoraWAN NVM   | 0x%08" PRIX32 " | 0x%08" PRIX32 " |  %08" PRIu32 " |",
              (uint32_t)bsp_flash_lorawan_nvm_get_addr(),
              (uint32_t)(bsp_flash_lorawan_nvm_get_addr() + FLASH_LORAWAN_NVM_PAGE_SIZE - 1),
@@ -16,12 +16,27 @@ void bsp_flash_gnss_trace_erase(size_t page);
 size_t bsp_flash_get_gnss_trace_page_count(void);
 size_t bsp_flash_get_gnss_trace_page_size(void);
 
+void bsp_flash_blackbox_read(const size_t offset, void *data, const size_t size);
+void bsp_flash_blackbox_write(const size_t offset, const void *data, const size_t size);
+void bsp_flash_blackbox_erase(size_t page);
+size_t bsp_flash_get_blackbox_page_count(void);
+size_t bsp_flash_get_blackbox_page_size(void);
+
 void bsp_flash_lorawan_nvm_read(const size_t offset, void *data, const size_t size);
 void bsp_flash_lorawan_nvm_write(const size_t offset, const void *data, const size_t size);
 void bsp_flash_lorawan_nvm_erase(void);
+void bsp_flash_lorawan_nvm_erase_page(size_t page);
+size_t bsp_flash_get_lorawan_nvm_page_count(void);
+size_t bsp_flash_get_lorawan_nvm_page_size(void);
 void *bsp_flash_lorawan_nvm_get_addr(void);
 
+void bsp_flash_update_write(const size_t offset, const void *data, const size_t size);
+void bsp_flash_update_erase(size_t page);
+void const *bsp_flash_update_get_addr(void);
+size_t bsp_flash_get_update_page_count(void);
+
 void mcu_flash_erase_app(void);
+void mcu_flash_erase_app_page(const size_t offset);
 void mcu_flash_write_app(const size_t offset, const void *data, const size_t size);
 void const *mcu_flash_get_app_addr(void);
 size_t mcu_flash_get_app_size(void);
@@ -14,12 +14,25 @@
 #define FLASH_APP_PAGE_ADDR  __PAGE_INDEX_TO_ARRD(FLASH_APP_PAGE_INDEX)
 #define FLASH_APP_PAGE_COUNT                                                                 \
     (128 - FLASH_BLDR_PAGE_COUNT - FLASH_SETTINGS_PAGE_COUNT - FLASH_GNSS_TRACE_PAGE_COUNT - \
-     FLASH_LORAWAN_NVM_PAGE_COUNT)
+     FLASH_LORAWAN_NVM_PAGE_COUNT - FLASH_UPDATE_PAGE_COUNT - FLASH_BLACKBOX_PAGE_COUNT)
 #define FLASH_APP_PAGE_SIZE __PAGE_COUNT_TO_SIZE(FLASH_APP_PAGE_COUNT)
 
-#define FLASH_LORAWAN_NVM_PAGE_INDEX (FLASH_GNSS_TRACE_PAGE_INDEX - 1U)
+/* Wakeup cycle records, taken from the end of the application so the update staging stays in place */
+#define FLASH_BLACKBOX_PAGE_INDEX (FLASH_UPDATE_PAGE_INDEX - FLASH_BLACKBOX_PAGE_COUNT)
+#define FLASH_BLACKBOX_PAGE_ADDR  __PAGE_INDEX_TO_ARRD(FLASH_BLACKBOX_PAGE_INDEX)
+#define FLASH_BLACKBOX_PAGE_COUNT (2U)
+#define FLASH_BLACKBOX_PAGE_SIZE  __PAGE_COUNT_TO_SIZE(FLASH_BLACKBOX_PAGE_COUNT)
+
+/* Delta patch staging, then the scratch and the journal pages */
+#define FLASH_UPDATE_PAGE_INDEX (FLASH_LORAWAN_NVM_PAGE_INDEX - FLASH_UPDATE_PAGE_COUNT)
+#define FLASH_UPDATE_PAGE_ADDR  __PAGE_INDEX_TO_ARRD(FLASH_UPDATE_PAGE_INDEX)
+#define FLASH_UPDATE_PAGE_COUNT (16U)
+#define FLASH_UPDATE_PAGE_SIZE  __PAGE_COUNT_TO_SIZE(FLASH_UPDATE_PAGE_COUNT)
+
+/* Context snapshots with the frame counter journal, rotated over the pages for wear levelling */
+#define FLASH_LORAWAN_NVM_PAGE_INDEX (FLASH_GNSS_TRACE_PAGE_INDEX - FLASH_LORAWAN_NVM_PAGE_COUNT)
 #define FLASH_LORAWAN_NVM_PAGE_ADDR  __PAGE_INDEX_TO_ARRD(FLASH_LORAWAN_NVM_PAGE_INDEX)
-#define FLASH_LORAWAN_NVM_PAGE_COUNT (1U)
+#define FLASH_LORAWAN_NVM_PAGE_COUNT (4U)
 #define FLASH_LORAWAN_NVM_PAGE_SIZE  __PAGE_COUNT_TO_SIZE(FLASH_LORAWAN_NVM_PAGE_COUNT)
 
 #define FLASH_GNSS_TRACE_PAGE_INDEX (FLASH_SETTINGS_PAGE_INDEX - FLASH_GNSS_TRACE_PAGE_COUNT)
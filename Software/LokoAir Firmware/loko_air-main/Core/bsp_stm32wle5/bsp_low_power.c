@@ -7,6 +7,47 @@
 #include "stm32wlxx_ll_system.h"
 #include "stm32wlxx_ll_utils.h"
 #include <bsp.h>
+#include <stats/stats.h>
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef BSP_LP_STOP2_ENABLED
+#    define BSP_LP_STOP2_ENABLED (1U)
+#endif
+
+/* Shorter idle stays in Sleep, Stop2 entry and the clock restore do not pay off */
+#define STOP2_MIN_IDLE_MS (5U)
+
+/* -------------------------------------------------------------------------- */
+
+#if CONFIG_BSP_USE_RTC == 1
+static bool _is_stop2_allowed(uint32_t idle_ms) {
+    if ((BSP_LP_STOP2_ENABLED == 0) || (idle_ms < STOP2_MIN_IDLE_MS)) {
+        return false;
+    }
+
+    /* Stop2 drops the debugger connection and the debug UART output in progress. USART1 receives nothing in Stop2,
+     * so the debug console keeps working with the USB power where the consumption does not matter */
+    if (bsp_is_debug_session() || bsp_gpio_is_usb_charger_connect()) {
+        return false;
+    }
+
+    return bsp_uart_debug_is_tx_busy() == false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Stop2 wakes up on MSI of the range set before, see bsp_init(). Its PLL mode is locked to LSE again */
+static void _restore_clocks(void) {
+    while (LL_RCC_MSI_IsReady() != 1) {
+        // Wait for complete
+    }
+
+    while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_MSI) {
+        // Wait for complete
+    }
+}
+#endif /* CONFIG_BSP_USE_RTC == 1 */
 
 /* -------------------------------------------------------------------------- */
 
@@ -53,3 +94,58 @@ void bsp_lp_sleep(void) {
 }
 
 /* -------------------------------------------------------------------------- */
+
+void bsp_lp_idle(uint32_t idle_ms) {
+#if CONFIG_BSP_USE_RTC == 1
+    if (idle_ms == 0) {
+        return;
+    }
+
+    /* SysTick is stopped, so the RTC wakeup timer bounds Sleep as well */
+    bsp_rtc_setup_idle_wakeup((idle_ms < BSP_RTC_IDLE_WAKEUP_MAX_MS) ? idle_ms : BSP_RTC_IDLE_WAKEUP_MAX_MS);
+
+    /* Pending interrupt ends WFI with the interrupts masked too, the handler runs once the clocks are restored */
+    const uint32_t PRIMASK = __get_PRIMASK();
+    __disable_irq();
+
+    if (_is_stop2_allowed(idle_ms)) {
+        const uint32_t START_TS = bsp_get_ticks();
+
+        HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+        _restore_clocks();
+
+        stats_inc(STATS_COUNTER_STOP2_ENTRIES);
+        stats_add(STATS_COUNTER_STOP2_MS, bsp_get_ticks() - START_TS);
+    } else {
+        bsp_lp_sleep();
+    }
+
+    __set_PRIMASK(PRIMASK);
+    bsp_rtc_wakeup_deactivate();
+#else
+    (void)idle_ms;
+    bsp_lp_sleep();
+#endif /* CONFIG_BSP_USE_RTC == 1 */
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Every interrupt ends the idle, so it is repeated for the time left */
+void bsp_lp_sleep_until(uint32_t ts) {
+    for (;;) {
+        const int32_t LEFT_MS = (int32_t)(ts - bsp_get_ticks());
+        if (LEFT_MS <= 0) {
+            return;
+        }
+
+        bsp_lp_idle((uint32_t)LEFT_MS);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bsp_lp_delay_ms(uint32_t ms) {
+    bsp_lp_sleep_until(bsp_get_ticks() + ms);
+}
+
+/* -------------------------------------------------------------------------- */
@@ -12,6 +12,13 @@ typedef enum {
 
 void bsp_lp_shutdown(bsp_wakeup_source_mask_list_t source_mask, size_t sleep_time_s);
 void bsp_lp_sleep(void);
+/* Idle until an interrupt or idle_ms later, Stop2 is chosen when it pays off and nothing needs the clocks running.
+ * May be called with the interrupts masked, a pending one still ends the idle */
+void bsp_lp_idle(uint32_t idle_ms);
+/* Low-power waits of the main loop until the bsp_get_ticks() deadline, the interrupts are served meanwhile.
+ * Not for the interrupt context, bsp_delay_ms() busy waits there */
+void bsp_lp_sleep_until(uint32_t ts);
+void bsp_lp_delay_ms(uint32_t ms);
 
 #ifdef __cplusplus
 }
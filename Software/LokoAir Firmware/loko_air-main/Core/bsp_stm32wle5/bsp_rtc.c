@@ -8,11 +8,27 @@
 // static
 RTC_HandleTypeDef _rtc;
 
+/* Time base of the firmware, milliseconds since bsp_rtc_init() out of the 32-bit RTC counter extended by its wraps */
+static struct {
+    bool is_running;       /* Binary counter runs, false before the init and after the reinit for the shutdown */
+    uint32_t last_counter; /* The latest counter read, a smaller one means a wrap */
+    uint32_t wraps;        /* Counter wraps since the init, one in 48 days */
+    uint64_t start;        /* Extended counter at the init */
+    uint32_t ms;           /* The latest time, kept while the counter does not run */
+} _time = { 0 };
+
 /* -------------------------------------------------------------------------- */
 #define RTC_N_PREDIV_S 10
 #define RTC_PREDIV_S   ((1 << RTC_N_PREDIV_S) - 1)
 #define RTC_PREDIV_A   ((1 << (15 - RTC_N_PREDIV_S)) - 1)
 
+#define IDLE_WAKEUP_TIMER_HZ  (LSE_VALUE / 16U)
+#define IDLE_WAKEUP_MAX_COUNT (0x10000UL)
+
+#if (1 << RTC_N_PREDIV_S) != BSP_RTC_COUNTER_HZ
+#    error BSP_RTC_COUNTER_HZ does not match the RTC prescaler
+#endif
+
 void bsp_rtc_init(void) {
     _rtc.Instance = RTC;
     _rtc.Init.HourFormat = RTC_HOURFORMAT_24;
@@ -37,6 +53,15 @@ void bsp_rtc_init(void) {
         BSP_FATAL(ret, NULL);
     }
 
+    /* The counter is read directly, not through the shadow registers */
+    HAL_RTCEx_EnableBypassShadow(&_rtc);
+
+    _time.last_counter = bsp_rtc_get_counter();
+    _time.wraps = 0;
+    _time.start = _time.last_counter;
+    _time.ms = 0;
+    _time.is_running = true;
+
     RTC_AlarmTypeDef sAlarm = { 0 };
     sAlarm.BinaryAutoClr = RTC_ALARMSUBSECONDBIN_AUTOCLR_NO;
     sAlarm.AlarmTime.SubSeconds = 0x0;
@@ -47,11 +72,19 @@ void bsp_rtc_init(void) {
 
     HAL_NVIC_SetPriority(RTC_Alarm_IRQn, 0, 0);
     HAL_NVIC_EnableIRQ(RTC_Alarm_IRQn);
+
+    /* Wakeup timer ends the Stop2 idle, WFI needs the interrupt enabled */
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
 }
 
 /* -------------------------------------------------------------------------- */
 
 static void _reinit_rtc_for_1s(void) {
+    /* Calendar mode counts the sub-seconds another way, the time stops until the shutdown */
+    bsp_rtc_get_ms();
+    _time.is_running = false;
+
     _rtc.Instance = RTC;
     _rtc.Init.HourFormat = RTC_HOURFORMAT_24;
     _rtc.Init.AsynchPrediv = 0x7F;
@@ -118,6 +151,7 @@ void HAL_RTC_MspDeInit(RTC_HandleTypeDef *rtc_handle) {
 
         HAL_NVIC_DisableIRQ(TAMP_STAMP_LSECSS_SSRU_IRQn);
         HAL_NVIC_DisableIRQ(RTC_Alarm_IRQn);
+        HAL_NVIC_DisableIRQ(RTC_WKUP_IRQn);
     }
 }
 
@@ -144,6 +178,22 @@ void bsp_rtc_setup_wakeup_timer(uint32_t timeout_s) {
 
 /* -------------------------------------------------------------------------- */
 
+/* Wakeup timer of the idle, the RTC keeps running in the binary mode unlike bsp_rtc_setup_wakeup_timer() */
+void bsp_rtc_setup_idle_wakeup(uint32_t timeout_ms) {
+    uint32_t count = (uint32_t)(((uint64_t)timeout_ms * IDLE_WAKEUP_TIMER_HZ) / 1000U);
+
+    count = (count == 0) ? 1U : count;
+    count = (count > IDLE_WAKEUP_MAX_COUNT) ? IDLE_WAKEUP_MAX_COUNT : count;
+
+    HAL_StatusTypeDef ret = HAL_RTCEx_SetWakeUpTimer_IT(&_rtc, count - 1U, RTC_WAKEUPCLOCK_RTCCLK_DIV16, 0);
+
+    if (ret != HAL_OK) {
+        BSP_FATAL(ret, NULL);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
 bool bsp_rtc_is_wakeup_activated(void) {
     return (_rtc.Instance->CR & RTC_CR_WUTE);
 }
@@ -174,3 +224,71 @@ uint32_t bsp_rtc_store_get_reg_count(void) {
 }
 
 /* -------------------------------------------------------------------------- */
+
+/* Free running counter at BSP_RTC_COUNTER_HZ, it keeps counting in Stop2. Sub-second register counts down and is
+ * clocked asynchronously to the bus, so it is read until two reads match */
+uint32_t bsp_rtc_get_counter(void) {
+    uint32_t ssr = _rtc.Instance->SSR;
+
+    while (ssr != _rtc.Instance->SSR) {
+        ssr = _rtc.Instance->SSR;
+    }
+
+    return UINT32_MAX - ssr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* It is called from the interrupt handlers too, the wrap accounting is done with the interrupts disabled */
+uint32_t bsp_rtc_get_ms(void) {
+    const uint32_t PRIMASK = __get_PRIMASK();
+    __disable_irq();
+
+    if (_time.is_running) {
+        const uint32_t COUNTER = bsp_rtc_get_counter();
+
+        if (COUNTER < _time.last_counter) {
+            _time.wraps++;
+        }
+        _time.last_counter = COUNTER;
+
+        const uint64_t COUNTS = ((((uint64_t)_time.wraps) << 32) | COUNTER) - _time.start;
+        _time.ms = (uint32_t)((COUNTS * 1000U) >> RTC_N_PREDIV_S);
+    }
+
+    const uint32_t MS = _time.ms;
+    __set_PRIMASK(PRIMASK);
+
+    return MS;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#if CONFIG_BSP_USE_RTC == 1
+/* HAL tick is the RTC time, SysTick does not run. HAL_Delay() and the HAL timeouts follow it, before bsp_rtc_init()
+ * the time stands still and the HAL waits only for their flags */
+HAL_StatusTypeDef HAL_InitTick(uint32_t tick_priority) {
+    (void)tick_priority;
+    SysTick->CTRL = 0;
+
+    return HAL_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t HAL_GetTick(void) {
+    return bsp_rtc_get_ms();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void HAL_SuspendTick(void) {
+}
+
+/* -------------------------------------------------------------------------- */
+
+void HAL_ResumeTick(void) {
+}
+#endif /* CONFIG_BSP_USE_RTC == 1 */
+
+/* -------------------------------------------------------------------------- */
@@ -6,10 +6,16 @@ extern "C" {
 
 #include "stdbool.h"
 
+#define BSP_RTC_COUNTER_HZ         (1024U)  /*<! Binary sub-second counter */
+#define BSP_RTC_IDLE_WAKEUP_MAX_MS (31000U) /*<! 16-bit wakeup timer at LSE / 16 */
+
 void bsp_rtc_init(void);
 void bsp_rtc_setup_wakeup_timer(uint32_t timeout_s);
+void bsp_rtc_setup_idle_wakeup(uint32_t timeout_ms);
 bool bsp_rtc_is_wakeup_activated(void);
 void bsp_rtc_wakeup_deactivate(void);
+uint32_t bsp_rtc_get_counter(void);
+uint32_t bsp_rtc_get_ms(void);
 
 void bsp_rtc_store_write_reg(size_t reg, uint32_t value);
 uint32_t bsp_rtc_store_read_reg(size_t reg);
@@ -1,5 +1,6 @@
 #include "bsp.h"
 #include "bsp_subghz.h"
+#include <profile/profile.h>
 
 #include "stm32wlxx_hal.h"
 #include "stm32wlxx_ll_lpuart.h"
@@ -68,7 +69,9 @@ void SysTick_Handler(void) {
 /*---------------------------------------------------------------------------*/
 
 void DMA1_Channel1_IRQHandler(void) {
-    _ENTRY_TRACE();
+#if CONFIG_BSP_USE_UART == 1
+    bsp_uart_debug_dma_tx_handler();
+#endif /* CONFIG_BSP_USE_UART == 1 */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -120,6 +123,8 @@ void USART1_IRQHandler(void) {
 
 void LPUART1_IRQHandler(void) {
 #if CONFIG_BSP_USE_UART == 1
+    PROFILE_BEGIN(PROFILE_SCOPE_GNSS_UART_ISR);
+
     if (LL_LPUART_IsActiveFlag_RXNE(LPUART1)) {
         /* RXNE flag will be cleared by reading of RDR register (done in call) */
         /* Call function in charge of handling Character reception */
@@ -135,6 +140,8 @@ void LPUART1_IRQHandler(void) {
     } else if (LL_LPUART_IsActiveFlag_PE(LPUART1)) {
         LL_LPUART_ClearFlag_PE(LPUART1);
     }
+
+    PROFILE_END(PROFILE_SCOPE_GNSS_UART_ISR);
 #endif /* CONFIG_BSP_USE_UART == 1 */
 }
 
@@ -168,7 +175,10 @@ void PVD_PVM_IRQHandler(void) {
 /*---------------------------------------------------------------------------*/
 
 void RTC_WKUP_IRQHandler(void) {
-    _ENTRY_TRACE();
+#if CONFIG_BSP_USE_RTC == 1
+    extern RTC_HandleTypeDef _rtc;
+    HAL_RTCEx_WakeUpTimerIRQHandler(&_rtc);
+#endif /* CONFIG_BSP_USE_RTC */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -16,10 +16,35 @@
 #include "bsp.h"
 #include "bsp_board.h"
 
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Debug output is copied to the ring and sent by DMA1 channel 1, the transfer complete interrupt starts the next
+ * contiguous chunk. When the ring is full the writer waits for the running transfer, nothing is dropped */
+#ifndef BSP_UART_DEBUG_TX_RING_SIZE
+#    define BSP_UART_DEBUG_TX_RING_SIZE (2048U)
+#endif
+
+#if (BSP_UART_DEBUG_TX_RING_SIZE & (BSP_UART_DEBUG_TX_RING_SIZE - 1U)) != 0
+#    error BSP_UART_DEBUG_TX_RING_SIZE must be a power of 2
+#endif
+
+#define DEBUG_TX_DMA_CHANNEL (LL_DMA_CHANNEL_1)
+
+static struct {
+    uint8_t data[BSP_UART_DEBUG_TX_RING_SIZE];
+    volatile uint32_t head;     /*<! Free running, written by bsp_uart_debug_write() */
+    volatile uint32_t tail;     /*<! Free running, moved when a DMA transfer is complete */
+    volatile uint32_t dma_size; /*<! Size of the running DMA transfer, 0 when DMA is idle */
+    bool is_ready;
+} _debug_tx = { 0 };
+
 /* -------------------------------------------------------------------------- */
 
 void bsp_uart_gnss_init(void) {
-    LL_RCC_SetLPUARTClockSource(LL_RCC_LPUART1_CLKSOURCE_SYSCLK);  // LSE allow max baudrate=9600
+    /* LSE allows 9600 at most, it keeps the baud rate over the core clock switches and runs in Stop2 */
+    LL_RCC_SetLPUARTClockSource(LL_RCC_LPUART1_CLKSOURCE_LSE);
 
     LL_APB1_GRP2_EnableClock(LL_APB1_GRP2_PERIPH_LPUART1);
     LL_AHB2_GRP1_EnableClock(LL_AHB2_GRP1_PERIPH_GPIOC);
@@ -60,6 +85,9 @@ void bsp_uart_gnss_init(void) {
     LL_LPUART_Init(LPUART1, &uart_init);
     LL_LPUART_SetTXFIFOThreshold(LPUART1, LL_LPUART_FIFOTHRESHOLD_1_8);
     LL_LPUART_SetRXFIFOThreshold(LPUART1, LL_LPUART_FIFOTHRESHOLD_1_8);
+    /* Received byte wakes the core up from Stop2 by RXNE, EXTI line 28 is the LPUART1 wakeup */
+    LL_LPUART_EnableInStopMode(LPUART1);
+    LL_EXTI_EnableIT_0_31(LL_EXTI_LINE_28);
     LL_LPUART_Enable(LPUART1);
 
     /* Polling LPUART1 initialisation */
@@ -95,17 +123,27 @@ void bsp_uart_debug_init(void) {
     gpio_init.Pin = USB_TXD_PIN;
     LL_GPIO_Init(USB_TXD_GPIO_PORT, &gpio_init);
 
-#if ENMABLE_USART1_DMA_TX == 1
     /* USART1_TX Init */
-    LL_DMA_SetPeriphRequest(DMA1, LL_DMA_CHANNEL_1, LL_DMAMUX_REQ_USART1_TX);
-    LL_DMA_SetDataTransferDirection(DMA1, LL_DMA_CHANNEL_1, LL_DMA_DIRECTION_MEMORY_TO_PERIPH);
-    LL_DMA_SetChannelPriorityLevel(DMA1, LL_DMA_CHANNEL_1, LL_DMA_PRIORITY_LOW);
-    LL_DMA_SetMode(DMA1, LL_DMA_CHANNEL_1, LL_DMA_MODE_NORMAL);
-    LL_DMA_SetPeriphIncMode(DMA1, LL_DMA_CHANNEL_1, LL_DMA_PERIPH_NOINCREMENT);
-    LL_DMA_SetMemoryIncMode(DMA1, LL_DMA_CHANNEL_1, LL_DMA_MEMORY_INCREMENT);
-    LL_DMA_SetPeriphSize(DMA1, LL_DMA_CHANNEL_1, LL_DMA_PDATAALIGN_BYTE);
-    LL_DMA_SetMemorySize(DMA1, LL_DMA_CHANNEL_1, LL_DMA_MDATAALIGN_BYTE);
-#endif
+    _debug_tx.is_ready = false;
+    LL_DMA_DisableChannel(DMA1, DEBUG_TX_DMA_CHANNEL);
+    LL_DMA_ClearFlag_GI1(DMA1);
+    _debug_tx.head = 0;
+    _debug_tx.tail = 0;
+    _debug_tx.dma_size = 0;
+
+    LL_DMA_SetPeriphRequest(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMAMUX_REQ_USART1_TX);
+    LL_DMA_SetDataTransferDirection(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_DIRECTION_MEMORY_TO_PERIPH);
+    LL_DMA_SetChannelPriorityLevel(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_PRIORITY_LOW);
+    LL_DMA_SetMode(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_MODE_NORMAL);
+    LL_DMA_SetPeriphIncMode(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_PERIPH_NOINCREMENT);
+    LL_DMA_SetMemoryIncMode(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_MEMORY_INCREMENT);
+    LL_DMA_SetPeriphSize(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_PDATAALIGN_BYTE);
+    LL_DMA_SetMemorySize(DMA1, DEBUG_TX_DMA_CHANNEL, LL_DMA_MDATAALIGN_BYTE);
+    LL_DMA_SetPeriphAddress(DMA1,
+                            DEBUG_TX_DMA_CHANNEL,
+                            LL_USART_DMA_GetRegAddr(USART1, LL_USART_DMA_REG_DATA_TRANSMIT));
+    LL_DMA_EnableIT_TC(DMA1, DEBUG_TX_DMA_CHANNEL);
+    LL_DMA_EnableIT_TE(DMA1, DEBUG_TX_DMA_CHANNEL);
 
     LL_USART_InitTypeDef uart_init = {
         .PrescalerValue = LL_USART_PRESCALER_DIV1,
@@ -122,6 +160,7 @@ void bsp_uart_debug_init(void) {
     LL_USART_SetRXFIFOThreshold(USART1, LL_USART_FIFOTHRESHOLD_1_8);
     LL_USART_DisableFIFO(USART1);
     LL_USART_ConfigAsyncMode(USART1);
+    LL_USART_EnableDMAReq_TX(USART1);
 
     LL_USART_Enable(USART1);
 
@@ -134,19 +173,153 @@ void bsp_uart_debug_init(void) {
     NVIC_EnableIRQ(USART1_IRQn);
     LL_USART_EnableIT_RXNE(USART1);
     LL_USART_EnableIT_ERROR(USART1);
+
+    _debug_tx.is_ready = true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Must be called with disabled interrupts */
+static void _debug_tx_start(void) {
+    const uint32_t USED = _debug_tx.head - _debug_tx.tail;
+
+    if ((_debug_tx.dma_size != 0) || (USED == 0)) {
+        return;
+    }
+
+    const uint32_t INDEX = _debug_tx.tail & (BSP_UART_DEBUG_TX_RING_SIZE - 1U);
+    const uint32_t TO_END = BSP_UART_DEBUG_TX_RING_SIZE - INDEX;
+
+    _debug_tx.dma_size = (USED < TO_END) ? USED : TO_END;
+    LL_DMA_SetMemoryAddress(DMA1, DEBUG_TX_DMA_CHANNEL, (uint32_t)&_debug_tx.data[INDEX]);
+    LL_DMA_SetDataLength(DMA1, DEBUG_TX_DMA_CHANNEL, _debug_tx.dma_size);
+    LL_DMA_EnableChannel(DMA1, DEBUG_TX_DMA_CHANNEL);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Must be called with disabled interrupts, a failed transfer is dropped to keep the ring moving */
+static void _debug_tx_complete(void) {
+    if ((LL_DMA_IsActiveFlag_TC1(DMA1) == 0) && (LL_DMA_IsActiveFlag_TE1(DMA1) == 0)) {
+        return;
+    }
+
+    LL_DMA_ClearFlag_GI1(DMA1);
+    LL_DMA_DisableChannel(DMA1, DEBUG_TX_DMA_CHANNEL);
+    _debug_tx.tail += _debug_tx.dma_size;
+    _debug_tx.dma_size = 0;
+    _debug_tx_start();
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Polls the DMA flags, so the ring moves even from a handler which masks the DMA interrupt */
+static void _debug_tx_poll(void) {
+    const uint32_t PRIMASK = __get_PRIMASK();
+    __disable_irq();
+    _debug_tx_complete();
+    __set_PRIMASK(PRIMASK);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bsp_uart_debug_dma_tx_handler(void) {
+    _debug_tx_complete();
 }
 
 /* -------------------------------------------------------------------------- */
 
 void bsp_uart_debug_write(uint8_t const *data, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        LL_USART_TransmitData8(USART1, data[i]);
-        while (LL_USART_IsActiveFlag_TXE(USART1) == 0) {
-            // Wait for transfer reg is empty
+    if (_debug_tx.is_ready == false) {
+        return;
+    }
+
+    while (size > 0) {
+        const uint32_t PRIMASK = __get_PRIMASK();
+        __disable_irq();
+
+        const uint32_t FREE = BSP_UART_DEBUG_TX_RING_SIZE - (_debug_tx.head - _debug_tx.tail);
+
+        if (FREE == 0) {
+            __set_PRIMASK(PRIMASK);
+            _debug_tx_poll();
+            continue;
         }
+
+        const uint32_t INDEX = _debug_tx.head & (BSP_UART_DEBUG_TX_RING_SIZE - 1U);
+        const uint32_t TO_END = BSP_UART_DEBUG_TX_RING_SIZE - INDEX;
+        size_t chunk = (size < FREE) ? size : FREE;
+        chunk = (chunk < TO_END) ? chunk : TO_END;
+
+        memcpy(&_debug_tx.data[INDEX], data, chunk);
+        _debug_tx.head += chunk;
+        data += chunk;
+        size -= chunk;
+
+        _debug_tx_start();
+        __set_PRIMASK(PRIMASK);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void bsp_uart_debug_flush(void) {
+    if (_debug_tx.is_ready == false) {
+        return;
+    }
+
+    while (_debug_tx.head != _debug_tx.tail) {
+        _debug_tx_poll();
     }
+
     while (LL_USART_IsActiveFlag_TC(USART1) == 0) {
-        // Wait for transfer reg is empty
+        // Wait for the last byte is shifted out
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool bsp_uart_debug_is_tx_busy(void) {
+    if (_debug_tx.is_ready == false) {
+        return false;
+    }
+
+    return (_debug_tx.head != _debug_tx.tail) || (LL_USART_IsActiveFlag_TC(USART1) == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The baud rate is valid if the divider error is below 2%, the other side keeps its own error budget */
+bool bsp_uart_debug_is_baudrate_valid(uint32_t baudrate) {
+    const uint32_t MAX_ERROR_PPM = 20000;
+    const uint32_t CLOCK_HZ = LL_RCC_GetUSARTClockFreq(LL_RCC_USART1_CLKSOURCE);
+
+    if ((baudrate == 0) || (baudrate > (CLOCK_HZ / 16))) {
+        return false;
+    }
+
+    const uint32_t DIVIDER = (CLOCK_HZ + (baudrate / 2)) / baudrate;
+    const uint32_t ACTUAL = CLOCK_HZ / DIVIDER;
+    const uint32_t DIFF = (ACTUAL > baudrate) ? (ACTUAL - baudrate) : (baudrate - ACTUAL);
+
+    return ((uint64_t)DIFF * 1000000U) <= ((uint64_t)baudrate * MAX_ERROR_PPM);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Pending output is sent with the previous baud rate */
+void bsp_uart_debug_set_baudrate(uint32_t baudrate) {
+    bsp_uart_debug_flush();
+    LL_USART_Disable(USART1);
+    LL_USART_SetBaudRate(USART1,
+                         LL_RCC_GetUSARTClockFreq(LL_RCC_USART1_CLKSOURCE),
+                         LL_USART_PRESCALER_DIV1,
+                         LL_USART_OVERSAMPLING_16,
+                         baudrate);
+    LL_USART_Enable(USART1);
+
+    while ((!(LL_USART_IsActiveFlag_TEACK(USART1))) || (!(LL_USART_IsActiveFlag_REACK(USART1)))) {
+        // Wait for ...
     }
 }
 
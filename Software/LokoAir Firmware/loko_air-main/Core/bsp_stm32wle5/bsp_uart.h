@@ -14,7 +14,15 @@ void bsp_uart_debug_init(void);
 void bsp_uart_gnss_byte_received(uint8_t byte);
 void bsp_uart_debug_byte_received(uint8_t byte);
 
+/* Copies the data to the TX ring and returns, DMA sends it in the background */
 void bsp_uart_debug_write(uint8_t const *data, size_t size);
+/* Waits until the TX ring is sent, call it before shutdown, reset or a clock change */
+void bsp_uart_debug_flush(void);
+/* The ring or the last byte is being sent, Stop2 would cut the transfer */
+bool bsp_uart_debug_is_tx_busy(void);
+void bsp_uart_debug_dma_tx_handler(void);
+bool bsp_uart_debug_is_baudrate_valid(uint32_t baudrate);
+void bsp_uart_debug_set_baudrate(uint32_t baudrate);
 void bsp_uart_gnss_write(uint8_t const *data, size_t size);
 
 #ifdef __cplusplus
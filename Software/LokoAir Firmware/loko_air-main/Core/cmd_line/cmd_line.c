@@ -11,11 +11,17 @@
 #include "cmd_line.h"
 
 #include <Mac/LoRaMacInterfaces.h>
+#include <airtime/airtime.h>
+#include <blackbox/blackbox.h>
 #include <bsp.h>
+#include <encrypt_p2p_payload/encrypt_p2p_payload.h>
 #include <gnss_trace.h>
 #include <lora_app.h>
+#include <lorawan_backoff/lorawan_backoff.h>
 #include <lorawan_app/lorawan_conf.h>
 #include <settings/settings.h>
+#include <profile/profile.h>
+#include <stats/stats.h>
 #include <utils.h>
 #include <version.h>
 
@@ -276,6 +282,7 @@ static char const *_cmd_reset(const char *data) {
     if ((data != NULL) && (data[6] == 'b')) {
 #if CONFIG_LOKO_CPPUTEST == 0
         INTER_TARGET_MAILBOX_SEND(INTER_TARGET_MAILBOX_CMD_STAY_IN_BOOTLOADER);
+        INTER_TARGET_MAILBOX_SEND_LEGACY(INTER_TARGET_MAILBOX_CMD_STAY_IN_BOOTLOADER);
 #endif
     }
 
@@ -298,7 +305,7 @@ static char const *_cmd_print(const char *data) {
     _print("\t.auto_wakeup_period_s = %ld" CONSOLE_EOL, settings_get_auto_wakeup_period_s());
     _print("\t.gnss_trace_save_mult = %ld" CONSOLE_EOL, settings_get_gnss_trace_save_mult());
     _print("\t.is_lorawan_mode = %d" CONSOLE_EOL, settings_get_is_lorawan_mode());
-    _print("\t.is_p2p_encrypted = %d" CONSOLE_EOL, settings_get_is_p2p_encrypted());
+    _print("\t.p2p_encryption = %d" CONSOLE_EOL, settings_get_p2p_encryption());
     _print("\t.is_debug_output = %d" CONSOLE_EOL, settings_is_debug_output());
     _print("\t.gnss_mode = %d" CONSOLE_EOL, settings_get_gnss_mode());
     _print("\t.is_extended_packet = %d" CONSOLE_EOL, settings_get_is_extended_packet());
@@ -329,6 +336,31 @@ static char const *_cmd_erase(const char *data) {
 
 /* -------------------------------------------------------------------------- */
 
+static char const *_cmd_lorawan_rejoin(const char *data) {
+    UNUSED(data);
+
+    /* The session keeps its DevNonce, erasing the NVM would reuse the nonces the network has seen */
+    lorawan_request_rejoin();
+    lorawan_backoff_reset();
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_lorawan_backoff_print(const char *data) {
+    UNUSED(data);
+
+    lorawan_backoff_state_t state;
+    lorawan_backoff_get_state(&state);
+
+    _print("Failed attempts %" PRIu32 ", next attempt in %" PRIu32 " s" CONSOLE_EOL, state.fail_count, state.wait_s);
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
 static char const *_cmd_gtrace_print(const char *data) {
     UNUSED(data);
 
@@ -436,11 +468,11 @@ static char const *_cmd_enable_p2p_enc(const char *string) {
         return WRONG_ARGUMENT;
     }
 
-    if (dig > 1) {
+    if (dig >= SETTINGS_P2P_ENCRYPTION_COUNT) {
         return WRONG_ARGUMENT;
     }
 
-    settings_set_p2p_encrypted((bool)dig);
+    settings_set_p2p_encryption((settings_p2p_encryption_t)dig);
 
     return NULL;
 }
@@ -590,6 +622,7 @@ static char const *_cmd_set_p2p_key(const char *string) {
     uint8_t p2p_key[SETTINGS_P2P_KEY_SIZE];
     _hex_str_to_array(p2p_key, dig_str, SETTINGS_P2P_KEY_SIZE);
     settings_set_p2p_key(p2p_key);
+    enc_p2p_init();
 
     return NULL;
 }
@@ -679,6 +712,164 @@ static char const *_cmd_set_tx_power(const char *string) {
 }
 
 /* -------------------------------------------------------------------------- */
+
+static char const *_cmd_airtime_print(const char *data) {
+    UNUSED(data);
+
+    airtime_ledger_t ledger;
+    airtime_get_ledger(&ledger);
+
+    _print("Band %" PRIu32 ", duty cycle %" PRIu32 " ppm, window %" PRIu32 " s" CONSOLE_EOL,
+           ledger.band_index,
+           ledger.duty_cycle_ppm,
+           (uint32_t)AIRTIME_WINDOW_S);
+    _print("Used %" PRIu32 " of %" PRIu32 " ms" CONSOLE_EOL, ledger.bucket_ms, ledger.budget_ms);
+    _print("Total %" PRIu32 " ms, TX %" PRIu32 ", deferred %" PRIu32 CONSOLE_EOL,
+           ledger.total_ms,
+           ledger.tx_count,
+           ledger.deferred_count);
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_airtime_reset(const char *data) {
+    UNUSED(data);
+
+    airtime_reset();
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* CSV of the wakeup cycles, the oldest first. The state times follow system_state_t of the application */
+static char const *_cmd_blackbox_print(const char *data) {
+    UNUSED(data);
+
+    const size_t RECORD_COUNT = blackbox_get_record_count();
+
+    _print("Record found %u" CONSOLE_EOL, RECORD_COUNT);
+    _print("seq,start,ttff_100ms,fix_time_s,tx,vbat_mv,sleep_s,flags,"
+           "init_s,tickle_s,fix_s,send_s,tx_done_s,shutdown_s,charging_s" CONSOLE_EOL);
+
+    for (size_t i = 0; i < RECORD_COUNT; i++) {
+        blackbox_record_t record;
+
+        if (blackbox_get_record(i, &record) != BLACKBOX_RESULT_OK) {
+            _print("#%u corrupted" CONSOLE_EOL, i);
+            continue;
+        }
+
+        _print("%" PRIu32 ",%u,%u,%" PRIu32 ",%u,%u,%u,0x%02X",
+               record.sequence,
+               record.start_reason,
+               record.ttff_100ms,
+               record.fix_time_s,
+               record.tx_result,
+               record.vbat_mv,
+               record.sleep_s,
+               record.flags);
+
+        for (size_t state = 0; state < BLACKBOX_STATE_COUNT; state++) {
+            _print(",%u", record.state_time_s[state]);
+        }
+        _print(CONSOLE_EOL);
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Raw records in hex, one per line, for the archive of the field units */
+static char const *_cmd_blackbox_dump(const char *data) {
+    UNUSED(data);
+
+    for (size_t i = 0; i < blackbox_get_record_count(); i++) {
+        blackbox_record_t record;
+
+        if (blackbox_get_record(i, &record) != BLACKBOX_RESULT_OK) {
+            continue;
+        }
+
+        uint8_t const *raw = (uint8_t const *)&record;
+        for (size_t byte = 0; byte < sizeof(record); byte++) {
+            _print("%02X", raw[byte]);
+        }
+        _print(CONSOLE_EOL);
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_blackbox_erase(const char *data) {
+    UNUSED(data);
+
+    blackbox_erase();
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_stats_print(const char *data) {
+    UNUSED(data);
+
+    for (size_t i = 0; i < STATS_COUNTER_COUNT; i++) {
+        _print("%s %" PRIu32 CONSOLE_EOL, stats_get_name((stats_counter_t)i), stats_get((stats_counter_t)i));
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_stats_reset(const char *data) {
+    UNUSED(data);
+
+    stats_reset();
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#if PROFILE_ENABLED == 1
+static char const *_cmd_profile_print(const char *data) {
+    UNUSED(data);
+
+    _print("scope,count,min,max,avg" CONSOLE_EOL);
+    for (size_t i = 0; i < PROFILE_SCOPE_COUNT; i++) {
+        profile_stats_t stats;
+        profile_get((profile_scope_t)i, &stats);
+
+        _print("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 CONSOLE_EOL,
+               profile_get_name((profile_scope_t)i),
+               stats.count,
+               stats.min_cycles,
+               stats.max_cycles,
+               profile_get_avg(&stats));
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static char const *_cmd_profile_reset(const char *data) {
+    UNUSED(data);
+
+    profile_reset();
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+#endif /* PROFILE_ENABLED == 1 */
 // clang-format off
 static cmd_t _cmd_list[] = {
     { "help",                _cmd_help,                     NULL                                                                                   },
@@ -697,12 +888,25 @@ static cmd_t _cmd_list[] = {
     { "set app-eui",         _cmd_set_app_eui,              "Set App/Join server IEEE EUI. Ex:set app-eui 0123456789ABCDEF"                        },
     { "set app-key",         _cmd_set_app_key,              "Set Application root key LoRaWAN key. Ex:set app-key 0123456789ABCDEF0123456789ABCDEF"},
     { "set region",          _cmd_set_region,               "Set LoRaWAN Active Region, use \"set region ?\" to print avalble regions"             },
-    { "p2p encryption",      _cmd_enable_p2p_enc,           "Enable or disable p2p encryption. Ex:p2p encryption 1"                                },
+    { "lorawan rejoin",      _cmd_lorawan_rejoin,           "Join LoRaWAN network again at the next wakeup"                                        },
+    { "lorawan backoff",     _cmd_lorawan_backoff_print,    "Show failed LoRaWAN attempts and the time until the next one"                         },
+    { "p2p encryption",      _cmd_enable_p2p_enc,           "P2P encryption, 0-off, 1-single block, 2-CTR with MAC. Ex:p2p encryption 2"           },
     { "set p2p-key",         _cmd_set_p2p_key,              "Set Point to Point 32bit encryption key. Ex:set p2p-key 0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"},
     { "debug",               _cmd_set_debug_output,         "Enable debug output, Ex:debug 1"                                                      },
     { "extended",            _cmd_set_extended_packet,      "Enable extended packet Ex:extended 1"                                                 },
     { "set gnss mode",       _cmd_set_gnss_mode,            "Set navigation mode, allowed: 0-normal, 1-fitness, 2-aviation, 3-balloon, 4-stationary. Ex: set gnss mode 1"},
     { "set tx",              _cmd_set_tx_power,             "Set lora TX power. Ex: set tx 10"},
+    { "airtime reset",       _cmd_airtime_reset,            "Reset P2P airtime ledger"                                                             },
+    { "airtime",             _cmd_airtime_print,            "Show P2P airtime ledger and duty cycle budget"                                        },
+    { "blackbox erase",      _cmd_blackbox_erase,           "Erase the wakeup cycle records"                                                       },
+    { "blackbox dump",       _cmd_blackbox_dump,            "Raw wakeup cycle records in hex, 32 bytes each"                                       },
+    { "blackbox",            _cmd_blackbox_print,           "Show the wakeup cycle records as CSV, the oldest first"                               },
+    { "stats reset",         _cmd_stats_reset,              "Reset the runtime counters"                                                           },
+    { "stats",               _cmd_stats_print,              "Show the runtime counters since the start or the reset"                               },
+#if PROFILE_ENABLED == 1
+    { "profile reset",       _cmd_profile_reset,            "Reset the cycle profiling scopes"                                                     },
+    { "profile",             _cmd_profile_print,            "Show the cycles of the profiling scopes as CSV: count, min, max, avg"                 },
+#endif
 };
 // clang-format on
 
@@ -1,5 +1,9 @@
 #include "crc16.h"
 
+#if (CRC16_MODE == CRC_HARDWARE)
+#    include <bsp.h>
+#endif
+
 /* CRC16 implementation according to CCITT standards */
 
 /*
@@ -12,8 +16,6 @@ Check : 0x29B1 ("123456789")
 MaxLen: 4095 bytes
 */
 
-#if (CRC16_MODE == CRC_ROM_TABLE)
-
 static const uint16_t _crc16_ccitt_table[256] = {
     0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U, 0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU,
     0xD1ADU, 0xE1CEU, 0xF1EFU, 0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U, 0x9339U, 0x8318U,
@@ -39,21 +41,39 @@ static const uint16_t _crc16_ccitt_table[256] = {
 
 /* -------------------------------------------------------------------------- */
 
-uint16_t crc16_ccitt(const uint8_t block[], uint32_t block_length, uint16_t crc) {
+uint16_t crc16_ccitt_bitwise(const uint8_t *data, uint32_t size, uint16_t crc) {
 
-    for (uint32_t i = 0U; i < block_length; i++) {
-        uint16_t tmp = (uint16_t)((crc >> 8) ^ (uint16_t)block[i]);
-        crc = ((uint16_t)(crc << 8U)) ^ _crc16_ccitt_table[tmp];
+    while (size--) {
+        crc ^= (uint16_t)(*data++ << 8);
+
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
     }
 
     return crc;
 }
 
-#elif (CRC16_MODE == CRC_RAM_TABLE)
+/* -------------------------------------------------------------------------- */
+
+uint16_t crc16_ccitt_rom_table(const uint8_t *data, uint32_t size, uint16_t crc) {
+
+    for (uint32_t i = 0U; i < size; i++) {
+        uint16_t tmp = (uint16_t)((crc >> 8) ^ (uint16_t)data[i]);
+        crc = ((uint16_t)(crc << 8U)) ^ _crc16_ccitt_table[tmp];
+    }
+
+    return crc;
+}
 
 /* -------------------------------------------------------------------------- */
 
-static uint16_t _crc16_ccitt_table[256];
+#if CRC16_IS_RAM_TABLE_MODE
+
+#    define SLICING_TABLE_COUNT (8U)
+
+/* _crc16_ram_table[n][i] is the CRC of the byte i followed by n zero bytes, row 0 is the plain byte table */
+static uint16_t _crc16_ram_table[SLICING_TABLE_COUNT][256];
 
 /* -------------------------------------------------------------------------- */
 
@@ -67,7 +87,7 @@ void crc16_generate_table(void) {
             uint32_t xor_flag = result & 0x8000;
 
             /* Shift CRC */
-            result <<= 1;
+            result = (uint16_t)(result << 1);
 
             /* Perform the XOR */
             if (xor_flag) {
@@ -75,46 +95,84 @@ void crc16_generate_table(void) {
             }
         }
 
-        _crc16_ccitt_table[i] = result;
+        _crc16_ram_table[0][i] = result;
+    }
+
+    for (uint32_t n = 1; n < SLICING_TABLE_COUNT; n++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint16_t prev = _crc16_ram_table[n - 1][i];
+            _crc16_ram_table[n][i] = (uint16_t)(prev << 8) ^ _crc16_ram_table[0][prev >> 8];
+        }
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-uint16_t crc16_ccitt(const uint8_t block[], uint32_t block_length, uint16_t crc) {
+uint16_t crc16_ccitt_ram_table(const uint8_t *data, uint32_t size, uint16_t crc) {
 
-    for (uint32_t i = 0U; i < block_length; i++) {
-        uint16_t tmp = (uint16_t)((crc >> 8) ^ (uint16_t)block[i]);
-        crc = ((uint16_t)(crc << 8U)) ^ _crc16_ccitt_table[tmp];
+    for (uint32_t i = 0U; i < size; i++) {
+        uint16_t tmp = (uint16_t)((crc >> 8) ^ (uint16_t)data[i]);
+        crc = ((uint16_t)(crc << 8U)) ^ _crc16_ram_table[0][tmp];
     }
 
     return crc;
 }
 
-#elif (CRC16_MODE == CRC_NO_TABLE)
-
 /* -------------------------------------------------------------------------- */
 
-uint16_t crc16_ccitt(const uint8_t *data, uint32_t data_size, const uint16_t crc_start_value) {
-    return crc16_offset_ccitt(crc_start_value, data, data_size);
+/* The CRC register is folded into the first two bytes of the slice, every byte of the slice is looked up in the
+ * table of its distance to the slice end, the lookups are independent of each other */
+uint16_t crc16_ccitt_slicing_by_4(const uint8_t *data, uint32_t size, uint16_t crc) {
+
+    while (size >= 4U) {
+        crc = _crc16_ram_table[3][(uint8_t)(data[0] ^ (crc >> 8))] ^ _crc16_ram_table[2][(uint8_t)(data[1] ^ crc)] ^
+              _crc16_ram_table[1][data[2]] ^ _crc16_ram_table[0][data[3]];
+        data += 4U;
+        size -= 4U;
+    }
+
+    return crc16_ccitt_ram_table(data, size, crc);
 }
 
 /* -------------------------------------------------------------------------- */
 
-uint16_t crc16_offset_ccitt(const uint16_t crc_start_value, const uint8_t *data, uint32_t data_size) {
-    uint16_t crc = crc_start_value;
-    uint32_t len = data_size;
-
-    while (len--) {
-        crc ^= *data++ << 8;
+uint16_t crc16_ccitt_slicing_by_8(const uint8_t *data, uint32_t size, uint16_t crc) {
 
-        for (uint8_t i = 0; i < 8; i++) {
-            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
-        }
+    while (size >= 8U) {
+        crc = _crc16_ram_table[7][(uint8_t)(data[0] ^ (crc >> 8))] ^ _crc16_ram_table[6][(uint8_t)(data[1] ^ crc)] ^
+              _crc16_ram_table[5][data[2]] ^ _crc16_ram_table[4][data[3]] ^ _crc16_ram_table[3][data[4]] ^
+              _crc16_ram_table[2][data[5]] ^ _crc16_ram_table[1][data[6]] ^ _crc16_ram_table[0][data[7]];
+        data += 8U;
+        size -= 8U;
     }
 
-    return crc;
+    return crc16_ccitt_ram_table(data, size, crc);
+}
+
+#endif /* CRC16_IS_RAM_TABLE_MODE */
+
+/* -------------------------------------------------------------------------- */
+
+uint16_t crc16_offset_ccitt(const uint16_t crc_start_value, const uint8_t *data, uint32_t data_size) {
+    return crc16_ccitt_bitwise(data, data_size, crc_start_value);
 }
+
+/* -------------------------------------------------------------------------- */
+
+uint16_t crc16_ccitt(const uint8_t block[], uint32_t block_length, uint16_t crc) {
+#if (CRC16_MODE == CRC_ROM_TABLE)
+    return crc16_ccitt_rom_table(block, block_length, crc);
+#elif (CRC16_MODE == CRC_RAM_TABLE)
+    return crc16_ccitt_ram_table(block, block_length, crc);
+#elif (CRC16_MODE == CRC_NO_TABLE)
+    return crc16_ccitt_bitwise(block, block_length, crc);
+#elif (CRC16_MODE == CRC_SLICING_BY_4)
+    return crc16_ccitt_slicing_by_4(block, block_length, crc);
+#elif (CRC16_MODE == CRC_SLICING_BY_8)
+    return crc16_ccitt_slicing_by_8(block, block_length, crc);
+#elif (CRC16_MODE == CRC_HARDWARE)
+    return bsp_crc16_ccitt(block, block_length, crc);
 #else
 #    error SET CRC16_MODE
 #endif
+}
@@ -6,20 +6,46 @@ extern "C" {
 
 #include <stdint.h>
 
-#define CRC_ROM_TABLE 0U
-#define CRC_RAM_TABLE 1U
-#define CRC_NO_TABLE  2U
+#define CRC_ROM_TABLE    0U
+#define CRC_RAM_TABLE    1U
+#define CRC_NO_TABLE     2U
+#define CRC_SLICING_BY_4 3U
+#define CRC_SLICING_BY_8 4U
+#define CRC_HARDWARE     5U
+
+#ifndef CRC16_MODE
+#    if defined(CONFIG_CRC16_HARDWARE)
+#        define CRC16_MODE CRC_HARDWARE
+#    elif defined(CONFIG_CRC16_SLICING_BY_8)
+#        define CRC16_MODE CRC_SLICING_BY_8
+#    elif defined(CONFIG_CRC16_SLICING_BY_4)
+#        define CRC16_MODE CRC_SLICING_BY_4
+#    else
+#        define CRC16_MODE CRC_ROM_TABLE
+#    endif
+#endif
 
-#define CRC16_MODE CRC_ROM_TABLE
+#define CRC16_IS_RAM_TABLE_MODE \
+    ((CRC16_MODE == CRC_RAM_TABLE) || (CRC16_MODE == CRC_SLICING_BY_4) || (CRC16_MODE == CRC_SLICING_BY_8))
 
 #define CRC16_CCITT_INIT_VAL 0xFFFF
 
 uint16_t crc16_offset_ccitt(const uint16_t crc_start_value, const uint8_t *data, uint32_t data_size);
 uint16_t crc16_ccitt(const uint8_t block[], uint32_t blockLength, const uint16_t crc);
 
-#if (CRC16_MODE == CRC_RAM_TABLE)
+/* Software backends, crc16_ccitt() uses one of them according to CRC16_MODE */
+uint16_t crc16_ccitt_bitwise(const uint8_t *data, uint32_t size, uint16_t crc);
+uint16_t crc16_ccitt_rom_table(const uint8_t *data, uint32_t size, uint16_t crc);
+
+#if CRC16_IS_RAM_TABLE_MODE
+/* Fills the RAM tables, required before the first crc16_ccitt() call */
 void crc16_generate_table(void);
-#endif
+
+/* Backends on the RAM tables, they exist in the RAM table modes only */
+uint16_t crc16_ccitt_ram_table(const uint8_t *data, uint32_t size, uint16_t crc);
+uint16_t crc16_ccitt_slicing_by_4(const uint8_t *data, uint32_t size, uint16_t crc);
+uint16_t crc16_ccitt_slicing_by_8(const uint8_t *data, uint32_t size, uint16_t crc);
+#endif /* CRC16_IS_RAM_TABLE_MODE */
 
 #ifdef __cplusplus
 }
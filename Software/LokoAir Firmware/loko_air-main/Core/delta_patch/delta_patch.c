@@ -0,0 +1,396 @@
+#include "delta_patch.h"
+#include <crc16.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Journal record: tag u8, 0, step u16, value u16, CRC16 u16 over the first 6 bytes. A record torn by power loss is
+ * skipped, so the records are appended to the first erased slot only */
+#define JOURNAL_TAG_START   (0xA1U) /*<! value: header CRC, binds the journal to the patch */
+#define JOURNAL_TAG_SCRATCH (0xA2U) /*<! value: CRC of the new page in the scratch, the page may be erased */
+#define STEP_NONE           (UINT32_MAX)
+
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t flags;
+    uint32_t page_size;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint32_t body_size;
+    uint16_t old_crc;
+    uint16_t new_crc;
+    uint16_t body_crc;
+    uint16_t header_crc;
+    uint32_t page_count;
+} patch_header_t;
+
+typedef struct {
+    bool is_started;
+    uint32_t scratch_step;
+    uint16_t scratch_crc;
+    size_t free_offset;
+} journal_state_t;
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _read_le32(uint8_t const *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _read_le16(uint8_t const *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _crc(uint8_t const *data, size_t size) {
+    return crc16_ccitt(data, (uint32_t)size, CRC16_CCITT_INIT_VAL);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _read_header(delta_patch_io_t const *io, patch_header_t *header) {
+    uint8_t const *raw = io->patch;
+
+    header->flags = _read_le32(&raw[4]);
+    header->page_size = _read_le32(&raw[8]);
+    header->old_size = _read_le32(&raw[12]);
+    header->new_size = _read_le32(&raw[16]);
+    header->body_size = _read_le32(&raw[20]);
+    header->old_crc = _read_le16(&raw[24]);
+    header->new_crc = _read_le16(&raw[26]);
+    header->body_crc = _read_le16(&raw[28]);
+    header->header_crc = _read_le16(&raw[30]);
+
+    if (header->header_crc != _crc(raw, DELTA_PATCH_HEADER_SIZE - 2)) {
+        return false;
+    }
+
+    if ((header->page_size != io->page_size) || (header->old_size > io->app_size) ||
+        (header->new_size > io->app_size) || (header->body_size > (io->patch_size - DELTA_PATCH_HEADER_SIZE))) {
+        return false;
+    }
+
+    header->page_count = (header->new_size + header->page_size - 1) / header->page_size;
+
+    /* START record and a record per page must fit the journal */
+    if ((header->new_size == 0) ||
+        (((1U + header->page_count) * DELTA_PATCH_JOURNAL_REC_SIZE) > header->page_size)) {
+        return false;
+    }
+
+    return header->body_crc == _crc(&raw[DELTA_PATCH_HEADER_SIZE], header->body_size);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _step_to_page(patch_header_t const *header, uint32_t step) {
+    return (header->flags & DELTA_PATCH_FLAG_DESCENDING) ? (header->page_count - 1 - step) : step;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_page_data_size(patch_header_t const *header, size_t page) {
+    size_t start = page * header->page_size;
+    size_t left = header->new_size - start;
+
+    return (left < header->page_size) ? left : header->page_size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Old data must be intact while the page is rebuilt, the pages processed before are already new */
+static bool _is_copy_allowed(patch_header_t const *header, size_t page, uint32_t src, uint32_t size) {
+    const uint32_t PAGE_START = (uint32_t)(page * header->page_size);
+    const uint32_t PAGE_END = PAGE_START + header->page_size;
+    const uint32_t NEW_END = header->page_count * header->page_size;
+
+    if (((uint64_t)src + size) > header->old_size) {
+        return false;
+    }
+
+    if (header->flags & DELTA_PATCH_FLAG_DESCENDING) {
+        return ((src + size) <= PAGE_END) || (src >= NEW_END);
+    }
+
+    return src >= PAGE_START;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Walks the operations of one page, copies the result to out if it is not NULL. Returns the offset of the next page
+ * operations in the body or 0 if the operations are broken */
+static size_t _page_ops(delta_patch_io_t const *io,
+                        patch_header_t const *header,
+                        size_t body_offset,
+                        size_t page,
+                        uint8_t *out) {
+    uint8_t const *body = &io->patch[DELTA_PATCH_HEADER_SIZE];
+    const size_t PAGE_DATA_SIZE = _get_page_data_size(header, page);
+    size_t produced = 0;
+
+    while (produced < PAGE_DATA_SIZE) {
+        if ((body_offset + 3) > header->body_size) {
+            return 0;
+        }
+
+        uint8_t op = body[body_offset];
+        uint16_t size;
+
+        if (op == DELTA_PATCH_OP_COPY) {
+            if ((body_offset + 7) > header->body_size) {
+                return 0;
+            }
+
+            uint32_t src = _read_le32(&body[body_offset + 1]);
+            size = _read_le16(&body[body_offset + 5]);
+
+            if (((produced + size) > PAGE_DATA_SIZE) || (_is_copy_allowed(header, page, src, size) == false)) {
+                return 0;
+            }
+
+            if (out != NULL) {
+                memcpy(&out[produced], &io->app[src], size);
+            }
+
+            body_offset += 7;
+        } else if (op == DELTA_PATCH_OP_INSERT) {
+            size = _read_le16(&body[body_offset + 1]);
+
+            if (((produced + size) > PAGE_DATA_SIZE) || ((body_offset + 3 + size) > header->body_size)) {
+                return 0;
+            }
+
+            if (out != NULL) {
+                memcpy(&out[produced], &body[body_offset + 3], size);
+            }
+
+            body_offset += 3 + (size_t)size;
+        } else {
+            return 0;
+        }
+
+        /* An empty operation is never generated by the packer */
+        if (size == 0) {
+            return 0;
+        }
+
+        produced += size;
+    }
+
+    return body_offset;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _find_step_ops(delta_patch_io_t const *io, patch_header_t const *header, uint32_t step) {
+    size_t body_offset = 0;
+
+    for (uint32_t i = 0; i < step; i++) {
+        body_offset = _page_ops(io, header, body_offset, _step_to_page(header, i), NULL);
+    }
+
+    return body_offset;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_body_valid(delta_patch_io_t const *io, patch_header_t const *header) {
+    size_t body_offset = 0;
+
+    for (uint32_t step = 0; step < header->page_count; step++) {
+        body_offset = _page_ops(io, header, body_offset, _step_to_page(header, step), NULL);
+
+        if (body_offset == 0) {
+            return false;
+        }
+    }
+
+    return body_offset == header->body_size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _journal_read(delta_patch_io_t const *io, patch_header_t const *header, journal_state_t *state) {
+    memset(state, 0, sizeof(*state));
+    state->scratch_step = STEP_NONE;
+
+    for (size_t offset = 0; offset < io->page_size; offset += DELTA_PATCH_JOURNAL_REC_SIZE) {
+        uint8_t const *rec = &io->journal[offset];
+        state->free_offset = offset + DELTA_PATCH_JOURNAL_REC_SIZE;
+
+        bool is_erased = true;
+        for (size_t i = 0; i < DELTA_PATCH_JOURNAL_REC_SIZE; i++) {
+            is_erased = is_erased && (rec[i] == 0xFF);
+        }
+
+        if (is_erased) {
+            state->free_offset = offset;
+            break;
+        }
+
+        if (_read_le16(&rec[6]) != _crc(rec, 6)) {
+            continue;
+        }
+
+        uint32_t step = _read_le16(&rec[2]);
+        uint16_t value = _read_le16(&rec[4]);
+
+        if (rec[0] == JOURNAL_TAG_START) {
+            state->is_started = (value == header->header_crc);
+        } else if (state->is_started && (rec[0] == JOURNAL_TAG_SCRATCH)) {
+            state->scratch_step = step;
+            state->scratch_crc = value;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _journal_append(delta_patch_io_t const *io,
+                            journal_state_t *state,
+                            uint8_t tag,
+                            uint32_t step,
+                            uint16_t value) {
+    uint8_t rec[DELTA_PATCH_JOURNAL_REC_SIZE] = { tag, 0, (uint8_t)step, (uint8_t)(step >> 8), (uint8_t)value,
+                                                  (uint8_t)(value >> 8) };
+    uint16_t crc = _crc(rec, 6);
+    rec[6] = (uint8_t)crc;
+    rec[7] = (uint8_t)(crc >> 8);
+
+    io->write_journal(state->free_offset, rec, sizeof(rec));
+    state->free_offset += DELTA_PATCH_JOURNAL_REC_SIZE;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _write_page(delta_patch_io_t const *io, patch_header_t const *header, uint32_t step, uint8_t const *data) {
+    const size_t PAGE = _step_to_page(header, step);
+
+    io->erase_app_page(PAGE);
+    io->write_app(PAGE * header->page_size, data, _get_page_data_size(header, PAGE));
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Completes the last journaled step, returns the step to continue with */
+static uint32_t _resume(delta_patch_io_t const *io,
+                        patch_header_t const *header,
+                        journal_state_t const *state,
+                        uint8_t *page_buffer) {
+    if (state->scratch_step == STEP_NONE) {
+        return 0;
+    }
+
+    const size_t PAGE = _step_to_page(header, state->scratch_step);
+    const size_t SIZE = _get_page_data_size(header, PAGE);
+
+    /* The scratch is erased only when the page is written, otherwise the page may be erased or written partially */
+    if ((_crc(io->scratch, SIZE) == state->scratch_crc) &&
+        (memcmp(&io->app[PAGE * header->page_size], io->scratch, SIZE) != 0)) {
+        memcpy(page_buffer, io->scratch, SIZE);
+        _write_page(io, header, state->scratch_step, page_buffer);
+    }
+
+    return state->scratch_step + 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _finish(delta_patch_io_t const *io) {
+    /* The patch goes first, a journal left without its patch is ignored */
+    io->erase_patch();
+    io->erase_journal();
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool delta_patch_is_present(delta_patch_io_t const *io) {
+    return _read_le32(io->patch) == DELTA_PATCH_MAGIC;
+}
+
+/* -------------------------------------------------------------------------- */
+
+delta_patch_result_t delta_patch_verify(delta_patch_io_t const *io) {
+    patch_header_t header;
+
+    if (delta_patch_is_present(io) == false) {
+        return DELTA_PATCH_RESULT_NO_PATCH;
+    }
+
+    if ((_read_header(io, &header) == false) || (_is_body_valid(io, &header) == false)) {
+        return DELTA_PATCH_RESULT_ERROR_PATCH;
+    }
+
+    if (_crc(io->app, header.old_size) != header.old_crc) {
+        return DELTA_PATCH_RESULT_ERROR_OLD_IMAGE;
+    }
+
+    return DELTA_PATCH_RESULT_READY;
+}
+
+/* -------------------------------------------------------------------------- */
+
+delta_patch_result_t delta_patch_apply(delta_patch_io_t const *io, uint8_t *page_buffer) {
+    patch_header_t header;
+    journal_state_t state;
+
+    if (delta_patch_is_present(io) == false) {
+        return DELTA_PATCH_RESULT_NO_PATCH;
+    }
+
+    if ((_read_header(io, &header) == false) || (_is_body_valid(io, &header) == false)) {
+        io->erase_patch();
+        return DELTA_PATCH_RESULT_ERROR_PATCH;
+    }
+
+    _journal_read(io, &header, &state);
+
+    if (state.is_started == false) {
+        /* Power loss during the final clean up */
+        if (_crc(io->app, header.new_size) == header.new_crc) {
+            _finish(io);
+            return DELTA_PATCH_RESULT_DONE;
+        }
+
+        if (_crc(io->app, header.old_size) != header.old_crc) {
+            io->erase_patch();
+            return DELTA_PATCH_RESULT_ERROR_OLD_IMAGE;
+        }
+
+        io->erase_journal();
+        state.free_offset = 0;
+        _journal_append(io, &state, JOURNAL_TAG_START, 0, header.header_crc);
+    }
+
+    uint32_t next_step = _resume(io, &header, &state, page_buffer);
+    size_t body_offset = _find_step_ops(io, &header, next_step);
+
+    for (uint32_t step = next_step; step < header.page_count; step++) {
+        const size_t SIZE = _get_page_data_size(&header, _step_to_page(&header, step));
+
+        /* Each power loss may leave a torn record, the patch stays for the flashing by the host */
+        if ((state.free_offset + DELTA_PATCH_JOURNAL_REC_SIZE) > io->page_size) {
+            return DELTA_PATCH_RESULT_ERROR_JOURNAL;
+        }
+
+        body_offset = _page_ops(io, &header, body_offset, _step_to_page(&header, step), page_buffer);
+
+        io->erase_scratch();
+        io->write_scratch(page_buffer, SIZE);
+        _journal_append(io, &state, JOURNAL_TAG_SCRATCH, step, _crc(page_buffer, SIZE));
+
+        _write_page(io, &header, step, page_buffer);
+    }
+
+    if (_crc(io->app, header.new_size) != header.new_crc) {
+        _finish(io);
+        return DELTA_PATCH_RESULT_ERROR_NEW_IMAGE;
+    }
+
+    _finish(io);
+    return DELTA_PATCH_RESULT_DONE;
+}
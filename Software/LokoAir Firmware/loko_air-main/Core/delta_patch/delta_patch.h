@@ -0,0 +1,69 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Patch: header, then the body with the operations of every new page in the processing order. Little endian.
+ * Header: magic u32, flags u32, page size u32, old size u32, new size u32, body size u32,
+ *         old CRC16 u16, new CRC16 u16, body CRC16 u16, header CRC16 u16 (over the first 30 bytes).
+ * Operations never cross a page: COPY [0x01][old offset u32][size u16], INSERT [0x02][size u16][data].
+ * Pages are rebuilt in place one by one, a page may copy only old data which is not overwritten yet: at or after the
+ * page start in the ascending order, before the page end in the descending order */
+#define DELTA_PATCH_MAGIC            (0x31444B4CUL) /*<! "LKD1" */
+#define DELTA_PATCH_HEADER_SIZE      (32U)
+#define DELTA_PATCH_FLAG_DESCENDING  (0x01UL)
+#define DELTA_PATCH_OP_COPY          (0x01U)
+#define DELTA_PATCH_OP_INSERT        (0x02U)
+#define DELTA_PATCH_JOURNAL_REC_SIZE (8U)
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    DELTA_PATCH_RESULT_NO_PATCH,
+    DELTA_PATCH_RESULT_DONE,
+    DELTA_PATCH_RESULT_READY,           /*<! Verified, applies to the installed image */
+    DELTA_PATCH_RESULT_ERROR_PATCH,     /*<! Patch is corrupted or does not fit the layout */
+    DELTA_PATCH_RESULT_ERROR_OLD_IMAGE, /*<! Installed image is not the patch base */
+    DELTA_PATCH_RESULT_ERROR_NEW_IMAGE, /*<! Result CRC mismatch */
+    DELTA_PATCH_RESULT_ERROR_JOURNAL,   /*<! No room for the progress record, the image is partially updated */
+} delta_patch_result_t;
+
+/* Flash access, reads are memory mapped. Scratch and journal are one page each */
+typedef struct {
+    uint8_t const *app;
+    size_t app_size;
+    uint8_t const *patch;
+    size_t patch_size;
+    uint8_t const *scratch;
+    uint8_t const *journal;
+    size_t page_size;
+
+    void (*erase_app_page)(size_t page);
+    void (*write_app)(size_t offset, void const *data, size_t size);
+    void (*erase_patch)(void); /*<! Drops the patch, the header page is enough */
+    void (*erase_scratch)(void);
+    void (*write_scratch)(void const *data, size_t size);
+    void (*erase_journal)(void);
+    void (*write_journal)(size_t offset, void const *data, size_t size);
+} delta_patch_io_t;
+
+/* -------------------------------------------------------------------------- */
+
+bool delta_patch_is_present(delta_patch_io_t const *io);
+
+/* Checks the staged patch against the installed image without flash writes, only the memory pointers are used */
+delta_patch_result_t delta_patch_verify(delta_patch_io_t const *io);
+
+/* Applies or resumes the staged patch, page_buffer is one page. Power loss at any point is resumed by the next call */
+delta_patch_result_t delta_patch_apply(delta_patch_io_t const *io, uint8_t *page_buffer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
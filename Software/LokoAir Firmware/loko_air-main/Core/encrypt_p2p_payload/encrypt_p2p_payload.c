@@ -1,12 +1,68 @@
 #include "encrypt_p2p_payload.h"
 
+#include "Crypto/cmac.h"
 #include "Crypto/lorawan_aes.h"
 #include <bsp.h>
+#include <rtc_backup_layout.h>
 #include <settings/settings.h>
 #include <utils.h>
 
 STATIC_ASSERT((sizeof(enc_p2p_payload_t)) == 16);
 STATIC_ASSERT((sizeof(enc_p2p_payload_t)) == ENC_BLOCK_SIZE);
+STATIC_ASSERT((sizeof(enc_p2p_record_t)) == 12);
+
+/* -------------------------------------------------------------------------- */
+
+#define ENC_P2P_COUNTER_SIGNATURE (0xC7E20001UL)
+#define ENC_P2P_CTR_DOMAIN        (0x01U)
+
+/* MAC key is derived from the P2P key, the block never collides with a CTR block */
+static const uint8_t _MAC_KEY_DERIVATION_BLOCK[ENC_BLOCK_SIZE] = { 0xFF, 'L', 'O', 'K', 'O', '-', 'M', 'A', 'C' };
+
+static struct {
+    bool is_key_ready;
+    lorawan_aes_context aes; /* 256 bit P2P key, expanded once per boot */
+    AES_CMAC_CTX cmac;       /* Keyed CMAC context, copied for every MAC */
+} _ctx = {
+    .is_key_ready = false,
+};
+
+/* -------------------------------------------------------------------------- */
+
+static void _put_le32(uint8_t *data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _check_key(void) {
+    if (_ctx.is_key_ready == false) {
+        enc_p2p_init();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Expands the key schedule, must be called again after the P2P key is changed */
+void enc_p2p_init(void) {
+    uint8_t p2p_key[SETTINGS_P2P_KEY_SIZE];
+    settings_get_p2p_key(p2p_key);
+
+    lorawan_aes_set_key(p2p_key, SETTINGS_P2P_KEY_SIZE, &_ctx.aes);
+    memset(p2p_key, 0, sizeof(p2p_key));
+
+    uint8_t mac_key[ENC_BLOCK_SIZE];
+    lorawan_aes_encrypt(_MAC_KEY_DERIVATION_BLOCK, mac_key, &_ctx.aes);
+
+    AES_CMAC_Init(&_ctx.cmac);
+    AES_CMAC_SetKey(&_ctx.cmac, mac_key);
+    memset(mac_key, 0, sizeof(mac_key));
+
+    _ctx.is_key_ready = true;
+}
 
 /* -------------------------------------------------------------------------- */
 
@@ -24,11 +80,65 @@ uint8_t enc_p2p_get_integrity_value(enc_p2p_payload_t const *payload) {
 /* -------------------------------------------------------------------------- */
 
 void enc_p2p_payload_bin(uint8_t encrypted[ENC_BLOCK_SIZE], enc_p2p_payload_t const *payload) {
+    _check_key();
+    lorawan_aes_encrypt(payload->raw, encrypted, &_ctx.aes);
+}
 
-    uint8_t p2p_key[SETTINGS_P2P_KEY_SIZE];
-    settings_get_p2p_key(p2p_key);
+/* -------------------------------------------------------------------------- */
+
+/* The counter is the CTR nonce, it must not repeat for the key. It survives the shutdown in the RTC backup domain
+ * and never goes below counter_floor, e.g. GNSS time in seconds, which covers the backup domain loss */
+uint32_t enc_p2p_get_next_counter(uint32_t counter_floor) {
+    uint32_t counter = 0;
+
+    if (bsp_rtc_store_read_reg(RTC_BACKUP_REG_P2P_COUNTER_SIGNATURE) == ENC_P2P_COUNTER_SIGNATURE) {
+        counter = bsp_rtc_store_read_reg(RTC_BACKUP_REG_P2P_COUNTER) + 1U;
+    }
+
+    counter = MAX(counter, counter_floor);
+
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_P2P_COUNTER_SIGNATURE, ENC_P2P_COUNTER_SIGNATURE);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_P2P_COUNTER, counter);
+
+    return counter;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Counter block: domain, id1, id2, counter (little endian), zero, block index (big endian) */
+void enc_p2p_ctr_crypt(uint8_t *data, size_t size, uint32_t id1, uint32_t id2, uint32_t counter) {
+    _check_key();
+
+    uint8_t block[ENC_BLOCK_SIZE] = { ENC_P2P_CTR_DOMAIN };
+    _put_le32(&block[1], id1);
+    _put_le32(&block[5], id2);
+    _put_le32(&block[9], counter);
+
+    for (size_t offset = 0, index = 0; offset < size; offset += ENC_BLOCK_SIZE, index++) {
+        uint8_t key_stream[ENC_BLOCK_SIZE];
+        block[14] = (uint8_t)(index >> 8);
+        block[15] = (uint8_t)index;
+        lorawan_aes_encrypt(block, key_stream, &_ctx.aes);
+
+        for (size_t i = 0; (i < ENC_BLOCK_SIZE) && ((offset + i) < size); i++) {
+            data[offset + i] ^= key_stream[i];
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* AES-CMAC truncated to ENC_P2P_MAC_SIZE, computed over the packet header and the encrypted records */
+void enc_p2p_get_mac(uint8_t mac[ENC_P2P_MAC_SIZE], uint8_t const *data, size_t size) {
+    _check_key();
+
+    AES_CMAC_CTX cmac = _ctx.cmac;
+    uint8_t digest[AES_CMAC_DIGEST_LENGTH];
+
+    AES_CMAC_Update(&cmac, data, (uint32_t)size);
+    AES_CMAC_Final(digest, &cmac);
 
-    lorawan_aes_encrypt_256(payload->raw, encrypted, p2p_key, p2p_key);
+    memcpy(mac, digest, ENC_P2P_MAC_SIZE);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -4,7 +4,8 @@
 extern "C" {
 #endif /* __cplusplus */
 
-#define ENC_BLOCK_SIZE 16
+#define ENC_BLOCK_SIZE   16
+#define ENC_P2P_MAC_SIZE 4
 
 typedef struct PACKED {
     union {
@@ -22,9 +23,25 @@ typedef struct PACKED {
     };
 } __packed enc_p2p_payload_t;
 
+/* Record of the authenticated packet, the packet carries one or more records encrypted in CTR mode */
+typedef struct PACKED {
+    uint8_t vbat     : 4; /* (n + 27) * 0.1 */
+    uint8_t reserved : 4;
+    uint8_t lat_32bit[4];
+    uint8_t lon_32bit[4];
+    uint8_t speed_mps;
+    uint16_t alt_meters;
+} __packed enc_p2p_record_t;
+
+void enc_p2p_init(void);
+
 uint8_t enc_p2p_get_integrity_value(enc_p2p_payload_t const *payload);
 void enc_p2p_payload_bin(uint8_t encrypted[ENC_BLOCK_SIZE], enc_p2p_payload_t const *payload);
 
+uint32_t enc_p2p_get_next_counter(uint32_t counter_floor);
+void enc_p2p_ctr_crypt(uint8_t *data, size_t size, uint32_t id1, uint32_t id2, uint32_t counter);
+void enc_p2p_get_mac(uint8_t mac[ENC_P2P_MAC_SIZE], uint8_t const *data, size_t size);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,121 @@
+#include "event.h"
+#include <bsp.h>
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+STATIC_ASSERT(EVENT_TYPE_COUNT <= 32U);
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _pending = 0; /* Bit per event_type_t, set by event_post() */
+
+static struct {
+    bool is_running;
+    uint32_t deadline_ts;
+} _timers[EVENT_TIMER_COUNT];
+
+/* -------------------------------------------------------------------------- */
+
+static int32_t _get_time_left_ms(size_t timer) {
+    return (int32_t)(_timers[timer].deadline_ts - bsp_get_ticks());
+}
+
+/* -------------------------------------------------------------------------- */
+
+void event_init(void) {
+    __atomic_store_n(&_pending, 0, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < EVENT_TIMER_COUNT; i++) {
+        _timers[i].is_running = false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void event_post(event_type_t type) {
+    if (type < EVENT_TYPE_COUNT) {
+        __atomic_fetch_or(&_pending, 1UL << type, __ATOMIC_RELAXED);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Takes the pending event of the lowest type, the bit is cleared atomically as an interrupt may post it again */
+bool event_get(event_t *event) {
+    for (size_t type = 0; type < EVENT_TYPE_COUNT; type++) {
+        const uint32_t BIT = 1UL << type;
+
+        if ((__atomic_fetch_and(&_pending, ~BIT, __ATOMIC_RELAXED) & BIT) != 0) {
+            event->type = (event_type_t)type;
+            event->timer = 0;
+            return true;
+        }
+    }
+
+    for (size_t timer = 0; timer < EVENT_TIMER_COUNT; timer++) {
+        if (_timers[timer].is_running && (_get_time_left_ms(timer) <= 0)) {
+            _timers[timer].is_running = false;
+            event->type = EVENT_TYPE_TIMER;
+            event->timer = timer;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Idles until an interrupt, the nearest timer or max_idle_ms later. The pending events are checked with the
+ * interrupts masked, so an event posted after the check leaves its interrupt pending. That ends the idle at once and
+ * the handler runs when the interrupts are enabled again */
+void event_wait(uint32_t max_idle_ms) {
+    uint32_t idle_ms = max_idle_ms;
+
+    for (size_t timer = 0; timer < EVENT_TIMER_COUNT; timer++) {
+        if (_timers[timer].is_running == false) {
+            continue;
+        }
+
+        const int32_t LEFT_MS = _get_time_left_ms(timer);
+        if (LEFT_MS <= 0) {
+            return;
+        }
+        idle_ms = MIN(idle_ms, (uint32_t)LEFT_MS);
+    }
+
+    bsp_disable_irq();
+
+    if (__atomic_load_n(&_pending, __ATOMIC_RELAXED) == 0) {
+        bsp_lp_idle(idle_ms);
+    }
+
+    bsp_enable_irq();
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Restarts the timer when it is running already, the expiry of the former deadline is not delivered */
+void event_timer_start(size_t timer, uint32_t timeout_ms) {
+    if (timer < EVENT_TIMER_COUNT) {
+        _timers[timer].deadline_ts = bsp_get_ticks() + timeout_ms;
+        _timers[timer].is_running = true;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void event_timer_stop(size_t timer) {
+    if (timer < EVENT_TIMER_COUNT) {
+        _timers[timer].is_running = false;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool event_timer_is_running(size_t timer) {
+    return (timer < EVENT_TIMER_COUNT) && _timers[timer].is_running;
+}
+
+/* -------------------------------------------------------------------------- */
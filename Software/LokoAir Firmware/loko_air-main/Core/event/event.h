@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Run-to-completion event queue of the application core. Each event is handled to the end before the next one is
+ * taken, the core sleeps while nothing is pending. Pending events are bits, so event_post() is safe in the interrupt
+ * handlers and never fails. An event posted again before it is taken is delivered once, the handler reads the
+ * current state anyway. The timers are polled by event_get(), they belong to the main loop only */
+
+#ifndef EVENT_TIMER_COUNT
+#    define EVENT_TIMER_COUNT (4U)
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+/* Delivery order when several events are pending, the expired timers come last */
+typedef enum {
+    EVENT_TYPE_ENTRY,        /*<! Current state has been entered */
+    EVENT_TYPE_TX_DONE,      /*<! P2P transmission, LoRaWAN join or uplink is complete */
+    EVENT_TYPE_GNSS_EPOCH,   /*<! NMEA sentences have been parsed, the fix may have changed */
+    EVENT_TYPE_BUTTON_EDGE,  /*<! Button has been pressed or released */
+    EVENT_TYPE_CHARGER_EDGE, /*<! USB power has been connected or disconnected */
+    EVENT_TYPE_TIMER,        /*<! Timer of event_timer_start() has expired */
+    EVENT_TYPE_COUNT,
+} event_type_t;
+
+typedef struct {
+    event_type_t type;
+    size_t timer; /*<! Expired timer of EVENT_TYPE_TIMER */
+} event_t;
+
+/* -------------------------------------------------------------------------- */
+
+void event_init(void);
+void event_post(event_type_t type);
+bool event_get(event_t *event);
+void event_wait(uint32_t max_idle_ms);
+void event_timer_start(size_t timer, uint32_t timeout_ms);
+void event_timer_stop(size_t timer);
+bool event_timer_is_running(size_t timer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -1,5 +1,6 @@
 #include "gnss_trace.h"
 #include <bsp.h>
+#include <profile/profile.h>
 #include <string.h>
 
 /* -------------------------------------------------------------------------- */
@@ -111,6 +112,8 @@ gtrace_result_t gtrace_init(gtrace_t *context) {
 /* -------------------------------------------------------------------------- */
 
 gtrace_result_t gtrace_add(gtrace_t *context, gtrace_record_t *record) {
+    PROFILE_BEGIN(PROFILE_SCOPE_GTRACE_ADD);
+
     if (context->current_index >= context->rec_per_page) {
         _switch_page(context);
     }
@@ -124,6 +127,7 @@ gtrace_result_t gtrace_add(gtrace_t *context, gtrace_record_t *record) {
                                sizeof(gtrace_record_t));
     context->current_index++;
     context->written_records++;
+    PROFILE_END(PROFILE_SCOPE_GTRACE_ADD);
 
     return GTRACE_RESULT_OK;
 }
@@ -7,6 +7,7 @@
 #    include <stddef.h>
 #    include <stdint.h>
 #    include <stdio.h>
+#    include <string.h>
 
 /* -------------------------------------------------------------------------- */
 
@@ -14,18 +15,71 @@ static struct {
     char buff[LOG_MAX_MESSAGE_LENGTH];
     log_mask_t mask;
     log_io_t const *io;
-#    if LOG_ISR_QUEUE == 1U
-    uint8_t queue[LOG_MAX_MESSAGE_LENGTH * 2U];
-    size_t queue_index;
-#    endif  // LOG_ISR_QUEUE == 1U
 } _ctx = {
     .mask = LOG_MASK_OFF,
     .io = NULL,
+};
+
+/* Separate from _ctx, the linker drops it when the binary mode is not used */
+static struct {
+    uint8_t data[LOG_BINARY_RING_SIZE];
+    size_t head; /* Free running indexes */
+    size_t tail;
+    uint32_t dropped;
+} _ring = {
+    .head = 0,
+    .tail = 0,
+    .dropped = 0,
+};
+
+#    if (LOG_BINARY_RING_SIZE & (LOG_BINARY_RING_SIZE - 1U)) != 0
+#        error LOG_BINARY_RING_SIZE must be a power of two
+#    endif
+
+#    if (LOG_BINARY_HEADER_SIZE + LOG_BINARY_MAX_ARGS_SIZE) > 256U
+#        error Binary frame length does not fit its byte
+#    endif
+
+/* Start of the format string section, defined by the linker when the section exists */
+extern const char __start_log_fmt[] __attribute__((weak));
+
 #    if LOG_ISR_QUEUE == 1U
-    .queue_index = 0,
-#    endif  // LOG_ISR_QUEUE == 1U
+
+#        if (LOG_ISR_QUEUE_SIZE & (LOG_ISR_QUEUE_SIZE - 1U)) != 0
+#            error LOG_ISR_QUEUE_SIZE must be a power of two
+#        endif
+
+#        if LOG_ISR_ARGS_SIZE > LOG_BINARY_MAX_ARGS_SIZE
+#            error LOG_ISR_ARGS_SIZE must fit the binary frame
+#        endif
+
+/* Message of an interrupt, the arguments are packed like in the binary mode and formatted by the main loop */
+typedef struct {
+    const char *format;
+    log_timestamp_t ts;
+    uint8_t is_ready; /* Set by the producer when the record is complete */
+    uint8_t level;
+    uint8_t kind; /* log_binary_kind_t, message or array */
+    uint8_t is_binary;
+    uint8_t args_size;
+    uint8_t args[LOG_ISR_ARGS_SIZE];
+} isr_record_t;
+
+/* Lock-free queue of many producers and one consumer. A producer reserves its record by compare and swap of the
+ * head, so interrupts of any priority can preempt each other. Records are taken in order by the main loop */
+static struct {
+    isr_record_t records[LOG_ISR_QUEUE_SIZE];
+    uint32_t head; /* Free running indexes */
+    uint32_t tail;
+    uint32_t dropped;
+} _isr = {
+    .head = 0,
+    .tail = 0,
+    .dropped = 0,
 };
 
+#    endif  // LOG_ISR_QUEUE == 1U
+
 /* -------------------------------------------------------------------------- */
 
 static const uint8_t snprintf_error[] = "\r\nsnprintf - internal error\r\n";
@@ -33,9 +87,26 @@ static const uint8_t snprintf_error[] = "\r\nsnprintf - internal error\r\n";
 /* -------------------------------------------------------------------------- */
 
 static void _log_to(uint8_t const *data, size_t size);
+static void _print_array(log_timestamp_t ts, const char *message, uint8_t const *array, size_t shown, size_t size);
+static size_t _pack_args(uint8_t *out, size_t max_size, const char *format, va_list *args);
 #    if LOG_TIMESTAMP_ENABLED == 1
-static inline void _print_ts(void);
+static inline void _print_ts(log_timestamp_t ts);
 #    endif  // LOG_TIMESTAMP_ENABLED == 1
+#    if LOG_ISR_QUEUE == 1U
+static void _isr_put_message(const log_mask_t level_mask, const char *format, va_list *args, bool is_binary);
+static void _isr_put_array(const log_mask_t level_mask, const char *message, const void *data, size_t size,
+                           bool is_binary);
+#    endif  // LOG_ISR_QUEUE == 1U
+
+/* -------------------------------------------------------------------------- */
+
+static inline log_timestamp_t _get_ts(void) {
+#    if LOG_TIMESTAMP_ENABLED == 1U
+    return _ctx.io->get_ts();
+#    else
+    return 0;
+#    endif  // LOG_TIMESTAMP_ENABLED == 1U
+}
 
 /* -------------------------------------------------------------------------- */
 
@@ -64,9 +135,6 @@ log_result_t log_init(const log_mask_t level_mask, log_io_t const *io) {
 
     _ctx.mask = level_mask;
     _ctx.io = io;
-#    if LOG_ISR_QUEUE == 1U
-    _ctx.queue_index = 0;
-#    endif  // LOG_ISR_QUEUE == 1U
 
     return LOGGER_RESULT_OK;
 }
@@ -78,18 +146,28 @@ void log_it(const log_mask_t level_mask, const char *format, ...) {
         return;
     }
 
+    va_list args;
+    va_start(args, format);
+
+#    if LOG_ISR_QUEUE == 1U
+    if (_ctx.io->is_isr()) {
+        _isr_put_message(level_mask, format, &args, false);
+        va_end(args);
+        return;
+    }
+
+    log_flush_isr_queue();
+#    endif  // LOG_ISR_QUEUE == 1U
+
 #    if LOG_THREADSAFE_ENABLED == 1U
     /* to protect _ctx.buff */
     _ctx.io->lock();
 #    endif  // LOG_THREADSAFE_ENABLED == 1U
 
 #    if LOG_TIMESTAMP_ENABLED == 1
-    _print_ts();
+    _print_ts(_get_ts());
 #    endif  // LOG_TIMESTAMP_ENABLED == 1
 
-    va_list args;
-    va_start(args, format);
-
     bool is_truncated = false;
     int strlen = vsnprintf(_ctx.buff, LOG_MAX_MESSAGE_LENGTH, format, args);
     if (strlen >= (int)LOG_MAX_MESSAGE_LENGTH) {
@@ -126,14 +204,34 @@ void log_array(const log_mask_t level_mask, const char *message, const void *dat
         return;
     }
 
-    uint8_t const *array = data;
+#    if LOG_ISR_QUEUE == 1U
+    if (_ctx.io->is_isr()) {
+        _isr_put_array(level_mask, message, data, size, false);
+        return;
+    }
+
+    log_flush_isr_queue();
+#    endif  // LOG_ISR_QUEUE == 1U
 
 #    if LOG_THREADSAFE_ENABLED == 1U
     _ctx.io->lock();
 #    endif  // LOG_THREADSAFE_ENABLED == 1U
 
+    _print_array(_get_ts(), message, data, size, size);
+
+#    if LOG_THREADSAFE_ENABLED == 1U
+    _ctx.io->unlock();
+#    endif  // LOG_THREADSAFE_ENABLED == 1U
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Only the shown bytes of the array are printed, the rest is marked by dots */
+static void _print_array(log_timestamp_t ts, const char *message, uint8_t const *array, size_t shown, size_t size) {
 #    if LOG_TIMESTAMP_ENABLED == 1
-    _print_ts();
+    _print_ts(ts);
+#    else
+    (void)ts;
 #    endif  // LOG_TIMESTAMP_ENABLED == 1
 
     int strlen = snprintf(_ctx.buff, sizeof(_ctx.buff), "%s[%u]:", message, size);
@@ -143,7 +241,7 @@ void log_array(const log_mask_t level_mask, const char *message, const void *dat
         _log_to(snprintf_error, sizeof(snprintf_error) - 1);
     }
 
-    for (uint32_t i = 0; i < size; i++) {
+    for (uint32_t i = 0; i < shown; i++) {
         strlen = snprintf(_ctx.buff, sizeof(_ctx.buff), " %02X", array[i]);
         if (strlen >= 0) {
             _log_to((uint8_t *)_ctx.buff, (size_t)strlen);
@@ -152,7 +250,207 @@ void log_array(const log_mask_t level_mask, const char *message, const void *dat
         }
     }
 
+    if (shown < size) {
+        _log_to((uint8_t *)" ...", sizeof(" ...") - 1);
+    }
+
     _log_to((uint8_t *)LOG_ENDLINE, sizeof(LOG_ENDLINE) - 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _put_le(uint8_t *out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (uint8_t)(value >> (8U * i));
+    }
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Walks the format like printf does, but copies the arguments instead of converting them */
+static size_t _pack_args(uint8_t *out, size_t max_size, const char *format, va_list *args) {
+    size_t size = 0;
+
+    while (*format != '\0') {
+        if (*format++ != '%') {
+            continue;
+        }
+
+        while ((*format != '\0') && (strchr("-+ #0", *format) != NULL)) {
+            format++;
+        }
+
+        /* Width and precision, '*' takes an int argument */
+        for (size_t field = 0; field < 2U; field++) {
+            if (*format == '*') {
+                int value = va_arg(*args, int);
+                if ((size + 4U) > max_size) {
+                    return size;
+                }
+                size += _put_le(&out[size], (uint32_t)value, 4U);
+                format++;
+            }
+            while ((*format >= '0') && (*format <= '9')) {
+                format++;
+            }
+            if ((field == 0) && (*format == '.')) {
+                format++;
+            } else {
+                break;
+            }
+        }
+
+        char length = 0;
+        while ((*format != '\0') && (strchr("hljztL", *format) != NULL)) {
+            length = ((length == 'l') && (*format == 'l')) ? 'q' : *format;
+            format++;
+        }
+
+        uint64_t value = 0;
+        size_t value_size = 4U;
+        char conversion = *format++;
+
+        switch (conversion) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                if ((length == 'q') || (length == 'j')) {
+                    value = va_arg(*args, unsigned long long);
+                    value_size = 8U;
+                } else if (length == 'l') {
+                    value = va_arg(*args, unsigned long);
+                } else if ((length == 'z') || (length == 't')) {
+                    value = va_arg(*args, size_t);
+                } else {
+                    value = va_arg(*args, unsigned int);
+                }
+                break;
+            case 'p':
+                value = (uintptr_t)va_arg(*args, void *);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double real = va_arg(*args, double);
+                memcpy(&value, &real, sizeof(value));
+                value_size = 8U;
+            } break;
+            case 's': {
+                const char *string = va_arg(*args, const char *);
+                if (string == NULL) {
+                    string = "(null)";
+                }
+                /* Truncated string still ends with zero, the arguments after it are dropped */
+                while ((size < max_size) && (*string != '\0')) {
+                    out[size++] = (uint8_t)*string++;
+                }
+                if (size >= max_size) {
+                    out[max_size - 1U] = 0;
+                    return max_size;
+                }
+                out[size++] = 0;
+                continue;
+            }
+            case '%':
+                continue;
+            default:
+                /* Unknown conversion, the rest of the arguments can't be walked */
+                return size;
+        }
+
+        if ((size + value_size) > max_size) {
+            return size;
+        }
+        size += _put_le(&out[size], value, value_size);
+    }
+
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _ring_free(void) {
+    return LOG_BINARY_RING_SIZE - (_ring.head - _ring.tail);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _ring_put(uint8_t const *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        _ring.data[(_ring.head + i) & (LOG_BINARY_RING_SIZE - 1U)] = data[i];
+    }
+    _ring.head += size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _frame_begin(uint8_t *frame,
+                           const log_mask_t level_mask,
+                           const char *format,
+                           log_binary_kind_t kind,
+                           log_timestamp_t ts) {
+    frame[0] = LOG_BINARY_SYNC;
+    _put_le(&frame[2], (uint16_t)(format - __start_log_fmt), 2U);
+    _put_le(&frame[4], (uint32_t)ts, 4U);
+    frame[8] = (uint8_t)level_mask;
+    frame[9] = (uint8_t)kind;
+
+    return LOG_BINARY_HEADER_SIZE;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _frame_end(uint8_t *frame, size_t size) {
+    uint8_t sum = 0;
+
+    frame[1] = (uint8_t)(size - 2U);
+    for (size_t i = 1; i < size; i++) {
+        sum = (uint8_t)(sum + frame[i]);
+    }
+    frame[size] = sum;
+
+    return size + 1U;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The count of the dropped messages goes first, when there is a room for both */
+static void _push_frame(uint8_t const *frame, size_t size) {
+#    if LOG_THREADSAFE_ENABLED == 1U
+    _ctx.io->lock();
+#    endif  // LOG_THREADSAFE_ENABLED == 1U
+
+    if (_ring.dropped > 0) {
+        uint8_t dropped[LOG_BINARY_HEADER_SIZE + 4U + 1U];
+        size_t dropped_size = _frame_begin(dropped,
+                                           LOG_MASK_WARNING,
+                                           __start_log_fmt,
+                                           LOG_BINARY_KIND_DROPPED,
+                                           _get_ts());
+        dropped_size += _put_le(&dropped[dropped_size], _ring.dropped, 4U);
+        dropped_size = _frame_end(dropped, dropped_size);
+
+        if (_ring_free() >= (dropped_size + size)) {
+            _ring_put(dropped, dropped_size);
+            _ring.dropped = 0;
+        }
+    }
+
+    if ((_ring.dropped == 0) && (_ring_free() >= size)) {
+        _ring_put(frame, size);
+    } else {
+        _ring.dropped++;
+    }
 
 #    if LOG_THREADSAFE_ENABLED == 1U
     _ctx.io->unlock();
@@ -161,46 +459,408 @@ void log_array(const log_mask_t level_mask, const char *message, const void *dat
 
 /* -------------------------------------------------------------------------- */
 
+void log_bin(const log_mask_t level_mask, const char *format, ...) {
+    if ((level_mask & _ctx.mask) == 0) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+
 #    if LOG_ISR_QUEUE == 1U
+    if (_ctx.io->is_isr()) {
+        _isr_put_message(level_mask, format, &args, true);
+        va_end(args);
+        return;
+    }
 
-void log_flush_isr_queue(void) {
-    if (_ctx.queue_index > 0) {
-        _ctx.io->write(_ctx.queue, _ctx.queue_index);
-        _ctx.queue_index = 0;
+    log_flush_isr_queue();
+#    endif  // LOG_ISR_QUEUE == 1U
+
+    uint8_t frame[LOG_BINARY_HEADER_SIZE + LOG_BINARY_MAX_ARGS_SIZE + 1U];
+    size_t size = _frame_begin(frame, level_mask, format, LOG_BINARY_KIND_MESSAGE, _get_ts());
+    size += _pack_args(&frame[size], LOG_BINARY_MAX_ARGS_SIZE, format, &args);
+    va_end(args);
+
+    _push_frame(frame, _frame_end(frame, size));
+}
+
+/* -------------------------------------------------------------------------- */
+
+void log_bin_array(const log_mask_t level_mask, const char *message, const void *data, size_t size) {
+    if ((level_mask & _ctx.mask) == 0) {
+        return;
+    }
+
+#    if LOG_ISR_QUEUE == 1U
+    if (_ctx.io->is_isr()) {
+        _isr_put_array(level_mask, message, data, size, true);
+        return;
     }
+
+    log_flush_isr_queue();
+#    endif  // LOG_ISR_QUEUE == 1U
+
+    /* The decoder shows the size of the array, the bytes are truncated to the frame */
+    uint8_t frame[LOG_BINARY_HEADER_SIZE + LOG_BINARY_MAX_ARGS_SIZE + 1U];
+    size_t frame_size = _frame_begin(frame, level_mask, message, LOG_BINARY_KIND_ARRAY, _get_ts());
+    size_t copy_size = (size < (LOG_BINARY_MAX_ARGS_SIZE - 2U)) ? size : (LOG_BINARY_MAX_ARGS_SIZE - 2U);
+
+    frame_size += _put_le(&frame[frame_size], (size > UINT16_MAX) ? UINT16_MAX : size, 2U);
+    memcpy(&frame[frame_size], data, copy_size);
+    frame_size += copy_size;
+
+    _push_frame(frame, _frame_end(frame, frame_size));
 }
 
+/* -------------------------------------------------------------------------- */
+
+void log_process(void) {
+#    if LOG_ISR_QUEUE == 1U
+    if (_ctx.io != NULL) {
+        log_flush_isr_queue();
+    }
 #    endif  // LOG_ISR_QUEUE == 1U
 
+    while ((_ctx.io != NULL) && (_ring.tail != _ring.head)) {
+        size_t index = _ring.tail & (LOG_BINARY_RING_SIZE - 1U);
+        size_t size = _ring.head - _ring.tail;
+
+        /* Contiguous part up to the end of the ring */
+        if (size > (LOG_BINARY_RING_SIZE - index)) {
+            size = LOG_BINARY_RING_SIZE - index;
+        }
+
+        _ctx.io->write(&_ring.data[index], size);
+        _ring.tail += size;
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 
-static inline void _log_to(uint8_t const *data, size_t size) {
 #    if LOG_ISR_QUEUE == 1U
 
-    if (_ctx.io->is_isr()) {
-        size_t queue_count = _ctx.queue_index;
-        for (size_t i = 0; i < size; i++) {
-            size_t index = queue_count + i;
-            if (index >= sizeof(_ctx.queue)) {
-                return;
+/* Returns NULL and counts the message as dropped when the queue is full. The retry of compare and swap happens
+ * only when a higher priority interrupt took the record in between, so the time is bounded by the nesting */
+static isr_record_t *_isr_reserve(void) {
+    uint32_t head = __atomic_load_n(&_isr.head, __ATOMIC_RELAXED);
+
+    do {
+        if ((head - __atomic_load_n(&_isr.tail, __ATOMIC_ACQUIRE)) >= LOG_ISR_QUEUE_SIZE) {
+            __atomic_fetch_add(&_isr.dropped, 1U, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&_isr.head, &head, head + 1U, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return &_isr.records[head & (LOG_ISR_QUEUE_SIZE - 1U)];
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _isr_put_message(const log_mask_t level_mask, const char *format, va_list *args, bool is_binary) {
+    isr_record_t *record = _isr_reserve();
+
+    if (record == NULL) {
+        return;
+    }
+
+    record->format = format;
+    record->ts = _get_ts();
+    record->level = (uint8_t)level_mask;
+    record->kind = LOG_BINARY_KIND_MESSAGE;
+    record->is_binary = is_binary;
+    record->args_size = (uint8_t)_pack_args(record->args, sizeof(record->args), format, args);
+
+    __atomic_store_n(&record->is_ready, 1U, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _isr_put_array(const log_mask_t level_mask, const char *message, const void *data, size_t size,
+                           bool is_binary) {
+    isr_record_t *record = _isr_reserve();
+
+    if (record == NULL) {
+        return;
+    }
+
+    const size_t COPY_SIZE = (size < (LOG_ISR_ARGS_SIZE - 2U)) ? size : (LOG_ISR_ARGS_SIZE - 2U);
+
+    record->format = message;
+    record->ts = _get_ts();
+    record->level = (uint8_t)level_mask;
+    record->kind = LOG_BINARY_KIND_ARRAY;
+    record->is_binary = is_binary;
+    _put_le(record->args, (size > UINT16_MAX) ? UINT16_MAX : size, 2U);
+    memcpy(&record->args[2], data, COPY_SIZE);
+    record->args_size = (uint8_t)(2U + COPY_SIZE);
+
+    __atomic_store_n(&record->is_ready, 1U, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint64_t _get_le(uint8_t const *data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= (uint64_t)data[i] << (8U * i);
+    }
+    return value;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The reverse of _pack_args(), each conversion is printed by snprintf() with its own part of the format */
+static size_t _format_args(char *out, size_t max_size, const char *format, uint8_t const *args, size_t args_size) {
+#        define _PRINT_SPEC(value)                                                     \
+            ((star_count == 0)   ? snprintf(&out[size], room, spec, value)           \
+             : (star_count == 1) ? snprintf(&out[size], room, spec, stars[0], value) \
+                                 : snprintf(&out[size], room, spec, stars[0], stars[1], value))
+
+    size_t size = 0;
+    size_t index = 0;
+
+    while ((*format != '\0') && ((size + 1U) < max_size)) {
+        if (*format != '%') {
+            out[size++] = *format++;
+            continue;
+        }
+
+        const char *start = format++;
+        int stars[2] = { 0 };
+        size_t star_count = 0;
+        bool is_missing = false;
+
+        while ((*format != '\0') && (strchr("-+ #0", *format) != NULL)) {
+            format++;
+        }
+
+        for (size_t field = 0; field < 2U; field++) {
+            if (*format == '*') {
+                if ((index + 4U) <= args_size) {
+                    stars[star_count++] = (int)(uint32_t)_get_le(&args[index], 4U);
+                    index += 4U;
+                } else {
+                    is_missing = true;
+                }
+                format++;
+            }
+            while ((*format >= '0') && (*format <= '9')) {
+                format++;
+            }
+            if ((field == 0) && (*format == '.')) {
+                format++;
+            } else {
+                break;
             }
-            _ctx.queue[index] = data[i];
-            _ctx.queue_index++;
         }
 
+        char length = 0;
+        while ((*format != '\0') && (strchr("hljztL", *format) != NULL)) {
+            length = ((length == 'l') && (*format == 'l')) ? 'q' : *format;
+            format++;
+        }
+
+        const char CONVERSION = *format;
+        if (CONVERSION == '\0') {
+            break;
+        }
+        format++;
+
+        char spec[16];
+        const size_t SPEC_SIZE = (size_t)(format - start);
+        const size_t room = max_size - size;
+        int written = -1;
+
+        if (SPEC_SIZE >= sizeof(spec)) {
+            is_missing = true;
+        } else {
+            memcpy(spec, start, SPEC_SIZE);
+            spec[SPEC_SIZE] = '\0';
+        }
+
+        switch (is_missing ? '\0' : CONVERSION) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c': {
+                const size_t VALUE_SIZE = ((length == 'q') || (length == 'j')) ? 8U : 4U;
+                if ((index + VALUE_SIZE) > args_size) {
+                    is_missing = true;
+                    break;
+                }
+                uint64_t value = _get_le(&args[index], VALUE_SIZE);
+                index += VALUE_SIZE;
+
+                /* Sign of the 4 bytes is extended for a long wider than them */
+                if ((VALUE_SIZE == 4U) && ((CONVERSION == 'd') || (CONVERSION == 'i'))) {
+                    value = (uint64_t)(int64_t)(int32_t)(uint32_t)value;
+                }
+
+                if (VALUE_SIZE == 8U) {
+                    written = _PRINT_SPEC((unsigned long long)value);
+                } else if (length == 'l') {
+                    written = _PRINT_SPEC((unsigned long)value);
+                } else if ((length == 'z') || (length == 't')) {
+                    written = _PRINT_SPEC((size_t)value);
+                } else {
+                    written = _PRINT_SPEC((unsigned int)value);
+                }
+            } break;
+            case 'p':
+                if ((index + 4U) > args_size) {
+                    is_missing = true;
+                    break;
+                }
+                written = _PRINT_SPEC((void *)(uintptr_t)_get_le(&args[index], 4U));
+                index += 4U;
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                if ((index + 8U) > args_size) {
+                    is_missing = true;
+                    break;
+                }
+                uint64_t bits = _get_le(&args[index], 8U);
+                double real = 0;
+                memcpy(&real, &bits, sizeof(real));
+                index += 8U;
+                written = _PRINT_SPEC(real);
+            } break;
+            case 's': {
+                const uint8_t *end = (index < args_size) ? memchr(&args[index], 0, args_size - index) : NULL;
+                if (end == NULL) {
+                    is_missing = true;
+                    break;
+                }
+                written = _PRINT_SPEC((const char *)&args[index]);
+                index = (size_t)(end - args) + 1U;
+            } break;
+            case '%':
+                written = snprintf(&out[size], room, "%%");
+                break;
+            default:
+                /* Unknown conversion, the rest of the arguments can't be walked */
+                is_missing = true;
+                index = args_size;
+                break;
+        }
+
+        if (is_missing) {
+            written = snprintf(&out[size], room, "<?>");
+        }
+
+        if (written > 0) {
+            size += ((size_t)written < room) ? (size_t)written : (room - 1U);
+        }
+    }
+
+    out[size] = '\0';
+    return size;
+
+#        undef _PRINT_SPEC
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _isr_record_out(isr_record_t const *record) {
+    if (record->is_binary) {
+        uint8_t frame[LOG_BINARY_HEADER_SIZE + LOG_BINARY_MAX_ARGS_SIZE + 1U];
+        size_t size = _frame_begin(frame, record->level, record->format, record->kind, record->ts);
+
+        memcpy(&frame[size], record->args, record->args_size);
+        _push_frame(frame, _frame_end(frame, size + record->args_size));
         return;
     }
 
-    log_flush_isr_queue();
+    if (record->kind == LOG_BINARY_KIND_ARRAY) {
+        const size_t SIZE = (size_t)_get_le(record->args, 2U);
+        _print_array(record->ts, record->format, &record->args[2], record->args_size - 2U, SIZE);
+        return;
+    }
+
+#        if LOG_TIMESTAMP_ENABLED == 1
+    _print_ts(record->ts);
+#        endif  // LOG_TIMESTAMP_ENABLED == 1
+
+    size_t strlen = _format_args(_ctx.buff, sizeof(_ctx.buff), record->format, record->args, record->args_size);
+    _log_to((uint8_t *)_ctx.buff, strlen);
+    _log_to((uint8_t *)LOG_ENDLINE, sizeof(LOG_ENDLINE) - 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void log_flush_isr_queue(void) {
+    for (;;) {
+        const uint32_t TAIL = _isr.tail;
+        isr_record_t *record = &_isr.records[TAIL & (LOG_ISR_QUEUE_SIZE - 1U)];
+
+        /* A record reserved by a preempted interrupt stops the flush, the next one will take it */
+        if (__atomic_load_n(&record->is_ready, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+
+#        if LOG_THREADSAFE_ENABLED == 1U
+        _ctx.io->lock();
+#        endif  // LOG_THREADSAFE_ENABLED == 1U
+
+        _isr_record_out(record);
+
+#        if LOG_THREADSAFE_ENABLED == 1U
+        _ctx.io->unlock();
+#        endif  // LOG_THREADSAFE_ENABLED == 1U
+
+        record->is_ready = 0;
+        __atomic_store_n(&_isr.tail, TAIL + 1U, __ATOMIC_RELEASE);
+    }
+
+    const uint32_t DROPPED = __atomic_exchange_n(&_isr.dropped, 0U, __ATOMIC_RELAXED);
+
+    if (DROPPED > 0) {
+#        if LOG_BINARY_ENABLED == 1U
+        /* Reported by the dropped frame before the next message */
+        _ring.dropped += DROPPED;
+#        else
+        if ((LOG_MASK_WARNING & _ctx.mask) != 0) {
+#            if LOG_TIMESTAMP_ENABLED == 1
+            _print_ts(_get_ts());
+#            endif  // LOG_TIMESTAMP_ENABLED == 1
+            int strlen = snprintf(_ctx.buff,
+                                  sizeof(_ctx.buff),
+                                  "%" PRIu32 " messages of interrupts dropped, the log queue was full",
+                                  DROPPED);
+            if (strlen >= 0) {
+                _log_to((uint8_t *)_ctx.buff, (size_t)strlen);
+            } else {
+                _log_to(snprintf_error, sizeof(snprintf_error) - 1);
+            }
+            _log_to((uint8_t *)LOG_ENDLINE, sizeof(LOG_ENDLINE) - 1);
+        }
+#        endif  // LOG_BINARY_ENABLED == 1U
+    }
+}
+
 #    endif  // LOG_ISR_QUEUE == 1U
 
+/* -------------------------------------------------------------------------- */
+
+static inline void _log_to(uint8_t const *data, size_t size) {
     _ctx.io->write(data, size);
 }
 
 /* -------------------------------------------------------------------------- */
 
 #    if LOG_TIMESTAMP_ENABLED == 1
-static inline void _print_ts(void) {
+static inline void _print_ts(log_timestamp_t ts) {
 #        if LOG_ENABLED_COLOR == 1
 #            define _COLOR "\033[0;97m"
 #        else
@@ -215,8 +875,6 @@ static inline void _print_ts(void) {
 #        endif  // LOG_TIMESTAMP_64BIT == 1
     static const char TS_TEMPLATE[] = _COLOR _FORMAT;
 
-    log_timestamp_t ts = _ctx.io->get_ts();
-
     int strlen = snprintf(_ctx.buff, sizeof(_ctx.buff), TS_TEMPLATE, (ts / _DIVIDER), (uint32_t)(ts % 1000UL));
     if (strlen >= 0) {
         _log_to((uint8_t *)_ctx.buff, (size_t)strlen);
@@ -36,6 +36,51 @@ extern "C" {
 #    define LOG_ISR_QUEUE (0U)
 #endif  // LOG_ISR_QUEUE
 
+#if !defined(LOG_ISR_QUEUE_SIZE)
+#    define LOG_ISR_QUEUE_SIZE (8U)
+#endif  // LOG_ISR_QUEUE_SIZE
+
+#if !defined(LOG_ISR_ARGS_SIZE)
+#    define LOG_ISR_ARGS_SIZE (32U)
+#endif  // LOG_ISR_ARGS_SIZE
+
+#if !defined(LOG_BINARY_ENABLED)
+#    define LOG_BINARY_ENABLED (0U)
+#endif  // LOG_BINARY_ENABLED
+
+#if !defined(LOG_BINARY_RING_SIZE)
+#    define LOG_BINARY_RING_SIZE (1024U)
+#endif  // LOG_BINARY_RING_SIZE
+
+#if !defined(LOG_BINARY_MAX_ARGS_SIZE)
+#    define LOG_BINARY_MAX_ARGS_SIZE (128U)
+#endif  // LOG_BINARY_MAX_ARGS_SIZE
+
+/* ===== BINARY FRAME ======================================================= */
+
+/*
+    [0]      LOG_BINARY_SYNC
+    [1]      length of the fields below, without the checksum
+    [2..3]   message id, offset of the format string in the log_fmt section, little endian
+    [4..7]   timestamp, little endian
+    [8]      log_mask_t level
+    [9]      log_binary_kind_t
+    [10..]   arguments: integers as 4 bytes (8 for ll and j), doubles as 8 bytes, strings with the terminating zero,
+             little endian. An array is its size as 2 bytes and the bytes, dropped is the count as 4 bytes
+    [last]   sum of the bytes [1..last-1]
+
+    tools/log-decoder.py reconstructs the text with the section extracted from the elf after the build
+*/
+#define LOG_BINARY_SYNC           (0xA5U)
+#define LOG_BINARY_HEADER_SIZE    (10U)
+#define LOG_BINARY_FORMAT_SECTION __attribute__((section("log_fmt")))
+
+typedef enum {
+    LOG_BINARY_KIND_MESSAGE = 0,
+    LOG_BINARY_KIND_ARRAY = 1,
+    LOG_BINARY_KIND_DROPPED = 2, /*<! Messages lost when the ring was full */
+} log_binary_kind_t;
+
 /* ===== TYPEDEFS =========================================================== */
 
 typedef enum log_mask_e {
@@ -64,10 +109,24 @@ typedef uint64_t log_timestamp_t;
 
 /* ===== LOG MACROS ========================================================= */
 
-#if LOG_ENABLED == 1U
+/* Format string is kept in its own section, its offset there is the message id */
+#define _LOG_BINARY(function, level, format, ...)                           \
+    do {                                                                    \
+        static const char _log_format[] LOG_BINARY_FORMAT_SECTION = format; \
+        function(level, _log_format, ##__VA_ARGS__);                        \
+    } while (0)
+
+#if (LOG_ENABLED == 1U) && (LOG_BINARY_ENABLED == 1U)
+#    define LOG(...)       _LOG_BINARY(log_bin, __VA_ARGS__)
+#    define LOG_ARRAY(...) _LOG_BINARY(log_bin_array, __VA_ARGS__)
+#elif LOG_ENABLED == 1U
 #    define LOG(...)       log_it(__VA_ARGS__)
 #    define LOG_ARRAY(...) log_array(__VA_ARGS__)
 #else /* LOG_ENABLED == 1 */
+#    define LOG_PROCESS()                                       \
+        do {                                                    \
+            /* emtpy macro to avoid static analyzer warnings */ \
+        } while (0)
 #    define LOG(...)                                            \
         do {                                                    \
             /* emtpy macro to avoid static analyzer warnings */ \
@@ -78,6 +137,10 @@ typedef uint64_t log_timestamp_t;
         } while (0)
 #endif /* LOG_ENABLED == 1 */
 
+#if LOG_ENABLED == 1U
+#    define LOG_PROCESS() log_process()
+#endif /* LOG_ENABLED == 1 */
+
 #if LOG_ENABLED_COLOR == 1
 #    define LOG_COLOR_RED     "91"
 #    define LOG_COLOR_GREEN   "92"
@@ -132,7 +195,16 @@ log_result_t log_init(const log_mask_t level, log_io_t const *io);
 void log_it(const log_mask_t level, const char *format, ...) __PRINTF_FORMAT;
 void log_array(const log_mask_t level, const char *message, const void *array, size_t size);
 
+/* Binary mode, the message is packed into the ring without formatting. Format must be in LOG_BINARY_FORMAT_SECTION */
+void log_bin(const log_mask_t level, const char *format, ...) __PRINTF_FORMAT;
+void log_bin_array(const log_mask_t level, const char *message, const void *array, size_t size);
+
+/* Writes the interrupt queue and the binary ring out, call it from the main loop and before sleep or reset */
+void log_process(void);
+
 #    if LOG_ISR_QUEUE == 1U
+/* Interrupts only pack the arguments to the queue, it is printed here. Messages lost when the queue was full are
+ * reported as a count. Called by log_process() and by every log call outside of interrupts, to keep the order */
 void log_flush_isr_queue(void);
 #    endif  // LOG_ISR_QUEUE == 1U
 
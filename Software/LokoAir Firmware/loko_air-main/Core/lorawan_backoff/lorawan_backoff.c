@@ -0,0 +1,127 @@
+#include "lorawan_backoff.h"
+#include <bsp.h>
+#include <rtc_backup_layout.h>
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define BACKOFF_SIGNATURE      (0xB0FF0000UL)
+#define BACKOFF_SIGNATURE_MASK (0xFFFF0000UL)
+#define BACKOFF_FAIL_COUNT_MAX (0xFFFFUL)
+#define LOG_PREFIX             "BACKOFF: "
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _get_fail_count(void) {
+    return bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF) & BACKOFF_FAIL_COUNT_MAX;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _set_fail_count(uint32_t fail_count) {
+    fail_count = MIN(fail_count, BACKOFF_FAIL_COUNT_MAX);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF, BACKOFF_SIGNATURE | fail_count);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Exponential wait of the fail count with a jitter, the random value selects it in the jitter range */
+static uint32_t _get_backoff_s(uint32_t fail_count, uint32_t random) {
+    uint32_t backoff_s = LORAWAN_BACKOFF_BASE_S;
+
+    for (uint32_t i = 1; (i < fail_count) && (backoff_s < LORAWAN_BACKOFF_MAX_S); i++) {
+        backoff_s *= 2U;
+    }
+    backoff_s = MIN(backoff_s, LORAWAN_BACKOFF_MAX_S);
+
+    const uint32_t JITTER_S = (backoff_s * LORAWAN_BACKOFF_JITTER_PERCENT) / 100U;
+
+    return backoff_s - JITTER_S + (random % (2U * JITTER_S + 1U));
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_init(bool is_sleep_time_valid) {
+    uint32_t signature = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF);
+
+    if ((signature & BACKOFF_SIGNATURE_MASK) != BACKOFF_SIGNATURE) {
+        lorawan_backoff_reset();
+        return;
+    }
+
+    uint32_t wait_s = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S);
+
+    if (is_sleep_time_valid == true) {
+        uint32_t sleep_s = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_SLEEP_S);
+        wait_s = (sleep_s >= wait_s) ? 0 : wait_s - sleep_s;
+    } else {
+        /* Woken up by the user, who expects the device to try right away */
+        wait_s = 0;
+    }
+
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S, wait_s);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_SLEEP_S, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+lorawan_backoff_action_t lorawan_backoff_get_action(void) {
+    if (_get_fail_count() == 0) {
+        return LORAWAN_BACKOFF_ACTION_SEND;
+    }
+
+    uint32_t wait_s = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S);
+
+    if (wait_s > 0) {
+        LOG_INFO(LOG_PREFIX "%lu failed attempts, next one in %lu s", _get_fail_count(), wait_s);
+        return LORAWAN_BACKOFF_ACTION_SKIP;
+    }
+
+    return LORAWAN_BACKOFF_ACTION_PROBE;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_on_success(void) {
+    if (_get_fail_count() > 0) {
+        LOG_INFO(LOG_PREFIX "Coverage is back after %lu failed attempts", _get_fail_count());
+    }
+
+    _set_fail_count(0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_on_failure(uint32_t random) {
+    uint32_t fail_count = _get_fail_count() + 1U;
+    uint32_t wait_s = _get_backoff_s(fail_count, random);
+
+    LOG_WARNING(LOG_PREFIX "Attempt %lu failed, next one in %lu s", fail_count, wait_s);
+
+    _set_fail_count(fail_count);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S, wait_s);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_prepare_to_shutdown(uint32_t sleep_s) {
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_SLEEP_S, sleep_s);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_get_state(lorawan_backoff_state_t *state) {
+    state->fail_count = _get_fail_count();
+    state->wait_s = bsp_rtc_store_read_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_reset(void) {
+    _set_fail_count(0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_WAIT_S, 0);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF_SLEEP_S, 0);
+}
+
+/* -------------------------------------------------------------------------- */
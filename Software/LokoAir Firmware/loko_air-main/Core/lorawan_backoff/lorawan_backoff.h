@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Out of coverage the LoRaWAN attempts are spread out exponentially, the fixes of the skipped wakeups go to the trace
+ * only. The state lives in the RTC backup registers, so it survives the shutdown between the wakeups */
+
+#define LORAWAN_BACKOFF_BASE_S         (900UL)   /*<! Wait after the first failed attempt */
+#define LORAWAN_BACKOFF_MAX_S          (21600UL) /*<! Wait limit, four attempts a day without coverage */
+#define LORAWAN_BACKOFF_JITTER_PERCENT (25U)     /*<! Wait is randomized by +-25% to spread the devices out */
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    LORAWAN_BACKOFF_ACTION_SEND,  /*<! Link is fine, join and send as usual */
+    LORAWAN_BACKOFF_ACTION_PROBE, /*<! Backoff has expired, single join attempt and a link check */
+    LORAWAN_BACKOFF_ACTION_SKIP,  /*<! Backoff is running, keep the radio off */
+} lorawan_backoff_action_t;
+
+typedef struct {
+    uint32_t fail_count; /*<! Consecutive failed attempts */
+    uint32_t wait_s;     /*<! Time left until the next attempt */
+} lorawan_backoff_state_t;
+
+/* -------------------------------------------------------------------------- */
+
+void lorawan_backoff_init(bool is_sleep_time_valid);
+lorawan_backoff_action_t lorawan_backoff_get_action(void);
+void lorawan_backoff_on_success(void);
+void lorawan_backoff_on_failure(uint32_t random);
+void lorawan_backoff_prepare_to_shutdown(uint32_t sleep_s);
+void lorawan_backoff_get_state(lorawan_backoff_state_t *state);
+void lorawan_backoff_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
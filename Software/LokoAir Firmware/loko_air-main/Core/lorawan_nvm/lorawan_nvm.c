@@ -0,0 +1,314 @@
+#include "lorawan_nvm.h"
+#include <bsp.h>
+#include <crc16.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define FLASH_WORD_SIZE (8U)
+#define PAGE_MAGIC      (0x4D564E4CUL) /* "LNVM" */
+#define RECORD_ERASED   (0xFFFFU)
+#define RUN_HEADER_SIZE (3U)   /* Offset and length of the changed bytes */
+#define RUN_MAX_SIZE    (255U) /* Length is a byte */
+#define LOG_PREFIX      "LoRaWAN NVM: "
+
+#define ALIGN_TO_WORD(size) (((size) + FLASH_WORD_SIZE - 1U) & ~(FLASH_WORD_SIZE - 1U))
+
+/* -------------------------------------------------------------------------- */
+
+/* Written after the snapshot, a page without a valid header is never used */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t context_size;
+    uint16_t context_crc;
+    uint16_t reserved;
+    uint16_t crc;
+} page_header_t;
+
+/* The payload is a list of runs: offset (2 bytes), length (1 byte) and the new bytes */
+typedef struct {
+    uint16_t payload_size;
+    uint16_t crc; /*<! Payload size and the payload */
+} record_header_t;
+
+#define PAGE_HEADER_SIZE   ALIGN_TO_WORD(sizeof(page_header_t))
+#define RECORD_HEADER_SIZE sizeof(record_header_t)
+#define RECORD_PAYLOAD_MAX (LORAWAN_NVM_RECORD_MAX_SIZE - RECORD_HEADER_SIZE)
+
+static uint8_t _record[LORAWAN_NVM_RECORD_MAX_SIZE];
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_page_offset(size_t page) {
+    return page * bsp_flash_get_lorawan_nvm_page_size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _get_records_offset(size_t context_size) {
+    return PAGE_HEADER_SIZE + ALIGN_TO_WORD(context_size);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _get_header_crc(page_header_t const *header) {
+    return crc16_ccitt((uint8_t const *)header, offsetof(page_header_t, crc), CRC16_CCITT_INIT_VAL);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _get_record_crc(uint8_t const *record, size_t payload_size) {
+    uint16_t crc = crc16_ccitt(record, offsetof(record_header_t, crc), CRC16_CCITT_INIT_VAL);
+    return crc16_ccitt(&record[RECORD_HEADER_SIZE], (uint32_t)payload_size, crc);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Reads the snapshot of the page into the shadow, only a complete one with a valid checksum is accepted */
+static bool _read_snapshot(lorawan_nvm_t *nvm, size_t page, page_header_t *header) {
+    bsp_flash_lorawan_nvm_read(_get_page_offset(page), header, sizeof(page_header_t));
+
+    if ((header->magic != PAGE_MAGIC) || (header->crc != _get_header_crc(header)) ||
+        (header->context_size > LORAWAN_NVM_CONTEXT_MAX_SIZE) || (header->context_size == 0)) {
+        return false;
+    }
+
+    bsp_flash_lorawan_nvm_read(_get_page_offset(page) + PAGE_HEADER_SIZE, nvm->shadow, header->context_size);
+
+    return header->context_crc == crc16_ccitt(nvm->shadow, header->context_size, CRC16_CCITT_INIT_VAL);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _apply_record(lorawan_nvm_t *nvm, uint8_t const *payload, size_t payload_size) {
+    size_t index = 0;
+
+    while (index < payload_size) {
+        if ((payload_size - index) < RUN_HEADER_SIZE) {
+            return false;
+        }
+
+        const size_t OFFSET = (size_t)payload[index] | ((size_t)payload[index + 1] << 8);
+        const size_t SIZE = payload[index + 2];
+        index += RUN_HEADER_SIZE;
+
+        if (((payload_size - index) < SIZE) || ((OFFSET + SIZE) > nvm->context_size)) {
+            return false;
+        }
+
+        memcpy(&nvm->shadow[OFFSET], &payload[index], SIZE);
+        index += SIZE;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Replays the records of the current page into the shadow, leaves the offset at the first free record */
+static void _replay_records(lorawan_nvm_t *nvm) {
+    const size_t PAGE_SIZE = bsp_flash_get_lorawan_nvm_page_size();
+
+    nvm->offset = _get_records_offset(nvm->context_size);
+    nvm->record_count = 0;
+
+    while ((nvm->offset + RECORD_HEADER_SIZE) <= PAGE_SIZE) {
+        record_header_t header;
+        bsp_flash_lorawan_nvm_read(_get_page_offset(nvm->page) + nvm->offset, &header, sizeof(header));
+
+        if ((header.payload_size == RECORD_ERASED) && (header.crc == RECORD_ERASED)) {
+            return;
+        }
+
+        const size_t RECORD_SIZE = ALIGN_TO_WORD(RECORD_HEADER_SIZE + header.payload_size);
+        bool is_valid = (header.payload_size <= RECORD_PAYLOAD_MAX) && ((nvm->offset + RECORD_SIZE) <= PAGE_SIZE);
+
+        if (is_valid) {
+            bsp_flash_lorawan_nvm_read(_get_page_offset(nvm->page) + nvm->offset, _record, RECORD_SIZE);
+            is_valid = (header.crc == _get_record_crc(_record, header.payload_size)) &&
+                       _apply_record(nvm, &_record[RECORD_HEADER_SIZE], header.payload_size);
+        }
+
+        if (!is_valid) {
+            /* Interrupted store, nothing was appended after it. The page is closed, the next store writes a snapshot */
+            LOG_WARNING(LOG_PREFIX "Torn record at %u of page %u", nvm->offset, nvm->page);
+            nvm->offset = PAGE_SIZE;
+            return;
+        }
+
+        nvm->offset += RECORD_SIZE;
+        nvm->record_count++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static lorawan_nvm_result_t _write_snapshot(lorawan_nvm_t *nvm, void const *context, size_t size) {
+    const size_t PAGE = (nvm->page + 1U) % bsp_flash_get_lorawan_nvm_page_count();
+
+    if (_get_records_offset(size) > bsp_flash_get_lorawan_nvm_page_size()) {
+        return LORAWAN_NVM_RESULT_ERROR;
+    }
+
+    page_header_t header = {
+        .magic = PAGE_MAGIC,
+        .sequence = nvm->sequence + 1U,
+        .context_size = (uint16_t)size,
+        .context_crc = crc16_ccitt(context, (uint32_t)size, CRC16_CCITT_INIT_VAL),
+        .reserved = 0xFFFFU,
+    };
+    header.crc = _get_header_crc(&header);
+
+    /* The previous snapshot stays valid until the header of the new one is written */
+    bsp_flash_lorawan_nvm_erase_page(PAGE);
+    bsp_flash_lorawan_nvm_write(_get_page_offset(PAGE) + PAGE_HEADER_SIZE, context, size);
+    bsp_flash_lorawan_nvm_write(_get_page_offset(PAGE), &header, sizeof(header));
+
+    nvm->page = PAGE;
+    nvm->sequence = header.sequence;
+    nvm->context_size = size;
+    nvm->offset = _get_records_offset(size);
+    nvm->record_count = 0;
+    nvm->is_valid = true;
+    memcpy(nvm->shadow, context, size);
+
+    LOG_INFO(LOG_PREFIX "Snapshot %lu to page %u", (unsigned long)nvm->sequence, PAGE);
+
+    return LORAWAN_NVM_RESULT_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Builds the runs of the changed bytes. Unchanged gaps shorter than the run header are merged into the run */
+static size_t _build_payload(lorawan_nvm_t const *nvm, uint8_t const *context, uint8_t *payload, size_t max_size) {
+    size_t payload_size = 0;
+    size_t i = 0;
+
+    while (i < nvm->context_size) {
+        if (context[i] == nvm->shadow[i]) {
+            i++;
+            continue;
+        }
+
+        const size_t START = i;
+        size_t end = i + 1U;
+
+        for (size_t j = end; (j < nvm->context_size) && (j < (end + RUN_HEADER_SIZE)) && ((j - START) < RUN_MAX_SIZE);
+             j++) {
+            if (context[j] != nvm->shadow[j]) {
+                end = j + 1U;
+            }
+        }
+
+        const size_t SIZE = end - START;
+
+        if ((payload_size + RUN_HEADER_SIZE + SIZE) > max_size) {
+            return max_size + 1U;
+        }
+
+        payload[payload_size++] = (uint8_t)START;
+        payload[payload_size++] = (uint8_t)(START >> 8);
+        payload[payload_size++] = (uint8_t)SIZE;
+        memcpy(&payload[payload_size], &context[START], SIZE);
+        payload_size += SIZE;
+
+        i = end;
+    }
+
+    return payload_size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+lorawan_nvm_result_t lorawan_nvm_load(lorawan_nvm_t *nvm, void *context, size_t size) {
+    const size_t PAGE_COUNT = bsp_flash_get_lorawan_nvm_page_count();
+    bool is_found = false;
+
+    nvm->is_valid = false;
+    nvm->page = PAGE_COUNT - 1U;
+    nvm->sequence = 0;
+
+    for (size_t page = 0; page < PAGE_COUNT; page++) {
+        page_header_t header;
+
+        if (!_read_snapshot(nvm, page, &header)) {
+            continue;
+        }
+
+        if (!is_found || ((int32_t)(header.sequence - nvm->sequence) > 0)) {
+            is_found = true;
+            nvm->page = page;
+            nvm->sequence = header.sequence;
+        }
+    }
+
+    if (!is_found) {
+        return LORAWAN_NVM_RESULT_NO_CONTEXT;
+    }
+
+    page_header_t header;
+    _read_snapshot(nvm, nvm->page, &header);
+    nvm->context_size = header.context_size;
+    _replay_records(nvm);
+
+    /* Stored context is rounded up to the flash double word */
+    if (size > nvm->context_size) {
+        LOG_WARNING(LOG_PREFIX "Stored context of %u bytes, %u expected", nvm->context_size, size);
+        return LORAWAN_NVM_RESULT_NO_CONTEXT;
+    }
+
+    nvm->is_valid = true;
+    memcpy(context, nvm->shadow, size);
+
+    LOG_INFO(LOG_PREFIX "Snapshot %lu of page %u, %u records",
+             (unsigned long)nvm->sequence,
+             nvm->page,
+             nvm->record_count);
+
+    return LORAWAN_NVM_RESULT_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+lorawan_nvm_result_t lorawan_nvm_store(lorawan_nvm_t *nvm, void const *context, size_t size) {
+    if ((size == 0) || (size > LORAWAN_NVM_CONTEXT_MAX_SIZE)) {
+        return LORAWAN_NVM_RESULT_ERROR;
+    }
+
+    if (!nvm->is_valid || (size != nvm->context_size)) {
+        return _write_snapshot(nvm, context, size);
+    }
+
+    const size_t PAYLOAD_SIZE = _build_payload(nvm, context, &_record[RECORD_HEADER_SIZE], RECORD_PAYLOAD_MAX);
+
+    if (PAYLOAD_SIZE == 0) {
+        return LORAWAN_NVM_RESULT_UNCHANGED;
+    }
+
+    const size_t RECORD_SIZE = ALIGN_TO_WORD(RECORD_HEADER_SIZE + PAYLOAD_SIZE);
+
+    if ((PAYLOAD_SIZE > RECORD_PAYLOAD_MAX) || ((nvm->offset + RECORD_SIZE) > bsp_flash_get_lorawan_nvm_page_size())) {
+        return _write_snapshot(nvm, context, size);
+    }
+
+    record_header_t header = {
+        .payload_size = (uint16_t)PAYLOAD_SIZE,
+    };
+    memcpy(_record, &header, sizeof(header));
+    header.crc = _get_record_crc(_record, PAYLOAD_SIZE);
+    memcpy(_record, &header, sizeof(header));
+    memset(&_record[RECORD_HEADER_SIZE + PAYLOAD_SIZE], 0xFF, RECORD_SIZE - RECORD_HEADER_SIZE - PAYLOAD_SIZE);
+
+    bsp_flash_lorawan_nvm_write(_get_page_offset(nvm->page) + nvm->offset, _record, RECORD_SIZE);
+
+    nvm->offset += RECORD_SIZE;
+    nvm->record_count++;
+    memcpy(nvm->shadow, context, size);
+
+    LOG_DEBUG(LOG_PREFIX "Record of %u bytes, page %u", RECORD_SIZE, nvm->page);
+
+    return LORAWAN_NVM_RESULT_OK;
+}
+
+/* -------------------------------------------------------------------------- */
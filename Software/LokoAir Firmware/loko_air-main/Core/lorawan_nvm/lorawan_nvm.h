@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* LoRaWAN context storage. Each page begins with a full snapshot of the context, the following uplinks append only the
+ * changed bytes (frame counters and the CRCs of their groups) as journal records. A new snapshot goes to the next page
+ * in rotation when the page is full, so the erases are spread over all of the LoRaWAN NVM pages */
+
+#define LORAWAN_NVM_CONTEXT_MAX_SIZE (1536U) /*<! LoRaMacNvmData_t rounded up to the flash double word */
+#define LORAWAN_NVM_RECORD_MAX_SIZE  (128U)  /*<! Larger changes are stored as a new snapshot */
+
+typedef struct {
+    size_t page;         /*<! Page of the latest snapshot */
+    size_t offset;       /*<! Free space of the page for the next record */
+    size_t record_count; /*<! Records after the latest snapshot */
+    uint32_t sequence;   /*<! Sequence number of the latest snapshot */
+    size_t context_size;
+    bool is_valid; /*<! Shadow holds the context stored in the flash */
+    uint8_t shadow[LORAWAN_NVM_CONTEXT_MAX_SIZE];
+} lorawan_nvm_t;
+
+typedef enum {
+    LORAWAN_NVM_RESULT_OK,
+    LORAWAN_NVM_RESULT_UNCHANGED,
+    LORAWAN_NVM_RESULT_NO_CONTEXT,
+    LORAWAN_NVM_RESULT_ERROR,
+} lorawan_nvm_result_t;
+
+/* Finds the latest snapshot and replays its records. Torn record of an interrupted store ends the journal, the next
+ * store writes a snapshot then */
+lorawan_nvm_result_t lorawan_nvm_load(lorawan_nvm_t *nvm, void *context, size_t size);
+
+/* Appends the difference to the loaded context, or writes a new snapshot when the record does not fit */
+lorawan_nvm_result_t lorawan_nvm_store(lorawan_nvm_t *nvm, void const *context, size_t size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
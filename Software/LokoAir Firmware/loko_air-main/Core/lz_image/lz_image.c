@@ -0,0 +1,176 @@
+#include "lz_image.h"
+#include <crc16.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define WINDOW_MASK (LZ_IMAGE_WINDOW_SIZE - 1U)
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _read_le32(uint8_t const *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint16_t _read_le16(uint8_t const *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _flush(lz_image_t *ctx) {
+    size_t size = ctx->produced & WINDOW_MASK;
+    size = (size == 0) ? LZ_IMAGE_WINDOW_SIZE : size;
+
+    ctx->crc = crc16_ccitt(ctx->window, (uint32_t)size, ctx->crc);
+    ctx->output(ctx->user, ctx->produced - size, ctx->window, size);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _put(lz_image_t *ctx, uint8_t byte) {
+    if (ctx->produced >= ctx->image_size) {
+        return false;
+    }
+
+    ctx->window[ctx->produced & WINDOW_MASK] = byte;
+    ctx->produced++;
+
+    if ((ctx->produced & WINDOW_MASK) == 0) {
+        _flush(ctx);
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _copy_match(lz_image_t *ctx, uint16_t match) {
+    const uint32_t OFFSET = (uint32_t)(match >> 5) + 1U;
+    const uint32_t LENGTH = (uint32_t)(match & 0x1FU) + LZ_IMAGE_MATCH_MIN;
+
+    if (OFFSET > ctx->produced) {
+        return false;
+    }
+
+    /* Byte by byte, the match may overlap the bytes it produces */
+    for (uint32_t i = 0; i < LENGTH; i++) {
+        if (_put(ctx, ctx->window[(ctx->produced - OFFSET) & WINDOW_MASK]) == false) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _parse_header(lz_image_t *ctx) {
+    const uint16_t HEADER_CRC = crc16_ccitt(ctx->header, LZ_IMAGE_HEADER_SIZE - 2, CRC16_CCITT_INIT_VAL);
+
+    if ((_read_le32(&ctx->header[0]) != LZ_IMAGE_MAGIC) || (_read_le16(&ctx->header[14]) != HEADER_CRC)) {
+        return false;
+    }
+
+    ctx->image_size = _read_le32(&ctx->header[4]);
+    ctx->packed_size = _read_le32(&ctx->header[8]);
+    ctx->image_crc = _read_le16(&ctx->header[12]);
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _decode_byte(lz_image_t *ctx, uint8_t byte) {
+
+    if (ctx->is_match_hi) {
+        ctx->is_match_hi = false;
+        return _copy_match(ctx, (uint16_t)((ctx->match_hi << 8) | byte));
+    }
+
+    if (ctx->flag_count == 0) {
+        ctx->flags = byte;
+        ctx->flag_count = 8;
+        return true;
+    }
+
+    bool is_literal = (ctx->flags & 0x01U) != 0;
+    ctx->flags >>= 1;
+    ctx->flag_count--;
+
+    if (is_literal) {
+        return _put(ctx, byte);
+    }
+
+    ctx->match_hi = byte;
+    ctx->is_match_hi = true;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static lz_image_result_t _finish(lz_image_t *ctx) {
+    if ((ctx->produced != ctx->image_size) || ctx->is_match_hi) {
+        return LZ_IMAGE_RESULT_ERROR;
+    }
+
+    if ((ctx->produced & WINDOW_MASK) != 0) {
+        _flush(ctx);
+    }
+
+    return (ctx->crc == ctx->image_crc) ? LZ_IMAGE_RESULT_DONE : LZ_IMAGE_RESULT_ERROR;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void lz_image_init(lz_image_t *ctx, lz_image_output_t output, void *user) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->output = output;
+    ctx->user = user;
+    ctx->crc = CRC16_CCITT_INIT_VAL;
+    ctx->result = LZ_IMAGE_RESULT_IN_PROGRESS;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Bytes after the end of the stream, e.g. write alignment padding, are ignored */
+lz_image_result_t lz_image_feed(lz_image_t *ctx, uint8_t const *data, size_t size) {
+
+    for (size_t i = 0; (i < size) && (ctx->result == LZ_IMAGE_RESULT_IN_PROGRESS); i++) {
+
+        if (ctx->received < LZ_IMAGE_HEADER_SIZE) {
+            ctx->header[ctx->received] = data[i];
+            ctx->received++;
+
+            if (ctx->received == LZ_IMAGE_HEADER_SIZE) {
+                if (_parse_header(ctx) == false) {
+                    ctx->result = LZ_IMAGE_RESULT_ERROR;
+                } else if (ctx->packed_size == 0) {
+                    ctx->result = _finish(ctx);
+                }
+            }
+        } else {
+            ctx->received++;
+
+            if (_decode_byte(ctx, data[i]) == false) {
+                ctx->result = LZ_IMAGE_RESULT_ERROR;
+            }
+        }
+
+        if ((ctx->result == LZ_IMAGE_RESULT_IN_PROGRESS) && (ctx->received > LZ_IMAGE_HEADER_SIZE) &&
+            ((ctx->received - LZ_IMAGE_HEADER_SIZE) == ctx->packed_size)) {
+            ctx->result = _finish(ctx);
+        }
+    }
+
+    return ctx->result;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t lz_image_get_size(lz_image_t const *ctx) {
+    return ctx->image_size;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Container: header, then LZSS stream. Header fields are little endian:
+ * magic u32, image size u32, packed size u32, image CRC16/CCITT u16, header CRC16/CCITT u16 (over the first 14 bytes).
+ * Stream: a flag byte for every 8 items, LSB first, 1 - literal byte, 0 - match of 2 bytes, big endian:
+ * 11 bits of (offset - 1) and 5 bits of (length - LZ_IMAGE_MATCH_MIN) */
+#define LZ_IMAGE_MAGIC       (0x315A4B4CUL) /*<! "LKZ1" */
+#define LZ_IMAGE_HEADER_SIZE (16U)
+#define LZ_IMAGE_WINDOW_SIZE (2048U) /*<! Also the output chunk size, flash page aligned */
+#define LZ_IMAGE_MATCH_MIN   (3U)
+#define LZ_IMAGE_MATCH_MAX   (LZ_IMAGE_MATCH_MIN + 31U)
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    LZ_IMAGE_RESULT_IN_PROGRESS,
+    LZ_IMAGE_RESULT_DONE,
+    LZ_IMAGE_RESULT_ERROR,
+} lz_image_result_t;
+
+/* Unpacked data in order, offset is a multiple of LZ_IMAGE_WINDOW_SIZE */
+typedef void (*lz_image_output_t)(void *user, size_t offset, uint8_t const *data, size_t size);
+
+typedef struct {
+    lz_image_output_t output;
+    void *user;
+    lz_image_result_t result;
+
+    uint8_t header[LZ_IMAGE_HEADER_SIZE];
+    uint32_t image_size;
+    uint32_t packed_size;
+    uint16_t image_crc;
+
+    uint32_t received; /*<! Container bytes, header included */
+    uint32_t produced; /*<! Unpacked bytes */
+    uint16_t crc;      /*<! CRC of the emitted output */
+
+    uint8_t flags;
+    uint8_t flag_count;
+    uint8_t match_hi;
+    bool is_match_hi;
+
+    uint8_t window[LZ_IMAGE_WINDOW_SIZE];
+} lz_image_t;
+
+/* -------------------------------------------------------------------------- */
+
+void lz_image_init(lz_image_t *ctx, lz_image_output_t output, void *user);
+lz_image_result_t lz_image_feed(lz_image_t *ctx, uint8_t const *data, size_t size);
+uint32_t lz_image_get_size(lz_image_t const *ctx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
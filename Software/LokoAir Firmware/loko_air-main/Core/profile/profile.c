@@ -0,0 +1,80 @@
+#include "profile.h"
+#include <bsp.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+static profile_stats_t _scopes[PROFILE_SCOPE_COUNT];
+
+static char const *const _names[PROFILE_SCOPE_COUNT] = {
+    [PROFILE_SCOPE_GNSS_UART_ISR] = "gnss_uart_isr",
+    [PROFILE_SCOPE_LWGPS_PROCESS] = "lwgps_process",
+    [PROFILE_SCOPE_GTRACE_ADD] = "gtrace_add",
+    [PROFILE_SCOPE_FLASH_WRITE] = "flash_write",
+    [PROFILE_SCOPE_AES_BLOCK] = "aes_block",
+    [PROFILE_SCOPE_SETTINGS_SAVE] = "settings_save",
+};
+
+/* -------------------------------------------------------------------------- */
+
+void profile_init(void) {
+    bsp_cycles_init();
+    profile_reset();
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t profile_get_cycles(void) {
+    return bsp_cycles_get();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void profile_record(profile_scope_t scope, uint32_t cycles) {
+    if (scope >= PROFILE_SCOPE_COUNT) {
+        return;
+    }
+
+    profile_stats_t *stats = &_scopes[scope];
+
+    if ((stats->count == 0) || (cycles < stats->min_cycles)) {
+        stats->min_cycles = cycles;
+    }
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    stats->total_cycles += cycles;
+    stats->count++;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The copy may be torn by an interrupt scope updated in between, it is fine for the printout */
+void profile_get(profile_scope_t scope, profile_stats_t *stats) {
+    if (scope >= PROFILE_SCOPE_COUNT) {
+        memset(stats, 0, sizeof(profile_stats_t));
+        return;
+    }
+
+    *stats = _scopes[scope];
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t profile_get_avg(profile_stats_t const *stats) {
+    return (stats->count == 0) ? 0 : (uint32_t)(stats->total_cycles / stats->count);
+}
+
+/* -------------------------------------------------------------------------- */
+
+char const *profile_get_name(profile_scope_t scope) {
+    return (scope < PROFILE_SCOPE_COUNT) ? _names[scope] : "";
+}
+
+/* -------------------------------------------------------------------------- */
+
+void profile_reset(void) {
+    memset(_scopes, 0, sizeof(_scopes));
+}
+
+/* -------------------------------------------------------------------------- */
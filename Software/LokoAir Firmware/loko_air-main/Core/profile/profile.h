@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Cycle profiling of the hot paths by the DWT cycle counter. Every scope keeps count, min, max and the total of the
+ * cycles between PROFILE_BEGIN() and PROFILE_END() in the same block. A scope is measured from one context only,
+ * the interrupt handler scopes are not measured in the main loop. Release builds and the bootloader compile it out */
+
+#ifndef PROFILE_ENABLED
+#    if (CONFIG_BOOTLOADER_BUILD == 0) && ((DEBUG_BUILD == 1) || (CONFIG_LOKO_CPPUTEST == 1))
+#        define PROFILE_ENABLED (1U)
+#    else
+#        define PROFILE_ENABLED (0U)
+#    endif
+#endif
+
+#if PROFILE_ENABLED == 1
+#    define PROFILE_INIT()       profile_init()
+#    define PROFILE_BEGIN(scope) const uint32_t _profile_begin_##scope = profile_get_cycles()
+#    define PROFILE_END(scope)   profile_record((scope), profile_get_cycles() - _profile_begin_##scope)
+#else
+#    define PROFILE_INIT()
+#    define PROFILE_BEGIN(scope)
+#    define PROFILE_END(scope)
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+typedef enum {
+    PROFILE_SCOPE_GNSS_UART_ISR,  /*<! GNSS LPUART interrupt handler */
+    PROFILE_SCOPE_LWGPS_PROCESS,  /*<! NMEA parser, one byte */
+    PROFILE_SCOPE_GTRACE_ADD,     /*<! GNSS trace record write */
+    PROFILE_SCOPE_FLASH_WRITE,    /*<! Flash program of a buffer */
+    PROFILE_SCOPE_AES_BLOCK,      /*<! AES block encryption */
+    PROFILE_SCOPE_SETTINGS_SAVE,  /*<! Settings write with the check */
+    PROFILE_SCOPE_COUNT,
+} profile_scope_t;
+
+typedef struct {
+    uint32_t count;        /*<! Measurements done */
+    uint32_t min_cycles;   /*<! The shortest one, 0 without measurements */
+    uint32_t max_cycles;   /*<! The longest one */
+    uint64_t total_cycles; /*<! Sum of all measurements, gives the average */
+} profile_stats_t;
+
+/* -------------------------------------------------------------------------- */
+
+void profile_init(void);
+uint32_t profile_get_cycles(void);
+void profile_record(profile_scope_t scope, uint32_t cycles);
+void profile_get(profile_scope_t scope, profile_stats_t *stats);
+uint32_t profile_get_avg(profile_stats_t const *stats);
+char const *profile_get_name(profile_scope_t scope);
+void profile_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -1,5 +1,6 @@
 #include "settings.h"
 #include <assert.h>
+#include <profile/profile.h>
 #include <string.h>
 
 #define AUTO_SAVE_DATA     (1)
@@ -76,7 +77,7 @@ void settings_print(void) {
     _LOG("\t.gnss_mode = %ld", _storage.settings.gnss_mode);
     _LOG("\t.is_lorawan_mode = %d", _storage.settings.is_lorawan_mode);
     _LOG("\t.debug_output = %ld", _storage.settings.debug_output);
-    _LOG("\t.is_p2p_encrypted = %d", _storage.settings.is_p2p_encrypted);
+    _LOG("\t.p2p_encryption = %d", _storage.settings.p2p_encryption);
     _LOG("\t.is_extended_packet = %d", _storage.settings.is_extended_packet);
     _LOG("\t.lorawan_region_id = %d", _storage.settings.lorawan_region_id);
     LOG_DEBUG_ARRAY("\t.lora_dev_eui", _storage.settings.lora_dev_eui, sizeof(_storage.settings.lora_dev_eui));
@@ -188,6 +189,7 @@ void settings_reload(void) {
 /* -------------------------------------------------------------------------- */
 
 void settings_save(void) {
+    PROFILE_BEGIN(PROFILE_SCOPE_SETTINGS_SAVE);
     settings_packet_t storage_last;
     _io->read(sizeof(settings_packet_t) * _storage.index, &storage_last, sizeof(settings_packet_t));
 
@@ -219,6 +221,7 @@ void settings_save(void) {
     } else {
         _LOG("no need save");
     }
+    PROFILE_END(PROFILE_SCOPE_SETTINGS_SAVE);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -325,14 +328,26 @@ void settings_set_lorawan_mode(bool is_lorawan_mode) {
 /* -------------------------------------------------------------------------- */
 
 bool settings_get_is_p2p_encrypted(void) {
-    return _storage.settings.is_p2p_encrypted;
+    return _storage.settings.p2p_encryption != SETTINGS_P2P_ENCRYPTION_OFF;
 }
 
 /* -------------------------------------------------------------------------- */
 
 void settings_set_p2p_encrypted(bool is_p2p_encrypted) {
-    _LOG("Set .is_p2p_encrypted = %d", is_p2p_encrypted);
-    _storage.settings.is_p2p_encrypted = is_p2p_encrypted;
+    settings_set_p2p_encryption(is_p2p_encrypted ? SETTINGS_P2P_ENCRYPTION_ECB : SETTINGS_P2P_ENCRYPTION_OFF);
+}
+
+/* -------------------------------------------------------------------------- */
+
+settings_p2p_encryption_t settings_get_p2p_encryption(void) {
+    return (settings_p2p_encryption_t)_storage.settings.p2p_encryption;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void settings_set_p2p_encryption(settings_p2p_encryption_t p2p_encryption) {
+    _LOG("Set .p2p_encryption = %d", p2p_encryption);
+    _storage.settings.p2p_encryption = (uint8_t)p2p_encryption;
 
 #if AUTO_SAVE_DATA == 1
     _save_request();
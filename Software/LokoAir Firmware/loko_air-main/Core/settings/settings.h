@@ -27,6 +27,14 @@ typedef enum settings_gnss_mode_s {
     SETTINGS_GNSS_MODE_COUNT,
 } settings_gnss_mode_t;
 
+typedef enum settings_p2p_encryption_s {
+    SETTINGS_P2P_ENCRYPTION_OFF = 0,
+    SETTINGS_P2P_ENCRYPTION_ECB,     /* Single block, 8 bit integrity */
+    SETTINGS_P2P_ENCRYPTION_CTR_MAC, /* Counter nonce, CTR over the records, truncated CMAC */
+
+    SETTINGS_P2P_ENCRYPTION_COUNT,
+} settings_p2p_encryption_t;
+
 /* -------------------------------------------------------------------------- */
 
 typedef struct PACKED {
@@ -39,7 +47,7 @@ typedef struct PACKED {
     settings_gnss_mode_t gnss_mode;
     bool debug_output;
     bool is_lorawan_mode;
-    bool is_p2p_encrypted;
+    uint8_t p2p_encryption; /* settings_p2p_encryption_t, same size as the former is_p2p_encrypted flag */
     bool is_extended_packet;
     uint8_t lora_dev_eui[SETTINGS_LORA_DEV_EUI_SIZE];
     uint8_t lora_app_eui[SETTINGS_LORA_APP_EUI_SIZE];
@@ -97,6 +105,9 @@ bool settings_get_is_lorawan_mode(void);
 void settings_set_p2p_encrypted(bool is_p2p_encrypted);
 bool settings_get_is_p2p_encrypted(void);
 
+void settings_set_p2p_encryption(settings_p2p_encryption_t p2p_encryption);
+settings_p2p_encryption_t settings_get_p2p_encryption(void);
+
 void settings_set_extended_packet(bool is_extended_packet);
 bool settings_get_is_extended_packet(void);
 
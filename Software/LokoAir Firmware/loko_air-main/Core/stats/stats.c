@@ -0,0 +1,85 @@
+#include "stats.h"
+#include <utils.h>
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _counters[STATS_COUNTER_COUNT];
+
+static char const *const _names[STATS_COUNTER_COUNT] = {
+    [STATS_COUNTER_GNSS_RX_PEAK] = "gnss_rx_peak",
+    [STATS_COUNTER_GNSS_RX_OVERFLOW] = "gnss_rx_overflow",
+    [STATS_COUNTER_DEBUG_RX_PEAK] = "debug_rx_peak",
+    [STATS_COUNTER_DEBUG_RX_OVERFLOW] = "debug_rx_overflow",
+    [STATS_COUNTER_NMEA_SENTENCES] = "nmea_sentences",
+    [STATS_COUNTER_NMEA_CRC_ERRORS] = "nmea_crc_errors",
+    [STATS_COUNTER_FLASH_PROGRAMS] = "flash_programs",
+    [STATS_COUNTER_FLASH_ERASES] = "flash_erases",
+    [STATS_COUNTER_RADIO_TX] = "radio_tx",
+    [STATS_COUNTER_RADIO_TX_ERRORS] = "radio_tx_errors",
+    [STATS_COUNTER_RADIO_TX_MS] = "radio_tx_ms",
+    [STATS_COUNTER_STOP2_ENTRIES] = "stop2_entries",
+    [STATS_COUNTER_STOP2_MS] = "stop2_ms",
+    [STATS_COUNTER_STATE_INIT_MS] = "state_init_ms",
+    [STATS_COUNTER_STATE_TICKLE_MS] = "state_tickle_ms",
+    [STATS_COUNTER_STATE_FIX_MS] = "state_fix_ms",
+    [STATS_COUNTER_STATE_SEND_MS] = "state_send_ms",
+    [STATS_COUNTER_STATE_TX_DONE_MS] = "state_tx_done_ms",
+    [STATS_COUNTER_STATE_SHUTDOWN_MS] = "state_shutdown_ms",
+    [STATS_COUNTER_STATE_CHARGING_MS] = "state_charging_ms",
+};
+
+/* -------------------------------------------------------------------------- */
+
+void stats_inc(stats_counter_t counter) {
+    stats_add(counter, 1U);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void stats_add(stats_counter_t counter, uint32_t value) {
+    if (counter < STATS_COUNTER_COUNT) {
+        __atomic_fetch_add(&_counters[counter], value, __ATOMIC_RELAXED);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* High-water mark, the exchange is retried when an interrupt has updated the counter in between */
+void stats_max(stats_counter_t counter, uint32_t value) {
+    if (counter >= STATS_COUNTER_COUNT) {
+        return;
+    }
+
+    uint32_t current = __atomic_load_n(&_counters[counter], __ATOMIC_RELAXED);
+    while (value > current) {
+        if (__atomic_compare_exchange_n(&_counters[counter], &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t stats_get(stats_counter_t counter) {
+    if (counter >= STATS_COUNTER_COUNT) {
+        return 0;
+    }
+
+    return __atomic_load_n(&_counters[counter], __ATOMIC_RELAXED);
+}
+
+/* -------------------------------------------------------------------------- */
+
+char const *stats_get_name(stats_counter_t counter) {
+    return (counter < STATS_COUNTER_COUNT) ? _names[counter] : "";
+}
+
+/* -------------------------------------------------------------------------- */
+
+void stats_reset(void) {
+    for (size_t i = 0; i < COUNT_OF(_counters); i++) {
+        __atomic_store_n(&_counters[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+
+/* Runtime counters of the hot paths since the start or the last stats_reset(). The updates are atomic, so they are
+ * safe in the interrupt handlers, the counters wrap around */
+
+typedef enum {
+    STATS_COUNTER_GNSS_RX_PEAK,       /*<! GNSS UART queue high-water mark, bytes */
+    STATS_COUNTER_GNSS_RX_OVERFLOW,   /*<! GNSS UART bytes lost on the full queue */
+    STATS_COUNTER_DEBUG_RX_PEAK,      /*<! Debug UART queue high-water mark, bytes */
+    STATS_COUNTER_DEBUG_RX_OVERFLOW,  /*<! Debug UART bytes lost on the full queue */
+    STATS_COUNTER_NMEA_SENTENCES,     /*<! NMEA sentences with the right CRC */
+    STATS_COUNTER_NMEA_CRC_ERRORS,    /*<! NMEA sentences dropped by the CRC */
+    STATS_COUNTER_FLASH_PROGRAMS,     /*<! Flash double words programmed */
+    STATS_COUNTER_FLASH_ERASES,       /*<! Flash pages erased */
+    STATS_COUNTER_RADIO_TX,           /*<! P2P radio transmissions done */
+    STATS_COUNTER_RADIO_TX_ERRORS,    /*<! P2P radio transmissions failed or timed out */
+    STATS_COUNTER_RADIO_TX_MS,        /*<! P2P radio time in TX */
+    STATS_COUNTER_STOP2_ENTRIES,      /*<! Idle periods spent in Stop2 */
+    STATS_COUNTER_STOP2_MS,           /*<! Time spent in Stop2 */
+    STATS_COUNTER_STATE_INIT_MS,      /*<! Time per application state, system_state_t order */
+    STATS_COUNTER_STATE_TICKLE_MS,
+    STATS_COUNTER_STATE_FIX_MS,
+    STATS_COUNTER_STATE_SEND_MS,
+    STATS_COUNTER_STATE_TX_DONE_MS,
+    STATS_COUNTER_STATE_SHUTDOWN_MS,
+    STATS_COUNTER_STATE_CHARGING_MS,
+    STATS_COUNTER_COUNT,
+} stats_counter_t;
+
+/* -------------------------------------------------------------------------- */
+
+void stats_inc(stats_counter_t counter);
+void stats_add(stats_counter_t counter, uint32_t value);
+void stats_max(stats_counter_t counter, uint32_t value);
+uint32_t stats_get(stats_counter_t counter);
+char const *stats_get_name(stats_counter_t counter);
+void stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -1,8 +1,11 @@
 #include "stm32_bootloader_host_protocol.h"
+#include <crc16.h>
+#include <string.h>
 
 /* -------------------------------------------------------------------------- */
 
 static const uint8_t STM32_BOOTLOADER_VERSION = 0x10;
+static const size_t STREAM_PAGE_BASE_UNSET = SIZE_MAX;
 
 /* -------------------------------------------------------------------------- */
 
@@ -28,7 +31,22 @@ static uint32_t _array_to_u32(uint8_t const *array) {
 
 /* -------------------------------------------------------------------------- */
 
-static bool _is_supported_cmd(uint8_t cmd) {
+static uint16_t _array_to_u16(uint8_t const *array) {
+    return (uint16_t)((array[0] << 8) | array[1]);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_ext_supported(stm32_bootloader_context_t const *context) {
+    stm32_bootloader_io_t const *io = context->io;
+
+    return (io->is_baud_valid != NULL) && (io->set_baud != NULL) && (io->erase_page_at != NULL) &&
+           (io->page_size != 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _is_supported_cmd(stm32_bootloader_context_t const *context, uint8_t cmd) {
     // clang-format off
     return (cmd == STM32_BOOTLOADER_CMD_GET) ||
            (cmd == STM32_BOOTLOADER_CMD_GET_VERSION) ||
@@ -37,6 +55,9 @@ static bool _is_supported_cmd(uint8_t cmd) {
            (cmd == STM32_BOOTLOADER_CMD_GO) ||
            (cmd == STM32_BOOTLOADER_CMD_WRITE_MEMORY) ||
            (cmd == STM32_BOOTLOADER_CMD_ERASE) ||
+           ((cmd == STM32_BOOTLOADER_CMD_EXT_GET) && _is_ext_supported(context)) ||
+           ((cmd == STM32_BOOTLOADER_CMD_EXT_SET_BAUD) && _is_ext_supported(context)) ||
+           ((cmd == STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM) && _is_ext_supported(context)) ||
            0;
     // clang-format on
 }
@@ -49,6 +70,141 @@ static void _send_ack_nack(stm32_bootloader_context_t const *context, bool is_ac
 
 /* -------------------------------------------------------------------------- */
 
+static void _reset_rx_context(stm32_bootloader_context_t *context) {
+    context->state = STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND;
+    context->received = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _send_stream_ack_nack(stm32_bootloader_context_t const *context, bool is_ack, uint8_t seq) {
+    uint8_t const response[] = { is_ack ? STM32_BOOTLOADER_ACK : STM32_BOOTLOADER_NACK, seq };
+    context->io->serial_out(response, sizeof(response));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _get_ticks(stm32_bootloader_context_t const *context) {
+    return (context->io->get_ticks != NULL) ? context->io->get_ticks() : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _stream_start(stm32_bootloader_context_t *context) {
+    context->stream.expected_seq = 0;
+    context->stream.is_nack_sent = false;
+    context->stream.rx_ts = _get_ticks(context);
+    context->stream.page_base = STREAM_PAGE_BASE_UNSET;
+    memset(context->stream.erased_pages, 0, sizeof(context->stream.erased_pages));
+    context->state = STM32_BOOTLOADER_STATE_STREAM;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Lazy erase, pages are erased once per stream right before the first write into them */
+static bool _stream_erase_pages(stm32_bootloader_context_t *context, size_t addr, size_t size) {
+    stm32_bootloader_stream_t *stream = &context->stream;
+    const size_t PAGE_SIZE = context->io->page_size;
+    const size_t FIRST_PAGE = addr / PAGE_SIZE;
+    const size_t LAST_PAGE = (addr + size - 1) / PAGE_SIZE;
+    const size_t PAGE_MAP_BITS = sizeof(stream->erased_pages) * 8;
+
+    if (stream->page_base == STREAM_PAGE_BASE_UNSET) {
+        stream->page_base = FIRST_PAGE;
+    }
+
+    if ((FIRST_PAGE < stream->page_base) || ((LAST_PAGE - stream->page_base) >= PAGE_MAP_BITS)) {
+        return false;
+    }
+
+    for (size_t page = FIRST_PAGE; page <= LAST_PAGE; page++) {
+        const size_t INDEX = page - stream->page_base;
+        const uint8_t MASK = (uint8_t)(1U << (INDEX % 8));
+
+        if ((stream->erased_pages[INDEX / 8] & MASK) == 0) {
+            context->io->erase_page_at(page * PAGE_SIZE);
+            stream->erased_pages[INDEX / 8] |= MASK;
+        }
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _stream_nack(stm32_bootloader_context_t *context) {
+    /* One NACK per copy of the expected block, blocks already in flight are dropped silently until it arrives */
+    if (context->stream.is_nack_sent == false) {
+        _send_stream_ack_nack(context, false, context->stream.expected_seq);
+        context->stream.is_nack_sent = true;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _stream_byte_handle(stm32_bootloader_context_t *context) {
+    uint8_t const *frame = context->buffer;
+
+    context->stream.rx_ts = _get_ticks(context);
+
+    if (frame[0] != STM32_BOOTLOADER_EXT_SYNC) {
+        context->received = 0;
+        return;
+    }
+
+    /* Retransmission of the expected block, its error is reported again */
+    if ((context->received == 2) && (frame[1] == context->stream.expected_seq)) {
+        context->stream.is_nack_sent = false;
+    }
+
+    if (context->received < STM32_BOOTLOADER_EXT_HEADER_SIZE) {
+        return;
+    }
+
+    const size_t SIZE = _array_to_u16(&frame[6]);
+
+    if (SIZE > STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX) {
+        context->received = 0;
+        _stream_nack(context);
+        return;
+    }
+
+    if (context->received < (STM32_BOOTLOADER_EXT_HEADER_SIZE + SIZE + STM32_BOOTLOADER_EXT_CRC_SIZE)) {
+        return;
+    }
+
+    context->received = 0;
+
+    const uint16_t CRC = crc16_ccitt(&frame[1], STM32_BOOTLOADER_EXT_HEADER_SIZE - 1 + SIZE, CRC16_CCITT_INIT_VAL);
+    const uint8_t SEQ = frame[1];
+
+    if ((CRC != _array_to_u16(&frame[STM32_BOOTLOADER_EXT_HEADER_SIZE + SIZE])) ||
+        (SEQ != context->stream.expected_seq)) {
+        _stream_nack(context);
+        return;
+    }
+
+    if (SIZE == 0) {
+        _send_stream_ack_nack(context, true, SEQ);
+        _reset_rx_context(context);
+        return;
+    }
+
+    const uint32_t ADDR = _array_to_u32(&frame[2]);
+
+    if (_stream_erase_pages(context, ADDR, SIZE) == false) {
+        _stream_nack(context);
+        return;
+    }
+
+    context->io->write_mem(ADDR, &frame[STM32_BOOTLOADER_EXT_HEADER_SIZE], SIZE);
+
+    context->stream.expected_seq++;
+    _send_stream_ack_nack(context, true, SEQ);
+}
+
+/* -------------------------------------------------------------------------- */
+
 static void _send_cmd_response(stm32_bootloader_context_t *context) {
     switch (context->command) {
         case STM32_BOOTLOADER_CMD_GET: {
@@ -75,6 +231,18 @@ static void _send_cmd_response(stm32_bootloader_context_t *context) {
             context->io->serial_out(response, sizeof(response));
             context->state = STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND;
         } break;
+        case STM32_BOOTLOADER_CMD_EXT_GET: {
+            uint8_t const response[] = { STM32_BOOTLOADER_EXT_VERSION,
+                                         (uint8_t)(STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX >> 8),
+                                         (uint8_t)STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX,
+                                         STM32_BOOTLOADER_EXT_WINDOW,
+                                         STM32_BOOTLOADER_ACK };
+            context->io->serial_out(response, sizeof(response));
+            context->state = STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND;
+        } break;
+        case STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM:
+            _stream_start(context);
+            break;
 
         default:
             break;
@@ -83,13 +251,6 @@ static void _send_cmd_response(stm32_bootloader_context_t *context) {
 
 /* -------------------------------------------------------------------------- */
 
-static void _reset_rx_context(stm32_bootloader_context_t *context) {
-    context->state = STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND;
-    context->received = 0;
-}
-
-/* -------------------------------------------------------------------------- */
-
 static void _command_check(stm32_bootloader_context_t *context) {
 
     if ((context->received == 1) && (context->buffer[0] == 0x7F)) {
@@ -106,7 +267,7 @@ static void _command_check(stm32_bootloader_context_t *context) {
         }
 
         context->command = context->buffer[0];
-        bool is_supported_cmd = _is_supported_cmd(context->command);
+        bool is_supported_cmd = _is_supported_cmd(context, context->command);
 
         _reset_rx_context(context);
         _send_ack_nack(context, is_supported_cmd);
@@ -151,6 +312,11 @@ void stm32_bootloader_host_protocol_byte_handle(stm32_bootloader_context_t *cont
         return;
     }
 
+    if (STM32_BOOTLOADER_STATE_STREAM == context->state) {
+        _stream_byte_handle(context);
+        return;
+    }
+
     switch (context->command) {
         case STM32_BOOTLOADER_CMD_READ_MEMORY:
             if (context->received == 5) {
@@ -229,9 +395,35 @@ void stm32_bootloader_host_protocol_byte_handle(stm32_bootloader_context_t *cont
                 _reset_rx_context(context);
             }
             break;
+
+        case STM32_BOOTLOADER_CMD_EXT_SET_BAUD:
+            if (context->received == 5) {
+                uint32_t baud = _array_to_u32(context->buffer);
+                if ((_is_data_checksum_valid(context->buffer, 5) == true) && context->io->is_baud_valid(baud)) {
+                    /* ACK goes out with the current baud rate, the host switches after it */
+                    _send_ack_nack(context, true);
+                    context->io->set_baud(baud);
+                } else {
+                    _send_ack_nack(context, false);
+                }
+                _reset_rx_context(context);
+            }
+            break;
         default:
             break;
     }
 }
 
 /* -------------------------------------------------------------------------- */
+
+void stm32_bootloader_host_protocol_poll(stm32_bootloader_context_t *context) {
+    if ((context->state != STM32_BOOTLOADER_STATE_STREAM) || (context->io->get_ticks == NULL)) {
+        return;
+    }
+
+    if ((context->io->get_ticks() - context->stream.rx_ts) >= STM32_BOOTLOADER_EXT_STREAM_TIMEOUT_MS) {
+        _reset_rx_context(context);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
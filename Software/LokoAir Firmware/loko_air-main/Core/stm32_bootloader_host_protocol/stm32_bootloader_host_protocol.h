@@ -43,6 +43,14 @@ typedef enum {
     /* Computes a CRC value on a given memory area with a size multiple of 4 bytes. */
     STM32_BOOTLOADER_CMD_READOUT_GET_CHECKSUM = 0xA1,
 
+    /* Loko extension. Gets the extended protocol version, the maximum block size and the block window */
+    STM32_BOOTLOADER_CMD_EXT_GET = 0xB0,
+    /* Loko extension. Switches the serial line to the requested baud rate after the ACK */
+    STM32_BOOTLOADER_CMD_EXT_SET_BAUD = 0xB1,
+    /* Loko extension. Starts a stream of CRC16 protected blocks with a sliding window of unacknowledged blocks, every
+     * flash page is erased before the first write into it */
+    STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM = 0xB2,
+
     STM32_BOOTLOADER_ACK = 0x79,
     STM32_BOOTLOADER_NACK = 0x1F,
 
@@ -56,13 +64,32 @@ typedef enum {
 typedef enum {
     STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND,
     STM32_BOOTLOADER_STATE_COMMAND_PROCCESS,
+    STM32_BOOTLOADER_STATE_STREAM,
 } stm32_bootloader_state_t;
 
+/* Stream block: [sync][seq][addr 4][size 2][data][crc16 2], big endian, CRC16/CCITT over seq..data. The device answers
+ * [ACK][seq] for a written block and [NACK][expected seq] once per bad copy of the expected block, the host goes back
+ * to it. An empty block ends the stream, a stream idle for STM32_BOOTLOADER_EXT_STREAM_TIMEOUT_MS is dropped */
+#define STM32_BOOTLOADER_EXT_VERSION           (0x01U)
+#define STM32_BOOTLOADER_EXT_SYNC              (0x5AU)
+#define STM32_BOOTLOADER_EXT_HEADER_SIZE       (8U)
+#define STM32_BOOTLOADER_EXT_CRC_SIZE          (2U)
+#define STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX    (2048U)
+#define STM32_BOOTLOADER_EXT_WINDOW            (4U)
+#define STM32_BOOTLOADER_EXT_PAGE_MAP_SIZE     (32U) /* Erase map of the stream, 256 pages from the first written one */
+#define STM32_BOOTLOADER_EXT_STREAM_TIMEOUT_MS (5000U)
+#define STM32_BOOTLOADER_EXT_FRAME_SIZE_MAX \
+    (STM32_BOOTLOADER_EXT_HEADER_SIZE + STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX + STM32_BOOTLOADER_EXT_CRC_SIZE)
+
 typedef void (*stm32_bootloader_serial_out_t)(uint8_t const *byte, size_t size);
 typedef void (*stm32_bootloader_read_mem_t)(size_t addr, uint8_t *byte, size_t size);
 typedef void (*stm32_bootloader_write_mem_t)(size_t addr, uint8_t const *byte, size_t size);
 typedef void (*stm32_bootloader_erase_page_t)(size_t page_number);
 typedef void (*stm32_bootloader_goto_t)(size_t addr);
+typedef bool (*stm32_bootloader_is_baud_valid_t)(uint32_t baud);
+typedef void (*stm32_bootloader_set_baud_t)(uint32_t baud);
+typedef void (*stm32_bootloader_erase_page_at_t)(size_t addr);
+typedef uint32_t (*stm32_bootloader_get_ticks_t)(void);
 
 typedef struct {
     stm32_bootloader_serial_out_t serial_out;
@@ -70,13 +97,32 @@ typedef struct {
     stm32_bootloader_write_mem_t write_mem;
     stm32_bootloader_erase_page_t erase_page;
     stm32_bootloader_goto_t goto_addr;
+
+    /* Optional, the extended commands are NACKed without them */
+    stm32_bootloader_is_baud_valid_t is_baud_valid;
+    stm32_bootloader_set_baud_t set_baud;
+    stm32_bootloader_erase_page_at_t erase_page_at;
+    size_t page_size;
+
+    /* Optional, milliseconds for the stream timeout of stm32_bootloader_host_protocol_poll() */
+    stm32_bootloader_get_ticks_t get_ticks;
 } stm32_bootloader_io_t;
+
+typedef struct {
+    uint8_t expected_seq;
+    bool is_nack_sent;
+    uint32_t rx_ts; /* Last byte of the stream */
+    size_t page_base;
+    uint8_t erased_pages[STM32_BOOTLOADER_EXT_PAGE_MAP_SIZE];
+} stm32_bootloader_stream_t;
+
 typedef struct {
     uint8_t command;
     stm32_bootloader_state_t state;
     size_t received;
     stm32_bootloader_io_t const *io;
-    uint8_t buffer[256 + 32];
+    stm32_bootloader_stream_t stream;
+    uint8_t buffer[STM32_BOOTLOADER_EXT_FRAME_SIZE_MAX];
 } stm32_bootloader_context_t;
 
 stm32_bootloader_result_t stm32_bootloader_host_protocol_init(stm32_bootloader_context_t *context,
@@ -84,6 +130,9 @@ stm32_bootloader_result_t stm32_bootloader_host_protocol_init(stm32_bootloader_c
 
 void stm32_bootloader_host_protocol_byte_handle(stm32_bootloader_context_t *context, uint8_t byte);
 
+/* Goes back to the commands when the stream is idle too long, called periodically */
+void stm32_bootloader_host_protocol_poll(stm32_bootloader_context_t *context);
+
 #ifdef __cplusplus
 }
 #endif
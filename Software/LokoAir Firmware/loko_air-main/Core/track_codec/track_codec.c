@@ -0,0 +1,234 @@
+#include "track_codec.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+
+#define COORD_SCALE      (1000000.0)
+#define VARINT_MAX_SIZE  (5U)
+#define DELTA_FIELDS     (4U)
+#define DELTA_MAX_SIZE   (VARINT_MAX_SIZE * DELTA_FIELDS)
+#define HEADER_COUNT_MSK (0x0FU)
+
+/* Scaled fix, the deltas are taken between these so the decoder sums them up without a drift */
+typedef struct {
+    int32_t time_s;
+    int32_t lat;
+    int32_t lon;
+    int32_t alt;
+} scaled_fix_t;
+
+/* -------------------------------------------------------------------------- */
+
+static scaled_fix_t _scale(track_fix_t const *fix) {
+    scaled_fix_t scaled = {
+        .time_s = (int32_t)fix->time_s,
+        .lat = (int32_t)lround(fix->lat * COORD_SCALE),
+        .lon = (int32_t)lround(fix->lon * COORD_SCALE),
+        .alt = (int32_t)fix->alt,
+    };
+    return scaled;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void _put_u32_be(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static uint32_t _get_u32_be(uint8_t const *data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+/* -------------------------------------------------------------------------- */
+
+static size_t _put_varint(uint8_t *out, int32_t value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(-(int32_t)((uint32_t)value >> 31));
+    size_t size = 0;
+
+    while (zigzag >= 0x80U) {
+        out[size++] = (uint8_t)(zigzag | 0x80U);
+        zigzag >>= 7;
+    }
+    out[size++] = (uint8_t)zigzag;
+
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool _get_varint(uint8_t const *data, size_t size, size_t *index, int32_t *value) {
+    uint32_t zigzag = 0;
+
+    for (size_t shift = 0; shift < (VARINT_MAX_SIZE * 7U); shift += 7U) {
+        if (*index >= size) {
+            return false;
+        }
+
+        uint8_t byte = data[(*index)++];
+        zigzag |= (uint32_t)(byte & 0x7FU) << shift;
+
+        if ((byte & 0x80U) == 0) {
+            *value = (int32_t)((zigzag >> 1) ^ (uint32_t)(-(int32_t)(zigzag & 1U)));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t track_codec_encode(uint8_t *out,
+                          size_t max_size,
+                          track_status_t const *status,
+                          track_fix_t const *fixes,
+                          size_t fix_count,
+                          size_t *encoded_fix_count) {
+    *encoded_fix_count = 0;
+
+    if ((fix_count == 0) || (max_size < TRACK_CODEC_BASE_SIZE)) {
+        return 0;
+    }
+
+    scaled_fix_t newer = _scale(&fixes[0]);
+
+    out[1] = (uint8_t)((status->vbat << 4) | (status->quality & 0x0FU));
+    _put_u32_be(&out[2], (uint32_t)newer.time_s);
+    _put_u32_be(&out[6], (uint32_t)newer.lat);
+    _put_u32_be(&out[10], (uint32_t)newer.lon);
+    out[14] = (uint8_t)(fixes[0].alt >> 8);
+    out[15] = (uint8_t)fixes[0].alt;
+    out[16] = fixes[0].speed_mps;
+
+    size_t size = TRACK_CODEC_BASE_SIZE;
+    size_t count = 1;
+
+    while ((count < fix_count) && (count < TRACK_CODEC_MAX_FIXES)) {
+        const scaled_fix_t OLDER = _scale(&fixes[count]);
+        uint8_t delta[DELTA_MAX_SIZE];
+        size_t delta_size = 0;
+
+        delta_size += _put_varint(&delta[delta_size], (int32_t)((uint32_t)newer.time_s - (uint32_t)OLDER.time_s));
+        delta_size += _put_varint(&delta[delta_size], (int32_t)((uint32_t)newer.lat - (uint32_t)OLDER.lat));
+        delta_size += _put_varint(&delta[delta_size], (int32_t)((uint32_t)newer.lon - (uint32_t)OLDER.lon));
+        delta_size += _put_varint(&delta[delta_size], newer.alt - OLDER.alt);
+
+        if ((size + delta_size) > max_size) {
+            break;
+        }
+
+        memcpy(&out[size], delta, delta_size);
+        size += delta_size;
+        newer = OLDER;
+        count++;
+    }
+
+    out[0] = (uint8_t)((TRACK_CODEC_VERSION << 4) | (count - 1U));
+    *encoded_fix_count = count;
+
+    return size;
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t track_codec_decode(uint8_t const *data,
+                          size_t size,
+                          track_status_t *status,
+                          track_fix_t *fixes,
+                          size_t max_fix_count) {
+    if ((size < TRACK_CODEC_BASE_SIZE) || ((data[0] >> 4) != TRACK_CODEC_VERSION) || (max_fix_count == 0)) {
+        return 0;
+    }
+
+    const size_t FIX_COUNT = (size_t)(data[0] & HEADER_COUNT_MSK) + 1U;
+
+    if (FIX_COUNT > max_fix_count) {
+        return 0;
+    }
+
+    status->vbat = data[1] >> 4;
+    status->quality = data[1] & 0x0FU;
+
+    scaled_fix_t newer = {
+        .time_s = (int32_t)_get_u32_be(&data[2]),
+        .lat = (int32_t)_get_u32_be(&data[6]),
+        .lon = (int32_t)_get_u32_be(&data[10]),
+        .alt = (int32_t)(((uint32_t)data[14] << 8) | data[15]),
+    };
+
+    fixes[0].time_s = (uint32_t)newer.time_s;
+    fixes[0].lat = newer.lat / COORD_SCALE;
+    fixes[0].lon = newer.lon / COORD_SCALE;
+    fixes[0].alt = (uint16_t)newer.alt;
+    fixes[0].speed_mps = data[16];
+
+    size_t index = TRACK_CODEC_BASE_SIZE;
+
+    for (size_t i = 1; i < FIX_COUNT; i++) {
+        int32_t delta[DELTA_FIELDS];
+
+        for (size_t field = 0; field < DELTA_FIELDS; field++) {
+            if (!_get_varint(data, size, &index, &delta[field])) {
+                return 0;
+            }
+        }
+
+        newer.time_s = (int32_t)((uint32_t)newer.time_s - (uint32_t)delta[0]);
+        newer.lat = (int32_t)((uint32_t)newer.lat - (uint32_t)delta[1]);
+        newer.lon = (int32_t)((uint32_t)newer.lon - (uint32_t)delta[2]);
+        newer.alt -= delta[3];
+
+        fixes[i].time_s = (uint32_t)newer.time_s;
+        fixes[i].lat = newer.lat / COORD_SCALE;
+        fixes[i].lon = newer.lon / COORD_SCALE;
+        fixes[i].alt = (uint16_t)newer.alt;
+        fixes[i].speed_mps = 0;
+    }
+
+    return (index == size) ? FIX_COUNT : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint8_t track_codec_get_quality(uint8_t fix_mode, float hdop) {
+    uint8_t hdop_class = 3U;
+
+    if (hdop < 1.0f) {
+        hdop_class = 0;
+    } else if (hdop < 2.0f) {
+        hdop_class = 1U;
+    } else if (hdop < 5.0f) {
+        hdop_class = 2U;
+    }
+
+    return (uint8_t)((fix_mode & TRACK_CODEC_QUALITY_FIX_MASK) | (hdop_class << TRACK_CODEC_QUALITY_HDOP_POS));
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Year is counted from 2000, like in the NMEA date */
+uint32_t track_codec_get_time_s(uint32_t year, uint32_t month, uint32_t date, uint32_t hours, uint32_t minutes,
+                                uint32_t seconds) {
+    static const uint16_t DAYS_BEFORE_MONTH[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+    if ((year == 0) || (month < 1) || (month > 12) || (date < 1)) {
+        return 0;
+    }
+
+    uint32_t days = year * 365U + (year + 3U) / 4U + DAYS_BEFORE_MONTH[month - 1] + (date - 1U);
+
+    if (((year % 4U) == 0) && (month > 2)) {
+        days++;
+    }
+
+    return ((days * 24U + hours) * 60U + minutes) * 60U + seconds;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compact LoRaWAN uplink with several fixes, the newest one in full and the older ones as deltas to the newer
+ * neighbour. Reference decoder for the network server is tools/lorawan-track-decoder.js
+ *
+ *  [0]      version (4 bits) | fix count - 1 (4 bits)
+ *  [1]      vbat (4 bits, (n + 27) * 0.1 V) | quality of the newest fix (4 bits)
+ *  [2..5]   time of the newest fix, seconds since 2000-01-01, 0 when unknown
+ *  [6..9]   latitude, 1e-6 degree
+ *  [10..13] longitude, 1e-6 degree
+ *  [14..15] altitude, meters
+ *  [16]     speed, m/s
+ *  then for every older fix the differences to the newer one as zigzag varints:
+ *           time (newer - older, s), latitude, longitude (1e-6 degree), altitude (m)
+ *
+ * Multibyte fields of the newest fix are big endian, like in the P2P packets */
+
+#define TRACK_CODEC_VERSION   (1U)
+#define TRACK_CODEC_MAX_FIXES (16U)
+#define TRACK_CODEC_BASE_SIZE (17U) /*<! Header and the newest fix */
+
+#define TRACK_CODEC_QUALITY_FIX_MASK  (0x03U) /*<! lwgps fix mode, 0 when the fix is not of this wakeup */
+#define TRACK_CODEC_QUALITY_HDOP_MASK (0x0CU) /*<! HDOP below 1, 2, 5 or higher */
+#define TRACK_CODEC_QUALITY_HDOP_POS  (2U)
+
+typedef struct {
+    double lat;
+    double lon;
+    uint32_t time_s; /*<! Seconds since 2000-01-01, 0 when unknown */
+    uint16_t alt;
+    uint8_t speed_mps; /*<! Sent for the newest fix only */
+} track_fix_t;
+
+typedef struct {
+    uint8_t vbat;    /*<! (n + 27) * 0.1 V */
+    uint8_t quality; /*<! TRACK_CODEC_QUALITY_* bits of the newest fix */
+} track_status_t;
+
+/* Fixes are ordered from the newest one. Returns the payload size, 0 when even the newest fix does not fit */
+size_t track_codec_encode(uint8_t *out,
+                          size_t max_size,
+                          track_status_t const *status,
+                          track_fix_t const *fixes,
+                          size_t fix_count,
+                          size_t *encoded_fix_count);
+
+/* Returns the number of the decoded fixes, 0 for a malformed payload */
+size_t track_codec_decode(uint8_t const *data,
+                          size_t size,
+                          track_status_t *status,
+                          track_fix_t *fixes,
+                          size_t max_fix_count);
+
+uint8_t track_codec_get_quality(uint8_t fix_mode, float hdop);
+uint32_t track_codec_get_time_s(uint32_t year, uint32_t month, uint32_t date, uint32_t hours, uint32_t minutes,
+                                uint32_t seconds);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -64,6 +64,9 @@
 
 #include "lorawan_aes.h"
 
+/* block cipher backend, NULL selects the software implementation */
+static lorawan_aes_backend_t aes_backend = NULL;
+
 //#if defined( HAVE_UINT_32T )
 //  typedef unsigned long uint32_t;
 //#endif
@@ -510,7 +513,7 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 
 /*  Set the cipher key for the pre-keyed version */
 
-return_type lorawan_aes_set_key( const uint8_t key[], length_type keylen, lorawan_aes_context ctx[1] )
+static return_type soft_set_key( const uint8_t key[], length_type keylen, lorawan_aes_context ctx[1] )
 {
     uint8_t cc, rc, hi;
 
@@ -565,7 +568,7 @@ return_type lorawan_aes_set_key( const uint8_t key[], length_type keylen, lorawa
 
 /*  Encrypt a single block of 16 bytes */
 
-return_type lorawan_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const lorawan_aes_context ctx[1] )
+static return_type soft_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const lorawan_aes_context ctx[1] )
 {
     if( ctx->rnd )
     {
@@ -592,6 +595,41 @@ return_type lorawan_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK
     return 0;
 }
 
+/*  With the backend set only the raw key is kept in the context, the
+    key schedule is done by the backend for every block. A raw key
+    context is marked by the key length in place of the round count
+*/
+
+return_type lorawan_aes_set_key( const uint8_t key[], length_type keylen, lorawan_aes_context ctx[1] )
+{
+    if( aes_backend != NULL && ( keylen == 16 || keylen == 32 ) )
+    {
+        block_copy_nn(ctx->ksch, key, keylen);
+        ctx->rnd = keylen;
+        return 0;
+    }
+    return soft_set_key( key, keylen, ctx );
+}
+
+/*  Raw key contexts fall back to the software implementation when the
+    backend fails or has been removed after the key was set
+*/
+
+return_type lorawan_aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const lorawan_aes_context ctx[1] )
+{
+    if( ctx->rnd > N_MAX_ROUNDS )
+    {
+        lorawan_aes_context soft_ctx[1];
+
+        if( aes_backend != NULL && aes_backend( ctx->ksch, ctx->rnd, in, out ) )
+            return 0;
+        if( soft_set_key( ctx->ksch, ctx->rnd, soft_ctx ) != 0 )
+            return ( uint8_t )-1;
+        return soft_encrypt( in, out, soft_ctx );
+    }
+    return soft_encrypt( in, out, ctx );
+}
+
 /* CBC encrypt a number of blocks (input and return an IV) */
 
 return_type lorawan_aes_cbc_encrypt( const uint8_t *in, uint8_t *out,
@@ -820,6 +858,8 @@ void lorawan_aes_encrypt_256( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK],
         block_copy( o_key, key );
         block_copy( o_key + 16, key + 16 );
     }
+    if( aes_backend != NULL && aes_backend( o_key, 2 * N_BLOCK, in, out ) )
+        return;
     copy_and_key( s1, in, o_key );
 
     for( r = 1 ; r < 14 ; ++r )
@@ -934,3 +974,8 @@ void lorawan_aes_decrypt_256( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK],
 }
 
 #endif
+
+void lorawan_aes_set_backend( lorawan_aes_backend_t backend )
+{
+    aes_backend = backend;
+}
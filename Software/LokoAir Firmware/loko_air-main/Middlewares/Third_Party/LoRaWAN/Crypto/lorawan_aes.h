@@ -35,6 +35,8 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #if 1
@@ -74,6 +76,23 @@ typedef struct
     uint8_t rnd;
 } lorawan_aes_context;
 
+/*  Block cipher backend, e.g. the AES peripheral of the MCU, which
+    encrypts one block with a raw 128 or 256 bit key and returns false
+    on failure. While it is set, lorawan_aes_set_key() keeps the raw
+    key in the context and the blocks are encrypted by the backend,
+    192 bit keys and backend failures are handled in software. With
+    the backend lorawan_aes_encrypt_256() returns the original key in
+    o_key[] instead of the decryption key.
+    NULL selects the software implementation (the default).
+*/
+
+typedef bool ( *lorawan_aes_backend_t )( const uint8_t *key,
+                                         size_t key_size,
+                                         const uint8_t in[N_BLOCK],
+                                         uint8_t out[N_BLOCK] );
+
+void lorawan_aes_set_backend( lorawan_aes_backend_t backend );
+
 /*  The following calls are for a precomputed key schedule
 
     NOTE: If the length_type used for the key length is an
@@ -30,10 +30,23 @@
   * @brief   Fragmentation Decoder definition
   ******************************************************************************
   */
+#include <string.h>
 #include "utilities.h"
 #include "FragDecoder.h"
 #include "frag_decoder_if.h"
 
+/*!
+ * Bit arrays are MSB first, a 32-bit word loaded from them is byte swapped on little endian cores so that CLZ gives
+ * the index of the first one
+ */
+#define BIT_ARRAY_WORD_BITS                         32U
+
+#if defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+#define BIT_ARRAY_WORD_FROM_BYTES( word )           __builtin_bswap32( word )
+#else
+#define BIT_ARRAY_WORD_FROM_BYTES( word )           ( word )
+#endif
+
 /*
  *=============================================================================
  * Fragmentation decoder algorithm utilities
@@ -131,6 +144,34 @@ static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size );
  */
 static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size );
 
+/*!
+ * \brief XORs two byte buffers a 32-bit word at a time
+ *
+ * \param [in,out]  dst   Buffer to be XORed, the result is stored in it
+ * \param [in]  src   Buffer to XOR dst with
+ * \param [in]  size  Number of bytes
+ */
+static void XorBytes( uint8_t *dst, uint8_t *src, uint32_t size );
+
+/*!
+ * \brief Gets up to 32 bits of a bit array, the bit at index is the MSB
+ *
+ * \param [in] bitArray Pointer to the bit array
+ * \param [in] index    Index of the first bit, multiple of 8
+ * \param [in] size     Bit array size, the bits past it read as zeros
+ * \retval word         Bits [index, index + 32) of the bit array
+ */
+static uint32_t BitArrayGetWord( uint8_t *bitArray, uint16_t index, uint16_t size );
+
+/*!
+ * \brief Gets the mask of the bits of a bit array byte starting from a given index
+ *
+ * \param [in] byteIndex Index of the byte in the bit array
+ * \param [in] index     Index of the first bit in the mask
+ * \retval mask          Mask of the bits [index, end of the byte)
+ */
+static uint8_t BitArrayByteMaskFrom( uint16_t byteIndex, uint32_t index );
+
 /*!
  * \brief Generates a pseudo random number : PRBS23
  *
@@ -202,6 +243,25 @@ static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowInde
  */
 static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
 
+/*!
+ * \brief Gets the bit offset of a row in the binary matrix
+ *
+ * \param [in] rowIndex  Matrix row index
+ * \param [in] bitsInRow Number of bits in one row
+ * \retval offset        Offset of the rowIndex th bit of the row, the bits before it are not stored
+ */
+static uint32_t FragGetBinaryMatrixRowOffset( uint16_t rowIndex, uint16_t bitsInRow );
+
+/*!
+ * \brief Gets a bit of the binary matrix
+ *
+ * \param [in] rowIndex  Matrix row index
+ * \param [in] colIndex  Matrix column index, not less than rowIndex
+ * \param [in] bitsInRow Number of bits in one row
+ * \retval bit           The value of the bit
+ */
+static uint8_t FragGetBinaryMatrixBit( uint16_t rowIndex, uint16_t colIndex, uint16_t bitsInRow );
+
 /*
  *=============================================================================
  * Fragmentation decoder algorithm
@@ -220,6 +280,7 @@ void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t
     FragDecoder.FragSize = fragSize;                            // number of byte on a row
     FragDecoder.Status.FragNbLastRx = 0;
     FragDecoder.Status.FragNbLost = 0;
+    FragDecoder.Status.MatrixError = 0;
     FragDecoder.M2BLine = 0;
 
     // Initialize missing fragments index array
@@ -310,10 +371,18 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
         // fragCounter - FragDecoder.FragNb
         FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, matrixRow );
 
-        for( int32_t i = 0; i < FragDecoder.FragNb; i++ )
+        // Visit the ones of the parity row only, a word at a time
+        for( int32_t base = 0; base < FragDecoder.FragNb; base += BIT_ARRAY_WORD_BITS )
         {
-            if( GetParity( i , matrixRow ) == 1 )
+            uint32_t word = BitArrayGetWord( matrixRow, base, FragDecoder.FragNb );
+
+            while( word != 0 )
             {
+                int32_t bit = __builtin_clz( word );
+                int32_t i = base + bit;
+
+                word &= ~( 0x80000000U >> bit );
+
                 if( FragDecoder.FragNbMissingIndex[i] == 0 )
                 {
                     // XOR with already receive frag
@@ -381,12 +450,9 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
                         GetRow( matrixDataTemp, li, FragDecoder.FragSize );
                         for( j = ( FragDecoder.Status.FragNbLost - 1 ); j > i; j--)
                         {
-                            FragExtractLineFromBinaryMatrix( dataTempVector2, i, FragDecoder.Status.FragNbLost );
-                            FragExtractLineFromBinaryMatrix( dataTempVector, j, FragDecoder.Status.FragNbLost );
-                            if( GetParity( j, dataTempVector2 ) == 1 )
+                            // Only the bit j of the row i decides, the matrix is not changed here
+                            if( FragGetBinaryMatrixBit( i, j, FragDecoder.Status.FragNbLost ) == 1 )
                             {
-                                XorParityLine( dataTempVector2, dataTempVector, FragDecoder.Status.FragNbLost );
-
                                 lj = FragFindMissingIndex( j );
 
                                 GetRow( rawData, lj, FragDecoder.FragSize );
@@ -467,18 +533,73 @@ static bool IsPowerOfTwo( uint32_t x )
 
 static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    XorBytes( line1, line2, size );
+}
+
+static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
+{
+    uint16_t nbBytes = size >> 3;
+
+    XorBytes( line1, line2, nbBytes );
+
+    if( ( size % 8 ) != 0 )
     {
-        line1[i] = line1[i] ^ line2[i];
+        line1[nbBytes] ^= line2[nbBytes] & ( uint8_t )~BitArrayByteMaskFrom( nbBytes, size );
     }
 }
 
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
+static void XorBytes( uint8_t *dst, uint8_t *src, uint32_t size )
+{
+    uint32_t i = 0;
+
+    for( ; ( i + sizeof( uint32_t ) ) <= size; i += sizeof( uint32_t ) )
+    {
+        uint32_t dstWord;
+        uint32_t srcWord;
+
+        memcpy( &dstWord, &dst[i], sizeof( dstWord ) );
+        memcpy( &srcWord, &src[i], sizeof( srcWord ) );
+        dstWord ^= srcWord;
+        memcpy( &dst[i], &dstWord, sizeof( dstWord ) );
+    }
+
+    for( ; i < size; i++ )
+    {
+        dst[i] ^= src[i];
+    }
+}
+
+static uint32_t BitArrayGetWord( uint8_t *bitArray, uint16_t index, uint16_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    uint32_t word = 0;
+    uint32_t bits = size - index;
+
+    if( bits >= BIT_ARRAY_WORD_BITS )
     {
-        SetParity( i, line1, ( GetParity( i, line1 ) ^ GetParity( i, line2 ) ) );
+        memcpy( &word, &bitArray[index >> 3], sizeof( word ) );
+        return BIT_ARRAY_WORD_FROM_BYTES( word );
     }
+
+    for( uint32_t i = 0; i < ( ( bits + 7 ) >> 3 ); i++ )
+    {
+        word |= ( uint32_t )bitArray[( index >> 3 ) + i] << ( 24 - ( 8 * i ) );
+    }
+    return word & ~( 0xFFFFFFFFU >> bits );
+}
+
+static uint8_t BitArrayByteMaskFrom( uint16_t byteIndex, uint32_t index )
+{
+    uint32_t byteStart = ( uint32_t )byteIndex << 3;
+
+    if( index <= byteStart )
+    {
+        return 0xFF;
+    }
+    if( index >= ( byteStart + 8 ) )
+    {
+        return 0x00;
+    }
+    return 0xFF >> ( index - byteStart );
 }
 
 static int32_t FragPrbs23( int32_t value )
@@ -529,11 +650,13 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
 
 static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
 {
-    for( uint16_t i = 0; i < size; i++)
+    for( uint16_t i = 0; i < size; i += BIT_ARRAY_WORD_BITS )
     {
-        if ( GetParity( i, bitArray ) == 1 )
+        uint32_t word = BitArrayGetWord( bitArray, i, size );
+
+        if( word != 0 )
         {
-            return i;
+            return i + __builtin_clz( word );
         }
     }
     return 0;
@@ -541,9 +664,9 @@ static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
 
 static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
 {
-    for( uint16_t i = 0; i < size; i++ )
+    for( uint16_t i = 0; i < size; i += BIT_ARRAY_WORD_BITS )
     {
-        if( GetParity( i, bitArray ) == 1 )
+        if( BitArrayGetWord( bitArray, i, size ) != 0 )
         {
             return 0;
         }
@@ -584,59 +707,58 @@ static uint16_t FragFindMissingIndex( uint16_t x )
     return 0;
 }
 
+static uint32_t FragGetBinaryMatrixRowOffset( uint16_t rowIndex, uint16_t bitsInRow )
+{
+    // Upper triangular matrix, the row r starts with its bit r
+    return ( uint32_t )rowIndex * bitsInRow - ( ( ( uint32_t )rowIndex * ( rowIndex - 1U ) ) >> 1 );
+}
+
+static uint8_t FragGetBinaryMatrixBit( uint16_t rowIndex, uint16_t colIndex, uint16_t bitsInRow )
+{
+    uint32_t offset = FragGetBinaryMatrixRowOffset( rowIndex, bitsInRow ) + ( colIndex - rowIndex );
+
+    return ( FragDecoder.MatrixM2B[offset >> 3] >> ( 7 - ( offset % 8 ) ) ) & 0x01;
+}
+
 static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
+    // The bit i of the line is the bit ( i + shift ) of the matrix
+    uint32_t shift = FragGetBinaryMatrixRowOffset( rowIndex, bitsInRow ) - rowIndex;
 
-    if( rowIndex > 0 )
+    for( uint16_t i = 0; i < ( ( bitsInRow + 7 ) >> 3 ); i++ )
     {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
-    }
-    if( rowIndex > 0 )
-    {
-        for( uint16_t i = 0; i < rowIndex; i++ )
-        {
-            SetParity( i, bitArray, 0 );
-        }
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
-    {
-        SetParity( i,
-                   bitArray,
-                   ( FragDecoder.MatrixM2B[findByte] >> ( 7 - findBitInByte ) ) & 0x01 );
+        uint32_t offset = ( ( uint32_t )i << 3 ) + shift;
+        uint8_t bits = FragDecoder.MatrixM2B[offset >> 3] << ( offset % 8 );
+        uint8_t copyMask = BitArrayByteMaskFrom( i, rowIndex ) & ( uint8_t )~BitArrayByteMaskFrom( i, bitsInRow );
+        uint8_t keepMask = BitArrayByteMaskFrom( i, bitsInRow );
 
-        findBitInByte++;
-        if( findBitInByte == 8 )
+        if( ( offset % 8 ) != 0 )
         {
-            findBitInByte = 0;
-            findByte++;
+            bits |= FragDecoder.MatrixM2B[( offset >> 3 ) + 1] >> ( 8 - ( offset % 8 ) );
         }
+
+        // Bits before rowIndex are cleared, the ones past the row are kept
+        bitArray[i] = ( bitArray[i] & keepMask ) | ( bits & copyMask );
     }
 }
 
 static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
-
-    if ( rowIndex > 0) {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
+    uint32_t shift = FragGetBinaryMatrixRowOffset( rowIndex, bitsInRow ) - rowIndex;
 
-    }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
+    // The matrix is initialized with ones, only the zeros of the line are pushed
+    for( uint16_t i = ( rowIndex >> 3 ); i < ( ( bitsInRow + 7 ) >> 3 ); i++ )
     {
-        if( GetParity( i, bitArray ) == 0 )
-        {
-            FragDecoder.MatrixM2B[findByte] = FragDecoder.MatrixM2B[findByte] & ( 0xFF - ( 1 << ( 7 - findBitInByte ) ) );
-        }
-        findBitInByte++;
-        if( findBitInByte == 8 )
+        uint8_t copyMask = BitArrayByteMaskFrom( i, rowIndex ) & ( uint8_t )~BitArrayByteMaskFrom( i, bitsInRow );
+        uint32_t zeros = ( uint8_t )( ~bitArray[i] & copyMask );
+
+        while( zeros != 0 )
         {
-            findBitInByte = 0;
-            findByte++;
+            uint32_t bit = __builtin_clz( zeros ) - 24U;
+            uint32_t offset = ( ( uint32_t )i << 3 ) + bit + shift;
+
+            zeros &= ~( 0x80U >> bit );
+            FragDecoder.MatrixM2B[offset >> 3] &= ( uint8_t )~( 0x80U >> ( offset % 8 ) );
         }
     }
 }
@@ -33,6 +33,7 @@
  */
 #include "lwgps.h"
 #include <math.h>
+#include <stats/stats.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -471,12 +472,18 @@ lwgps_process(lwgps_t *gh, const void *data, size_t len) {
             if (prv_check_crc(gh)) { /* Check for CRC result */
                 /* CRC is OK, in theory we can copy data from statements to user data */
                 prv_copy_from_tmp_memory(gh); /* Copy memory from temporary to user memory */
+                stats_inc(STATS_COUNTER_NMEA_SENTENCES);
 #if LWGPS_CFG_STATUS
                 if (evt_fn != NULL) {
                     evt_fn(gh->p.stat);
                 }
-            } else if (evt_fn != NULL) {
-                evt_fn(STAT_CHECKSUM_FAIL);
+#endif /* LWGPS_CFG_STATUS */
+            } else {
+                stats_inc(STATS_COUNTER_NMEA_CRC_ERRORS);
+#if LWGPS_CFG_STATUS
+                if (evt_fn != NULL) {
+                    evt_fn(STAT_CHECKSUM_FAIL);
+                }
 #endif /* LWGPS_CFG_STATUS */
             }
         } else {
@@ -142,6 +142,13 @@ def add_crc_to_app():
             f'python ./tools/crc_recorder/crc_recorder.py -i {app_path}')
 
 
+def make_compressed_images():
+    for target in TARGETS:
+        app_path = get_app_bin_path(target)
+        executer(
+            f'python ./tools/image_packer/image_packer.py -i {app_path}')
+
+
 def make_full_images(version_str):
     executer('mkdir release')
     executer(f'mkdir {MANUFACTURE_DIR}')
@@ -287,6 +294,9 @@ def build_firmware(link_bootloader):
     print("Add CRC to application binaries...")
     add_crc_to_app()
 
+    print("Make compressed application containers...")
+    make_compressed_images()
+
     print("Make full image binaries...")
     make_full_images(version_str)
 
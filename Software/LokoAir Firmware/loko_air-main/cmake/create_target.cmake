@@ -21,7 +21,8 @@ function(project_create_app TARGET LIBS)
     add_custom_command(TARGET ${TARGET} POST_BUILD
         COMMAND ${CMAKE_OBJCOPY} -Oihex ${EXECUTABLE_OUTPUT_PATH}/${TARGET} ${EXECUTABLE_OUTPUT_PATH}/${TARGET}.hex
         COMMAND ${CMAKE_OBJCOPY} -Obinary ${EXECUTABLE_OUTPUT_PATH}/${TARGET} ${EXECUTABLE_OUTPUT_PATH}/${TARGET}.bin
-        COMMENT "Create ${TARGET}.hex and ${TARGET}.bin"
+        COMMAND ${CMAKE_OBJCOPY} -Obinary --only-section=log_fmt ${EXECUTABLE_OUTPUT_PATH}/${TARGET} ${EXECUTABLE_OUTPUT_PATH}/${TARGET}.log_fmt.bin
+        COMMENT "Create ${TARGET}.hex, ${TARGET}.bin and the binary log id table ${TARGET}.log_fmt.bin"
     )
 
 endfunction()
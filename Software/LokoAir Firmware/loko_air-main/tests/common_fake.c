@@ -1,8 +1,15 @@
 #include <bsp.h>
 
 #include <gnss_trace.h>
+#include <lora_app.h>
 
 gtrace_t *app_get_gtrace_context(void) {
     static gtrace_t gtrace_fake = { 0 };
     return &gtrace_fake;
 }
+
+size_t fake_lorawan_rejoin_request_count = 0;
+
+void lorawan_request_rejoin(void) {
+    fake_lorawan_rejoin_request_count++;
+}
@@ -0,0 +1,146 @@
+#include "CppUTest/TestHarness.h"
+
+#include <airtime/airtime.h>
+#include <bsp.h>
+#include <rtc_backup_layout.h>
+
+static const uint32_t FREQ_EU868_G1_HZ = 868100000; /* 1% */
+static const uint32_t FREQ_EU868_G2_HZ = 868900000; /* 0.1% */
+static const uint32_t FREQ_US915_HZ = 915000000;    /* Not restricted */
+static const uint32_t TOA_SF12_MS = 1500;
+
+TEST_GROUP(airtime_test) {
+    void setup() {
+        bsp_fake_rtc_store_clear();
+        airtime_init(FREQ_EU868_G1_HZ, false);
+    }
+
+    void teardown() {
+    }
+
+    airtime_ledger_t get_ledger() {
+        airtime_ledger_t ledger;
+        airtime_get_ledger(&ledger);
+        return ledger;
+    }
+};
+
+TEST(airtime_test, init_empty_ledger) {
+    airtime_ledger_t ledger = get_ledger();
+
+    CHECK_EQUAL(10000, ledger.duty_cycle_ppm);
+    CHECK_EQUAL(36000, ledger.budget_ms);
+    CHECK_EQUAL(0, ledger.bucket_ms);
+    CHECK_EQUAL(0, ledger.total_ms);
+    CHECK_EQUAL(0, ledger.tx_count);
+    CHECK_EQUAL(0, ledger.deferred_count);
+    CHECK_EQUAL(0, airtime_get_wait_s(TOA_SF12_MS));
+}
+
+TEST(airtime_test, defer_when_budget_exceeded) {
+    for (size_t i = 0; i < 36000 / TOA_SF12_MS; i++) {
+        CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    }
+
+    CHECK_EQUAL(AIRTIME_RESULT_DEFERRED, airtime_consume(TOA_SF12_MS));
+
+    airtime_ledger_t ledger = get_ledger();
+    CHECK_EQUAL(36000, ledger.bucket_ms);
+    CHECK_EQUAL(36000, ledger.total_ms);
+    CHECK_EQUAL(24, ledger.tx_count);
+    CHECK_EQUAL(1, ledger.deferred_count);
+
+    /* 1500ms of airtime at 1% leaks in 150 seconds */
+    CHECK_EQUAL(150, airtime_get_wait_s(TOA_SF12_MS));
+
+    bsp_fake_forward_ticks_ms(149 * 1000);
+    CHECK_EQUAL(AIRTIME_RESULT_DEFERRED, airtime_consume(TOA_SF12_MS));
+    CHECK_EQUAL(1, airtime_get_wait_s(TOA_SF12_MS));
+
+    bsp_fake_forward_ticks_ms(1000);
+    CHECK_EQUAL(0, airtime_get_wait_s(TOA_SF12_MS));
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    CHECK_EQUAL(2, get_ledger().deferred_count);
+}
+
+TEST(airtime_test, leak_accumulates_short_intervals) {
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+
+    /* 1ms of airtime per 100ms, partial leak is not lost */
+    for (size_t i = 0; i < 1000; i++) {
+        bsp_fake_forward_ticks_ms(15);
+        get_ledger();
+    }
+
+    CHECK_EQUAL(TOA_SF12_MS - 150, get_ledger().bucket_ms);
+}
+
+TEST(airtime_test, ledger_survives_shutdown) {
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    airtime_prepare_to_shutdown(60);
+
+    /* Wakeup by button, sleep time is unknown */
+    airtime_init(FREQ_EU868_G1_HZ, false);
+    CHECK_EQUAL(2 * TOA_SF12_MS, get_ledger().bucket_ms);
+    CHECK_EQUAL(2, get_ledger().tx_count);
+    airtime_prepare_to_shutdown(60);
+
+    /* Wakeup by timer, 60s at 1% = 600ms */
+    airtime_init(FREQ_EU868_G1_HZ, true);
+    CHECK_EQUAL(2 * TOA_SF12_MS - 600, get_ledger().bucket_ms);
+
+    /* Sleep time is consumed once */
+    airtime_init(FREQ_EU868_G1_HZ, true);
+    CHECK_EQUAL(2 * TOA_SF12_MS - 600, get_ledger().bucket_ms);
+    CHECK_EQUAL(2 * TOA_SF12_MS, get_ledger().total_ms);
+}
+
+TEST(airtime_test, backup_domain_lost) {
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_AIRTIME_SIGNATURE, 0);
+    airtime_init(FREQ_EU868_G1_HZ, true);
+
+    CHECK_EQUAL(0, get_ledger().bucket_ms);
+    CHECK_EQUAL(0, get_ledger().tx_count);
+}
+
+TEST(airtime_test, band_change) {
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+
+    airtime_init(FREQ_EU868_G2_HZ, false);
+    airtime_ledger_t ledger = get_ledger();
+    CHECK_EQUAL(1000, ledger.duty_cycle_ppm);
+    CHECK_EQUAL(3600, ledger.budget_ms);
+    CHECK_EQUAL(0, ledger.bucket_ms);
+    CHECK_EQUAL(TOA_SF12_MS, ledger.total_ms);
+
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    CHECK_EQUAL(AIRTIME_RESULT_DEFERRED, airtime_consume(TOA_SF12_MS));
+
+    /* (3 * 1500 - 3600)ms at 0.1% */
+    CHECK_EQUAL(900, airtime_get_wait_s(TOA_SF12_MS));
+}
+
+TEST(airtime_test, unrestricted_band) {
+    airtime_init(FREQ_US915_HZ, false);
+
+    for (size_t i = 0; i < 1000; i++) {
+        CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    }
+
+    CHECK_EQUAL(AIRTIME_DUTY_CYCLE_PPM_FULL, get_ledger().duty_cycle_ppm);
+    CHECK_EQUAL(0, get_ledger().deferred_count);
+}
+
+TEST(airtime_test, reset) {
+    CHECK_EQUAL(AIRTIME_RESULT_OK, airtime_consume(TOA_SF12_MS));
+    airtime_reset();
+
+    airtime_ledger_t ledger = get_ledger();
+    CHECK_EQUAL(0, ledger.bucket_ms);
+    CHECK_EQUAL(0, ledger.total_ms);
+    CHECK_EQUAL(0, ledger.tx_count);
+}
@@ -0,0 +1,141 @@
+#include "CppUTest/TestHarness.h"
+
+#include <blackbox/blackbox.h>
+#include <bsp.h>
+#include <string.h>
+
+static size_t _get_slot_count(void) {
+    return bsp_flash_get_blackbox_page_count() * bsp_flash_get_blackbox_page_size() / sizeof(blackbox_record_t);
+}
+
+/* Short cycle without a fix, the sleep period tells the cycles apart */
+static void _run_cycle(uint32_t sleep_s) {
+    blackbox_begin(4);
+    bsp_fake_forward_ticks_ms(1000);
+    blackbox_commit(3900, sleep_s);
+}
+
+TEST_GROUP(blackbox_test) {
+    void setup() {
+        blackbox_erase();
+        blackbox_init();
+    }
+};
+
+TEST(blackbox_test, empty) {
+    blackbox_record_t record;
+
+    CHECK_EQUAL(0, blackbox_get_record_count());
+    CHECK_EQUAL(BLACKBOX_RESULT_ERROR, blackbox_get_record(0, &record));
+}
+
+TEST(blackbox_test, cycle_is_recorded) {
+    blackbox_begin(4);
+    bsp_fake_forward_ticks_ms(2000);
+    blackbox_set_state(2);
+    bsp_fake_forward_ticks_ms(35000);
+    blackbox_set_fix(800000000UL);
+    blackbox_set_state(3);
+    bsp_fake_forward_ticks_ms(1400);
+    blackbox_set_fix(800000001UL);
+    blackbox_set_tx_result(BLACKBOX_TX_OK);
+    blackbox_set_flags(BLACKBOX_FLAG_GTRACE_SAVE);
+    blackbox_set_state(5);
+    blackbox_commit(3950, 600);
+
+    /* Nothing is kept in RAM over the shutdown */
+    blackbox_init();
+    CHECK_EQUAL(1, blackbox_get_record_count());
+
+    blackbox_record_t record;
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(0, &record));
+    CHECK_EQUAL(0, record.sequence);
+    CHECK_EQUAL(4, record.start_reason);
+    CHECK_EQUAL(370, record.ttff_100ms);
+    CHECK_EQUAL(800000001UL, record.fix_time_s);
+    CHECK_EQUAL(BLACKBOX_TX_OK, record.tx_result);
+    CHECK_EQUAL(BLACKBOX_FLAG_GTRACE_SAVE, record.flags);
+    CHECK_EQUAL(3950, record.vbat_mv);
+    CHECK_EQUAL(600, record.sleep_s);
+    CHECK_EQUAL(2, record.state_time_s[0]);
+    CHECK_EQUAL(35, record.state_time_s[2]);
+    CHECK_EQUAL(1, record.state_time_s[3]);
+    CHECK_EQUAL(0, record.state_time_s[5]);
+}
+
+TEST(blackbox_test, single_record_per_cycle) {
+    blackbox_begin(0);
+    blackbox_commit(3900, 60);
+    blackbox_commit(3800, 120);
+    blackbox_set_state(1);
+
+    CHECK_EQUAL(1, blackbox_get_record_count());
+
+    blackbox_record_t record;
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(0, &record));
+    CHECK_EQUAL(3900, record.vbat_mv);
+    CHECK_EQUAL(BLACKBOX_NO_FIX, record.ttff_100ms);
+    CHECK_EQUAL(BLACKBOX_TX_NONE, record.tx_result);
+}
+
+TEST(blackbox_test, saturation) {
+    blackbox_begin(0);
+    blackbox_set_state(6);
+    bsp_fake_forward_ticks_ms(70000UL * 1000UL);
+    blackbox_commit(3900, 86400);
+
+    blackbox_record_t record;
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(0, &record));
+    CHECK_EQUAL(0xFFFF, record.state_time_s[6]);
+    CHECK_EQUAL(0xFFFF, record.sleep_s);
+}
+
+TEST(blackbox_test, oldest_page_is_reused) {
+    const size_t SLOT_COUNT = _get_slot_count();
+    const size_t PER_PAGE = bsp_flash_get_blackbox_page_size() / sizeof(blackbox_record_t);
+
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+        _run_cycle(i);
+    }
+    CHECK_EQUAL(SLOT_COUNT, blackbox_get_record_count());
+
+    /* The ring is full, the first page goes away with the next record */
+    for (uint32_t i = 0; i < 5U; i++) {
+        _run_cycle((uint32_t)SLOT_COUNT + i);
+    }
+    blackbox_init();
+    CHECK_EQUAL(SLOT_COUNT - PER_PAGE + 5U, blackbox_get_record_count());
+
+    blackbox_record_t record;
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(0, &record));
+    CHECK_EQUAL(PER_PAGE, record.sequence);
+    CHECK_EQUAL(PER_PAGE, record.sleep_s);
+
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(blackbox_get_record_count() - 1U, &record));
+    CHECK_EQUAL(SLOT_COUNT + 4U, record.sequence);
+    CHECK_EQUAL(SLOT_COUNT + 4U, record.sleep_s);
+}
+
+TEST(blackbox_test, torn_record_page_is_erased) {
+    const size_t PER_PAGE = bsp_flash_get_blackbox_page_size() / sizeof(blackbox_record_t);
+
+    for (uint32_t i = 0; i < (PER_PAGE + 2U); i++) {
+        _run_cycle(i);
+    }
+
+    /* Power loss in the middle of the next record of the second page */
+    const uint8_t TORN[8] = { 0x12, 0x34, 0x56, 0x78, 0x00, 0x00, 0x00, 0x00 };
+    bsp_flash_blackbox_write(bsp_flash_get_blackbox_page_size() + 2U * sizeof(blackbox_record_t), TORN, sizeof(TORN));
+
+    blackbox_init();
+    CHECK_EQUAL(PER_PAGE, blackbox_get_record_count());
+
+    /* Sequence goes on from the records left */
+    _run_cycle(1000);
+    CHECK_EQUAL(PER_PAGE + 1U, blackbox_get_record_count());
+
+    blackbox_record_t record;
+    CHECK_EQUAL(BLACKBOX_RESULT_OK, blackbox_get_record(PER_PAGE, &record));
+    CHECK_EQUAL(PER_PAGE, record.sequence);
+    CHECK_EQUAL(1000, record.sleep_s);
+}
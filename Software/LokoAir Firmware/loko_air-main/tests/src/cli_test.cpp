@@ -1,14 +1,20 @@
 #include "CppUTest/TestHarness.h"
 
 #include "cmd_line.h"
+#include <airtime/airtime.h>
+#include <blackbox/blackbox.h>
 #include <bsp.h>
 #include <gnss_trace.h>
 #include <lorawan_app/lorawan_conf.h>
+#include <lorawan_backoff/lorawan_backoff.h>
+#include <profile/profile.h>
 #include <settings.h>
 #include <spy/settings_io.hpp>
+#include <stats/stats.h>
 
 extern "C" {
 extern gtrace_t *app_get_gtrace_context(void);
+extern size_t fake_lorawan_rejoin_request_count;
 }
 
 TEST_GROUP(cli_test) {
@@ -485,9 +491,16 @@ TEST(cli_test, command_enable_p2p_encryption) {
     STRCMP_EQUAL("ERR Wrong argument" CONSOLE_EOL, rx_buffer);
     CHECK_EQUAL(1, settings_get_is_p2p_encrypted());
 
+    CHECK_EQUAL(SETTINGS_P2P_ENCRYPTION_ECB, settings_get_p2p_encryption());
+
     cli_send("p2p encryption 2\r");
-    STRCMP_EQUAL("ERR Wrong argument" CONSOLE_EOL, rx_buffer);
+    STRCMP_EQUAL("OK" CONSOLE_EOL, &rx_buffer[buffer_size - 4]);
     CHECK_EQUAL(1, settings_get_is_p2p_encrypted());
+    CHECK_EQUAL(SETTINGS_P2P_ENCRYPTION_CTR_MAC, settings_get_p2p_encryption());
+
+    cli_send("p2p encryption 3\r");
+    STRCMP_EQUAL("ERR Wrong argument" CONSOLE_EOL, rx_buffer);
+    CHECK_EQUAL(SETTINGS_P2P_ENCRYPTION_CTR_MAC, settings_get_p2p_encryption());
 }
 
 TEST(cli_test, command_erase) {
@@ -495,6 +508,28 @@ TEST(cli_test, command_erase) {
     STRCMP_EQUAL("OK" CONSOLE_EOL, &rx_buffer[buffer_size - 4]);
 }
 
+TEST(cli_test, command_lorawan_rejoin) {
+    size_t count = fake_lorawan_rejoin_request_count;
+
+    cli_send("lorawan rejoin\r");
+    STRCMP_EQUAL("OK" CONSOLE_EOL, rx_buffer);
+    CHECK_EQUAL(count + 1U, fake_lorawan_rejoin_request_count);
+}
+
+TEST(cli_test, command_lorawan_backoff) {
+    bsp_fake_rtc_store_clear();
+    lorawan_backoff_init(false);
+    lorawan_backoff_on_failure(0);
+
+    cli_send("lorawan backoff\r");
+    STRCMP_EQUAL("Failed attempts 1, next attempt in 675 s" CONSOLE_EOL "OK" CONSOLE_EOL, rx_buffer);
+
+    /* Rejoin requested by the user is attempted at the next wakeup */
+    cli_send("lorawan rejoin\r");
+    cli_send("lorawan backoff\r");
+    STRCMP_EQUAL("Failed attempts 0, next attempt in 0 s" CONSOLE_EOL "OK" CONSOLE_EOL, rx_buffer);
+}
+
 TEST(cli_test, command_goto_bootloader) {
 
     cli_send("\x7F\x7f");
@@ -687,3 +722,78 @@ TEST(cli_test, command_set_region) {
     cli_send("set region test\r");
     STRCMP_EQUAL("ERR Wrong argument" CONSOLE_EOL, rx_buffer);
 }
+
+TEST(cli_test, command_airtime) {
+    bsp_fake_rtc_store_clear();
+    airtime_init(868100000, false);
+    airtime_consume(1500);
+
+    cli_send("airtime\r");
+    STRCMP_EQUAL("Band 3, duty cycle 10000 ppm, window 3600 s" CONSOLE_EOL "Used 1500 of 36000 ms" CONSOLE_EOL
+                 "Total 1500 ms, TX 1, deferred 0" CONSOLE_EOL "OK" CONSOLE_EOL,
+                 rx_buffer);
+
+    cli_send("airtime reset\r");
+    STRCMP_EQUAL("OK" CONSOLE_EOL, rx_buffer);
+
+    cli_send("airtime\r");
+    STRCMP_EQUAL("Band 3, duty cycle 10000 ppm, window 3600 s" CONSOLE_EOL "Used 0 of 36000 ms" CONSOLE_EOL
+                 "Total 0 ms, TX 0, deferred 0" CONSOLE_EOL "OK" CONSOLE_EOL,
+                 rx_buffer);
+}
+
+TEST(cli_test, command_blackbox) {
+    blackbox_erase();
+    blackbox_begin(2);
+    bsp_fake_forward_ticks_ms(3000);
+    blackbox_set_tx_result(BLACKBOX_TX_DEFERRED);
+    blackbox_commit(3700, 300);
+
+    cli_send("blackbox\r");
+    STRCMP_EQUAL("Record found 1" CONSOLE_EOL
+                 "seq,start,ttff_100ms,fix_time_s,tx,vbat_mv,sleep_s,flags,"
+                 "init_s,tickle_s,fix_s,send_s,tx_done_s,shutdown_s,charging_s" CONSOLE_EOL
+                 "0,2,65535,0,3,3700,300,0x00,3,0,0,0,0,0,0" CONSOLE_EOL "OK" CONSOLE_EOL,
+                 rx_buffer);
+
+    cli_send("blackbox dump\r");
+    STRCMP_EQUAL("00000000000000000300000000000000000000000000FFFF740E2C010203006A" CONSOLE_EOL "OK" CONSOLE_EOL,
+                 rx_buffer);
+
+    cli_send("blackbox erase\r");
+    STRCMP_EQUAL("OK" CONSOLE_EOL, rx_buffer);
+    CHECK_EQUAL(0, blackbox_get_record_count());
+}
+
+TEST(cli_test, command_stats) {
+    stats_reset();
+    stats_add(STATS_COUNTER_RADIO_TX_MS, 1234);
+    stats_max(STATS_COUNTER_GNSS_RX_PEAK, 77);
+
+    cli_send("stats\r");
+    CHECK_TRUE(strstr(rx_buffer, "gnss_rx_peak 77" CONSOLE_EOL) != NULL);
+    CHECK_TRUE(strstr(rx_buffer, "radio_tx_ms 1234" CONSOLE_EOL) != NULL);
+    CHECK_TRUE(strstr(rx_buffer, "state_charging_ms 0" CONSOLE_EOL "OK" CONSOLE_EOL) != NULL);
+
+    cli_send("stats reset\r");
+    STRCMP_EQUAL("OK" CONSOLE_EOL, rx_buffer);
+    CHECK_EQUAL(0, stats_get(STATS_COUNTER_RADIO_TX_MS));
+}
+
+TEST(cli_test, command_profile) {
+    profile_reset();
+    profile_record(PROFILE_SCOPE_FLASH_WRITE, 300);
+    profile_record(PROFILE_SCOPE_FLASH_WRITE, 100);
+
+    cli_send("profile\r");
+    CHECK_TRUE(strstr(rx_buffer, "scope,count,min,max,avg" CONSOLE_EOL) != NULL);
+    CHECK_TRUE(strstr(rx_buffer, "flash_write,2,100,300,200" CONSOLE_EOL) != NULL);
+    CHECK_TRUE(strstr(rx_buffer, "settings_save,0,0,0,0" CONSOLE_EOL "OK" CONSOLE_EOL) != NULL);
+
+    cli_send("profile reset\r");
+    STRCMP_EQUAL("OK" CONSOLE_EOL, rx_buffer);
+
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_FLASH_WRITE, &stats);
+    CHECK_EQUAL(0, stats.count);
+}
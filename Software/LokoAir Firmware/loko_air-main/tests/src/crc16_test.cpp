@@ -1,19 +1,125 @@
 #include "CppUTest/TestHarness.h"
 
+#include <bsp.h>
+#include <chrono>
 #include <crc16.h>
+#include <stdio.h>
+#include <vector>
+
+typedef uint16_t (*crc16_backend_t)(const uint8_t *data, uint32_t size, uint16_t crc);
+
+static const struct {
+    const char *name;
+    crc16_backend_t calc;
+} _backends[] = {
+    {"bitwise",      crc16_ccitt_bitwise     },
+    {"rom table",    crc16_ccitt_rom_table   },
+    {"ram table",    crc16_ccitt_ram_table   },
+    {"slicing by 4", crc16_ccitt_slicing_by_4},
+    {"slicing by 8", crc16_ccitt_slicing_by_8},
+    {"hardware",     bsp_crc16_ccitt         },
+};
 
 TEST_GROUP(crc16_test) {
     void setup() {
-#if (CRC16_MODE == CRC_RAM_TABLE)
         crc16_generate_table();
-#endif /* CRC16_MODE */
     }
 
     void teardown() {
     }
+
+    std::vector<uint8_t> get_pattern(size_t size) {
+        std::vector<uint8_t> data(size);
+        uint32_t x = 0x12345678;
+
+        for (size_t i = 0; i < size; i++) {
+            x = x * 1103515245U + 12345U;
+            data[i] = (uint8_t)(x >> 16);
+        }
+
+        return data;
+    }
 };
 
 TEST(crc16_test, pass_me) {
     uint16_t crc_result = crc16_ccitt((uint8_t *)"123456789", 9, CRC16_CCITT_INIT_VAL);
     CHECK_EQUAL(0x29B1, crc_result);
 }
+
+TEST(crc16_test, check_value_all_backends) {
+    for (size_t i = 0; i < sizeof(_backends) / sizeof(_backends[0]); i++) {
+        uint16_t crc_result = _backends[i].calc((const uint8_t *)"123456789", 9, CRC16_CCITT_INIT_VAL);
+        CHECK_EQUAL_TEXT(0x29B1, crc_result, _backends[i].name);
+    }
+}
+
+TEST(crc16_test, backends_equivalence) {
+    std::vector<uint8_t> data = get_pattern(1024 + 7);
+
+    /* Every length covers all the slicing tails, odd offsets cover unaligned data */
+    for (uint32_t offset = 0; offset < 8; offset++) {
+        for (uint32_t size = 0; size < 64; size++) {
+            uint16_t expected = crc16_ccitt_bitwise(&data[offset], size, CRC16_CCITT_INIT_VAL);
+
+            for (size_t i = 0; i < sizeof(_backends) / sizeof(_backends[0]); i++) {
+                CHECK_EQUAL_TEXT(expected, _backends[i].calc(&data[offset], size, CRC16_CCITT_INIT_VAL),
+                                 _backends[i].name);
+            }
+        }
+    }
+
+    uint16_t expected = crc16_ccitt_bitwise(data.data(), (uint32_t)data.size(), 0);
+
+    for (size_t i = 0; i < sizeof(_backends) / sizeof(_backends[0]); i++) {
+        CHECK_EQUAL_TEXT(expected, _backends[i].calc(data.data(), (uint32_t)data.size(), 0), _backends[i].name);
+    }
+}
+
+TEST(crc16_test, ram_tables_match_rom_table) {
+    /* A single non zero byte in an 8 byte block reads one entry of one slicing row, so every entry of every row of the
+     * generated tables is compared against the ROM table */
+    for (uint32_t position = 0; position < 8; position++) {
+        for (uint32_t value = 0; value < 256; value++) {
+            uint8_t block[8] = {0};
+            block[position] = (uint8_t)value;
+
+            uint16_t expected = crc16_ccitt_rom_table(block, sizeof(block), 0);
+            CHECK_EQUAL(expected, crc16_ccitt_slicing_by_8(block, sizeof(block), 0));
+            CHECK_EQUAL(expected, crc16_ccitt_slicing_by_4(block, sizeof(block), 0));
+            CHECK_EQUAL(expected, crc16_ccitt_ram_table(block, sizeof(block), 0));
+        }
+    }
+}
+
+TEST(crc16_test, chunked_equals_whole) {
+    std::vector<uint8_t> data = get_pattern(300);
+    uint16_t expected = crc16_ccitt(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+
+    for (size_t i = 0; i < sizeof(_backends) / sizeof(_backends[0]); i++) {
+        uint16_t crc = CRC16_CCITT_INIT_VAL;
+        crc = _backends[i].calc(&data[0], 13, crc);
+        crc = _backends[i].calc(&data[13], 200, crc);
+        crc = _backends[i].calc(&data[213], 87, crc);
+        CHECK_EQUAL_TEXT(expected, crc, _backends[i].name);
+    }
+
+    CHECK_EQUAL(expected, crc16_offset_ccitt(CRC16_CCITT_INIT_VAL, data.data(), (uint32_t)data.size()));
+}
+
+TEST(crc16_test, throughput) {
+    /* Application image sized buffer, the numbers are informative only */
+    std::vector<uint8_t> data = get_pattern(224 * 1024);
+    uint16_t expected = crc16_ccitt_bitwise(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+
+    for (size_t i = 0; i < sizeof(_backends) / sizeof(_backends[0]); i++) {
+        auto start = std::chrono::steady_clock::now();
+        uint16_t crc = _backends[i].calc(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+        auto end = std::chrono::steady_clock::now();
+
+        double elapsed_s = std::chrono::duration<double>(end - start).count();
+        printf("\ncrc16 %-12s %8.2f MB/s", _backends[i].name, (double)data.size() / (elapsed_s * 1e6 + 1e-9));
+        CHECK_EQUAL_TEXT(expected, crc, _backends[i].name);
+    }
+
+    printf("\n");
+}
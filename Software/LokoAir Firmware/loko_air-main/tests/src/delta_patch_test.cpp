@@ -0,0 +1,386 @@
+#include "CppUTest/TestHarness.h"
+
+#include <crc16.h>
+#include <delta_patch.h>
+#include <string.h>
+#include <vector>
+
+static const size_t PAGE_SIZE = 256;
+static const size_t APP_PAGES = 16;
+static const size_t PATCH_PAGES = 8;
+static const size_t COPY_MIN = 8;
+static const size_t NO_CUT = SIZE_MAX;
+
+/* Flash with the power cut: the operation number cut_op is done by half, the next ones are lost */
+static struct {
+    std::vector<uint8_t> app;
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> scratch;
+    std::vector<uint8_t> journal;
+    size_t page_size;
+    size_t op_count;
+    size_t cut_op;
+} flash;
+
+static size_t flash_op_size(size_t size) {
+    if (flash.op_count > flash.cut_op) {
+        return 0;
+    }
+
+    return (flash.op_count++ == flash.cut_op) ? (size / 2) : size;
+}
+
+static void flash_erase(std::vector<uint8_t> &area, size_t offset, size_t size) {
+    memset(&area[offset], 0xFF, flash_op_size(size));
+}
+
+static void flash_write(std::vector<uint8_t> &area, size_t offset, void const *data, size_t size) {
+    memcpy(&area[offset], data, flash_op_size(size));
+}
+
+static void erase_app_page(size_t page) {
+    flash_erase(flash.app, page * flash.page_size, flash.page_size);
+}
+
+static void write_app(size_t offset, void const *data, size_t size) {
+    flash_write(flash.app, offset, data, size);
+}
+
+static void erase_patch(void) {
+    flash_erase(flash.patch, 0, flash.patch.size());
+}
+
+static void erase_scratch(void) {
+    flash_erase(flash.scratch, 0, flash.page_size);
+}
+
+static void write_scratch(void const *data, size_t size) {
+    flash_write(flash.scratch, 0, data, size);
+}
+
+static void erase_journal(void) {
+    flash_erase(flash.journal, 0, flash.page_size);
+}
+
+static void write_journal(size_t offset, void const *data, size_t size) {
+    flash_write(flash.journal, offset, data, size);
+}
+
+static void put_le(std::vector<uint8_t> &out, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static uint16_t crc(std::vector<uint8_t> const &data) {
+    return crc16_ccitt(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+}
+
+/* Greedy reference packer, the same format and copy rules as tools/delta_packer */
+static std::vector<uint8_t> make_patch(std::vector<uint8_t> const &old_image,
+                                       std::vector<uint8_t> const &new_image,
+                                       bool is_descending) {
+    const size_t PAGE_COUNT = (new_image.size() + PAGE_SIZE - 1) / PAGE_SIZE;
+    const size_t NEW_END = PAGE_COUNT * PAGE_SIZE;
+    std::vector<uint8_t> body;
+
+    for (size_t step = 0; step < PAGE_COUNT; step++) {
+        const size_t PAGE = is_descending ? (PAGE_COUNT - 1 - step) : step;
+        const size_t PAGE_START = PAGE * PAGE_SIZE;
+        const size_t PAGE_END = std::min(PAGE_START + PAGE_SIZE, new_image.size());
+        std::vector<uint8_t> literal;
+
+        auto flush = [&]() {
+            if (literal.size() > 0) {
+                body.push_back(DELTA_PATCH_OP_INSERT);
+                put_le(body, (uint32_t)literal.size(), 2);
+                body.insert(body.end(), literal.begin(), literal.end());
+                literal.clear();
+            }
+        };
+
+        for (size_t pos = PAGE_START; pos < PAGE_END;) {
+            size_t best_len = 0;
+            size_t best_src = 0;
+
+            for (size_t src = 0; src < old_image.size(); src++) {
+                size_t limit = std::min(PAGE_END - pos, old_image.size() - src);
+
+                if (is_descending && (src < NEW_END)) {
+                    limit = (src < PAGE_START + PAGE_SIZE) ? std::min(limit, PAGE_START + PAGE_SIZE - src) : 0;
+                } else if ((is_descending == false) && (src < PAGE_START)) {
+                    limit = 0;
+                }
+
+                size_t len = 0;
+                while ((len < limit) && (old_image[src + len] == new_image[pos + len])) {
+                    len++;
+                }
+                if (len > best_len) {
+                    best_len = len;
+                    best_src = src;
+                }
+            }
+
+            if (best_len >= COPY_MIN) {
+                flush();
+                body.push_back(DELTA_PATCH_OP_COPY);
+                put_le(body, (uint32_t)best_src, 4);
+                put_le(body, (uint32_t)best_len, 2);
+                pos += best_len;
+            } else {
+                literal.push_back(new_image[pos++]);
+            }
+        }
+        flush();
+    }
+
+    std::vector<uint8_t> patch;
+    put_le(patch, DELTA_PATCH_MAGIC, 4);
+    put_le(patch, is_descending ? DELTA_PATCH_FLAG_DESCENDING : 0, 4);
+    put_le(patch, PAGE_SIZE, 4);
+    put_le(patch, (uint32_t)old_image.size(), 4);
+    put_le(patch, (uint32_t)new_image.size(), 4);
+    put_le(patch, (uint32_t)body.size(), 4);
+    put_le(patch, crc(old_image), 2);
+    put_le(patch, crc(new_image), 2);
+    put_le(patch, crc(body), 2);
+    put_le(patch, crc(patch), 2);
+    patch.insert(patch.end(), body.begin(), body.end());
+
+    return patch;
+}
+
+TEST_GROUP(delta_patch_test) {
+    delta_patch_io_t io;
+    uint8_t page_buffer[PAGE_SIZE];
+    std::vector<uint8_t> old_image;
+    std::vector<uint8_t> new_image;
+
+    void setup() {
+        old_image = get_image(12 * PAGE_SIZE + 100, 1);
+        new_image = old_image;
+
+        /* Changed constants, a removed function and a longer image */
+        for (size_t i = 300; i < 310; i++) {
+            new_image[i] ^= 0x5A;
+        }
+        new_image.erase(new_image.begin() + 1000, new_image.begin() + 1100);
+        new_image.insert(new_image.end(), 250, 0x42);
+    }
+
+    void teardown() {
+    }
+
+    /* Code-like data: random areas mixed with repeated structures */
+    std::vector<uint8_t> get_image(size_t size, uint32_t seed) {
+        std::vector<uint8_t> image(size);
+        uint32_t x = seed;
+        for (size_t i = 0; i < size; i++) {
+            x = x * 1103515245U + 12345U;
+            image[i] = ((i / 128) % 2 == 0) ? (uint8_t)(x >> 16) : (uint8_t)((i % 32) ^ (i / 32));
+        }
+        return image;
+    }
+
+    void install(std::vector<uint8_t> const &image, std::vector<uint8_t> const &patch, size_t page_size = PAGE_SIZE) {
+        flash.app.assign(APP_PAGES * PAGE_SIZE, 0xFF);
+        flash.patch.assign(PATCH_PAGES * PAGE_SIZE, 0xFF);
+        flash.scratch.assign(PAGE_SIZE, 0xFF);
+        flash.journal.assign(PAGE_SIZE, 0xFF);
+        flash.page_size = page_size;
+        flash.op_count = 0;
+        flash.cut_op = NO_CUT;
+
+        memcpy(flash.app.data(), image.data(), image.size());
+        memcpy(flash.patch.data(), patch.data(), patch.size());
+
+        io = {
+            flash.app.data(), APP_PAGES * PAGE_SIZE, flash.patch.data(), PATCH_PAGES * PAGE_SIZE,
+            flash.scratch.data(), flash.journal.data(), page_size, erase_app_page, write_app, erase_patch,
+            erase_scratch, write_scratch, erase_journal, write_journal,
+        };
+    }
+
+    bool is_app_equal(std::vector<uint8_t> const &image) {
+        return memcmp(flash.app.data(), image.data(), image.size()) == 0;
+    }
+
+    void check_applied() {
+        CHECK(is_app_equal(new_image));
+        CHECK_FALSE(delta_patch_is_present(&io));
+        CHECK_EQUAL(DELTA_PATCH_RESULT_NO_PATCH, delta_patch_apply(&io, page_buffer));
+    }
+
+    void check_power_loss(std::vector<uint8_t> const &patch) {
+        install(old_image, patch);
+        CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+        const size_t OP_COUNT = flash.op_count;
+
+        for (size_t cut = 0; cut < OP_COUNT; cut++) {
+            install(old_image, patch);
+            flash.cut_op = cut;
+            delta_patch_apply(&io, page_buffer);
+
+            /* Reboot */
+            flash.cut_op = NO_CUT;
+            delta_patch_result_t result = delta_patch_apply(&io, page_buffer);
+            CHECK((result == DELTA_PATCH_RESULT_DONE) || (result == DELTA_PATCH_RESULT_NO_PATCH));
+            check_applied();
+        }
+    }
+};
+
+TEST(delta_patch_test, packer_tool_vector) {
+    /* tools/delta_packer/delta_packer.py output with the page size of 64 */
+    const std::vector<uint8_t> patch = { 0x4c, 0x4b, 0x44, 0x31, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00,
+                                         0x66, 0x00, 0x00, 0x00, 0x66, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x00,
+                                         0x1f, 0x36, 0x80, 0x51, 0xb2, 0xa7, 0x85, 0x05, 0x01, 0x00, 0x00, 0x00,
+                                         0x00, 0x14, 0x00, 0x02, 0x01, 0x00, 0x31, 0x01, 0x15, 0x00, 0x00, 0x00,
+                                         0x2b, 0x00, 0x01, 0x40, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x02, 0x01, 0x00,
+                                         0x32, 0x01, 0x4c, 0x00, 0x00, 0x00, 0x1a, 0x00 };
+    const char old_text[] = "Loko Air firmware 1.0.0, GNSS tracker with LoRaWAN and P2P modes. "
+                            "Build 0001 of the Loko Air firmware!";
+    const char new_text[] = "Loko Air firmware 1.1.0, GNSS tracker with LoRaWAN and P2P modes. "
+                            "Build 0002 of the Loko Air firmware!";
+
+    install(std::vector<uint8_t>(old_text, old_text + strlen(old_text)), patch, 64);
+
+    CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+    MEMCMP_EQUAL(new_text, flash.app.data(), strlen(new_text));
+    CHECK_FALSE(delta_patch_is_present(&io));
+}
+
+TEST(delta_patch_test, apply_ascending) {
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    CHECK(patch.size() < (new_image.size() / 4));
+
+    install(old_image, patch);
+    CHECK_TRUE(delta_patch_is_present(&io));
+    CHECK_EQUAL(DELTA_PATCH_RESULT_READY, delta_patch_verify(&io));
+    CHECK_EQUAL(0, flash.op_count);
+    CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+    check_applied();
+}
+
+TEST(delta_patch_test, apply_descending) {
+    /* Data moved towards the end is copied only in the descending order */
+    new_image = old_image;
+    new_image.insert(new_image.begin(), 200, 0x00);
+    std::vector<uint8_t> ascending = make_patch(old_image, new_image, false);
+    std::vector<uint8_t> descending = make_patch(old_image, new_image, true);
+    CHECK(descending.size() < (ascending.size() / 4));
+
+    install(old_image, descending);
+    CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+    check_applied();
+}
+
+TEST(delta_patch_test, shrinking_image) {
+    new_image = old_image;
+    new_image.erase(new_image.begin() + 500, new_image.begin() + 1500);
+    new_image[2000] ^= 0x01;
+
+    install(old_image, make_patch(old_image, new_image, false));
+    CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+    check_applied();
+}
+
+TEST(delta_patch_test, power_loss_ascending) {
+    check_power_loss(make_patch(old_image, new_image, false));
+}
+
+TEST(delta_patch_test, power_loss_descending) {
+    check_power_loss(make_patch(old_image, new_image, true));
+}
+
+TEST(delta_patch_test, repeated_power_loss) {
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    install(old_image, patch);
+
+    /* Every boot makes two steps only and leaves a torn record */
+    size_t boot_count = 0;
+    do {
+        flash.op_count = 0;
+        flash.cut_op = 11;
+        boot_count++;
+    } while ((delta_patch_apply(&io, page_buffer) != DELTA_PATCH_RESULT_DONE) && (boot_count < 100));
+
+    CHECK(boot_count > 5);
+    check_applied();
+}
+
+TEST(delta_patch_test, already_applied) {
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    install(new_image, patch);
+
+    CHECK_EQUAL(DELTA_PATCH_RESULT_DONE, delta_patch_apply(&io, page_buffer));
+    check_applied();
+}
+
+TEST(delta_patch_test, journal_full) {
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    install(old_image, patch);
+
+    flash.cut_op = 20;
+    delta_patch_apply(&io, page_buffer);
+
+    /* Records torn by power loss in every free slot */
+    for (size_t offset = 0; offset < PAGE_SIZE; offset += DELTA_PATCH_JOURNAL_REC_SIZE) {
+        if (flash.journal[offset] == 0xFF) {
+            flash.journal[offset] = 0x00;
+        }
+    }
+
+    flash.cut_op = NO_CUT;
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_JOURNAL, delta_patch_apply(&io, page_buffer));
+    CHECK_TRUE(delta_patch_is_present(&io));
+}
+
+TEST(delta_patch_test, wrong_old_image) {
+    std::vector<uint8_t> other_image = get_image(old_image.size(), 2);
+    install(other_image, make_patch(old_image, new_image, false));
+
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_OLD_IMAGE, delta_patch_verify(&io));
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_OLD_IMAGE, delta_patch_apply(&io, page_buffer));
+    CHECK(is_app_equal(other_image));
+    CHECK_FALSE(delta_patch_is_present(&io));
+}
+
+TEST(delta_patch_test, corrupted_patch) {
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    patch[patch.size() - 3] ^= 0x10;
+    install(old_image, patch);
+
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_PATCH, delta_patch_verify(&io));
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_PATCH, delta_patch_apply(&io, page_buffer));
+    CHECK(is_app_equal(old_image));
+    CHECK_FALSE(delta_patch_is_present(&io));
+}
+
+TEST(delta_patch_test, copy_of_rebuilt_page_rejected) {
+    /* Valid CRCs, but the second page copies the first one which is already rebuilt */
+    new_image = old_image;
+    std::vector<uint8_t> patch = make_patch(old_image, new_image, false);
+    const size_t SECOND_PAGE_OP = DELTA_PATCH_HEADER_SIZE + 7;
+    CHECK_EQUAL(DELTA_PATCH_OP_COPY, patch[SECOND_PAGE_OP]);
+    patch[SECOND_PAGE_OP + 1] = 0;
+    patch[SECOND_PAGE_OP + 2] = 0;
+
+    std::vector<uint8_t> body(patch.begin() + DELTA_PATCH_HEADER_SIZE, patch.end());
+    patch[28] = (uint8_t)crc(body);
+    patch[29] = (uint8_t)(crc(body) >> 8);
+    uint16_t header_crc = crc16_ccitt(patch.data(), DELTA_PATCH_HEADER_SIZE - 2, CRC16_CCITT_INIT_VAL);
+    patch[30] = (uint8_t)header_crc;
+    patch[31] = (uint8_t)(header_crc >> 8);
+
+    install(old_image, patch);
+    CHECK_EQUAL(DELTA_PATCH_RESULT_ERROR_PATCH, delta_patch_apply(&io, page_buffer));
+    CHECK(is_app_equal(old_image));
+}
+
+TEST(delta_patch_test, no_patch) {
+    install(old_image, {});
+    CHECK_FALSE(delta_patch_is_present(&io));
+    CHECK_EQUAL(DELTA_PATCH_RESULT_NO_PATCH, delta_patch_apply(&io, page_buffer));
+}
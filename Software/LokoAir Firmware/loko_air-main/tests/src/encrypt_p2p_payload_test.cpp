@@ -1,15 +1,20 @@
 #include "CppUTest/TestHarness.h"
 
 #include "encrypt_p2p_payload.h"
+#include <bsp.h>
+#include <rtc_backup_layout.h>
 #include <spy/settings_io.hpp>
 
 #include <array>
 #include <string>
+#include <vector>
 
 TEST_GROUP(encrypt_p2p_payload_test) {
     void setup() final {
         settings_setup_io();
         settings_init(settings_get_io());
+        bsp_fake_rtc_store_clear();
+        enc_p2p_init();
     }
 
     void teardown() final {
@@ -68,3 +73,92 @@ TEST(encrypt_p2p_payload_test, integrity_calculation_1) {
 TEST(encrypt_p2p_payload_test, payload_size) {
     CHECK_EQUAL(16, sizeof(enc_p2p_payload_t));
 }
+
+/* Reference values are produced by tools/p2p-decrypt-bin-mode-example.py primitives, zero key */
+
+TEST(encrypt_p2p_payload_test, ctr_encryption_test) {
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    enc_p2p_ctr_crypt(data.data(), data.size(), 1, 2, 3);
+
+    std::string expected = "\xA0\x93\x07\x7C\x68\x37\xF1\x50\x54\x25\x6B\x5A";
+    MEMCMP_EQUAL(expected.data(), reinterpret_cast<const char *>(data.data()), data.size());
+
+    enc_p2p_ctr_crypt(data.data(), data.size(), 1, 2, 3);
+    for (size_t i = 0; i < data.size(); i++) {
+        CHECK_EQUAL(i, data[i]);
+    }
+}
+
+TEST(encrypt_p2p_payload_test, ctr_arbitrary_length) {
+    std::vector<uint8_t> data(40);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)i;
+    }
+    enc_p2p_ctr_crypt(data.data(), data.size(), 1, 2, 3);
+
+    std::string expected = "\xA0\x93\x07\x7C\x68\x37\xF1\x50\x54\x25\x6B\x5A\xC5\x27\xA7\x30"
+                           "\x95\x13\xDF\xA3\x30\x3F\x01\x4A\x4E\x14\x93\x89\xFB\xF1\xF2\x19"
+                           "\x81\xC0\x67\x7F\x15\x8B\xF4\x60";
+    MEMCMP_EQUAL(expected.data(), reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+TEST(encrypt_p2p_payload_test, ctr_nonce_changes_key_stream) {
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data_1 = { 0 };
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data_2 = { 0 };
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data_3 = { 0 };
+
+    enc_p2p_ctr_crypt(data_1.data(), data_1.size(), 1, 2, 3);
+    enc_p2p_ctr_crypt(data_2.data(), data_2.size(), 1, 2, 4);
+    enc_p2p_ctr_crypt(data_3.data(), data_3.size(), 1, 3, 3);
+
+    CHECK(data_1 != data_2);
+    CHECK(data_1 != data_3);
+}
+
+TEST(encrypt_p2p_payload_test, mac_test) {
+    /* id1 1, id2 2, version 6, counter 3, encrypted record */
+    std::vector<uint8_t> packet = { 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x60, 0x03, 0x00, 0x00, 0x00,
+                                    0xA0, 0x93, 0x07, 0x7C, 0x68, 0x37, 0xF1, 0x50, 0x54, 0x25, 0x6B, 0x5A };
+    std::array<uint8_t, ENC_P2P_MAC_SIZE> mac = { 0 };
+    enc_p2p_get_mac(mac.data(), packet.data(), packet.size());
+
+    std::string expected = "\xFA\x99\x29\x5B";
+    MEMCMP_EQUAL(expected.data(), reinterpret_cast<const char *>(mac.data()), mac.size());
+
+    /* Single bit change */
+    packet[9] ^= 0x01;
+    std::array<uint8_t, ENC_P2P_MAC_SIZE> tampered_mac = { 0 };
+    enc_p2p_get_mac(tampered_mac.data(), packet.data(), packet.size());
+    CHECK(mac != tampered_mac);
+}
+
+TEST(encrypt_p2p_payload_test, key_change) {
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data_1 = { 0 };
+    std::array<uint8_t, sizeof(enc_p2p_record_t)> data_2 = { 0 };
+    enc_p2p_ctr_crypt(data_1.data(), data_1.size(), 1, 2, 3);
+
+    std::array<uint8_t, SETTINGS_P2P_KEY_SIZE> key;
+    key.fill(0xAA);
+    settings_set_p2p_key(key.data());
+    enc_p2p_init();
+
+    enc_p2p_ctr_crypt(data_2.data(), data_2.size(), 1, 2, 3);
+    CHECK(data_1 != data_2);
+}
+
+TEST(encrypt_p2p_payload_test, counter) {
+    CHECK_EQUAL(0, enc_p2p_get_next_counter(0));
+    CHECK_EQUAL(1, enc_p2p_get_next_counter(0));
+    CHECK_EQUAL(2, enc_p2p_get_next_counter(1));
+
+    /* Floor, e.g. GNSS time, is ahead */
+    CHECK_EQUAL(1000, enc_p2p_get_next_counter(1000));
+    CHECK_EQUAL(1001, enc_p2p_get_next_counter(1000));
+    CHECK_EQUAL(1001, bsp_rtc_store_read_reg(RTC_BACKUP_REG_P2P_COUNTER));
+
+    /* Backup domain lost */
+    bsp_fake_rtc_store_clear();
+    CHECK_EQUAL(500, enc_p2p_get_next_counter(500));
+    bsp_fake_rtc_store_clear();
+    CHECK_EQUAL(0, enc_p2p_get_next_counter(0));
+}
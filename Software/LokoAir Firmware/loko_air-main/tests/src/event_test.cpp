@@ -0,0 +1,153 @@
+#include "CppUTest/TestHarness.h"
+
+#include <bsp.h>
+#include <event/event.h>
+
+static void _post_button_edge(void) {
+    event_post(EVENT_TYPE_BUTTON_EDGE);
+}
+
+TEST_GROUP(event_test) {
+    void setup() {
+        event_init();
+    }
+
+    void teardown() {
+        bsp_fake_irq_schedule(0, NULL);
+        bsp_enable_irq();
+    }
+};
+
+TEST(event_test, empty) {
+    event_t event;
+
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, delivered_in_type_order) {
+    event_t event;
+
+    event_post(EVENT_TYPE_CHARGER_EDGE);
+    event_post(EVENT_TYPE_GNSS_EPOCH);
+    event_post(EVENT_TYPE_ENTRY);
+
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_ENTRY, event.type);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_GNSS_EPOCH, event.type);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_CHARGER_EDGE, event.type);
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, pending_event_is_delivered_once) {
+    event_t event;
+
+    event_post(EVENT_TYPE_TX_DONE);
+    event_post(EVENT_TYPE_TX_DONE);
+    event_post(EVENT_TYPE_COUNT);
+
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_TX_DONE, event.type);
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, timer_expires_once) {
+    event_t event;
+
+    event_timer_start(2, 100);
+    bsp_fake_forward_ticks_ms(99);
+    CHECK_FALSE(event_get(&event));
+    CHECK_TRUE(event_timer_is_running(2));
+
+    bsp_fake_forward_ticks_ms(1);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_TIMER, event.type);
+    CHECK_EQUAL(2, event.timer);
+    CHECK_FALSE(event_timer_is_running(2));
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, timer_restart_and_stop) {
+    event_t event;
+
+    event_timer_start(0, 100);
+    event_timer_start(1, 100);
+    bsp_fake_forward_ticks_ms(60);
+    event_timer_start(0, 100);
+    event_timer_stop(1);
+    bsp_fake_forward_ticks_ms(60);
+    CHECK_FALSE(event_get(&event));
+
+    bsp_fake_forward_ticks_ms(40);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(0, event.timer);
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, wait_ends_at_nearest_timer) {
+    event_t event;
+
+    event_timer_start(0, 300);
+    event_timer_start(1, 30);
+
+    const uint32_t START_TS = bsp_get_ticks();
+    event_wait(50);
+    CHECK_EQUAL(30, bsp_get_ticks() - START_TS);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(1, event.timer);
+
+    /* Expired timer is not slept over */
+    bsp_fake_forward_ticks_ms(300);
+    event_wait(50);
+    CHECK_EQUAL(330, bsp_get_ticks() - START_TS);
+}
+
+TEST(event_test, wait_returns_with_pending_event) {
+    event_post(EVENT_TYPE_BUTTON_EDGE);
+
+    const uint32_t START_TS = bsp_get_ticks();
+    event_wait(50);
+    CHECK_EQUAL(START_TS, bsp_get_ticks());
+
+    event_t event;
+    CHECK_TRUE(event_get(&event));
+    event_wait(50);
+    CHECK_EQUAL(50, bsp_get_ticks() - START_TS);
+}
+
+TEST(event_test, interrupt_ends_the_wait) {
+    event_t event;
+    const uint32_t START_TS = bsp_get_ticks();
+
+    /* One cycle of the application main loop: the interrupt wakes it up before the timer */
+    event_timer_start(0, 500);
+    bsp_fake_irq_schedule(START_TS + 20, _post_button_edge);
+
+    event_wait(1000);
+    CHECK_EQUAL(20, bsp_get_ticks() - START_TS);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_BUTTON_EDGE, event.type);
+    CHECK_FALSE(event_get(&event));
+
+    event_wait(1000);
+    CHECK_EQUAL(500, bsp_get_ticks() - START_TS);
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_TIMER, event.type);
+    CHECK_FALSE(event_get(&event));
+}
+
+TEST(event_test, interrupt_raised_during_check_is_not_lost) {
+    event_t event;
+    const uint32_t START_TS = bsp_get_ticks();
+
+    /* The interrupt comes while the pending events are checked, it stays pending and must not be slept over */
+    bsp_disable_irq();
+    bsp_fake_irq_schedule(START_TS, _post_button_edge);
+    CHECK_FALSE(event_get(&event));
+
+    event_wait(1000);
+    CHECK_EQUAL(START_TS, bsp_get_ticks());
+    CHECK_TRUE(event_get(&event));
+    CHECK_EQUAL(EVENT_TYPE_BUTTON_EDGE, event.type);
+}
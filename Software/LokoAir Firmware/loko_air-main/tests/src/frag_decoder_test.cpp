@@ -0,0 +1,363 @@
+#include "CppUTest/TestHarness.h"
+
+#include <bsp.h>
+#include <chrono>
+#include <crc16.h>
+#include <delta_patch.h>
+#include <frag_decoder_if.h>
+#include <random>
+#include <string.h>
+#include <vector>
+
+/* Largest session, it fills the staging area of FRAG_DECODER_IF_REGION_SIZE bytes */
+#define BENCH_FRAG_NB   (FRAG_MAX_NB)
+#define BENCH_FRAG_SIZE (FRAG_MAX_SIZE)
+#define FRAG_PVER       (2U)
+
+static const uint32_t LOSS_PERCENTS[] = { 1U, 3U, 5U };
+static const uint32_t SEEDS[] = { 1U, 2U, 3U };
+
+static std::vector<uint8_t> file;
+
+static int32_t file_erase(void) {
+    std::fill(file.begin(), file.end(), 0xFF);
+    return 0;
+}
+
+static int32_t file_write(uint32_t addr, uint8_t *data, uint32_t size) {
+    if ((addr + size) > file.size()) {
+        return -1;
+    }
+    memcpy(&file[addr], data, size);
+    return 0;
+}
+
+static int32_t file_read(uint32_t addr, uint8_t *data, uint32_t size) {
+    if ((addr + size) > file.size()) {
+        return -1;
+    }
+    memcpy(data, &file[addr], size);
+    return 0;
+}
+
+static FragDecoderCallbacks_t callbacks = {
+    .FragDecoderErase = file_erase,
+    .FragDecoderWrite = file_write,
+    .FragDecoderRead = file_read,
+};
+
+/* Reference encoder, LoRa Alliance fragmented data block transport, independent of the decoder internals */
+static int32_t prbs23(int32_t value) {
+    int32_t b0 = value & 0x01;
+    int32_t b1 = (value & 0x20) >> 5;
+    return (value >> 1) + ((b0 ^ b1) << 22);
+}
+
+static std::vector<bool> get_parity_row(int32_t n, int32_t m) {
+    std::vector<bool> row((size_t)m);
+    int32_t m_temp = ((m & (m - 1)) == 0) ? 1 : 0;
+    int32_t x = 1 + (1001 * n);
+    int32_t nb_coeff = 0;
+
+    while (nb_coeff < (m >> 1)) {
+        int32_t r = 1 << 16;
+        while (r >= m) {
+            x = prbs23(x);
+            r = x % (m + m_temp);
+        }
+        if (!row[(size_t)r]) {
+            row[(size_t)r] = true;
+            nb_coeff++;
+        }
+    }
+
+    return row;
+}
+
+static std::vector<uint8_t> get_fragment(std::vector<uint8_t> const &data, uint16_t frag_nb, uint8_t frag_size,
+                                         uint32_t counter) {
+    std::vector<uint8_t> fragment(frag_size, 0);
+
+    if (counter <= frag_nb) {
+        memcpy(fragment.data(), &data[(counter - 1U) * frag_size], frag_size);
+        return fragment;
+    }
+
+    std::vector<bool> row = get_parity_row((int32_t)(counter - frag_nb), frag_nb);
+    for (size_t i = 0; i < frag_nb; i++) {
+        if (row[i]) {
+            for (size_t j = 0; j < frag_size; j++) {
+                fragment[j] ^= data[(i * frag_size) + j];
+            }
+        }
+    }
+    return fragment;
+}
+
+typedef struct {
+    int32_t result;
+    FragDecoderStatus_t status;
+    uint32_t sent;
+    double decode_us;
+    bool is_exact;
+} session_t;
+
+/* Sends the fragments, is_lost decides per fragment counter, then the coded ones until the decoder finishes */
+template <typename LOST>
+static session_t run_session(uint16_t frag_nb, uint8_t frag_size, LOST is_lost) {
+    std::mt19937 rng(frag_nb);
+    std::vector<uint8_t> data((size_t)frag_nb * frag_size);
+    for (auto &byte : data) {
+        byte = (uint8_t)rng();
+    }
+
+    file.assign(data.size(), 0);
+    FragDecoderInit(frag_nb, frag_size, &callbacks, FRAG_PVER);
+
+    session_t session = {};
+    session.result = FRAG_SESSION_ONGOING;
+    std::chrono::steady_clock::duration elapsed = {};
+
+    for (uint32_t counter = 1; (counter <= (frag_nb + (3U * FRAG_MAX_REDUNDANCY))) &&
+                               (session.result == FRAG_SESSION_ONGOING);
+         counter++) {
+        if (is_lost(counter)) {
+            continue;
+        }
+
+        std::vector<uint8_t> fragment = get_fragment(data, frag_nb, frag_size, counter);
+        session.sent++;
+
+        auto start = std::chrono::steady_clock::now();
+        session.result = FragDecoderProcess((uint16_t)counter, fragment.data());
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    session.status = FragDecoderGetStatus();
+    session.decode_us = std::chrono::duration<double, std::micro>(elapsed).count();
+    session.is_exact = (file == data);
+    return session;
+}
+
+static session_t run_random_session(uint16_t frag_nb, uint8_t frag_size, uint32_t loss_percent, uint32_t seed) {
+    std::mt19937 rng(seed);
+    return run_session(frag_nb, frag_size, [&](uint32_t counter) {
+        (void)counter;
+        return (rng() % 100U) < loss_percent;
+    });
+}
+
+TEST_GROUP(frag_decoder_test) {
+    void teardown() {
+        file.clear();
+    }
+};
+
+TEST(frag_decoder_test, no_loss) {
+    session_t session = run_session(BENCH_FRAG_NB, BENCH_FRAG_SIZE, [](uint32_t counter) {
+        (void)counter;
+        return false;
+    });
+
+    CHECK_EQUAL(FRAG_SESSION_FINISHED, session.result);
+    CHECK_EQUAL(BENCH_FRAG_NB, session.sent);
+    CHECK_EQUAL(0, session.status.MatrixError);
+    CHECK_TRUE(session.is_exact);
+}
+
+TEST(frag_decoder_test, lost_first_last_and_adjacent) {
+    session_t session = run_session(BENCH_FRAG_NB, BENCH_FRAG_SIZE, [](uint32_t counter) {
+        return (counter == 1U) || (counter == 100U) || (counter == 101U) || (counter == BENCH_FRAG_NB) ||
+               (counter == (BENCH_FRAG_NB + 1U));
+    });
+
+    CHECK_EQUAL(4, session.result);
+    CHECK_EQUAL(0, session.status.MatrixError);
+    CHECK_TRUE(session.is_exact);
+}
+
+TEST(frag_decoder_test, bit_array_word_edges) {
+    /* Around the 32-bit words of the parity rows, and a power of two session */
+    const uint16_t FRAG_NBS[] = { 7U, 31U, 32U, 33U, 64U, 95U, 96U, 97U };
+
+    for (size_t i = 0; i < sizeof(FRAG_NBS) / sizeof(FRAG_NBS[0]); i++) {
+        session_t session = run_session(FRAG_NBS[i], 13U, [&](uint32_t counter) {
+            return ((counter % 10U) == 2U) && (counter <= FRAG_NBS[i]);
+        });
+
+        CHECK_TRUE(session.result > 0);
+        CHECK_EQUAL(0, session.status.MatrixError);
+        CHECK_TEXT(session.is_exact, "frag_nb");
+    }
+}
+
+TEST(frag_decoder_test, too_many_lost_then_new_session) {
+    session_t session = run_random_session(BENCH_FRAG_NB, BENCH_FRAG_SIZE, 30U, 1U);
+
+    CHECK_EQUAL(FRAG_SESSION_FINISHED, session.result);
+    CHECK_EQUAL(1, session.status.MatrixError);
+
+    /* The error of the previous session must not stick */
+    session = run_random_session(BENCH_FRAG_NB, BENCH_FRAG_SIZE, 3U, 2U);
+
+    CHECK_TRUE(session.result > 0);
+    CHECK_EQUAL(0, session.status.MatrixError);
+    CHECK_TRUE(session.is_exact);
+}
+
+TEST(frag_decoder_test, loss_rates) {
+    /* The decode time is informative only, the output must be bit exact */
+    for (size_t i = 0; i < sizeof(LOSS_PERCENTS) / sizeof(LOSS_PERCENTS[0]); i++) {
+        for (size_t j = 0; j < sizeof(SEEDS) / sizeof(SEEDS[0]); j++) {
+            session_t session = run_random_session(BENCH_FRAG_NB, BENCH_FRAG_SIZE, LOSS_PERCENTS[i], SEEDS[j]);
+
+            printf("\nfrag_decoder %u x %u B, loss %2u%%, lost %3u, sent %4u, %9.1f us, %s",
+                   BENCH_FRAG_NB,
+                   BENCH_FRAG_SIZE,
+                   (unsigned)LOSS_PERCENTS[i],
+                   session.status.FragNbLost,
+                   (unsigned)session.sent,
+                   session.decode_us,
+                   session.is_exact ? "bit exact" : "MISMATCH");
+
+            CHECK_TRUE(session.result >= 0);
+            CHECK_EQUAL(0, session.status.MatrixError);
+            CHECK_TRUE(session.is_exact);
+        }
+    }
+
+    printf("\n");
+}
+
+/* FUOTA session through the staging area callbacks, the fake flash counts the words programmed twice */
+static void put_le(std::vector<uint8_t> &out, uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static uint16_t crc(std::vector<uint8_t> const &data) {
+    return crc16_ccitt(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+}
+
+/* Patch of the installed image to the new one, every page is inserted */
+static std::vector<uint8_t> make_patch(std::vector<uint8_t> const &old_image, std::vector<uint8_t> const &new_image) {
+    std::vector<uint8_t> body;
+
+    for (size_t offset = 0; offset < new_image.size(); offset += BSP_FLASH_SETTINGS_PAGE_SIZE) {
+        const size_t SIZE = std::min((size_t)BSP_FLASH_SETTINGS_PAGE_SIZE, new_image.size() - offset);
+        body.push_back(DELTA_PATCH_OP_INSERT);
+        put_le(body, (uint32_t)SIZE, 2);
+        body.insert(body.end(), new_image.begin() + (long)offset, new_image.begin() + (long)(offset + SIZE));
+    }
+
+    std::vector<uint8_t> patch;
+    put_le(patch, DELTA_PATCH_MAGIC, 4);
+    put_le(patch, 0, 4);
+    put_le(patch, BSP_FLASH_SETTINGS_PAGE_SIZE, 4);
+    put_le(patch, (uint32_t)old_image.size(), 4);
+    put_le(patch, (uint32_t)new_image.size(), 4);
+    put_le(patch, (uint32_t)body.size(), 4);
+    put_le(patch, crc(old_image), 2);
+    put_le(patch, crc(new_image), 2);
+    put_le(patch, crc(body), 2);
+    put_le(patch, crc(patch), 2);
+    patch.insert(patch.end(), body.begin(), body.end());
+
+    return patch;
+}
+
+TEST_GROUP(frag_decoder_if_test) {
+    /* Not a multiple of the flash word, the fragments share partial words */
+    static const uint8_t FRAG_SIZE = 100U;
+
+    std::vector<uint8_t> patch;
+    uint16_t frag_nb;
+
+    void setup() {
+        std::mt19937 rng(1U);
+        std::vector<uint8_t> old_image(2U * BSP_FLASH_SETTINGS_PAGE_SIZE);
+        std::vector<uint8_t> new_image((2U * BSP_FLASH_SETTINGS_PAGE_SIZE) + 900U);
+        for (auto &byte : old_image) {
+            byte = (uint8_t)rng();
+        }
+        for (auto &byte : new_image) {
+            byte = (uint8_t)rng();
+        }
+
+        mcu_flash_erase_app();
+        mcu_flash_write_app(0, old_image.data(), old_image.size());
+        bsp_fake_flash_update_reset();
+
+        patch = make_patch(old_image, new_image);
+        frag_nb = (uint16_t)((patch.size() + FRAG_SIZE - 1U) / FRAG_SIZE);
+        patch.resize((size_t)frag_nb * FRAG_SIZE, 0);
+    }
+
+    void teardown() {
+        patch.clear();
+    }
+
+    /* Fragments in the LmhpFragmentation order: progress after every one, done once the decoder finishes */
+    template <typename LOST>
+    int32_t run(LOST is_lost, uint32_t repeated_counter) {
+        LmhpFragmentationParams_t const *params = &FRAG_DECODER_IF_FragmentationParams;
+        int32_t result = FRAG_SESSION_ONGOING;
+
+        FragDecoderInit(frag_nb, FRAG_SIZE, const_cast<FragDecoderCallbacks_t *>(&params->DecoderCallbacks), FRAG_PVER);
+
+        for (uint32_t counter = 1; (counter <= (frag_nb + (3U * FRAG_MAX_REDUNDANCY))) &&
+                                   (result == FRAG_SESSION_ONGOING);
+             counter++) {
+            if (is_lost(counter)) {
+                continue;
+            }
+
+            std::vector<uint8_t> fragment = get_fragment(patch, frag_nb, FRAG_SIZE, counter);
+            const uint32_t SEND_COUNT = (counter == repeated_counter) ? 2U : 1U;
+
+            for (uint32_t i = 0; (i < SEND_COUNT) && (result == FRAG_SESSION_ONGOING); i++) {
+                result = FragDecoderProcess((uint16_t)counter, fragment.data());
+                FragDecoderStatus_t status = FragDecoderGetStatus();
+                params->OnProgress(status.FragNbRx, frag_nb, FRAG_SIZE, status.FragNbLost);
+            }
+        }
+
+        if (result >= 0) {
+            params->OnDone(result, (uint32_t)frag_nb * FRAG_SIZE);
+        }
+
+        return result;
+    }
+};
+
+TEST(frag_decoder_if_test, lost_fragments_are_programmed_once) {
+    /* Adjacent lost ones share a flash word, a repeated fragment is written by the decoder again */
+    int32_t result = run(
+        [&](uint32_t counter) {
+            return (counter == 2U) || (counter == 3U) || (counter == 30U) || (counter == frag_nb) ||
+                   (counter == (frag_nb + 2U));
+        },
+        10U);
+
+    CHECK_EQUAL(4, result);
+    CHECK_EQUAL(0, FragDecoderGetStatus().MatrixError);
+    CHECK_EQUAL(0, bsp_fake_flash_update_get_overwrite_count());
+    MEMCMP_EQUAL(patch.data(), bsp_flash_update_get_addr(), patch.size());
+    CHECK_FALSE(frag_decoder_if_is_session_active());
+    CHECK_TRUE(frag_decoder_if_is_update_ready());
+}
+
+TEST(frag_decoder_if_test, too_many_lost) {
+    int32_t result = run(
+        [&](uint32_t counter) {
+            return (counter > 10U) && (counter <= (11U + FRAG_MAX_REDUNDANCY));
+        },
+        0);
+
+    CHECK_EQUAL(FRAG_SESSION_FINISHED, result);
+    CHECK_EQUAL(1, FragDecoderGetStatus().MatrixError);
+    CHECK_EQUAL(0, bsp_fake_flash_update_get_overwrite_count());
+    CHECK_FALSE(frag_decoder_if_is_session_active());
+    CHECK_FALSE(frag_decoder_if_is_update_ready());
+}
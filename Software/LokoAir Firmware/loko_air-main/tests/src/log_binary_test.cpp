@@ -0,0 +1,159 @@
+#include "CppUTest/TestHarness.h"
+
+#include <bsp.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+extern const char __start_log_fmt[];
+}
+
+static std::vector<uint8_t> _output;
+
+static void _capture_write(const uint8_t *data, size_t size) {
+    _output.insert(_output.end(), data, data + size);
+}
+
+static log_timestamp_t _get_ts(void) {
+    return 0x12345678UL;
+}
+
+static bool _is_isr(void) {
+    return false;
+}
+
+static const log_io_t CAPTURE_IO = {
+    .write = _capture_write,
+    .get_ts = _get_ts,
+    .is_isr = _is_isr,
+};
+
+static uint8_t _sum(size_t start, size_t end) {
+    uint8_t sum = 0;
+    for (size_t i = start; i < end; i++) {
+        sum = (uint8_t)(sum + _output[i]);
+    }
+    return sum;
+}
+
+/* Checks the frame at the offset, returns the offset of its arguments */
+static size_t _check_frame(size_t offset, log_mask_t level, log_binary_kind_t kind, size_t args_size) {
+    CHECK_TRUE(_output.size() >= (offset + LOG_BINARY_HEADER_SIZE + args_size + 1U));
+    CHECK_EQUAL(LOG_BINARY_SYNC, _output[offset]);
+    CHECK_EQUAL(LOG_BINARY_HEADER_SIZE - 2U + args_size, _output[offset + 1U]);
+    CHECK_EQUAL(0x78, _output[offset + 4U]);
+    CHECK_EQUAL(0x12, _output[offset + 7U]);
+    CHECK_EQUAL(level, _output[offset + 8U]);
+    CHECK_EQUAL(kind, _output[offset + 9U]);
+
+    const size_t END = offset + LOG_BINARY_HEADER_SIZE + args_size;
+    CHECK_EQUAL(_sum(offset + 1U, END), _output[END]);
+
+    return offset + LOG_BINARY_HEADER_SIZE;
+}
+
+static const char *_get_format(size_t offset) {
+    return &__start_log_fmt[_output[offset + 2U] | (_output[offset + 3U] << 8)];
+}
+
+TEST_GROUP(log_binary_test) {
+    void setup() {
+        log_init(LOG_MASK_ALL, &CAPTURE_IO);
+        log_process();
+        _output.clear();
+    }
+
+    void teardown() {
+        log_set_output_mask(LOG_MASK_OFF);
+        log_process();
+        _output.clear();
+    }
+};
+
+TEST(log_binary_test, message_arguments) {
+    _LOG_BINARY(log_bin, LOG_MASK_INFO, "Fix %d %s %lu %.1f %%", -5, "ab", 7UL, 1.5);
+    CHECK_EQUAL(0, _output.size());
+
+    log_process();
+
+    const size_t ARGS = _check_frame(0, LOG_MASK_INFO, LOG_BINARY_KIND_MESSAGE, 4U + 3U + 4U + 8U);
+    STRCMP_EQUAL("Fix %d %s %lu %.1f %%", _get_format(0));
+
+    const uint8_t EXPECTED[] = {
+        0xFB, 0xFF, 0xFF, 0xFF, 'a', 'b', 0, 0x07, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xF8, 0x3F,
+    };
+    MEMCMP_EQUAL(EXPECTED, &_output[ARGS], sizeof(EXPECTED));
+}
+
+TEST(log_binary_test, messages_have_own_ids) {
+    for (size_t i = 0; i < 2U; i++) {
+        _LOG_BINARY(log_bin, LOG_MASK_DEBUG, "First");
+        _LOG_BINARY(log_bin, LOG_MASK_DEBUG, "Second %c", 'x');
+    }
+    log_process();
+
+    const size_t FIRST_SIZE = LOG_BINARY_HEADER_SIZE + 1U;
+    const size_t SECOND_SIZE = LOG_BINARY_HEADER_SIZE + 4U + 1U;
+
+    CHECK_EQUAL(2U * (FIRST_SIZE + SECOND_SIZE), _output.size());
+    STRCMP_EQUAL("First", _get_format(0));
+    STRCMP_EQUAL("Second %c", _get_format(FIRST_SIZE));
+    MEMCMP_EQUAL(&_output[0], &_output[FIRST_SIZE + SECOND_SIZE], FIRST_SIZE + SECOND_SIZE);
+}
+
+TEST(log_binary_test, array_is_truncated_to_frame) {
+    uint8_t array[300];
+    for (size_t i = 0; i < sizeof(array); i++) {
+        array[i] = (uint8_t)i;
+    }
+
+    _LOG_BINARY(log_bin_array, LOG_MASK_DEBUG, "RX", array, sizeof(array));
+    log_process();
+
+    const size_t ARGS = _check_frame(0, LOG_MASK_DEBUG, LOG_BINARY_KIND_ARRAY, LOG_BINARY_MAX_ARGS_SIZE);
+    STRCMP_EQUAL("RX", _get_format(0));
+    CHECK_EQUAL(sizeof(array), _output[ARGS] | (_output[ARGS + 1U] << 8));
+    MEMCMP_EQUAL(array, &_output[ARGS + 2U], LOG_BINARY_MAX_ARGS_SIZE - 2U);
+}
+
+TEST(log_binary_test, long_string_is_truncated) {
+    char string[LOG_BINARY_MAX_ARGS_SIZE * 2U];
+    memset(string, 'x', sizeof(string) - 1U);
+    string[sizeof(string) - 1U] = 0;
+
+    _LOG_BINARY(log_bin, LOG_MASK_INFO, "%u %s %u", 1U, string, 2U);
+    log_process();
+
+    const size_t ARGS = _check_frame(0, LOG_MASK_INFO, LOG_BINARY_KIND_MESSAGE, LOG_BINARY_MAX_ARGS_SIZE);
+    CHECK_EQUAL(0, _output[ARGS + LOG_BINARY_MAX_ARGS_SIZE - 1U]);
+    CHECK_EQUAL('x', _output[ARGS + LOG_BINARY_MAX_ARGS_SIZE - 2U]);
+}
+
+TEST(log_binary_test, masked_level_is_not_packed) {
+    log_set_output_mask(LOG_MASK_ERROR);
+
+    _LOG_BINARY(log_bin, LOG_MASK_DEBUG, "Not packed %u", 1U);
+    _LOG_BINARY(log_bin_array, LOG_MASK_DEBUG, "Not packed", "ab", 2U);
+    log_process();
+
+    CHECK_EQUAL(0, _output.size());
+}
+
+TEST(log_binary_test, full_ring_reports_dropped) {
+    const size_t FRAME_SIZE = LOG_BINARY_HEADER_SIZE + 4U + 1U;
+    const size_t FITS = LOG_BINARY_RING_SIZE / FRAME_SIZE;
+
+    for (uint32_t i = 0; i < (FITS + 5U); i++) {
+        _LOG_BINARY(log_bin, LOG_MASK_INFO, "%lu", (unsigned long)i);
+    }
+    log_process();
+    CHECK_EQUAL(FITS * FRAME_SIZE, _output.size());
+
+    _output.clear();
+    _LOG_BINARY(log_bin, LOG_MASK_INFO, "After %u", 1U);
+    log_process();
+
+    const size_t ARGS = _check_frame(0, LOG_MASK_WARNING, LOG_BINARY_KIND_DROPPED, 4U);
+    CHECK_EQUAL(5, _output[ARGS]);
+    STRCMP_EQUAL("After %u", _get_format(FRAME_SIZE));
+}
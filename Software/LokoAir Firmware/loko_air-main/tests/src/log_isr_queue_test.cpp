@@ -0,0 +1,138 @@
+#include "CppUTest/TestHarness.h"
+
+#include <bsp.h>
+#include <string>
+#include <string.h>
+
+static std::string _output;
+static bool _is_isr_context = false;
+
+static void _capture_write(const uint8_t *data, size_t size) {
+    _output.append((const char *)data, size);
+}
+
+static log_timestamp_t _get_ts(void) {
+    return 1234;
+}
+
+static bool _is_isr(void) {
+    return _is_isr_context;
+}
+
+static const log_io_t CAPTURE_IO = {
+    .write = _capture_write,
+    .get_ts = _get_ts,
+    .is_isr = _is_isr,
+};
+
+static size_t _count_lines(void) {
+    size_t count = 0;
+    for (size_t pos = _output.find(LOG_ENDLINE); pos != std::string::npos; pos = _output.find(LOG_ENDLINE, pos + 1U)) {
+        count++;
+    }
+    return count;
+}
+
+TEST_GROUP(log_isr_queue_test) {
+    void setup() {
+        _is_isr_context = false;
+        log_init(LOG_MASK_ALL, &CAPTURE_IO);
+        log_process();
+        _output.clear();
+    }
+
+    void teardown() {
+        _is_isr_context = false;
+        log_set_output_mask(LOG_MASK_OFF);
+        log_process();
+        _output.clear();
+    }
+};
+
+TEST(log_isr_queue_test, printed_by_main_loop) {
+    _is_isr_context = true;
+    log_it(LOG_MASK_INFO, "RX %d %s %lu", -3, "ab", 70000UL);
+    CHECK_EQUAL(0, _output.size());
+
+    _is_isr_context = false;
+    log_process();
+    STRCMP_EQUAL("[0001.234] RX -3 ab 70000" LOG_ENDLINE, _output.c_str());
+}
+
+TEST(log_isr_queue_test, conversions) {
+    /* 30 bytes of arguments, LOG_ISR_ARGS_SIZE keeps all of them */
+    _is_isr_context = true;
+    log_it(LOG_MASK_INFO, "%5.2f|%llu|%*d|%-4s|%%|%08x", 3.14159, 1ULL << 40, 4, -7, "s", 0xBEEFU);
+    _is_isr_context = false;
+    log_process();
+
+    STRCMP_EQUAL("[0001.234]  3.14|1099511627776|  -7|s   |%|0000beef" LOG_ENDLINE, _output.c_str());
+}
+
+TEST(log_isr_queue_test, order_is_kept) {
+    _is_isr_context = true;
+    log_it(LOG_MASK_ERROR, "From interrupt");
+    _is_isr_context = false;
+
+    log_it(LOG_MASK_INFO, "From main loop");
+
+    const size_t ISR_POS = _output.find("From interrupt");
+    CHECK_TRUE(ISR_POS != std::string::npos);
+    CHECK_TRUE(_output.find("From main loop") > ISR_POS);
+}
+
+TEST(log_isr_queue_test, full_queue_reports_dropped) {
+    _is_isr_context = true;
+    for (uint32_t i = 0; i < (LOG_ISR_QUEUE_SIZE + 3U); i++) {
+        log_it(LOG_MASK_INFO, "Byte %u", (unsigned)i);
+    }
+    _is_isr_context = false;
+    log_process();
+
+    CHECK_EQUAL(LOG_ISR_QUEUE_SIZE + 1U, _count_lines());
+    CHECK_TRUE(_output.find("Byte 0" LOG_ENDLINE) != std::string::npos);
+    CHECK_TRUE(_output.find("Byte " + std::to_string(LOG_ISR_QUEUE_SIZE)) == std::string::npos);
+    CHECK_TRUE(_output.find("3 messages of interrupts dropped") != std::string::npos);
+
+    /* The queue is free again */
+    _output.clear();
+    _is_isr_context = true;
+    log_it(LOG_MASK_INFO, "After");
+    _is_isr_context = false;
+    log_process();
+    STRCMP_EQUAL("[0001.234] After" LOG_ENDLINE, _output.c_str());
+}
+
+TEST(log_isr_queue_test, array_and_missing_arguments) {
+    uint8_t array[LOG_ISR_ARGS_SIZE + 8U];
+    memset(array, 0xAB, sizeof(array));
+
+    char string[LOG_ISR_ARGS_SIZE * 2U];
+    memset(string, 'x', sizeof(string) - 1U);
+    string[sizeof(string) - 1U] = 0;
+
+    _is_isr_context = true;
+    log_array(LOG_MASK_DEBUG, "Frame", array, sizeof(array));
+    log_it(LOG_MASK_INFO, "%s %u", string, 5U);
+    _is_isr_context = false;
+    log_process();
+
+    CHECK_TRUE(_output.find("Frame[" + std::to_string(sizeof(array)) + "]: AB") != std::string::npos);
+    CHECK_TRUE(_output.find(" AB ..." LOG_ENDLINE) != std::string::npos);
+    CHECK_TRUE(_output.find("x <?>" LOG_ENDLINE) != std::string::npos);
+}
+
+TEST(log_isr_queue_test, binary_message) {
+    _is_isr_context = true;
+    _LOG_BINARY(log_bin, LOG_MASK_WARNING, "Queue %u", 9U);
+    _is_isr_context = false;
+    CHECK_EQUAL(0, _output.size());
+
+    log_process();
+
+    const size_t FRAME_SIZE = LOG_BINARY_HEADER_SIZE + 4U + 1U;
+    CHECK_EQUAL(FRAME_SIZE, _output.size());
+    CHECK_EQUAL(LOG_BINARY_SYNC, (uint8_t)_output[0]);
+    CHECK_EQUAL(LOG_MASK_WARNING, (uint8_t)_output[8]);
+    CHECK_EQUAL(9, (uint8_t)_output[LOG_BINARY_HEADER_SIZE]);
+}
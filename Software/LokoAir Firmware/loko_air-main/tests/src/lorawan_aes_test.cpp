@@ -1,6 +1,8 @@
 #include "CppUTest/TestHarness.h"
 
+#include "Crypto/cmac.h"
 #include "Crypto/lorawan_aes.h"
+#include <bsp.h>
 #include <string.h>
 
 #include <array>
@@ -60,3 +62,184 @@ TEST(lorawan_aes_test, several_blocks) {
     STRCMP_EQUAL(text.data(), reinterpret_cast<const char *>(decrypted_text.data()));
 #endif  // AES_DEC_PREKEYED
 }
+
+/* -------------------------------------------------------------------------- */
+
+/* Known answer tests from FIPS-197, NIST SP800-38A and RFC 4493, the same suite runs against both backends */
+
+static std::vector<uint8_t> from_hex(const std::string &hex) {
+    std::vector<uint8_t> bytes;
+
+    for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+        bytes.push_back((uint8_t)std::stoul(hex.substr(i, 2), nullptr, 16));
+    }
+
+    return bytes;
+}
+
+static const std::string NIST_KEY_128 = "2b7e151628aed2a6abf7158809cf4f3c";
+static const std::string NIST_PLAIN_TEXT = "6bc1bee22e409f96e93d7e117393172a"
+                                           "ae2d8a571e03ac9c9eb76fac45af8e51"
+                                           "30c81c46a35ce411e5fbc1191a0a52ef"
+                                           "f69f2445df4f9b17ad2b417be66c3710";
+
+static void check_ecb(const std::string &key_hex, const std::string &plain_hex, const std::string &cipher_hex) {
+    std::vector<uint8_t> key = from_hex(key_hex);
+    std::vector<uint8_t> plain = from_hex(plain_hex);
+    std::vector<uint8_t> expected = from_hex(cipher_hex);
+    std::vector<uint8_t> cipher(plain.size(), 0);
+
+    lorawan_aes_context ctx;
+    CHECK_EQUAL(0, lorawan_aes_set_key(key.data(), (length_type)key.size(), &ctx));
+
+    for (size_t i = 0; i < plain.size(); i += N_BLOCK) {
+        CHECK_EQUAL(0, lorawan_aes_encrypt(&plain[i], &cipher[i], &ctx));
+    }
+
+    MEMCMP_EQUAL(expected.data(), cipher.data(), expected.size());
+}
+
+static void check_cbc(void) {
+    std::vector<uint8_t> key = from_hex(NIST_KEY_128);
+    std::vector<uint8_t> iv = from_hex("000102030405060708090a0b0c0d0e0f");
+    std::vector<uint8_t> plain = from_hex(NIST_PLAIN_TEXT);
+    std::vector<uint8_t> expected = from_hex("7649abac8119b246cee98e9b12e9197d"
+                                             "5086cb9b507219ee95db113a917678b2"
+                                             "73bed6b8e3c1743b7116e69e22229516"
+                                             "3ff1caa1681fac09120eca307586e1a7");
+    std::vector<uint8_t> cipher(plain.size(), 0);
+
+    lorawan_aes_context ctx;
+    CHECK_EQUAL(0, lorawan_aes_set_key(key.data(), (length_type)key.size(), &ctx));
+    CHECK_EQUAL(0,
+                lorawan_aes_cbc_encrypt(
+                    plain.data(), cipher.data(), (int32_t)(plain.size() / N_BLOCK), iv.data(), &ctx));
+
+    MEMCMP_EQUAL(expected.data(), cipher.data(), expected.size());
+}
+
+static void check_encrypt_256(void) {
+    std::vector<uint8_t> key = from_hex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    std::vector<uint8_t> plain = from_hex("00112233445566778899aabbccddeeff");
+    std::vector<uint8_t> expected = from_hex("8ea2b7ca516745bfeafc49904b496089");
+    std::vector<uint8_t> cipher(N_BLOCK, 0);
+    std::vector<uint8_t> o_key(key.size(), 0);
+
+    lorawan_aes_encrypt_256(plain.data(), cipher.data(), key.data(), o_key.data());
+
+    MEMCMP_EQUAL(expected.data(), cipher.data(), expected.size());
+}
+
+static void check_cmac(size_t message_size, const std::string &mac_hex) {
+    std::vector<uint8_t> key = from_hex(NIST_KEY_128);
+    std::vector<uint8_t> message = from_hex(NIST_PLAIN_TEXT);
+    std::vector<uint8_t> expected = from_hex(mac_hex);
+    std::array<uint8_t, AES_CMAC_DIGEST_LENGTH> mac = { 0 };
+
+    AES_CMAC_CTX ctx;
+    AES_CMAC_Init(&ctx);
+    AES_CMAC_SetKey(&ctx, key.data());
+    AES_CMAC_Update(&ctx, message.data(), (uint32_t)message_size);
+    AES_CMAC_Final(mac.data(), &ctx);
+
+    MEMCMP_EQUAL(expected.data(), mac.data(), expected.size());
+}
+
+static void check_all_vectors(void) {
+    /* FIPS-197 C.1, C.3 */
+    check_ecb("000102030405060708090a0b0c0d0e0f",
+              "00112233445566778899aabbccddeeff",
+              "69c4e0d86a7b0430d8cdb78070b4c55a");
+    check_ecb("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f",
+              "00112233445566778899aabbccddeeff",
+              "8ea2b7ca516745bfeafc49904b496089");
+
+    /* SP800-38A F.1.1, F.1.3, F.1.5 */
+    check_ecb(NIST_KEY_128,
+              NIST_PLAIN_TEXT,
+              "3ad77bb40d7a3660a89ecaf32466ef97"
+              "f5d3d58503b9699de785895a96fdbaaf"
+              "43b1cd7f598ece23881b00e3ed030688"
+              "7b0c785e27e8ad3f8223207104725dd4");
+    check_ecb("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b",
+              "6bc1bee22e409f96e93d7e117393172a",
+              "bd334f1d6e45f25ff712a214571fa5cc");
+    check_ecb("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",
+              "6bc1bee22e409f96e93d7e117393172a",
+              "f3eed1bdb5d2a03c064b5a7e3db181f8");
+
+    /* SP800-38A F.2.1 */
+    check_cbc();
+
+    check_encrypt_256();
+
+    /* RFC 4493 examples 1-4 */
+    check_cmac(0, "bb1d6929e95937287fa37d129b756746");
+    check_cmac(16, "070a16b46b4d4144f79bdd9dd04a287c");
+    check_cmac(40, "dfa66747de9ae63030ca32611497c827");
+    check_cmac(64, "51f0bebf7e3b9d92fc49741779363cfe");
+}
+
+/* -------------------------------------------------------------------------- */
+
+TEST_GROUP(lorawan_aes_soft_test) {
+    void setup() final {
+        bsp_fake_aes_reset();
+        lorawan_aes_set_backend(NULL);
+    }
+
+    void teardown() final {
+        // nothing to do
+    }
+};
+
+TEST(lorawan_aes_soft_test, test_vectors) {
+    check_all_vectors();
+    CHECK_EQUAL(0, bsp_fake_aes_get_block_count());
+}
+
+/* -------------------------------------------------------------------------- */
+
+TEST_GROUP(lorawan_aes_hw_test) {
+    void setup() final {
+        bsp_fake_aes_reset();
+        lorawan_aes_set_backend(bsp_aes_encrypt_block);
+    }
+
+    void teardown() final {
+        lorawan_aes_set_backend(NULL);
+    }
+};
+
+TEST(lorawan_aes_hw_test, test_vectors) {
+    check_all_vectors();
+    CHECK(bsp_fake_aes_get_block_count() > 0);
+}
+
+TEST(lorawan_aes_hw_test, key_192_bit_in_software) {
+    check_ecb("8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b",
+              "6bc1bee22e409f96e93d7e117393172a",
+              "bd334f1d6e45f25ff712a214571fa5cc");
+    CHECK_EQUAL(0, bsp_fake_aes_get_block_count());
+}
+
+TEST(lorawan_aes_hw_test, software_fallback_on_failure) {
+    bsp_fake_aes_set_fail(true);
+    check_all_vectors();
+    CHECK_EQUAL(0, bsp_fake_aes_get_block_count());
+}
+
+TEST(lorawan_aes_hw_test, backend_removed_after_set_key) {
+    std::vector<uint8_t> key = from_hex(NIST_KEY_128);
+    std::vector<uint8_t> plain = from_hex("6bc1bee22e409f96e93d7e117393172a");
+    std::vector<uint8_t> expected = from_hex("3ad77bb40d7a3660a89ecaf32466ef97");
+    std::vector<uint8_t> cipher(N_BLOCK, 0);
+
+    lorawan_aes_context ctx;
+    CHECK_EQUAL(0, lorawan_aes_set_key(key.data(), (length_type)key.size(), &ctx));
+    lorawan_aes_set_backend(NULL);
+
+    CHECK_EQUAL(0, lorawan_aes_encrypt(plain.data(), cipher.data(), &ctx));
+    MEMCMP_EQUAL(expected.data(), cipher.data(), expected.size());
+    CHECK_EQUAL(0, bsp_fake_aes_get_block_count());
+}
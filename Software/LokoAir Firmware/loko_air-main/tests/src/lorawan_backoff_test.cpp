@@ -0,0 +1,125 @@
+#include "CppUTest/TestHarness.h"
+
+#include <algorithm>
+#include <bsp.h>
+#include <lorawan_backoff/lorawan_backoff.h>
+#include <rtc_backup_layout.h>
+
+static const uint32_t WAKEUP_PERIOD_S = 600;
+static const uint32_t RANDOM_MIDDLE = 0x7FFFFFFFUL;
+
+TEST_GROUP(lorawan_backoff_test) {
+    void setup() {
+        bsp_fake_rtc_store_clear();
+        lorawan_backoff_init(false);
+    }
+
+    void teardown() {
+    }
+
+    /* Shutdown for the wakeup period and the timer wakeup */
+    void sleep(uint32_t sleep_s) {
+        lorawan_backoff_prepare_to_shutdown(sleep_s);
+        lorawan_backoff_init(true);
+    }
+
+    lorawan_backoff_state_t get_state() {
+        lorawan_backoff_state_t state;
+        lorawan_backoff_get_state(&state);
+        return state;
+    }
+};
+
+TEST(lorawan_backoff_test, send_without_failures) {
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_SEND, lorawan_backoff_get_action());
+
+    lorawan_backoff_on_success();
+    sleep(WAKEUP_PERIOD_S);
+
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_SEND, lorawan_backoff_get_action());
+    CHECK_EQUAL(0, get_state().fail_count);
+}
+
+TEST(lorawan_backoff_test, exponential_wait_with_limit) {
+    const uint32_t EXPECTED_S[] = { 900, 1800, 3600, 7200, 14400, 21600, 21600 };
+
+    for (size_t i = 0; i < sizeof(EXPECTED_S) / sizeof(EXPECTED_S[0]); i++) {
+        const uint32_t JITTER_S = (EXPECTED_S[i] * LORAWAN_BACKOFF_JITTER_PERCENT) / 100U;
+
+        lorawan_backoff_on_failure(JITTER_S);
+        CHECK_EQUAL(i + 1U, get_state().fail_count);
+        CHECK_EQUAL(EXPECTED_S[i], get_state().wait_s);
+    }
+}
+
+TEST(lorawan_backoff_test, jitter_range) {
+    uint32_t min_s = UINT32_MAX;
+    uint32_t max_s = 0;
+
+    for (uint32_t random = 0; random < 1000; random++) {
+        lorawan_backoff_reset();
+        lorawan_backoff_on_failure(random * 7919U);
+        min_s = std::min(min_s, get_state().wait_s);
+        max_s = std::max(max_s, get_state().wait_s);
+    }
+
+    CHECK_EQUAL(LORAWAN_BACKOFF_BASE_S * 3U / 4U, min_s);
+    CHECK_EQUAL(LORAWAN_BACKOFF_BASE_S * 5U / 4U, max_s);
+}
+
+TEST(lorawan_backoff_test, skip_until_wait_expired) {
+    lorawan_backoff_on_failure(RANDOM_MIDDLE);
+    const uint32_t WAIT_S = get_state().wait_s;
+
+    uint32_t skipped = 0;
+    while (lorawan_backoff_get_action() == LORAWAN_BACKOFF_ACTION_SKIP) {
+        sleep(WAKEUP_PERIOD_S);
+        skipped++;
+    }
+
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_PROBE, lorawan_backoff_get_action());
+    CHECK_EQUAL((WAIT_S + WAKEUP_PERIOD_S - 1U) / WAKEUP_PERIOD_S, skipped);
+
+    lorawan_backoff_on_success();
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_SEND, lorawan_backoff_get_action());
+    CHECK_EQUAL(0, get_state().wait_s);
+}
+
+TEST(lorawan_backoff_test, button_wakeup_probes_right_away) {
+    lorawan_backoff_on_failure(RANDOM_MIDDLE);
+    sleep(WAKEUP_PERIOD_S);
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_SKIP, lorawan_backoff_get_action());
+
+    lorawan_backoff_prepare_to_shutdown(WAKEUP_PERIOD_S);
+    lorawan_backoff_init(false);
+
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_PROBE, lorawan_backoff_get_action());
+    CHECK_EQUAL(1, get_state().fail_count);
+}
+
+TEST(lorawan_backoff_test, lost_backup_domain_resets_state) {
+    lorawan_backoff_on_failure(RANDOM_MIDDLE);
+    bsp_rtc_store_write_reg(RTC_BACKUP_REG_LORAWAN_BACKOFF, 0);
+
+    sleep(WAKEUP_PERIOD_S);
+
+    CHECK_EQUAL(LORAWAN_BACKOFF_ACTION_SEND, lorawan_backoff_get_action());
+    CHECK_EQUAL(0, get_state().fail_count);
+    CHECK_EQUAL(0, get_state().wait_s);
+}
+
+/* A device in a basement with the 10 minutes wakeup period, the radio is used a few times a day */
+TEST(lorawan_backoff_test, day_without_coverage) {
+    uint32_t attempts = 0;
+
+    for (uint32_t elapsed_s = 0; elapsed_s < 24U * 3600U; elapsed_s += WAKEUP_PERIOD_S) {
+        if (lorawan_backoff_get_action() != LORAWAN_BACKOFF_ACTION_SKIP) {
+            lorawan_backoff_on_failure(elapsed_s * 2654435761UL);
+            attempts++;
+        }
+        sleep(WAKEUP_PERIOD_S);
+    }
+
+    CHECK_TRUE(attempts <= 10U);
+    CHECK_TRUE(attempts >= 5U);
+}
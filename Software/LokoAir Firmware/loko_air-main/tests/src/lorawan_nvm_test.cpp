@@ -0,0 +1,230 @@
+#include "CppUTest/TestHarness.h"
+
+#include <algorithm>
+#include <bsp.h>
+#include <lorawan_nvm.h>
+#include <random>
+#include <string.h>
+
+/* LoRaMacNvmData_t sized context, every group ends with its CRC like in the stack */
+#define CONTEXT_SIZE        (1512U)
+#define CRYPTO_FCNT_UP      (12U)
+#define CRYPTO_CRC          (36U)
+#define MAC_GROUP1_ADR_ACK  (48U)
+#define MAC_GROUP1_CRC      (76U)
+#define MAC_GROUP2_START    (80U)
+#define MAC_GROUP2_CRC      (340U)
+#define REGION_GROUP1_START (564U)
+#define REGION_GROUP1_CRC   (580U)
+
+#define HOURS_PER_YEAR   (24U * 365U)
+#define SIMULATED_YEARS  (10U)
+#define FLASH_ENDURANCE  (10000U) /*<! Page erase cycles */
+#define FLASH_PAGE_COUNT (4U)
+
+static uint8_t _context[CONTEXT_SIZE];
+
+static void _put_u32(size_t offset, uint32_t value) {
+    memcpy(&_context[offset], &value, sizeof(value));
+}
+
+static uint32_t _get_u32(size_t offset) {
+    uint32_t value;
+    memcpy(&value, &_context[offset], sizeof(value));
+    return value;
+}
+
+static uint32_t _group_crc(size_t start, size_t end) {
+    uint32_t crc = 0x811C9DC5UL;
+    for (size_t i = start; i < end; i++) {
+        crc = (crc ^ _context[i]) * 0x01000193UL;
+    }
+    return crc;
+}
+
+/* An uplink increments the frame counter and the ADR acknowledge counter, the downlinks reset the last one */
+static void _uplink(std::mt19937 &rng) {
+    _put_u32(CRYPTO_FCNT_UP, _get_u32(CRYPTO_FCNT_UP) + 1U);
+    _put_u32(CRYPTO_CRC, _group_crc(0, CRYPTO_CRC));
+
+    _put_u32(MAC_GROUP1_ADR_ACK, ((rng() % 8U) == 0) ? 0 : (_get_u32(MAC_GROUP1_ADR_ACK) + 1U));
+    _put_u32(MAC_GROUP1_CRC, _group_crc(40, MAC_GROUP1_CRC));
+
+    /* Band time credits */
+    if ((rng() % 4U) == 0) {
+        _put_u32(REGION_GROUP1_START, (uint32_t)rng());
+        _put_u32(REGION_GROUP1_CRC, _group_crc(REGION_GROUP1_START, REGION_GROUP1_CRC));
+    }
+
+    /* Channels and datarate of a LinkADRReq */
+    if ((rng() % 500U) == 0) {
+        for (size_t i = MAC_GROUP2_START; i < MAC_GROUP2_CRC; i += 4) {
+            _put_u32(i, (uint32_t)rng());
+        }
+        _put_u32(MAC_GROUP2_CRC, _group_crc(MAC_GROUP2_START, MAC_GROUP2_CRC));
+    }
+}
+
+static void _check_load(void) {
+    lorawan_nvm_t nvm;
+    uint8_t context[CONTEXT_SIZE];
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_load(&nvm, context, sizeof(context)));
+    MEMCMP_EQUAL(_context, context, sizeof(context));
+}
+
+TEST_GROUP(lorawan_nvm_test) {
+    lorawan_nvm_t nvm;
+
+    void setup() {
+        bsp_fake_flash_lorawan_nvm_reset();
+
+        std::mt19937 rng(1);
+        for (auto &byte : _context) {
+            byte = (uint8_t)rng();
+        }
+        _put_u32(CRYPTO_FCNT_UP, 0);
+        _put_u32(MAC_GROUP1_ADR_ACK, 0);
+
+        memset(&nvm, 0, sizeof(nvm));
+    }
+
+    void teardown() {
+        bsp_fake_flash_lorawan_nvm_reset();
+    }
+};
+
+TEST(lorawan_nvm_test, erased_flash_has_no_context) {
+    uint8_t context[CONTEXT_SIZE];
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_NO_CONTEXT, lorawan_nvm_load(&nvm, context, sizeof(context)));
+}
+
+TEST(lorawan_nvm_test, store_and_load) {
+    uint8_t context[CONTEXT_SIZE];
+    std::mt19937 rng(2);
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_NO_CONTEXT, lorawan_nvm_load(&nvm, context, sizeof(context)));
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    _check_load();
+
+    _uplink(rng);
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    CHECK_EQUAL(1, nvm.record_count);
+    _check_load();
+
+    /* Larger context of another firmware version is not restored */
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_NO_CONTEXT, lorawan_nvm_load(&nvm, context, LORAWAN_NVM_CONTEXT_MAX_SIZE));
+}
+
+TEST(lorawan_nvm_test, unchanged_context_is_not_written) {
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+
+    const size_t OFFSET = nvm.offset;
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_UNCHANGED, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    CHECK_EQUAL(OFFSET, nvm.offset);
+    CHECK_EQUAL(1, bsp_fake_flash_lorawan_nvm_get_erase_count(nvm.page));
+}
+
+TEST(lorawan_nvm_test, pages_are_rotated) {
+    std::mt19937 rng(3);
+
+    for (size_t i = 0; i < 1000; i++) {
+        _uplink(rng);
+        CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    }
+
+    _check_load();
+
+    size_t min_erases = SIZE_MAX;
+    size_t max_erases = 0;
+    for (size_t page = 0; page < FLASH_PAGE_COUNT; page++) {
+        min_erases = std::min(min_erases, bsp_fake_flash_lorawan_nvm_get_erase_count(page));
+        max_erases = std::max(max_erases, bsp_fake_flash_lorawan_nvm_get_erase_count(page));
+    }
+
+    CHECK_TRUE(min_erases > 0);
+    CHECK_TRUE((max_erases - min_erases) <= 1U);
+}
+
+TEST(lorawan_nvm_test, torn_record_keeps_previous_context) {
+    std::mt19937 rng(4);
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    _uplink(rng);
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+
+    /* Power lost after the first double word of the next record */
+    const uint8_t TORN[8] = { 20, 0, 0x12, 0x34, 0x0C, 0x00, 0x04, 0x55 };
+    bsp_flash_lorawan_nvm_write(nvm.page * bsp_flash_get_lorawan_nvm_page_size() + nvm.offset, TORN, sizeof(TORN));
+
+    _check_load();
+
+    lorawan_nvm_t restored;
+    uint8_t context[CONTEXT_SIZE];
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_load(&restored, context, sizeof(context)));
+    CHECK_EQUAL(1, restored.record_count);
+
+    /* The torn page is not appended anymore */
+    _uplink(rng);
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&restored, _context, sizeof(_context)));
+    CHECK_EQUAL((nvm.page + 1U) % FLASH_PAGE_COUNT, restored.page);
+    CHECK_EQUAL(0, restored.record_count);
+    CHECK_EQUAL(0, bsp_fake_flash_lorawan_nvm_get_overwrite_count());
+
+    _check_load();
+}
+
+TEST(lorawan_nvm_test, torn_snapshot_keeps_previous_page) {
+    std::mt19937 rng(5);
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+    _uplink(rng);
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+
+    /* Power lost before the header of the next snapshot */
+    const size_t NEXT_PAGE = (nvm.page + 1U) % FLASH_PAGE_COUNT;
+    bsp_flash_lorawan_nvm_erase_page(NEXT_PAGE);
+    bsp_flash_lorawan_nvm_write(NEXT_PAGE * bsp_flash_get_lorawan_nvm_page_size() + 8U, _context, 256U);
+
+    _check_load();
+}
+
+TEST(lorawan_nvm_test, years_of_hourly_uplinks) {
+    std::mt19937 rng(6);
+    size_t snapshots = 0;
+
+    CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+
+    for (size_t hour = 0; hour < (SIMULATED_YEARS * HOURS_PER_YEAR); hour++) {
+        const uint32_t SEQUENCE = nvm.sequence;
+
+        _uplink(rng);
+        CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_store(&nvm, _context, sizeof(_context)));
+        snapshots += (nvm.sequence != SEQUENCE) ? 1U : 0;
+
+        /* The device restores the context after every wakeup, checking it daily keeps the test fast */
+        if ((hour % 24U) == 0) {
+            uint8_t context[CONTEXT_SIZE];
+            CHECK_EQUAL(LORAWAN_NVM_RESULT_OK, lorawan_nvm_load(&nvm, context, sizeof(context)));
+            MEMCMP_EQUAL(_context, context, sizeof(context));
+        }
+    }
+
+    _check_load();
+    CHECK_EQUAL(0, bsp_fake_flash_lorawan_nvm_get_overwrite_count());
+
+    size_t max_erases = 0;
+    for (size_t page = 0; page < FLASH_PAGE_COUNT; page++) {
+        max_erases = std::max(max_erases, bsp_fake_flash_lorawan_nvm_get_erase_count(page));
+    }
+
+    printf("\nlorawan_nvm %u years of hourly uplinks, %u stores, %u snapshots, max %u erases of a page",
+           SIMULATED_YEARS,
+           SIMULATED_YEARS * HOURS_PER_YEAR,
+           (unsigned)snapshots,
+           (unsigned)max_erases);
+
+    CHECK_TRUE(max_erases < (FLASH_ENDURANCE / 2U));
+}
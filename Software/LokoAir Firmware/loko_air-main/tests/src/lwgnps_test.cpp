@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include <lwgps.h>
+#include <stats/stats.h>
 
 TEST_GROUP(lwgnps_test) {
     lwgps_t lwgps;
@@ -77,3 +78,17 @@ TEST(lwgnps_test, test_GPGSA) {
     // CHECK_EQUAL(1.9, lwgps.dop_v);
     CHECK_EQUAL(2.5f, lwgps.dop_p);
 }
+
+TEST(lwgnps_test, crc_counters) {
+    stats_reset();
+
+    char good[] = "$GPGGA,202530.00,5109.0262,N,11401.8407,W,5,40,0.5,1097.36,M,-17.00,M,18,TSTR*61\r\n";
+    lwgps_process(&lwgps, good, strlen(good));
+
+    char broken[] = "$GPGGA,202530.00,5109.0262,N,11401.8407,W,5,40,0.5,1097.37,M,-17.00,M,18,TSTR*61\r\n";
+    lwgps_process(&lwgps, broken, strlen(broken));
+
+    CHECK_EQUAL(1, stats_get(STATS_COUNTER_NMEA_SENTENCES));
+    CHECK_EQUAL(1, stats_get(STATS_COUNTER_NMEA_CRC_ERRORS));
+    CHECK_EQUAL(1097.36, lwgps.altitude);
+}
@@ -0,0 +1,185 @@
+#include "CppUTest/TestHarness.h"
+
+#include <crc16.h>
+#include <lz_image.h>
+#include <string.h>
+#include <vector>
+
+static std::vector<uint8_t> unpacked;
+static bool is_chunk_aligned = true;
+
+static void output(void *user, size_t offset, uint8_t const *data, size_t size) {
+    (void)user;
+    is_chunk_aligned = is_chunk_aligned && (offset == unpacked.size()) && ((offset % LZ_IMAGE_WINDOW_SIZE) == 0);
+    unpacked.insert(unpacked.end(), data, data + size);
+}
+
+/* Greedy reference packer, the same format as tools/image_packer */
+static std::vector<uint8_t> pack(std::vector<uint8_t> const &data) {
+    std::vector<uint8_t> payload;
+    size_t pos = 0;
+
+    while (pos < data.size()) {
+        size_t flags_pos = payload.size();
+        payload.push_back(0);
+
+        for (uint8_t bit = 0; (bit < 8) && (pos < data.size()); bit++) {
+            size_t best_len = 0;
+            size_t best_offset = 0;
+            size_t max_len = std::min((size_t)LZ_IMAGE_MATCH_MAX, data.size() - pos);
+
+            for (size_t offset = 1; (offset <= LZ_IMAGE_WINDOW_SIZE) && (offset <= pos); offset++) {
+                size_t len = 0;
+                while ((len < max_len) && (data[pos - offset + len] == data[pos + len])) {
+                    len++;
+                }
+                if (len > best_len) {
+                    best_len = len;
+                    best_offset = offset;
+                }
+            }
+
+            if (best_len >= LZ_IMAGE_MATCH_MIN) {
+                uint16_t token = (uint16_t)(((best_offset - 1) << 5) | (best_len - LZ_IMAGE_MATCH_MIN));
+                payload.push_back((uint8_t)(token >> 8));
+                payload.push_back((uint8_t)token);
+                pos += best_len;
+            } else {
+                payload[flags_pos] |= (uint8_t)(1U << bit);
+                payload.push_back(data[pos]);
+                pos++;
+            }
+        }
+    }
+
+    uint32_t header_words[] = { LZ_IMAGE_MAGIC, (uint32_t)data.size(), (uint32_t)payload.size() };
+    std::vector<uint8_t> container(sizeof(header_words));
+    memcpy(container.data(), header_words, sizeof(header_words));
+
+    uint16_t image_crc = crc16_ccitt(data.data(), (uint32_t)data.size(), CRC16_CCITT_INIT_VAL);
+    container.push_back((uint8_t)image_crc);
+    container.push_back((uint8_t)(image_crc >> 8));
+
+    uint16_t header_crc = crc16_ccitt(container.data(), (uint32_t)container.size(), CRC16_CCITT_INIT_VAL);
+    container.push_back((uint8_t)header_crc);
+    container.push_back((uint8_t)(header_crc >> 8));
+
+    container.insert(container.end(), payload.begin(), payload.end());
+    return container;
+}
+
+TEST_GROUP(lz_image_test) {
+    lz_image_t ctx;
+
+    void setup() {
+        unpacked.clear();
+        is_chunk_aligned = true;
+        lz_image_init(&ctx, output, nullptr);
+    }
+
+    void teardown() {
+    }
+
+    /* Firmware-like data: repeated structures with small changes and a few random areas */
+    std::vector<uint8_t> get_image(size_t size) {
+        std::vector<uint8_t> image(size);
+        uint32_t x = 0x1234;
+        for (size_t i = 0; i < size; i++) {
+            x = x * 1103515245U + 12345U;
+            image[i] = ((i / 512) % 3 == 0) ? (uint8_t)(x >> 16) : (uint8_t)((i % 64) ^ ((i / 64) & 0x7));
+        }
+        return image;
+    }
+
+    lz_image_result_t feed(std::vector<uint8_t> const &container, size_t chunk) {
+        lz_image_result_t result = LZ_IMAGE_RESULT_IN_PROGRESS;
+        for (size_t offset = 0; offset < container.size(); offset += chunk) {
+            result = lz_image_feed(&ctx, &container[offset], std::min(chunk, container.size() - offset));
+        }
+        return result;
+    }
+};
+
+TEST(lz_image_test, packer_tool_vector) {
+    /* tools/image_packer/image_packer.py output for "Loko Loko Loko Loko bootloader image!" */
+    const std::vector<uint8_t> container = { 0x4c, 0x4b, 0x5a, 0x31, 0x25, 0x00, 0x00, 0x00, 0x1b, 0x00, 0x00, 0x00,
+                                             0xc4, 0x8b, 0x40, 0x02, 0xdf, 0x4c, 0x6f, 0x6b, 0x6f, 0x20, 0x00, 0x8c,
+                                             0x62, 0x6f, 0xff, 0x6f, 0x74, 0x6c, 0x6f, 0x61, 0x64, 0x65, 0x72, 0x7f,
+                                             0x20, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x21 };
+    const char expected[] = "Loko Loko Loko Loko bootloader image!";
+
+    CHECK_EQUAL(LZ_IMAGE_RESULT_DONE, feed(container, container.size()));
+    CHECK_EQUAL(strlen(expected), lz_image_get_size(&ctx));
+    CHECK_EQUAL(strlen(expected), unpacked.size());
+    MEMCMP_EQUAL(expected, unpacked.data(), unpacked.size());
+}
+
+TEST(lz_image_test, roundtrip_chunks) {
+    std::vector<uint8_t> image = get_image(3 * LZ_IMAGE_WINDOW_SIZE + 333);
+    std::vector<uint8_t> container = pack(image);
+    CHECK(container.size() < image.size());
+
+    const size_t CHUNKS[] = { 1, 7, 256, 2048, container.size() };
+
+    for (size_t chunk : CHUNKS) {
+        setup();
+        CHECK_EQUAL(LZ_IMAGE_RESULT_DONE, feed(container, chunk));
+        CHECK(unpacked == image);
+        CHECK(is_chunk_aligned);
+    }
+}
+
+TEST(lz_image_test, window_exact_multiple) {
+    std::vector<uint8_t> image = get_image(2 * LZ_IMAGE_WINDOW_SIZE);
+    CHECK_EQUAL(LZ_IMAGE_RESULT_DONE, feed(pack(image), 100));
+    CHECK(unpacked == image);
+}
+
+TEST(lz_image_test, empty_image) {
+    CHECK_EQUAL(LZ_IMAGE_RESULT_DONE, feed(pack({}), 16));
+    CHECK_EQUAL(0, unpacked.size());
+}
+
+TEST(lz_image_test, padding_ignored) {
+    std::vector<uint8_t> image = get_image(1000);
+    std::vector<uint8_t> container = pack(image);
+    container.insert(container.end(), 3, 0xFF);
+
+    CHECK_EQUAL(LZ_IMAGE_RESULT_DONE, feed(container, 256));
+    CHECK(unpacked == image);
+}
+
+TEST(lz_image_test, bad_header) {
+    std::vector<uint8_t> container = pack(get_image(1000));
+    container[0] ^= 0x01;
+    CHECK_EQUAL(LZ_IMAGE_RESULT_ERROR, feed(container, 64));
+
+    setup();
+    container = pack(get_image(1000));
+    container[5] ^= 0x01;
+    CHECK_EQUAL(LZ_IMAGE_RESULT_ERROR, feed(container, 64));
+    CHECK_EQUAL(0, unpacked.size());
+}
+
+TEST(lz_image_test, corrupted_payload) {
+    std::vector<uint8_t> image = get_image(5000);
+    std::vector<uint8_t> container = pack(image);
+    container[container.size() - 10] ^= 0x40;
+
+    CHECK_EQUAL(LZ_IMAGE_RESULT_ERROR, feed(container, 64));
+}
+
+TEST(lz_image_test, match_before_image_start) {
+    std::vector<uint8_t> container = pack({ 'a', 'b', 'c', 'd' });
+
+    /* First item is a match with offset 1 */
+    container[LZ_IMAGE_HEADER_SIZE] = 0x00;
+    CHECK_EQUAL(LZ_IMAGE_RESULT_ERROR, feed(container, container.size()));
+}
+
+TEST(lz_image_test, truncated) {
+    std::vector<uint8_t> container = pack(get_image(5000));
+    container.resize(container.size() - 1);
+
+    CHECK_EQUAL(LZ_IMAGE_RESULT_IN_PROGRESS, feed(container, 64));
+}
@@ -0,0 +1,81 @@
+#include "CppUTest/TestHarness.h"
+
+#include <bsp.h>
+#include <gnss_trace/gnss_trace.h>
+#include <profile/profile.h>
+#include <string.h>
+
+static void _measure(uint32_t cycles) {
+    PROFILE_BEGIN(PROFILE_SCOPE_LWGPS_PROCESS);
+    bsp_fake_forward_cycles(cycles);
+    PROFILE_END(PROFILE_SCOPE_LWGPS_PROCESS);
+}
+
+TEST_GROUP(profile_test) {
+    void setup() {
+        profile_init();
+    }
+};
+
+TEST(profile_test, empty) {
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_AES_BLOCK, &stats);
+
+    CHECK_EQUAL(0, stats.count);
+    CHECK_EQUAL(0, stats.min_cycles);
+    CHECK_EQUAL(0, stats.max_cycles);
+    CHECK_EQUAL(0, profile_get_avg(&stats));
+}
+
+TEST(profile_test, min_max_avg) {
+    _measure(120);
+    _measure(40);
+    _measure(500);
+
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_LWGPS_PROCESS, &stats);
+
+    CHECK_EQUAL(3, stats.count);
+    CHECK_EQUAL(40, stats.min_cycles);
+    CHECK_EQUAL(500, stats.max_cycles);
+    CHECK_EQUAL(660, stats.total_cycles);
+    CHECK_EQUAL(220, profile_get_avg(&stats));
+
+    profile_get(PROFILE_SCOPE_GTRACE_ADD, &stats);
+    CHECK_EQUAL(0, stats.count);
+}
+
+TEST(profile_test, counter_wraps_around) {
+    bsp_fake_forward_cycles(UINT32_MAX - 10U);
+    _measure(25);
+
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_LWGPS_PROCESS, &stats);
+    CHECK_EQUAL(25, stats.max_cycles);
+}
+
+TEST(profile_test, instrumented_code) {
+    gtrace_t gtrace;
+    gtrace_init(&gtrace);
+    gtrace_erase_all(&gtrace);
+
+    gtrace_record_t record;
+    memset(&record, 0x55, sizeof(record));
+    CHECK_EQUAL(GTRACE_RESULT_OK, gtrace_add(&gtrace, &record));
+    CHECK_EQUAL(GTRACE_RESULT_OK, gtrace_add(&gtrace, &record));
+
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_GTRACE_ADD, &stats);
+    CHECK_EQUAL(2, stats.count);
+}
+
+TEST(profile_test, reset) {
+    _measure(7);
+    profile_reset();
+
+    profile_stats_t stats;
+    profile_get(PROFILE_SCOPE_LWGPS_PROCESS, &stats);
+    CHECK_EQUAL(0, stats.count);
+    STRCMP_EQUAL("lwgps_process", profile_get_name(PROFILE_SCOPE_LWGPS_PROCESS));
+    STRCMP_EQUAL("", profile_get_name(PROFILE_SCOPE_COUNT));
+}
@@ -0,0 +1,58 @@
+#include "CppUTest/TestHarness.h"
+
+#include <stats/stats.h>
+#include <string.h>
+
+TEST_GROUP(stats_test) {
+    void setup() {
+        stats_reset();
+    }
+};
+
+TEST(stats_test, inc_and_add) {
+    stats_inc(STATS_COUNTER_RADIO_TX);
+    stats_inc(STATS_COUNTER_RADIO_TX);
+    stats_add(STATS_COUNTER_RADIO_TX_MS, 1500);
+    stats_add(STATS_COUNTER_RADIO_TX_MS, 25);
+
+    CHECK_EQUAL(2, stats_get(STATS_COUNTER_RADIO_TX));
+    CHECK_EQUAL(1525, stats_get(STATS_COUNTER_RADIO_TX_MS));
+    CHECK_EQUAL(0, stats_get(STATS_COUNTER_RADIO_TX_ERRORS));
+}
+
+TEST(stats_test, high_water_mark) {
+    stats_max(STATS_COUNTER_GNSS_RX_PEAK, 10);
+    stats_max(STATS_COUNTER_GNSS_RX_PEAK, 200);
+    stats_max(STATS_COUNTER_GNSS_RX_PEAK, 30);
+
+    CHECK_EQUAL(200, stats_get(STATS_COUNTER_GNSS_RX_PEAK));
+}
+
+TEST(stats_test, wrap_around) {
+    stats_add(STATS_COUNTER_FLASH_PROGRAMS, UINT32_MAX);
+    stats_add(STATS_COUNTER_FLASH_PROGRAMS, 3);
+
+    CHECK_EQUAL(2, stats_get(STATS_COUNTER_FLASH_PROGRAMS));
+}
+
+TEST(stats_test, reset) {
+    for (size_t i = 0; i < STATS_COUNTER_COUNT; i++) {
+        stats_inc((stats_counter_t)i);
+    }
+    stats_reset();
+
+    for (size_t i = 0; i < STATS_COUNTER_COUNT; i++) {
+        CHECK_EQUAL(0, stats_get((stats_counter_t)i));
+    }
+}
+
+TEST(stats_test, names) {
+    for (size_t i = 0; i < STATS_COUNTER_COUNT; i++) {
+        CHECK_TRUE(stats_get_name((stats_counter_t)i) != NULL);
+        CHECK_TRUE(strlen(stats_get_name((stats_counter_t)i)) > 0);
+    }
+
+    STRCMP_EQUAL("nmea_crc_errors", stats_get_name(STATS_COUNTER_NMEA_CRC_ERRORS));
+    STRCMP_EQUAL("", stats_get_name(STATS_COUNTER_COUNT));
+    CHECK_EQUAL(0, stats_get(STATS_COUNTER_COUNT));
+}
@@ -1,6 +1,8 @@
 #include "CppUTest/TestHarness.h"
 
 #include "stm32_bootloader_host_protocol.h"
+#include <crc16.h>
+#include <stdio.h>
 #include <string.h>
 #include <vector>
 
@@ -17,7 +19,9 @@ std::vector<uint8_t> response(256);
 TEST_GROUP(stm32_bootloader_host_test_exchange) {
 
     stm32_bootloader_context_t context;
-    stm32_bootloader_io_t io = { serial_out, read_mem, write_mem, erase_page, goto_addr };
+    stm32_bootloader_io_t io = {
+        serial_out, read_mem, write_mem, erase_page, goto_addr, nullptr, nullptr, nullptr, 0, nullptr,
+    };
     void setup() final {
         response.clear();
         CHECK_EQUAL(STM32_BOOTLOADER_RESULT_OK, stm32_bootloader_host_protocol_init(&context, &io));
@@ -240,6 +244,15 @@ TEST(stm32_bootloader_host_test_exchange, get_checksum_command_unsupported) {
     CHECK(check_response("\x1F"));
 }
 
+TEST(stm32_bootloader_host_test_exchange, ext_commands_unsupported_without_io) {
+    _SEND("\xB0\x4F");
+    CHECK(check_response("\x1F"));
+    _SEND("\xB1\x4E");
+    CHECK(check_response("\x1F"));
+    _SEND("\xB2\x4D");
+    CHECK(check_response("\x1F"));
+}
+
 TEST(stm32_bootloader_host_test_exchange, get_version_command_ok) {
     _SEND("\x01\xFE");
     CHECK(check_response("\x79\x10\x00\x00\x79"));
@@ -366,3 +379,430 @@ TEST(stm32_bootloader_host_test_init, init_args) {
     io.goto_addr = goto_addr;
     CHECK_EQUAL(STM32_BOOTLOADER_RESULT_OK, stm32_bootloader_host_protocol_init(&context, &io));
 }
+
+static const size_t FLASH_BASE_ADDR = 0x08008000;
+static const size_t FLASH_PAGE_SIZE = 2048;
+static const size_t FLASH_PAGE_COUNT = 96;
+static const uint32_t ST_BAUD = 115200;
+static const uint32_t USART_CLOCK_HZ = 16000000; /* Bootloader core clock, USART1 runs from it */
+
+static std::vector<uint8_t> flash(FLASH_PAGE_SIZE * FLASH_PAGE_COUNT);
+static size_t flash_erased_pages = 0;
+static size_t flash_not_erased_writes = 0;
+static uint32_t serial_baud = ST_BAUD;
+static uint32_t ticks_ms = 0;
+
+TEST_GROUP(stm32_bootloader_host_test_ext) {
+
+    stm32_bootloader_context_t context;
+    stm32_bootloader_io_t io = {
+        serial_out, read_mem,      write_mem,       erase_page, goto_addr, is_baud_valid,
+        set_baud,   erase_page_at, FLASH_PAGE_SIZE, get_ticks,
+    };
+
+    /* Host side link statistics, a turnaround is a host wait for the device answer */
+    size_t tx_bytes;
+    size_t rx_bytes;
+    size_t turnarounds;
+
+    void setup() final {
+        response.clear();
+        std::fill(flash.begin(), flash.end(), 0x00);
+        flash_erased_pages = 0;
+        flash_not_erased_writes = 0;
+        serial_baud = ST_BAUD;
+        ticks_ms = 0;
+        tx_bytes = 0;
+        rx_bytes = 0;
+        turnarounds = 0;
+        CHECK_EQUAL(STM32_BOOTLOADER_RESULT_OK, stm32_bootloader_host_protocol_init(&context, &io));
+    }
+
+    void teardown() final {
+        CHECK_EQUAL(STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND, context.state);
+        CHECK_EQUAL(0, context.received);
+    }
+
+    static void goto_addr(size_t addr) {
+        (void)addr;
+    }
+
+    static void erase_page(size_t page_number) {
+        /* The bootloader special case, any ST erase clears the whole application */
+        (void)page_number;
+        std::fill(flash.begin(), flash.end(), 0xFF);
+        flash_erased_pages += FLASH_PAGE_COUNT;
+    }
+
+    static void erase_page_at(size_t addr) {
+        size_t offset = addr - FLASH_BASE_ADDR;
+        std::fill(&flash[offset], &flash[offset] + FLASH_PAGE_SIZE, 0xFF);
+        flash_erased_pages++;
+    }
+
+    static void write_mem(size_t addr, uint8_t const *byte, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            uint8_t *cell = &flash[addr - FLASH_BASE_ADDR + i];
+            flash_not_erased_writes += (*cell != 0xFF) ? 1 : 0;
+            *cell = byte[i];
+        }
+    }
+
+    static void read_mem(size_t addr, uint8_t * byte, size_t size) {
+        memcpy(byte, &flash[addr - FLASH_BASE_ADDR], size);
+    }
+
+    static void serial_out(uint8_t const *byte, size_t size) {
+        response.insert(response.end(), byte, byte + size);
+    }
+
+    /* Same divider error check as bsp_uart_debug_is_baudrate_valid() */
+    static bool is_baud_valid(uint32_t baud) {
+        const uint32_t MAX_ERROR_PPM = 20000;
+
+        if ((baud == 0) || (baud > (USART_CLOCK_HZ / 16))) {
+            return false;
+        }
+
+        const uint32_t DIVIDER = (USART_CLOCK_HZ + (baud / 2)) / baud;
+        const uint32_t ACTUAL = USART_CLOCK_HZ / DIVIDER;
+        const uint32_t DIFF = (ACTUAL > baud) ? (ACTUAL - baud) : (baud - ACTUAL);
+
+        return ((uint64_t)DIFF * 1000000U) <= ((uint64_t)baud * MAX_ERROR_PPM);
+    }
+
+    static void set_baud(uint32_t baud) {
+        serial_baud = baud;
+    }
+
+    static uint32_t get_ticks(void) {
+        return ticks_ms;
+    }
+
+    void send(std::vector<uint8_t> const &bytes) {
+        tx_bytes += bytes.size();
+        for (uint8_t byte : bytes) {
+            stm32_bootloader_host_protocol_byte_handle(&context, byte);
+        }
+    }
+
+    /* Sends and waits for the answer */
+    void exchange(std::vector<uint8_t> const &bytes) {
+        response.clear();
+        send(bytes);
+        rx_bytes += response.size();
+        turnarounds++;
+    }
+
+    static std::vector<uint8_t> with_xor(std::vector<uint8_t> bytes) {
+        uint8_t checksum = 0;
+        for (uint8_t byte : bytes) {
+            checksum ^= byte;
+        }
+        bytes.push_back(checksum);
+        return bytes;
+    }
+
+    static std::vector<uint8_t> make_frame(uint8_t seq, size_t addr, uint8_t const *data, size_t size) {
+        std::vector<uint8_t> frame = { STM32_BOOTLOADER_EXT_SYNC,
+                                       seq,
+                                       (uint8_t)(addr >> 24),
+                                       (uint8_t)(addr >> 16),
+                                       (uint8_t)(addr >> 8),
+                                       (uint8_t)addr,
+                                       (uint8_t)(size >> 8),
+                                       (uint8_t)size };
+        frame.insert(frame.end(), data, data + size);
+        uint16_t crc = crc16_ccitt(&frame[1], (uint32_t)(frame.size() - 1), CRC16_CCITT_INIT_VAL);
+        frame.push_back((uint8_t)(crc >> 8));
+        frame.push_back((uint8_t)crc);
+        return frame;
+    }
+
+    std::vector<uint8_t> get_image(size_t size) {
+        std::vector<uint8_t> image(size);
+        uint32_t x = 0xC0FFEE;
+        for (size_t i = 0; i < size; i++) {
+            x = x * 1103515245U + 12345U;
+            image[i] = (uint8_t)(x >> 16);
+        }
+        return image;
+    }
+
+    bool is_flash_equal(std::vector<uint8_t> const &image) const {
+        return std::equal(image.begin(), image.end(), flash.begin());
+    }
+
+    bool is_response(std::vector<uint8_t> const &expected) const {
+        return response == expected;
+    }
+
+    void st_flash(std::vector<uint8_t> const &image) {
+        exchange({ STM32_BOOTLOADER_CMD_ERASE, 0xBC });
+        exchange({ 0xFF, 0x00 });
+
+        for (size_t offset = 0; offset < image.size(); offset += 256) {
+            size_t addr = FLASH_BASE_ADDR + offset;
+            size_t size = std::min((size_t)256, image.size() - offset);
+            std::vector<uint8_t> data = { (uint8_t)(size - 1) };
+            data.insert(data.end(), &image[offset], &image[offset] + size);
+
+            exchange({ STM32_BOOTLOADER_CMD_WRITE_MEMORY, 0xCE });
+            exchange(with_xor({ (uint8_t)(addr >> 24), (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr }));
+            exchange(with_xor(data));
+            CHECK(is_response({ STM32_BOOTLOADER_ACK }));
+        }
+    }
+};
+
+TEST(stm32_bootloader_host_test_ext, get_caps) {
+    exchange({ STM32_BOOTLOADER_CMD_EXT_GET, 0x4F });
+    CHECK(is_response({ STM32_BOOTLOADER_ACK,
+                        STM32_BOOTLOADER_EXT_VERSION,
+                        STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX >> 8,
+                        STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX & 0xFF,
+                        STM32_BOOTLOADER_EXT_WINDOW,
+                        STM32_BOOTLOADER_ACK }));
+}
+
+TEST(stm32_bootloader_host_test_ext, set_baud) {
+    exchange({ STM32_BOOTLOADER_CMD_EXT_SET_BAUD, 0x4E });
+    exchange(with_xor({ 0x00, 0x07, 0xA1, 0x20 }));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK }));
+    CHECK_EQUAL(500000, serial_baud);
+
+    /* ST commands keep working after the switch */
+    exchange({ 0x7F });
+    CHECK(is_response({ STM32_BOOTLOADER_ACK }));
+}
+
+TEST(stm32_bootloader_host_test_ext, set_baud_rejected) {
+    exchange({ STM32_BOOTLOADER_CMD_EXT_SET_BAUD, 0x4E });
+    exchange(with_xor({ 0x00, 0x1E, 0x84, 0x80 }));
+    CHECK(is_response({ STM32_BOOTLOADER_NACK }));
+
+    /* 16 MHz / 17 is 941176 baud, 2.1% off */
+    exchange({ STM32_BOOTLOADER_CMD_EXT_SET_BAUD, 0x4E });
+    exchange(with_xor({ 0x00, 0x0E, 0x10, 0x00 }));
+    CHECK(is_response({ STM32_BOOTLOADER_NACK }));
+
+    exchange({ STM32_BOOTLOADER_CMD_EXT_SET_BAUD, 0x4E });
+    exchange({ 0x00, 0x07, 0xA1, 0x20, 0x00 });
+    CHECK(is_response({ STM32_BOOTLOADER_NACK }));
+    CHECK_EQUAL(ST_BAUD, serial_baud);
+}
+
+TEST(stm32_bootloader_host_test_ext, stream_lazy_erase) {
+    std::vector<uint8_t> image = get_image(FLASH_PAGE_SIZE * 3 + 100);
+
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+    CHECK(is_response({ STM32_BOOTLOADER_ACK }));
+    CHECK_EQUAL(STM32_BOOTLOADER_STATE_STREAM, context.state);
+
+    /* Unaligned to pages blocks, every page is erased once */
+    uint8_t seq = 0;
+    for (size_t offset = 0; offset < image.size(); offset += 1500) {
+        size_t size = std::min((size_t)1500, image.size() - offset);
+        exchange(make_frame(seq, FLASH_BASE_ADDR + offset, &image[offset], size));
+        CHECK(is_response({ STM32_BOOTLOADER_ACK, seq }));
+        seq++;
+    }
+
+    exchange(make_frame(seq, 0, nullptr, 0));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, seq }));
+
+    CHECK(is_flash_equal(image));
+    CHECK_EQUAL(4, flash_erased_pages);
+    CHECK_EQUAL(0, flash_not_erased_writes);
+}
+
+TEST(stm32_bootloader_host_test_ext, stream_go_back_on_error) {
+    std::vector<uint8_t> image = get_image(4 * 1024);
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+
+    std::vector<uint8_t> frames[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        frames[i] = make_frame(i, FLASH_BASE_ADDR + i * 1024U, &image[i * 1024U], 1024);
+    }
+
+    /* Block 1 is corrupted, blocks 2 and 3 are already in flight */
+    std::vector<uint8_t> corrupted = frames[1];
+    corrupted[100] ^= 0x01;
+
+    response.clear();
+    send(frames[0]);
+    send(corrupted);
+    send(frames[2]);
+    send(frames[3]);
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 0, STM32_BOOTLOADER_NACK, 1 }));
+
+    /* Host goes back to the expected block */
+    response.clear();
+    send(frames[1]);
+    send(frames[2]);
+    send(frames[3]);
+    send(make_frame(4, 0, nullptr, 0));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 1, STM32_BOOTLOADER_ACK, 2, STM32_BOOTLOADER_ACK, 3, STM32_BOOTLOADER_ACK,
+                        4 }));
+
+    CHECK(is_flash_equal(image));
+    CHECK_EQUAL(2, flash_erased_pages);
+}
+
+TEST(stm32_bootloader_host_test_ext, stream_nack_per_bad_retransmission) {
+    uint8_t data[64] = { 0 };
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+
+    std::vector<uint8_t> corrupted = make_frame(0, FLASH_BASE_ADDR, data, sizeof(data));
+    corrupted[20] ^= 0x01;
+
+    /* Every bad copy of the expected block is answered, the blocks in flight are not */
+    response.clear();
+    send(corrupted);
+    send(make_frame(1, FLASH_BASE_ADDR + sizeof(data), data, sizeof(data)));
+    send(corrupted);
+    CHECK(is_response({ STM32_BOOTLOADER_NACK, 0, STM32_BOOTLOADER_NACK, 0 }));
+
+    exchange(make_frame(0, FLASH_BASE_ADDR, data, sizeof(data)));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 0 }));
+
+    exchange(make_frame(1, 0, nullptr, 0));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 1 }));
+}
+
+TEST(stm32_bootloader_host_test_ext, stream_idle_timeout) {
+    uint8_t data[8] = { 0 };
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+    exchange(make_frame(0, FLASH_BASE_ADDR, data, sizeof(data)));
+
+    /* Host is gone in the middle of a block */
+    std::vector<uint8_t> frame = make_frame(1, FLASH_BASE_ADDR + sizeof(data), data, sizeof(data));
+    send(std::vector<uint8_t>(frame.begin(), frame.begin() + 5));
+
+    ticks_ms += STM32_BOOTLOADER_EXT_STREAM_TIMEOUT_MS - 1;
+    stm32_bootloader_host_protocol_poll(&context);
+    CHECK_EQUAL(STM32_BOOTLOADER_STATE_STREAM, context.state);
+
+    ticks_ms++;
+    stm32_bootloader_host_protocol_poll(&context);
+    CHECK_EQUAL(STM32_BOOTLOADER_STATE_WAIT_FOR_COMMAND, context.state);
+
+    exchange({ 0x7F });
+    CHECK(is_response({ STM32_BOOTLOADER_ACK }));
+}
+
+TEST(stm32_bootloader_host_test_ext, stream_bad_block_size_and_range) {
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+
+    /* Oversized block header is rejected right away */
+    exchange({ STM32_BOOTLOADER_EXT_SYNC, 0, 0x08, 0x00, 0x80, 0x00, 0xFF, 0xFF });
+    CHECK(is_response({ STM32_BOOTLOADER_NACK, 0 }));
+
+    uint8_t data[8] = { 0 };
+    exchange(make_frame(0, FLASH_BASE_ADDR, data, sizeof(data)));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 0 }));
+
+    /* Out of the erase map of the stream */
+    size_t far_addr = FLASH_BASE_ADDR + FLASH_PAGE_SIZE * STM32_BOOTLOADER_EXT_PAGE_MAP_SIZE * 8;
+    exchange(make_frame(1, far_addr, data, sizeof(data)));
+    CHECK(is_response({ STM32_BOOTLOADER_NACK, 1 }));
+
+    exchange(make_frame(1, 0, nullptr, 0));
+    CHECK(is_response({ STM32_BOOTLOADER_ACK, 1 }));
+}
+
+/* Simulated 100 KB image transfer: ST write commands at 115200 against the extended stream at a negotiated baud rate.
+ * The model counts the bytes on the line, the host waits for answers over a USB-UART bridge and the flash timings */
+TEST(stm32_bootloader_host_test_ext, simulated_transfer_efficiency) {
+    const double TURNAROUND_S = 0.002;
+    const double PAGE_ERASE_S = 0.023;
+    const double FLASH_WRITE_S_PER_BYTE = 0.000082 / 8;
+    const size_t IMAGE_SIZE = 100 * 1024;
+    const uint32_t EXT_BAUD = 500000;
+    const size_t BLOCK_SIZE = STM32_BOOTLOADER_EXT_BLOCK_SIZE_MAX;
+
+    std::vector<uint8_t> image = get_image(IMAGE_SIZE);
+
+    /* ST compatible transfer */
+    st_flash(image);
+    CHECK(is_flash_equal(image));
+    CHECK_EQUAL(0, flash_not_erased_writes);
+
+    const double ST_TIME_S = (double)(tx_bytes + rx_bytes) * 10.0 / ST_BAUD + (double)turnarounds * TURNAROUND_S +
+                             (double)flash_erased_pages * PAGE_ERASE_S + (double)IMAGE_SIZE * FLASH_WRITE_S_PER_BYTE;
+    const size_t ST_LINE_BYTES = tx_bytes + rx_bytes;
+    const size_t ST_TURNAROUNDS = turnarounds;
+    const size_t ST_ERASED_PAGES = flash_erased_pages;
+
+    /* Extended transfer */
+    std::fill(flash.begin(), flash.end(), 0x00);
+    flash_erased_pages = 0;
+    tx_bytes = 0;
+    rx_bytes = 0;
+    turnarounds = 0;
+
+    exchange({ STM32_BOOTLOADER_CMD_EXT_SET_BAUD, 0x4E });
+    exchange(with_xor({ (uint8_t)(EXT_BAUD >> 24), (uint8_t)(EXT_BAUD >> 16), (uint8_t)(EXT_BAUD >> 8),
+                        (uint8_t)EXT_BAUD }));
+    CHECK_EQUAL(EXT_BAUD, serial_baud);
+    exchange({ STM32_BOOTLOADER_CMD_EXT_WRITE_STREAM, 0x4D });
+
+    double time_s = (double)(tx_bytes + rx_bytes) * 10.0 / ST_BAUD + (double)turnarounds * TURNAROUND_S;
+    const double BYTE_S = 10.0 / EXT_BAUD;
+
+    /* Event model: a block waits for a free window slot, the device handles blocks one by one */
+    std::vector<double> ack_time_s;
+    double line_free_s = time_s;
+    double device_free_s = time_s;
+    uint8_t seq = 0;
+
+    for (size_t offset = 0; offset <= image.size(); offset += BLOCK_SIZE) {
+        size_t size = std::min(BLOCK_SIZE, image.size() - offset);
+        size_t addr = (size == 0) ? 0 : FLASH_BASE_ADDR + offset;
+        std::vector<uint8_t> frame = make_frame(seq, addr, image.data() + offset, size);
+
+        size_t erased_before = flash_erased_pages;
+        response.clear();
+        send(frame);
+        rx_bytes += response.size();
+        CHECK(is_response({ STM32_BOOTLOADER_ACK, seq }));
+
+        double start_s = line_free_s;
+        if (ack_time_s.size() >= STM32_BOOTLOADER_EXT_WINDOW) {
+            start_s = std::max(start_s, ack_time_s[ack_time_s.size() - STM32_BOOTLOADER_EXT_WINDOW]);
+        }
+        line_free_s = start_s + (double)frame.size() * BYTE_S;
+
+        device_free_s = std::max(device_free_s, line_free_s) +
+                        (double)(flash_erased_pages - erased_before) * PAGE_ERASE_S +
+                        (double)size * FLASH_WRITE_S_PER_BYTE;
+        ack_time_s.push_back(device_free_s + TURNAROUND_S + 2.0 * BYTE_S);
+        seq++;
+
+        if (size == 0) {
+            break;
+        }
+    }
+
+    const double EXT_TIME_S = ack_time_s.back();
+
+    CHECK(is_flash_equal(image));
+    CHECK_EQUAL(0, flash_not_erased_writes);
+    CHECK_EQUAL(IMAGE_SIZE / FLASH_PAGE_SIZE, flash_erased_pages);
+
+    printf("\nST:  %6zu line bytes, %4zu turnarounds, %3zu pages erased, %6.2f s, %6.2f KB/s",
+           ST_LINE_BYTES,
+           ST_TURNAROUNDS,
+           ST_ERASED_PAGES,
+           ST_TIME_S,
+           (double)IMAGE_SIZE / 1024.0 / ST_TIME_S);
+    printf("\nEXT: %6zu line bytes, %4zu turnarounds, %3zu pages erased, %6.2f s, %6.2f KB/s, line use %.0f%%\n",
+           tx_bytes + rx_bytes,
+           turnarounds + 1,
+           flash_erased_pages,
+           EXT_TIME_S,
+           (double)IMAGE_SIZE / 1024.0 / EXT_TIME_S,
+           100.0 * (double)IMAGE_SIZE * BYTE_S / EXT_TIME_S);
+
+    CHECK(EXT_TIME_S * 4 < ST_TIME_S);
+}
@@ -0,0 +1,143 @@
+#include "CppUTest/TestHarness.h"
+
+#include <string.h>
+#include <track_codec.h>
+
+#define COORD_TOLERANCE (0.0000005)
+
+static const track_status_t STATUS = {
+    .vbat = 11,
+    .quality = 3U | (1U << TRACK_CODEC_QUALITY_HDOP_POS),
+};
+
+/* Newest first, five minutes apart */
+static track_fix_t _make_fix(size_t index, double step) {
+    track_fix_t fix = {
+        .lat = 50.4501 - step * (double)index,
+        .lon = 30.5234 + step * (double)index,
+        .time_s = (uint32_t)(800000000UL - 300U * index),
+        .alt = (uint16_t)(180U + index),
+        .speed_mps = 3,
+    };
+    return fix;
+}
+
+TEST_GROUP(track_codec_test){};
+
+TEST(track_codec_test, single_fix) {
+    track_fix_t fix = _make_fix(0, 0);
+    uint8_t payload[64];
+    size_t encoded = 0;
+
+    CHECK_EQUAL(TRACK_CODEC_BASE_SIZE, track_codec_encode(payload, sizeof(payload), &STATUS, &fix, 1, &encoded));
+    CHECK_EQUAL(1, encoded);
+
+    const uint8_t EXPECTED[TRACK_CODEC_BASE_SIZE] = {
+        0x10, 0xB7, 0x2F, 0xAF, 0x08, 0x00, 0x03, 0x01, 0xCE, 0xB4, 0x01, 0xD1, 0xC0, 0x08, 0x00, 0xB4, 0x03,
+    };
+    MEMCMP_EQUAL(EXPECTED, payload, sizeof(EXPECTED));
+}
+
+TEST(track_codec_test, round_trip) {
+    track_fix_t fixes[TRACK_CODEC_MAX_FIXES];
+    for (size_t i = 0; i < TRACK_CODEC_MAX_FIXES; i++) {
+        fixes[i] = _make_fix(i, 0.0007);
+    }
+
+    uint8_t payload[242];
+    size_t encoded = 0;
+    size_t size = track_codec_encode(payload, sizeof(payload), &STATUS, fixes, TRACK_CODEC_MAX_FIXES, &encoded);
+    CHECK_EQUAL(TRACK_CODEC_MAX_FIXES, encoded);
+
+    track_status_t status;
+    track_fix_t decoded[TRACK_CODEC_MAX_FIXES];
+    CHECK_EQUAL(TRACK_CODEC_MAX_FIXES, track_codec_decode(payload, size, &status, decoded, TRACK_CODEC_MAX_FIXES));
+    CHECK_EQUAL(STATUS.vbat, status.vbat);
+    CHECK_EQUAL(STATUS.quality, status.quality);
+    CHECK_EQUAL(fixes[0].speed_mps, decoded[0].speed_mps);
+
+    for (size_t i = 0; i < TRACK_CODEC_MAX_FIXES; i++) {
+        DOUBLES_EQUAL(fixes[i].lat, decoded[i].lat, COORD_TOLERANCE);
+        DOUBLES_EQUAL(fixes[i].lon, decoded[i].lon, COORD_TOLERANCE);
+        CHECK_EQUAL(fixes[i].time_s, decoded[i].time_s);
+        CHECK_EQUAL(fixes[i].alt, decoded[i].alt);
+    }
+
+    /* Cayenne LPP takes 11 bytes per fix, the walking speed deltas take 7 */
+    CHECK_EQUAL(TRACK_CODEC_BASE_SIZE + 7U * (TRACK_CODEC_MAX_FIXES - 1U), size);
+}
+
+TEST(track_codec_test, fits_max_payload) {
+    track_fix_t fixes[TRACK_CODEC_MAX_FIXES];
+    for (size_t i = 0; i < TRACK_CODEC_MAX_FIXES; i++) {
+        fixes[i] = _make_fix(i, 0.01);
+    }
+
+    /* Maximal payload of EU868 DR0 */
+    uint8_t payload[51];
+    size_t encoded = 0;
+    size_t size = track_codec_encode(payload, sizeof(payload), &STATUS, fixes, TRACK_CODEC_MAX_FIXES, &encoded);
+
+    CHECK_TRUE(size <= sizeof(payload));
+    CHECK_TRUE(encoded > 1U);
+    CHECK_TRUE(encoded < TRACK_CODEC_MAX_FIXES);
+
+    track_status_t status;
+    track_fix_t decoded[TRACK_CODEC_MAX_FIXES];
+    CHECK_EQUAL(encoded, track_codec_decode(payload, size, &status, decoded, TRACK_CODEC_MAX_FIXES));
+    DOUBLES_EQUAL(fixes[encoded - 1U].lat, decoded[encoded - 1U].lat, COORD_TOLERANCE);
+
+    /* US915 DR0 has no room even for the newest fix */
+    CHECK_EQUAL(0, track_codec_encode(payload, 11U, &STATUS, fixes, TRACK_CODEC_MAX_FIXES, &encoded));
+    CHECK_EQUAL(0, encoded);
+}
+
+TEST(track_codec_test, large_and_negative_deltas) {
+    track_fix_t fixes[3] = {
+        { .lat = -33.8688, .lon = 151.2093, .time_s = 1000, .alt = 10, .speed_mps = 0 },
+        { .lat = 51.5072, .lon = -0.1276, .time_s = 2000, .alt = 30000, .speed_mps = 0 },
+        { .lat = -89.999999, .lon = 179.999999, .time_s = 0, .alt = 0, .speed_mps = 0 },
+    };
+
+    uint8_t payload[64];
+    size_t encoded = 0;
+    size_t size = track_codec_encode(payload, sizeof(payload), &STATUS, fixes, 3, &encoded);
+    CHECK_EQUAL(3, encoded);
+
+    track_status_t status;
+    track_fix_t decoded[3];
+    CHECK_EQUAL(3, track_codec_decode(payload, size, &status, decoded, 3));
+
+    for (size_t i = 0; i < 3; i++) {
+        DOUBLES_EQUAL(fixes[i].lat, decoded[i].lat, COORD_TOLERANCE);
+        DOUBLES_EQUAL(fixes[i].lon, decoded[i].lon, COORD_TOLERANCE);
+        CHECK_EQUAL(fixes[i].time_s, decoded[i].time_s);
+        CHECK_EQUAL(fixes[i].alt, decoded[i].alt);
+    }
+}
+
+TEST(track_codec_test, malformed_payload) {
+    track_fix_t fixes[2] = { _make_fix(0, 0.001), _make_fix(1, 0.001) };
+    uint8_t payload[64];
+    size_t encoded = 0;
+    size_t size = track_codec_encode(payload, sizeof(payload), &STATUS, fixes, 2, &encoded);
+
+    track_status_t status;
+    track_fix_t decoded[2];
+    CHECK_EQUAL(0, track_codec_decode(payload, size - 1U, &status, decoded, 2));
+    CHECK_EQUAL(0, track_codec_decode(payload, size, &status, decoded, 1));
+
+    payload[0] ^= 0x30U;
+    CHECK_EQUAL(0, track_codec_decode(payload, size, &status, decoded, 2));
+}
+
+TEST(track_codec_test, time_and_quality) {
+    CHECK_EQUAL(0, track_codec_get_time_s(0, 1, 1, 0, 0, 0));
+    CHECK_EQUAL(0, track_codec_get_time_s(24, 13, 1, 0, 0, 0));
+    /* 2024-03-01 12:34:56 UTC is 1709296496 of the Unix time, 946684800 is 2000-01-01 */
+    CHECK_EQUAL(1709296496UL - 946684800UL, track_codec_get_time_s(24, 3, 1, 12, 34, 56));
+
+    CHECK_EQUAL(3U, track_codec_get_quality(3, 0.8f));
+    CHECK_EQUAL(2U | (2U << TRACK_CODEC_QUALITY_HDOP_POS), track_codec_get_quality(2, 4.9f));
+    CHECK_EQUAL(0U | (3U << TRACK_CODEC_QUALITY_HDOP_POS), track_codec_get_quality(0, 99.9f));
+}
@@ -1,10 +1,13 @@
 #include "CppUTest/CommandLineTestRunner.h"
 
 #include <bsp.h>
+#include <crc16.h>
 
 #include "log_io.h"
 
 int main(int ac, char **av) {
+    crc16_generate_table();
+
 #if LOG_ENABLED == 1U
     log_init(LOG_MASK_ALL, &LOG_IO_INTERFACE);
     log_set_output_mask(LOG_MASK_OFF);
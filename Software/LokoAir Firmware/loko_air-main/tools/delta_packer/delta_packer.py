@@ -0,0 +1,152 @@
+import argparse
+import os
+import struct
+
+# LKD1 patch, see Core/delta_patch/delta_patch.h
+MAGIC = 0x31444B4C
+HEADER_SIZE = 32
+FLAG_DESCENDING = 0x01
+OP_COPY = 0x01
+OP_INSERT = 0x02
+COPY_OP_SIZE = 7
+INSERT_OP_SIZE = 3
+COPY_MIN = 8  # Shorter matches are cheaper as an insert
+SIZE_MAX = 0xFFFF
+KEY_SIZE = 4
+CHAIN_LIMIT = 64
+PAGE_SIZE = 2048
+
+# Name : CRC-16/CCITT
+# Poly : 0x1021
+# Init : 0xFFFF
+# Check: 0x29B1 ("123456789")
+
+
+def crc16(array):
+    crc = 0xFFFF
+    for i in array:
+        crc ^= i << 8
+        for j in range(8):
+            if crc & 0x8000:
+                crc = (((crc << 1) & 0xFFFF) ^ 0x1021)
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+
+def make_index(old):
+    index = {}
+    for i in range(len(old) - KEY_SIZE + 1):
+        index.setdefault(old[i:i + KEY_SIZE], []).append(i)
+    return index
+
+
+def get_copy_limit(src, page_start, page_end, new_end, is_descending):
+    """Copy size allowed from src, the pages rebuilt before must not be read"""
+    if is_descending:
+        if src >= new_end:
+            return SIZE_MAX
+        return max(page_end - src, 0)
+    return SIZE_MAX if src >= page_start else 0
+
+
+def find_copy(old, new, pos, page_start, page_end, new_end, is_descending, index):
+    best_len = 0
+    best_src = 0
+    max_len = min(page_end, len(new)) - pos
+
+    # Unchanged data at the same place is the most common case
+    candidates = [pos] + index.get(new[pos:pos + KEY_SIZE], [])[:CHAIN_LIMIT]
+
+    for src in candidates:
+        limit = min(max_len, len(old) - src, get_copy_limit(src, page_start, page_end, new_end, is_descending))
+        length = 0
+        while length < limit and old[src + length] == new[pos + length]:
+            length += 1
+        if length > best_len:
+            best_len = length
+            best_src = src
+            if length == max_len:
+                break
+
+    return best_len, best_src
+
+
+def make_body(old, new, page_size, is_descending):
+    page_count = (len(new) + page_size - 1) // page_size
+    new_end = page_count * page_size
+    index = make_index(old)
+    pages = range(page_count - 1, -1, -1) if is_descending else range(page_count)
+    body = bytearray()
+
+    for page in pages:
+        page_start = page * page_size
+        page_end = min(page_start + page_size, len(new))
+        pos = page_start
+        literal = bytearray()
+
+        def flush():
+            if literal:
+                body.extend(struct.pack('<BH', OP_INSERT, len(literal)) + literal)
+                literal.clear()
+
+        while pos < page_end:
+            length, src = find_copy(old, new, pos, page_start, page_start + page_size, new_end, is_descending, index)
+            if length >= COPY_MIN:
+                flush()
+                body.extend(struct.pack('<BIH', OP_COPY, src, length))
+                pos += length
+            else:
+                literal.append(new[pos])
+                pos += 1
+        flush()
+
+    return bytes(body)
+
+
+def make_patch(old, new, page_size=PAGE_SIZE):
+    patches = []
+
+    for flags in (0, FLAG_DESCENDING):
+        body = make_body(old, new, page_size, flags & FLAG_DESCENDING)
+        header = struct.pack('<IIIIIIHHH', MAGIC, flags, page_size, len(old), len(new), len(body),
+                             crc16(old), crc16(new), crc16(body))
+        header += struct.pack('<H', crc16(header))
+        patches.append(header + body)
+
+    return min(patches, key=len)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Make an LKD1 delta patch from the installed to the new image')
+    parser.add_argument('-s', '--old_file', help='installed image file')
+    parser.add_argument('-i', '--input_file', help='new image file')
+    parser.add_argument('-o', '--output_file', help='output patch file, input_file.lkd by default')
+    parser.add_argument('-p', '--page_size', type=int, default=PAGE_SIZE, help='flash page size')
+    args = parser.parse_args()
+
+    if args.old_file is None or args.input_file is None:
+        print('Error,  Old or input file is not set')
+        exit(-2)
+
+    output_file = args.output_file
+    if output_file is None:
+        output_file = os.path.splitext(args.input_file)[0] + '.lkd'
+
+    with open(args.old_file, 'rb') as read_stream:
+        old = read_stream.read()
+
+    with open(args.input_file, 'rb') as read_stream:
+        new = read_stream.read()
+
+    patch = make_patch(old, new, args.page_size)
+
+    with open(output_file, 'wb') as write_stream:
+        write_stream.write(patch)
+
+    print('Image: {} bytes, patch: {} bytes ({:.1f}%), {}'.format(
+        len(new), len(patch), 100.0 * len(patch) / max(len(new), 1), output_file))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,121 @@
+import argparse
+import os
+import struct
+
+# LKZ1 container, see Core/lz_image/lz_image.h
+MAGIC = 0x315A4B4C
+WINDOW_SIZE = 2048
+MATCH_MIN = 3
+MATCH_MAX = MATCH_MIN + 31
+CHAIN_LIMIT = 256
+
+# Name : CRC-16/CCITT
+# Poly : 0x1021
+# Init : 0xFFFF
+# Check: 0x29B1 ("123456789")
+
+
+def crc16(array):
+    crc = 0xFFFF
+    for i in array:
+        crc ^= i << 8
+        for j in range(8):
+            if crc & 0x8000:
+                crc = (((crc << 1) & 0xFFFF) ^ 0x1021)
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+
+def find_match(data, pos, chains):
+    best_len = 0
+    best_offset = 0
+    key = data[pos:pos + MATCH_MIN]
+    max_len = min(MATCH_MAX, len(data) - pos)
+
+    for candidate in reversed(chains.get(key, [])[-CHAIN_LIMIT:]):
+        offset = pos - candidate
+        if offset > WINDOW_SIZE:
+            break
+        length = MATCH_MIN
+        while length < max_len and data[candidate + length] == data[pos + length]:
+            length += 1
+        if length > best_len:
+            best_len = length
+            best_offset = offset
+            if length == max_len:
+                break
+
+    return best_len, best_offset
+
+
+def compress(data):
+    out = bytearray()
+    chains = {}
+    pos = 0
+
+    while pos < len(data):
+        flags_pos = len(out)
+        out.append(0)
+        flags = 0
+
+        for bit in range(8):
+            if pos >= len(data):
+                break
+
+            length, offset = (0, 0)
+            if pos + MATCH_MIN <= len(data):
+                length, offset = find_match(data, pos, chains)
+
+            if length >= MATCH_MIN:
+                token = ((offset - 1) << 5) | (length - MATCH_MIN)
+                out += token.to_bytes(2, byteorder='big')
+            else:
+                flags |= 1 << bit
+                out.append(data[pos])
+                length = 1
+
+            for i in range(pos, pos + length):
+                chains.setdefault(bytes(data[i:i + MATCH_MIN]), []).append(i)
+            pos += length
+
+        out[flags_pos] = flags
+
+    return bytes(out)
+
+
+def pack(data):
+    payload = compress(data)
+    header = struct.pack('<IIIH', MAGIC, len(data), len(payload), crc16(data))
+    header += struct.pack('<H', crc16(header))
+    return header + payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack an application image into the LKZ1 container')
+    parser.add_argument('-i', '--input_file', help='input image file')
+    parser.add_argument('-o', '--output_file', help='output container file, input_file.lkz by default')
+    args = parser.parse_args()
+
+    if args.input_file is None:
+        print('Error,  Input file is not set')
+        exit(-2)
+
+    output_file = args.output_file
+    if output_file is None:
+        output_file = os.path.splitext(args.input_file)[0] + '.lkz'
+
+    with open(args.input_file, 'rb') as read_stream:
+        data = read_stream.read()
+
+    container = pack(data)
+
+    with open(output_file, 'wb') as write_stream:
+        write_stream.write(container)
+
+    print('Image: {} bytes, container: {} bytes ({:.1f}%), {}'.format(
+        len(data), len(container), 100.0 * len(container) / max(len(data), 1), output_file))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,185 @@
+import argparse
+import re
+import struct
+import sys
+
+# Prints the binary log (LOG_BINARY_ENABLED in Core/Inc/log_conf.h) as text. The other output of the debug UART,
+# like the command line answers, is passed through.
+#
+# usage example:
+# python log-decoder.py --formats build/loko_app.log_fmt.bin --port COM3
+# python log-decoder.py --formats build/loko_app.log_fmt.bin --input capture.bin
+
+LOG_BINARY_SYNC = 0xA5
+LOG_BINARY_HEADER_SIZE = 10
+KIND_MESSAGE = 0
+KIND_ARRAY = 1
+KIND_DROPPED = 2
+
+LEVELS = {0x01: 'I', 0x02: 'W', 0x04: 'E', 0x08: 'D'}
+
+SPEC = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diuxXocpfFeEgGaAs%])')
+
+
+def load_formats(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def get_format(formats, message_id):
+    end = formats.find(b'\0', message_id)
+    if message_id >= len(formats) or end < 0:
+        return None
+    return formats[message_id:end].decode('utf-8', errors='replace')
+
+
+class Args:
+    def __init__(self, data):
+        self.data = data
+        self.index = 0
+
+    def take(self, size):
+        if self.index + size > len(self.data):
+            raise IndexError
+        value = self.data[self.index:self.index + size]
+        self.index += size
+        return value
+
+    def int32(self, signed):
+        return struct.unpack('<i' if signed else '<I', self.take(4))[0]
+
+    def int64(self, signed):
+        return struct.unpack('<q' if signed else '<Q', self.take(8))[0]
+
+    def double(self):
+        return struct.unpack('<d', self.take(8))[0]
+
+    def string(self):
+        end = self.data.find(b'\0', self.index)
+        if end < 0:
+            raise IndexError
+        value = self.data[self.index:end].decode('utf-8', errors='replace')
+        self.index = end + 1
+        return value
+
+
+# Same walk as _pack_args() in Core/log_/log_.c, every conversion is formatted by python
+def format_message(fmt, data):
+    args = Args(data)
+    out = []
+    last = 0
+
+    for spec in SPEC.finditer(fmt):
+        out.append(fmt[last:spec.start()])
+        last = spec.end()
+        flags, width, precision, length, conversion = spec.groups()
+
+        if conversion == '%':
+            out.append('%')
+            continue
+
+        try:
+            if width == '*':
+                width = str(args.int32(True))
+            if precision == '*':
+                precision = str(args.int32(True))
+
+            py_spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+            signed = conversion in 'di'
+
+            if conversion in 'diuxXoc':
+                value = args.int64(signed) if length in ('ll', 'j') else args.int32(signed)
+                if length == 'hh':
+                    value &= 0xFF
+                elif length == 'h':
+                    value &= 0xFFFF
+                out.append((py_spec + ('d' if conversion in 'iu' else conversion)) % value)
+            elif conversion == 'p':
+                out.append('0x%08x' % args.int32(False))
+            elif conversion in 'aA':
+                out.append(float.hex(args.double()))
+            elif conversion in 'fFeEgG':
+                out.append((py_spec + conversion) % args.double())
+            else:
+                out.append((py_spec + 's') % args.string())
+        except IndexError:
+            out.append('<?>')
+
+    out.append(fmt[last:])
+    return ''.join(out)
+
+
+def decode_frame(formats, frame):
+    message_id, ts, level, kind = struct.unpack('<HIBB', frame[:8])
+    data = frame[8:]
+    prefix = '[%04d.%03d] %s ' % (ts // 1000, ts % 1000, LEVELS.get(level, '%02X' % level))
+
+    if kind == KIND_DROPPED:
+        return prefix + '%d messages dropped, the log ring was full' % struct.unpack('<I', data[:4])[0]
+
+    fmt = get_format(formats, message_id)
+    if fmt is None:
+        return prefix + 'unknown message id %d, is the format table of this build?' % message_id
+
+    if kind == KIND_ARRAY:
+        size = struct.unpack('<H', data[:2])[0]
+        hex_bytes = ' '.join('%02X' % b for b in data[2:])
+        return prefix + '%s[%d]: %s%s' % (fmt, size, hex_bytes, ' ...' if size > len(data) - 2 else '')
+
+    return prefix + format_message(fmt, data)
+
+
+def decode_stream(formats, chunks, write):
+    buffer = bytearray()
+
+    for chunk in chunks:
+        buffer += chunk
+
+        while buffer:
+            sync = buffer.find(LOG_BINARY_SYNC)
+            if sync < 0:
+                write(buffer.decode('utf-8', errors='replace'))
+                buffer.clear()
+                break
+            if sync > 0:
+                write(buffer[:sync].decode('utf-8', errors='replace'))
+                del buffer[:sync]
+            if len(buffer) < 2 or len(buffer) < buffer[1] + 3:
+                break
+
+            length = buffer[1]
+            frame = buffer[2:2 + length]
+            if length >= LOG_BINARY_HEADER_SIZE - 2 and (sum(buffer[1:2 + length]) & 0xFF) == buffer[2 + length]:
+                write(decode_frame(formats, bytes(frame)) + '\n')
+                del buffer[:3 + length]
+            else:
+                # Not a frame, the byte is passed through like the other output
+                write(buffer[:1].decode('utf-8', errors='replace'))
+                del buffer[:1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Loko binary log decoder')
+    parser.add_argument('--formats', required=True, help='<target>.log_fmt.bin created by the build')
+    parser.add_argument('--port', help='Debug UART serial port')
+    parser.add_argument('--baudrate', type=int, default=115200)
+    parser.add_argument('--input', help='Captured UART output, stdin when neither port nor input is set')
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baudrate, timeout=0.1) as port:
+            decode_stream(formats, iter(lambda: port.read(256), None), write)
+    else:
+        with open(args.input, 'rb') if args.input else sys.stdin.buffer as f:
+            decode_stream(formats, iter(lambda: f.read(4096), b''), write)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,97 @@
+// Payload formatter of the compact LoRaWAN track uplink (Core/track_codec), FPort 4.
+// decodeUplink() is the entry point of The Things Stack and ChirpStack v4 payload codecs.
+
+var TRACK_PORT = 4;
+var TRACK_VERSION = 1;
+var BASE_SIZE = 17;
+var COORD_SCALE = 1000000;
+var EPOCH_2000_MS = Date.UTC(2000, 0, 1);
+var HDOP_CLASSES = ["<1", "<2", "<5", ">=5"];
+
+function readInt32BE(bytes, index) {
+  return (bytes[index] << 24) | (bytes[index + 1] << 16) | (bytes[index + 2] << 8) | bytes[index + 3];
+}
+
+// Zigzag varint, 7 bits per byte starting from the least significant ones
+function readVarint(bytes, state) {
+  var value = 0;
+  for (var shift = 0; shift < 35; shift += 7) {
+    if (state.index >= bytes.length) {
+      return null;
+    }
+    var byte = bytes[state.index++];
+    value += (byte & 0x7f) * Math.pow(2, shift);
+    if ((byte & 0x80) === 0) {
+      return value % 2 === 0 ? value / 2 : -(value + 1) / 2;
+    }
+  }
+  return null;
+}
+
+function toTime(seconds) {
+  return seconds === 0 ? null : new Date(EPOCH_2000_MS + seconds * 1000).toISOString();
+}
+
+function decodeTrack(bytes) {
+  if (bytes.length < BASE_SIZE || bytes[0] >> 4 !== TRACK_VERSION) {
+    return { errors: ["not a track payload of version " + TRACK_VERSION] };
+  }
+
+  var count = (bytes[0] & 0x0f) + 1;
+  var quality = bytes[1] & 0x0f;
+  var fix = {
+    time: readInt32BE(bytes, 2) >>> 0,
+    lat: readInt32BE(bytes, 6),
+    lon: readInt32BE(bytes, 10),
+    alt: (bytes[14] << 8) | bytes[15],
+  };
+  var fixes = [];
+  var state = { index: BASE_SIZE };
+
+  for (var i = 0; i < count; i++) {
+    if (i > 0) {
+      var delta = [readVarint(bytes, state), readVarint(bytes, state), readVarint(bytes, state), readVarint(bytes, state)];
+      if (delta.indexOf(null) >= 0) {
+        return { errors: ["truncated fix " + i] };
+      }
+      fix = {
+        time: fix.time - delta[0],
+        lat: fix.lat - delta[1],
+        lon: fix.lon - delta[2],
+        alt: fix.alt - delta[3],
+      };
+    }
+
+    fixes.push({
+      time: toTime(fix.time),
+      latitude: fix.lat / COORD_SCALE,
+      longitude: fix.lon / COORD_SCALE,
+      altitude: fix.alt,
+      speed_mps: i === 0 ? bytes[16] : null,
+    });
+  }
+
+  if (state.index !== bytes.length) {
+    return { errors: ["unexpected trailing bytes"] };
+  }
+
+  return {
+    data: {
+      battery_v: ((bytes[1] >> 4) + 27) / 10,
+      fix_mode: quality & 0x03,
+      hdop: HDOP_CLASSES[quality >> 2],
+      fixes: fixes,
+    },
+  };
+}
+
+function decodeUplink(input) {
+  if (input.fPort !== TRACK_PORT) {
+    return { errors: ["unknown FPort " + input.fPort] };
+  }
+  return decodeTrack(input.bytes);
+}
+
+if (typeof module !== "undefined") {
+  module.exports = { decodeUplink: decodeUplink };
+}
@@ -1,11 +1,17 @@
 
 import base64
+import hmac
 import struct
 
 #pip install cryptography
 from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+from cryptography.hazmat.primitives.cmac import CMAC
 from cryptography.hazmat.backends import default_backend
-from Crypto.Cipher import AES
+
+PACKET_VERSION_AUTHENTICATED = 6
+AUTHENTICATED_HEADER_SIZE = 13  # id1, id2, version, counter
+AUTHENTICATED_RECORD_SIZE = 12
+AUTHENTICATED_MAC_SIZE = 4
 
 def unpack_lat_lon(packed_data):
     # Extract and convert 3 bytes for latitude to a signed 24-bit integer
@@ -18,9 +24,60 @@ def unpack_lat_lon(packed_data):
 
     return lat_lon
 
+def unpack_lat_lon_32(packed_data):
+    # Big endian signed 32-bit integer, degrees * 1000000
+    return struct.unpack('>i', packed_data)[0] / 1000000.0
+
 def bin_unpack_vbat(vbat):
     return (vbat + 27) * 0.1
 
+def aes_ecb_encrypt(key, block):
+    encryptor = Cipher(algorithms.AES(key), modes.ECB(), backend=default_backend()).encryptor()
+    return encryptor.update(block) + encryptor.finalize()
+
+def derive_mac_key(key):
+    # Must match _MAC_KEY_DERIVATION_BLOCK in Core/encrypt_p2p_payload
+    return aes_ecb_encrypt(key, bytes([0xFF]) + b'LOKO-MAC' + bytes(7))
+
+def ctr_decrypt(key, id1, id2, counter, data):
+    # Counter block: domain, id1, id2, counter (little endian), zero, block index (big endian)
+    initial_block = struct.pack('<BIIIB', 0x01, id1, id2, counter, 0) + bytes(2)
+    decryptor = Cipher(algorithms.AES(key), modes.CTR(initial_block), backend=default_backend()).decryptor()
+    return decryptor.update(data) + decryptor.finalize()
+
+def is_mac_valid(key, data, mac):
+    cmac = CMAC(algorithms.AES(derive_mac_key(key)), backend=default_backend())
+    cmac.update(data)
+    return hmac.compare_digest(cmac.finalize()[:AUTHENTICATED_MAC_SIZE], mac)
+
+def parse_loko_authenticated_packet(data, key, last_counter=None):
+    id1, id2, reserved_version, counter = struct.unpack('<IIBI', data[:AUTHENTICATED_HEADER_SIZE])
+    mac = data[-AUTHENTICATED_MAC_SIZE:]
+
+    if not is_mac_valid(key, data[:-AUTHENTICATED_MAC_SIZE], mac):
+        print('Wrong MAC, possible wrong key or corrupted packet')
+        return None
+
+    # Receiver should keep the last counter per device to reject replayed packets
+    if last_counter is not None and counter <= last_counter:
+        print('Replayed packet, counter {} <= {}'.format(counter, last_counter))
+        return None
+
+    records = ctr_decrypt(key, id1, id2, counter, data[AUTHENTICATED_HEADER_SIZE:-AUTHENTICATED_MAC_SIZE])
+    fixes = []
+    for offset in range(0, len(records), AUTHENTICATED_RECORD_SIZE):
+        vb_reserved, lat_32bit, lon_32bit, speed_mps, alt_meters = struct.unpack(
+            '<B4s4sBH', records[offset:offset + AUTHENTICATED_RECORD_SIZE])
+        fixes.append({'lat': unpack_lat_lon_32(lat_32bit), 'lon': unpack_lat_lon_32(lon_32bit),
+                      'vbat': bin_unpack_vbat(vb_reserved & 0x0F), 'alt': alt_meters, 'mps': speed_mps})
+
+    return {'id1': id1, 'id2': id2, 'version': (reserved_version >> 4) & 0x0F, 'counter': counter, 'records': fixes}
+
+def is_authenticated_packet(data):
+    return (len(data) >= AUTHENTICATED_HEADER_SIZE + AUTHENTICATED_RECORD_SIZE + AUTHENTICATED_MAC_SIZE
+            and (len(data) - AUTHENTICATED_HEADER_SIZE - AUTHENTICATED_MAC_SIZE) % AUTHENTICATED_RECORD_SIZE == 0
+            and ((data[8] >> 4) & 0x0F) == PACKET_VERSION_AUTHENTICATED)
+
 
 def parse_loko_bin_packet(bin_data, key):
     id1 = 0
@@ -32,7 +89,9 @@ def parse_loko_bin_packet(bin_data, key):
     alt_meters = 0
     speed_mps = 0
     data = bytes.fromhex(bin_data)
-    if len(data) == 15:
+    if is_authenticated_packet(data):
+        return parse_loko_authenticated_packet(data, key)
+    elif len(data) == 15:
         id1, id2, vb_version, lat_24bit, lon_24bit= struct.unpack("<II B 3s 3s", data)
         packet_version = (vb_version >> 4) & 0x0F
         vbat_mv = bin_unpack_vbat(vb_version & 0x0F)
@@ -49,10 +108,9 @@ def parse_loko_bin_packet(bin_data, key):
         packet_version = (vb_version >> 4) & 0x0F
         encrypted_bytes = bytes(aes_payload)
 
-        # Initialize the AES cipher in ECB mode
-        cipher = aes(key, 1)  # 1 for ECB mode
-        # cipher = AES.new(key, AES.MODE_ECB)
-        decrypted_bytes = cipher.decrypt(encrypted_bytes)
+        # Single block in ECB mode
+        decryptor = Cipher(algorithms.AES(key), modes.ECB(), backend=default_backend()).decryptor()
+        decrypted_bytes = decryptor.update(encrypted_bytes) + decryptor.finalize()
         checksum = sum(decrypted_bytes[:-1]) % 256
 
         (vb_version, lat_24bit, lon_24bit, speed_mps, alt_meters, reserved1,  integrity) = struct.unpack('<B3s3sBH5sB', decrypted_bytes)
@@ -69,6 +127,7 @@ def parse_loko_bin_packet(bin_data, key):
 enc_payload = "0000000000000000302C01694AAD3996B9831555F75B4251BC"
 p1_payload = "00000000000000001F05F1C206F672"
 extended_payload = "00000000000000001E08582403DB94027A00"
+authenticated_payload = "01000000020000006003000000A093077C6837F15054256B5AFA99295B"
 secret_p2p_key_hex  = "0000000000000000000000000000000000000000000000000000000000000000"
 # Convert hexadecimal key to bytes
 key = bytes.fromhex(secret_p2p_key_hex)
@@ -76,3 +135,4 @@ key = bytes.fromhex(secret_p2p_key_hex)
 print(parse_loko_bin_packet(enc_payload, key))
 print(parse_loko_bin_packet(p1_payload, key))
 print(parse_loko_bin_packet(extended_payload, key))
+print(parse_loko_bin_packet(authenticated_payload, key))